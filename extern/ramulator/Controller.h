@@ -389,6 +389,29 @@ public:
         return true;
     }
 
+    // Ticks with nothing to do before the next refresh, assuming no request
+    // arrives meanwhile; 0 while any request is queued or in flight
+    long idle_ticks()
+    {
+        if (readq.size() || writeq.size() || otherq.size() || actq.size() ||
+            pending.size() || is_active())
+            return 0;
+        if (rowpolicy->type != RowPolicy<T>::Type::Opened &&
+            !rowtable->table.empty())
+            return 0;
+        return refresh->idle_ticks();
+    }
+
+    // Same effect as n tick() calls on an idle controller
+    void skip_idle_ticks(long n)
+    {
+        if (n == 0) return;
+        total_cycle += n;
+        clk += n;
+        refresh->skip_idle_ticks(n);
+        write_mode = true;  // an empty read queue selects write mode
+    }
+
     void tick()
     {
         total_cycle++;
@@ -14,6 +14,7 @@
 #include <functional>
 #include <cmath>
 #include <cassert>
+#include <climits>
 #include <tuple>
 #include <spdlog/fmt/ranges.h>
 #include <spdlog/spdlog.h>
@@ -35,6 +36,11 @@ public:
     virtual void tick() = 0;
     virtual bool send(Request req, int ch_num) = 0;
     virtual int pending_requests() = 0;
+    // Requests waiting in the read/write queues of one channel's controller
+    virtual int queued_requests(int ch_num) { return pending_requests(); }
+    // Idle ticks that skip_idle_ticks() can replace; 0 if it is unsupported
+    virtual long idle_ticks() { return 0; }
+    virtual void skip_idle_ticks(long n) {}
     virtual void finish(void) = 0;
     virtual long page_allocator(long addr, int coreid) = 0;
     virtual void record_core(int coreid) = 0;
@@ -383,6 +389,19 @@ public:
         ctrl->record_core(coreid);
       }
     }
+    long idle_ticks()
+    {
+        long ticks = LONG_MAX;
+        for (auto ctrl : ctrls) ticks = std::min(ticks, ctrl->idle_ticks());
+        return ticks;
+    }
+
+    void skip_idle_ticks(long n)
+    {
+        num_dram_cycles += n;
+        for (auto ctrl : ctrls) ctrl->skip_idle_ticks(n);
+    }
+
     void tick()
     {
         ++num_dram_cycles;
@@ -603,6 +622,11 @@ public:
         return reqs;
     }
 
+    int queued_requests(int ch_num)
+    {
+        return ctrls[ch_num]->readq.size() + ctrls[ch_num]->writeq.size();
+    }
+
     void set_high_writeq_watermark(const float watermark) {
         for (auto ctrl: ctrls)
             ctrl->set_high_writeq_watermark(watermark);
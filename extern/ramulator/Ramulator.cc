@@ -212,6 +212,20 @@ bool Ramulator::send(Request req, int ch_num) {
   return false;
 }
 
+uint64_t Ramulator::idle_ticks() {
+  if (is_active()) return 0;
+  for (int i = 0; i < channels; i++)
+    if (!unaccepted[i].empty()) return 0;
+  long ticks = memory->idle_ticks();
+  if (ticks <= 0) return 0;
+  return std::min<uint64_t>(ticks, log_interval - 1 - clk % log_interval);
+}
+
+void Ramulator::skip_idle_ticks(uint64_t n) {
+  memory->skip_idle_ticks(n);
+  clk += n;
+}
+
 bool Ramulator::is_active() {
   bool active = false;
 
@@ -227,6 +241,11 @@ void Ramulator::push(class mem_fetch* mf, int ch_num) {
   from_gpgpusim[ch_num]->push(mf);
 }
 
+int Ramulator::get_queue_occupancy(int ch_num) {
+  return from_gpgpusim[ch_num]->get_length() + unaccepted[ch_num].size() +
+         memory->queued_requests(ch_num);
+}
+
 bool Ramulator::returnq_full(int ch_num) const {
   return returnq[ch_num]->full();
 }
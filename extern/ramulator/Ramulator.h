@@ -39,6 +39,11 @@ class Ramulator {
   // check whether the read or write queue is available
   bool full(bool is_write) const;
   void cycle();
+  // cycle() calls that only advance counters: none while a request is in
+  // the wrapper or DRAM, otherwise up to the next refresh or bandwidth log
+  uint64_t idle_ticks();
+  // Same effect as n such cycle() calls
+  void skip_idle_ticks(uint64_t n);
 
   void finish();
   void print(FILE *fp = NULL);
@@ -53,6 +58,9 @@ class Ramulator {
 
   bool returnq_full(int ch_num) const;
   bool from_gpgpusim_full(int ch_num) {return from_gpgpusim[ch_num]->full();}
+  // Requests of a channel not yet scheduled by DRAM, including those the
+  // controller has not accepted yet
+  int get_queue_occupancy(int ch_num);
   bool send(NDPSim::Request req, int ch_num);
 
   virtual bool is_active();
@@ -17,6 +17,7 @@
 #define __REFRESH_H_
 
 #include <stddef.h>
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <vector>
@@ -84,6 +85,14 @@ public:
     }
   }
 
+  // tick_ref() calls before the one that schedules the next refresh
+  long idle_ticks() {
+    int refresh_interval = ctrl->channel->spec->speed_entry.nREFI;
+    return std::max(0L, refresh_interval - (clk - refreshed) - 1);
+  }
+
+  void skip_idle_ticks(long n) { clk += n; }
+
 private:
   // Keeping track of refresh status of every bank: + means ahead of schedule, - means behind schedule
   vector<vector<int>*> bank_refresh_backlog;
@@ -0,0 +1,40 @@
+#include "command_line_parser.h"
+#include "memory_map.h"
+#include <spdlog/spdlog.h>
+#include <spdlog/cfg/env.h>
+
+namespace po = boost::program_options;
+using namespace NDPSim;
+
+// Converts a text memory map (input or target) into a binary memory image
+// that PagedMemoryMap mmaps directly.
+int main(int argc, char** argv) {
+  spdlog::cfg::load_env_levels();
+  CommandLineParser cmd_parser = CommandLineParser();
+  cmd_parser.add_command_line_option<std::string>(
+      "input", "path for text memory map file");
+  cmd_parser.add_command_line_option<std::string>(
+      "output", "path for binary memory image");
+  try {
+    cmd_parser.parse(argc, argv);
+  } catch (const CommandLineParser::ParsingError& e) {
+    spdlog::error(
+        "Command line argument parrsing error captured. Error message: {}",
+        e.what());
+    throw(e);
+  }
+  std::string input_path;
+  std::string output_path;
+  cmd_parser.set_if_defined("input", &input_path);
+  cmd_parser.set_if_defined("output", &output_path);
+  if (input_path.empty() || output_path.empty()) {
+    spdlog::error("Usage: {} --input <text map> --output <image>", argv[0]);
+    return 1;
+  }
+
+  spdlog::info("Parsing memory map {}", input_path);
+  PagedMemoryMap memory_map(input_path);
+  if (!memory_map.SaveImage(output_path)) return 1;
+  spdlog::info("Memory image written to {}", output_path);
+  return 0;
+}
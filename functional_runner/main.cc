@@ -3,6 +3,7 @@
 #include "ndp_unit.h"
 #include "m2ndp_parser.h"
 #include "m2ndp_config.h"
+#include "ndp_worker_pool.h"
 #include <spdlog/spdlog.h>
 #include <spdlog/cfg/env.h>
 #include <fstream>
@@ -28,6 +29,8 @@ void functional_simulation(int argc, char** argv) {
   cmd_parser.add_command_line_option<std::string>("config",
                                                   "path for config file");
   cmd_parser.add_command_line_option<int>("option", "trace option");
+  cmd_parser.add_command_line_option<int>(
+      "num_threads", "number of host threads running NDP units in parallel");
   try {
     cmd_parser.parse(argc, argv);
   } catch (const CommandLineParser::ParsingError& e) {
@@ -42,6 +45,7 @@ void functional_simulation(int argc, char** argv) {
   std::string config_path;
   std::string launch_file_path;
   TraceOption trace_option = SINGLE;
+  int num_threads = 1;
 
   cmd_parser.set_if_defined("ndp_trace", &ndp_file_path);
   cmd_parser.set_if_defined("memory_map", &memory_map_path);
@@ -49,35 +53,59 @@ void functional_simulation(int argc, char** argv) {
   cmd_parser.set_if_defined("launch_file", &launch_file_path);
   cmd_parser.set_if_defined("config", &config_path);
   cmd_parser.set_if_defined("option", (int*)&trace_option);
+  cmd_parser.set_if_defined("num_threads", &num_threads);
 
-  HashMemoryMap memory_map(memory_map_path);
+  PagedMemoryMap memory_map(memory_map_path);
+  // Units running in parallel share the global memory map through a lock.
+  // Kernel bodies of a launch run concurrently with their global stores and
+  // AMOs deferred; the writes are then applied and the finalizers run, both
+  // in unit id order, so results match the serial run for commutative
+  // updates and never depend on thread timing. Kernels that read AMO results
+  // run serially.
+  SynchronizedMemoryMap synchronized_map(&memory_map);
+  MemoryMap* unit_memory_map =
+      num_threads > 1 ? (MemoryMap*)&synchronized_map : &memory_map;
+  NdpWorkerPool worker_pool(std::max(num_threads, 1));
 
   if (trace_option == SINGLE) {
     // Initialize NDP fuctions, Memory map, NDP units
     spdlog::info("Running FuncSim in Single Kernel Mode..");
 
-    NdpKernel ndp_kernel;
     std::ifstream launch_file(launch_file_path);
     std::string line;
     
     std::vector<NdpUnit*> ndp_units;
     M2NDPConfig *config = new M2NDPConfig(config_path, 1);
     int num_ndp = config->get_num_ndp_units();
-    M2NDPParser::parse_ndp_kernel(num_ndp, ndp_file_path, &ndp_kernel, config);
+    const NdpKernel* ndp_kernel = KernelCache::get_kernel(ndp_file_path, config);
     if (config->get_use_synthetic_memory())
         memory_map.set_synthetic_memory(config->get_synthetic_base_address(),
                                         config->get_synthetic_memory_size());
     ndp_units.resize(num_ndp);
     for (int id = 0; id < num_ndp; id++) {
-      ndp_units[id] = new NdpUnit(config, &memory_map, id);
+      ndp_units[id] = new NdpUnit(config, unit_memory_map, id);
     }
 
+    bool parallel = num_threads > 1 && !ndp_kernel->amo_result_used;
+    if (num_threads > 1 && !parallel)
+      spdlog::warn("Kernel {} reads AMO results, num_threads is ignored",
+                   ndp_kernel->kernel_name);
     // // Run Functional simulation on NDP unit
     int iter = 0;
     while(std::getline(launch_file, line)) {
-      for (int id = 0; id < num_ndp; id++) {
-        spdlog::info("Iter {} NDP {} Run..", iter, id);
-        ndp_units[id]->Run(id, &ndp_kernel, line);
+      if (parallel) {
+        worker_pool.run(num_ndp, [&](int id) {
+          spdlog::info("Iter {} NDP {} Run..", iter, id);
+          ndp_units[id]->RunKernelBodies(ndp_kernel, line, true);
+        });
+        for (int id = 0; id < num_ndp; id++)
+          ndp_units[id]->commit_global_writes();
+        for (int id = 0; id < num_ndp; id++) ndp_units[id]->RunFinalizer();
+      } else {
+        for (int id = 0; id < num_ndp; id++) {
+          spdlog::info("Iter {} NDP {} Run..", iter, id);
+          ndp_units[id]->Run(id, ndp_kernel, line);
+        }
       }
       iter++;
     }
@@ -90,22 +118,38 @@ void functional_simulation(int argc, char** argv) {
     int num_ndp = config->get_num_ndp_units();
 
     LoopParser loop_parser(config, ndp_file_path);
-    std::vector<NdpKernel> *ndp_kernels = loop_parser.GetNDPKernels();
+    std::vector<const NdpKernel*> *ndp_kernels = loop_parser.GetNDPKernels();
     int num_kernel = loop_parser.GetNumKernel();
     int num_loop = loop_parser.GetNumLoop();
 
     ndp_units.resize(num_ndp);
     for (int id = 0; id < num_ndp; id++) {
-      ndp_units[id] = new NdpUnit(config, &memory_map, id);
+      ndp_units[id] = new NdpUnit(config, unit_memory_map, id);
     }
 
     for (int loop = 0; loop < num_loop; loop++) {
       spdlog::info("Loop {} Run..", loop);
       for (int kernel_id=0; kernel_id < num_kernel; kernel_id++) {
-        for (int id = 0; id < num_ndp; id++) {
-          spdlog::info("NDP {} Run Kernel {}", id, kernel_id);
-          ndp_units[id]->Run(id, &(*ndp_kernels)[kernel_id], launch_file_path);
-        }  
+        const NdpKernel* ndp_kernel = (*ndp_kernels)[kernel_id];
+        bool parallel = num_threads > 1 && !ndp_kernel->amo_result_used;
+        if (num_threads > 1 && !parallel && loop == 0)
+          spdlog::warn("Kernel {} reads AMO results, num_threads is ignored",
+                       ndp_kernel->kernel_name);
+        if (parallel) {
+          worker_pool.run(num_ndp, [&](int id) {
+            spdlog::info("NDP {} Run Kernel {}", id, kernel_id);
+            ndp_units[id]->RunKernelBodies((*ndp_kernels)[kernel_id],
+                                           launch_file_path, true);
+          });
+          for (int id = 0; id < num_ndp; id++)
+            ndp_units[id]->commit_global_writes();
+          for (int id = 0; id < num_ndp; id++) ndp_units[id]->RunFinalizer();
+        } else {
+          for (int id = 0; id < num_ndp; id++) {
+            spdlog::info("NDP {} Run Kernel {}", id, kernel_id);
+            ndp_units[id]->Run(id, (*ndp_kernels)[kernel_id], launch_file_path);
+          }
+        }
       }  
     }
   } 
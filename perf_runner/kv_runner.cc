@@ -1,9 +1,12 @@
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <string>
 
 #include "command_line_parser.h"
 #include "kv_runner.h"
+#include "stats_registry.h"
 
 namespace po = boost::program_options;
 namespace NDPSim {
@@ -51,6 +54,9 @@ KVRunner::KVRunner(int argc, char* argv[])
             "w");
   m_m2ndp_config->set_output_file(m_output_file);
   m_m2ndp_config->print_config(m_output_file);
+  if (m_m2ndp_config->get_stats_interval() > 0)
+    StatsRegistry::get()->open(m_m2ndp_config->get_stats_file(),
+                               m_m2ndp_config->get_stats_interval());
   m_injection_queue = InjectionQueue(m_injection_rate, m_max_mps, m_m2ndp_config, serial);
   m_injection_queue.initialize_commands(&m_ndp_commands);
   parse_ndp_trace();
@@ -67,13 +73,17 @@ void KVRunner::run() {
   NdpCommand running_command;
   remaing_memory_reqs = 0;
   while (!check_all_simulaiton_finished()) {
+    if (m_m2ndp_config->is_fast_forward_idle() && is_idle()) {
+      fast_forward_idle();
+    }
     m_m2ndp_config->cycle();
     m_cxl_link->cycle();
     m_injection_queue.cycle();
     for (int i = 0; i < m_num_m2ndps; i++) {
       m_m2ndps[i]->cycle();
     }
-    if(!m_bi_reqs.empty() && m_bi_reqs.front().second >= m_m2ndp_config->get_ndp_cycle()) {
+    StatsRegistry::get()->cycle(m_m2ndp_config->get_ndp_cycle());
+    if(!m_bi_reqs.empty() && m_bi_reqs.front().second <= m_m2ndp_config->get_ndp_cycle()) {
       mem_fetch* mf = m_bi_reqs.front().first;
       m_bi_reqs.pop();
       m_memory_reqs.push(mf);
@@ -85,6 +95,7 @@ void KVRunner::run() {
     }
     process_memory_access();
   }
+  StatsRegistry::get()->close(m_m2ndp_config->get_ndp_cycle());
   m_injection_queue.print_avg_latency();
   fprintf(m_output_file, "========== CXL LINK STATS ==========\n");
   m_cxl_link->display_stats(m_output_file);
@@ -94,6 +105,8 @@ void KVRunner::run() {
     m2ndp->display_stats(m_output_file);
     m2ndp->print_energy_stats(m_energy_file);
   }
+  fprintf(m_output_file, "========== MEM_FETCH POOL STATS ==========\n");
+  MemFetchPool::print_stats(m_output_file);
   Stats_NDPSim::statlist.printall();
   spdlog::info("CXL BUFFER FINISHED");
   spdlog::info("EXPR FINISHED {}", m_m2ndp_config->get_sim_cycle());
@@ -103,7 +116,8 @@ void KVRunner::run() {
 
 bool KVRunner::check_all_simulaiton_finished() {
   bool running = remaing_memory_reqs > 0 || !check_all_memory_reqs_empty() ||
-                 !m_ndp_commands.empty() || !m_injection_queue.finished();
+                 !m_ndp_commands.empty() || !m_injection_queue.finished() ||
+                 !m_bi_reqs.empty();
 
   running = running || m_cxl_link->is_active();
   for (int i = 0; i < m_num_m2ndps; i++) {
@@ -121,6 +135,43 @@ bool KVRunner::check_single_simulation_finished() {
   return !running;
 }
 
+// Nothing is in flight anywhere; the next event is a future injection, BI
+// reply release or DRAM refresh
+bool KVRunner::is_idle() {
+  if (remaing_memory_reqs > 0 || !m_memory_reqs.empty() ||
+      !m_injection_queue.empty())
+    return false;
+  if (!m_cxl_link->is_idle()) return false;
+  for (int i = 0; i < m_num_m2ndps; i++) {
+    if (!m_m2ndps[i]->is_idle()) return false;
+  }
+  return true;
+}
+
+// Jumps to the tick of the next event: an injection, a BI request, DRAM or
+// a stats snapshot. The clocks, the injection counter, the per-unit cycle
+// counters and DRAM advance in one step each.
+void KVRunner::fast_forward_idle() {
+  uint64_t ndp_cycles = std::min(
+      m_injection_queue.idle_ticks(),
+      m_m2ndp_config->ndp_cycles_before(StatsRegistry::get()->next_snapshot(
+          m_m2ndp_config->get_ndp_cycle())));
+  if (!m_bi_reqs.empty())
+    ndp_cycles = std::min(ndp_cycles, m_m2ndp_config->ndp_cycles_before(
+                                          m_bi_reqs.front().second));
+  uint64_t dram_cycles = UINT64_MAX;
+  for (int i = 0; i < m_num_m2ndps; i++) {
+    dram_cycles = std::min(dram_cycles, m_m2ndps[i]->idle_dram_cycles());
+  }
+  if (ndp_cycles == 0 || dram_cycles == 0) return;
+  m_m2ndp_config->skip_cycles(ndp_cycles, dram_cycles, &ndp_cycles,
+                              &dram_cycles);
+  m_injection_queue.skip_idle_ticks(ndp_cycles);
+  for (int i = 0; i < m_num_m2ndps; i++) {
+    m_m2ndps[i]->skip_idle(ndp_cycles, dram_cycles);
+  }
+}
+
 bool KVRunner::check_can_launch_ndp_kernel() {
   bool can_launch = true;
   for (auto m2ndp : m_m2ndps) {
@@ -220,7 +271,7 @@ void KVRunner::parse_ndp_trace() {
   spdlog::debug("Parsing trace...");
   // make input memory map at first kernel
   std::string input_memory_path = m_trace_dir_path + "/input.data";
-  m_memory_map = new HashMemoryMap(input_memory_path);
+  m_memory_map = new PagedMemoryMap(input_memory_path);
   std::ifstream ifs_data(m_trace_dir_path + "/launch.txt");
   assert(ifs_data.is_open());
   std::string line;
@@ -253,7 +304,7 @@ void KVRunner::fill_memory_access(NdpCommand& command, std::string line) {
 
 InjectionQueue::InjectionQueue(double injection_rate, int max_mps, M2NDPConfig* m2ndp_config, bool serial)
     : m_injection_rate(injection_rate), m_max_mps(max_mps),
-    m_queue(), m_injection_times(), m_counter(0), m_m2ndp_config(m2ndp_config), serial(serial) {
+    m_queue(), m_injection_times(), m_m2ndp_config(m2ndp_config), serial(serial) {
   m_queue = std::queue<InjectionQueueEntry>();
   m_injection_times = std::unordered_map<mem_fetch*, uint64_t>();
 }
@@ -264,9 +315,9 @@ void InjectionQueue::initialize_commands(std::queue<NdpCommand>* commands) {
 
 void InjectionQueue::cycle() {
   if(!m_m2ndp_config->is_buffer_ndp_cycle()) return;
-  m_counter += m_injection_rate;
-  if(m_counter >= 1) {
-    m_counter -= 1;
+  m_ticks++;
+  if(slot_due(m_ticks)) {
+    m_slots++;
     if (serial && m_injection_times.size() > 1) return;
     if (!m_commands->empty()) {
       NdpCommand command = m_commands->front();
@@ -280,6 +331,31 @@ void InjectionQueue::cycle() {
   }
 }
 
+// An injection slot is due once ticks * rate reaches one more than the
+// slots taken so far
+bool InjectionQueue::slot_due(uint64_t ticks) {
+  return ticks * m_injection_rate >= m_slots + 1.0;
+}
+
+uint64_t InjectionQueue::idle_ticks() {
+  if (!has_pending_commands()) return UINT64_MAX;
+  // First tick count at which the next slot is due, corrected for rounding
+  uint64_t ticks = std::max((double)m_ticks + 1,
+                            std::ceil((m_slots + 1.0) / m_injection_rate));
+  while (ticks > m_ticks + 1 && slot_due(ticks - 1)) ticks--;
+  while (!slot_due(ticks)) ticks++;
+  return ticks - m_ticks - 1;
+}
+
+void InjectionQueue::skip_idle_ticks(uint64_t ticks) {
+  m_ticks += ticks;
+  assert(!slot_due(m_ticks) || !has_pending_commands());
+}
+
+bool InjectionQueue::has_pending_commands() {
+  return !m_commands->empty() && m_injection_rate > 0;
+}
+
 mem_fetch* InjectionQueue::top() {
   if (m_queue.empty()) return NULL;
   if(m_max_mps  <= m_injection_times.size()) return NULL;
@@ -22,6 +22,11 @@ class InjectionQueue {
     InjectionQueue(double injection_rate, int max_mps, M2NDPConfig* m2ndp_config, bool serial);
     void initialize_commands(std::queue<NdpCommand> *commands);
     void cycle();
+    // BUFFER_NDP ticks before the one on which cycle() injects
+    uint64_t idle_ticks();
+    // Same effect as cycle() on that many BUFFER_NDP ticks without injection
+    void skip_idle_ticks(uint64_t ticks);
+    bool has_pending_commands();
     mem_fetch* top();
     void pop();
     bool empty();
@@ -33,6 +38,7 @@ class InjectionQueue {
     };
     bool finished();
   private: 
+    bool slot_due(uint64_t ticks);
     bool serial;
     double m_injection_rate;
     int m_max_mps;
@@ -41,7 +47,10 @@ class InjectionQueue {
     std::unordered_map<mem_fetch*, uint64_t> m_injection_times;
     std::queue<NdpCommand> *m_commands;
     std::vector<uint64_t> m_latencies;
-    float m_counter = 0;    
+    // BUFFER_NDP ticks and injection slots so far, as counts so that
+    // skip_idle_ticks() advances them in one step
+    uint64_t m_ticks = 0;
+    uint64_t m_slots = 0;
     uint64_t m_total_latency = 0;
     uint64_t m_total_requests = 0;
 };
@@ -58,6 +67,8 @@ class KVRunner {
   bool check_all_memory_reqs_empty();
   bool check_all_simulaiton_finished();
   bool check_single_simulation_finished();
+  bool is_idle();
+  void fast_forward_idle();
   bool check_can_launch_ndp_kernel();
   void launch_ndp_kernel(NdpCommand command);
   void process_memory_access();
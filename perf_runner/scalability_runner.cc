@@ -5,10 +5,11 @@
 #include <string>
 
 #include "command_line_parser.h"
+#include "stats_registry.h"
 namespace po = boost::program_options;
 namespace NDPSim {
 ScalabilityRunner::ScalabilityRunner(int argc, char* argv[])
-    : remaing_memory_reqs(0), m_memory_map(NULL), m_target_map(NULL) {
+    : m_worker_pool(NULL), remaing_memory_reqs(0) {
   CommandLineParser cmd_parser = CommandLineParser();
   cmd_parser.add_command_line_option<std::string>("config",
                                                   "path for m2ndp config file");
@@ -21,6 +22,8 @@ ScalabilityRunner::ScalabilityRunner(int argc, char* argv[])
   cmd_parser.add_command_line_option<std::string>("output", "output filename");
   cmd_parser.add_command_line_option<bool>("synthetic_memory",
                                                 "use synthetic memory");
+  cmd_parser.add_command_line_option<bool>(
+      "parallel_buffers", "simulate each memory buffer on its own thread");
   try {
     cmd_parser.parse(argc, argv);
   } catch (const CommandLineParser::ParsingError& e) {
@@ -31,12 +34,14 @@ ScalabilityRunner::ScalabilityRunner(int argc, char* argv[])
   }
   m_output_filename = "";
   m_use_synthetic_memory = false;
+  m_parallel_buffers = false;
   cmd_parser.set_if_defined("config", &m_config_file_path);
   cmd_parser.set_if_defined("trace", &m_trace_dir_path);
   cmd_parser.set_if_defined("num_hosts", &m_num_hosts);
   cmd_parser.set_if_defined("num_m2ndps", &m_num_m2ndps);
   cmd_parser.set_if_defined("output", &m_output_filename);
   cmd_parser.set_if_defined("synthetic_memory", &m_use_synthetic_memory);
+  cmd_parser.set_if_defined("parallel_buffers", &m_parallel_buffers);
   m_memory_reqs.resize(m_num_hosts);
   m_m2ndp_config = new M2NDPConfig(m_config_file_path, m_num_hosts);
   m_m2ndps.resize(m_num_m2ndps);
@@ -55,12 +60,30 @@ ScalabilityRunner::ScalabilityRunner(int argc, char* argv[])
             "w");
   m_m2ndp_config->set_output_file(m_output_file);
   m_m2ndp_config->print_config(m_output_file);
+  if (m_m2ndp_config->get_stats_interval() > 0)
+    StatsRegistry::get()->open(m_m2ndp_config->get_stats_file(),
+                               m_m2ndp_config->get_stats_interval());
   for (int i = 0; i < m_num_m2ndps; i++) {
     spdlog::info("Parsing NDP trace...{}", i);
     parse_ndp_trace(i);
     m_m2ndps[i] = new M2NDP(m_m2ndp_config, m_memory_map.at(i), i);
     m_m2ndps[i]->set_cxl_link(m_cxl_link);
   }
+  // Memory buffers share the BI and DRAM-TLB bookkeeping in M2NDPConfig
+  if (m_parallel_buffers && (m_m2ndp_config->is_bi_enabled() ||
+                             m_m2ndp_config->is_dram_tlb_miss_handling_enabled())) {
+    spdlog::warn(
+        "parallel_buffers is ignored with random BI or DRAM-TLB miss handling "
+        "enabled");
+    m_parallel_buffers = false;
+  }
+  if (m_parallel_buffers && m_num_m2ndps > 1) {
+    m_worker_pool = new NdpWorkerPool(m_num_m2ndps);
+  }
+}
+
+ScalabilityRunner::~ScalabilityRunner() {
+  if (m_worker_pool != NULL) delete m_worker_pool;
 }
 
 void ScalabilityRunner::run() {
@@ -73,27 +96,11 @@ void ScalabilityRunner::run() {
 
     m_m2ndp_config->cycle();
     m_cxl_link->cycle();
-    for (int i = 0; i < m_num_m2ndps; i++) {
-      m_m2ndps[i]->cycle();
-      if (!m_m2ndps[i]->is_active()) {
-        if (!m_ndp_commands[i].empty()) {
-          NdpCommand command = m_ndp_commands[i].front();
-          if (command.is_barrier) {
-            if (!check_ndp_kenrel_active() && remaing_memory_reqs == 0 &&
-                check_all_memory_reqs_empty()) {
-              printf("NDP barrier popped\n");
-              m_ndp_commands[i].pop();
-            }
-          }
-          if (check_can_launch_ndp_kernel(i)) {
-            launch_ndp_kernel(command, i);
-            m_ndp_commands[i].pop();
-          }
-        }
-      }
-    }
+    buffers_cycle();
+    StatsRegistry::get()->cycle(m_m2ndp_config->get_ndp_cycle());
     process_memory_access();
   }
+  StatsRegistry::get()->close(m_m2ndp_config->get_ndp_cycle());
   fprintf(m_output_file, "========== CXL LINK STATS ==========\n");
   m_cxl_link->display_stats(m_output_file);
   m_cxl_link->print_energy_stats(m_energy_file, "LINK");
@@ -102,9 +109,11 @@ void ScalabilityRunner::run() {
     m2ndp->display_stats(m_output_file);
     m2ndp->print_energy_stats(m_energy_file);
   }
+  fprintf(m_output_file, "========== MEM_FETCH POOL STATS ==========\n");
+  MemFetchPool::print_stats(m_output_file);
   fprintf(m_output_file, "========== M2NDP ACCESS TIME ==========\n");
   for (int i = 0; i < m_num_m2ndps; i++) {
-    M2NDPSwitch* m2ndp = m_m2ndps[i];
+    M2NDP* m2ndp = m_m2ndps[i];
     fprintf(m_output_file, "[M2NDP %d]\n", i);
     m2ndp->print_access_time(m_output_file);
   }
@@ -116,6 +125,50 @@ void ScalabilityRunner::run() {
   fclose(m_output_file);
 }
 
+// Runs one cycle of every memory buffer in phases. Buffers interact only
+// through the CXL link, and the link and crossbars share booksim's global
+// state, so link and crossbar transfers and command launches stay serial in
+// buffer order. The L2 caches, NDP units, and DRAM of each buffer run on the
+// worker pool when there is one. Each buffer still steps in the order of
+// M2NDP::cycle(), and the serial and parallel runs take the same phases, so
+// --parallel_buffers does not change the results.
+void ScalabilityRunner::buffers_cycle() {
+  for (int i = 0; i < m_num_m2ndps; i++)
+    if (m_m2ndp_config->is_link_cycle()) m_m2ndps[i]->cxl_link_cycle();
+  for_each_buffer([this](int i) { m_m2ndps[i]->cache_cycle(); });
+  for (int i = 0; i < m_num_m2ndps; i++) m_m2ndps[i]->crossbar_cycle();
+  for_each_buffer([this](int i) { m_m2ndps[i]->ndp_cycle(); });
+  for (int i = 0; i < m_num_m2ndps; i++) {
+    m_m2ndps[i]->check_kernel_active();
+    if (!m_m2ndps[i]->is_active()) check_ndp_command(i);
+  }
+}
+
+void ScalabilityRunner::for_each_buffer(
+    const std::function<void(int)>& task) {
+  if (m_worker_pool != NULL) {
+    m_worker_pool->run(m_num_m2ndps, task);
+  } else {
+    for (int i = 0; i < m_num_m2ndps; i++) task(i);
+  }
+}
+
+void ScalabilityRunner::check_ndp_command(int buffer_id) {
+  if (m_ndp_commands[buffer_id].empty()) return;
+  NdpCommand command = m_ndp_commands[buffer_id].front();
+  if (command.is_barrier) {
+    if (!check_ndp_kenrel_active() && remaing_memory_reqs == 0 &&
+        check_all_memory_reqs_empty()) {
+      printf("NDP barrier popped\n");
+      m_ndp_commands[buffer_id].pop();
+    }
+  }
+  if (check_can_launch_ndp_kernel(buffer_id)) {
+    launch_ndp_kernel(command, buffer_id);
+    m_ndp_commands[buffer_id].pop();
+  }
+}
+
 bool ScalabilityRunner::check_all_simulaiton_finished() {
   bool running = remaing_memory_reqs > 0 || !check_all_memory_reqs_empty();
   for (int i = 0; i < m_num_m2ndps; i++) {
@@ -226,7 +279,7 @@ void ScalabilityRunner::parse_ndp_trace(int buffer_id) {
       //make input memory map at first kernel
       std::string input_memory_path =
           trace_dir_path + "/" + file_name + "_input.data";
-      m_memory_map[buffer_id] = new HashMemoryMap(input_memory_path);
+      m_memory_map[buffer_id] = new PagedMemoryMap(input_memory_path);
       if (m_m2ndp_config->get_use_synthetic_memory())
         m_memory_map[buffer_id]->set_synthetic_memory(
             m_m2ndp_config->get_synthetic_base_address(),
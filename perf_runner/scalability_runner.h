@@ -2,7 +2,8 @@
 #define SCALABILITY_RUNNER_H
 #include "cxl_link.h"
 #include "m2ndp_config.h"
-#include "m2ndp_switch.h"
+#include "m2ndp.h"
+#include "ndp_worker_pool.h"
 namespace NDPSim {
 struct NdpCommand {
   std::string ndp_kernel_path;
@@ -16,6 +17,8 @@ struct NdpCommand {
 class ScalabilityRunner {
  public:
   ScalabilityRunner(int argc, char* argv[]);
+  ScalabilityRunner(const ScalabilityRunner&) = delete;
+  ~ScalabilityRunner();
   void run();
   void match_memorymap();
 
@@ -27,6 +30,9 @@ class ScalabilityRunner {
   bool check_single_simulation_finished(int buffer_id);
   bool check_can_launch_ndp_kernel(int buffer_id);
   void launch_ndp_kernel(NdpCommand command, int buffer_id);
+  void check_ndp_command(int buffer_id);
+  void buffers_cycle();
+  void for_each_buffer(const std::function<void(int)>& task);
   void process_memory_access();
   void fill_memory_access(NdpCommand& command, std::string line);
   int m_num_hosts;
@@ -37,9 +43,11 @@ class ScalabilityRunner {
   FILE* m_output_file;
   FILE* m_energy_file;
   M2NDPConfig* m_m2ndp_config;
-  std::vector<M2NDP*> m_m2m2ndps;
+  std::vector<M2NDP*> m_m2ndps;
   CxlLink* m_cxl_link;
   bool m_use_synthetic_memory;
+  bool m_parallel_buffers;
+  NdpWorkerPool* m_worker_pool;
 
   // MemoryMap* m_memory_map;
   // MemoryMap* m_target_map;
@@ -1,14 +1,23 @@
 #include "simulation_runner.h"
 
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <string>
 
+#include "checkpoint.h"
 #include "command_line_parser.h"
+#include "stats_registry.h"
 namespace po = boost::program_options;
 namespace NDPSim {
 SimulationRunner::SimulationRunner(int argc, char* argv[])
-    : remaing_memory_reqs(0), m_memory_map(NULL), m_target_map(NULL) {
+    : m_checkpoint_at(0),
+      m_checkpoint_written(false),
+      m_checkpoint_deferred(false),
+      m_num_consumed_commands(0),
+      m_memory_map(NULL),
+      m_target_map(NULL),
+      remaing_memory_reqs(0) {
   CommandLineParser cmd_parser = CommandLineParser();
   cmd_parser.add_command_line_option<std::string>("config",
                                                   "path for m2ndp config file");
@@ -23,6 +32,14 @@ SimulationRunner::SimulationRunner(int argc, char* argv[])
                                                 "use synthetic memory");
   cmd_parser.add_command_line_option<bool>("serial_launch",
                                                 "launch single kernel at a time");
+  cmd_parser.add_command_line_option<std::string>(
+      "checkpoint", "path to write a simulation checkpoint to");
+  cmd_parser.add_command_line_option<unsigned long long>(
+      "checkpoint_at",
+      "NDP cycle from which the checkpoint is taken, at the first NDP command "
+      "boundary where the system is drained (no in-flight state is saved)");
+  cmd_parser.add_command_line_option<std::string>(
+      "restore", "path of a simulation checkpoint to resume from");
   try {
     cmd_parser.parse(argc, argv);
   } catch (const CommandLineParser::ParsingError& e) {
@@ -41,7 +58,11 @@ SimulationRunner::SimulationRunner(int argc, char* argv[])
   cmd_parser.set_if_defined("output", &m_output_filename);
   cmd_parser.set_if_defined("synthetic_memory", &m_use_synthetic_memory);
   cmd_parser.set_if_defined("serial_launch", &m_serial_launch);
-  m_memory_reqs.resize(m_num_hosts);
+  cmd_parser.set_if_defined("checkpoint", &m_checkpoint_path);
+  cmd_parser.set_if_defined("checkpoint_at", &m_checkpoint_at);
+  cmd_parser.set_if_defined("restore", &m_restore_path);
+  for (int host = 0; host < m_num_hosts; host++)
+    m_memory_reqs.push_back(std::make_shared<MemoryRequestStream>());
   m_m2ndp_config = new M2NDPConfig(m_config_file_path, m_num_hosts);
   m_m2ndps.resize(m_num_m2ndps);
   m_cxl_link = new CxlLink(m_m2ndp_config);
@@ -55,11 +76,16 @@ SimulationRunner::SimulationRunner(int argc, char* argv[])
             "w");
   m_m2ndp_config->set_output_file(m_output_file);
   m_m2ndp_config->print_config(m_output_file);
+  if (m_m2ndp_config->get_stats_interval() > 0)
+    StatsRegistry::get()->open(m_m2ndp_config->get_stats_file(),
+                               m_m2ndp_config->get_stats_interval());
   parse_ndp_trace();
+  if (!m_restore_path.empty()) restore_memory_map();
   for (int i = 0; i < m_num_m2ndps; i++) {
     m_m2ndps[i] = new M2NDP(m_m2ndp_config, m_memory_map, i);
     m_m2ndps[i]->set_cxl_link(m_cxl_link);
   }
+  if (!m_restore_path.empty()) restore_checkpoint();
 }
 
 void SimulationRunner::run() {
@@ -70,17 +96,34 @@ void SimulationRunner::run() {
   while (!check_all_simulaiton_finished()) {
     // printf("remaing_memory_reqs = %d\n", remaing_memory_reqs);
 
+    if (m_m2ndp_config->is_fast_forward_idle() && is_idle()) {
+      fast_forward_idle();
+    }
     m_m2ndp_config->cycle();
     m_cxl_link->cycle();
     for (int i = 0; i < m_num_m2ndps; i++) {
       m_m2ndps[i]->cycle();
     }
-    if(!m_bi_reqs.empty() &&m_bi_reqs.front().second >= m_m2ndp_config->get_ndp_cycle()) {
+    StatsRegistry::get()->cycle(m_m2ndp_config->get_ndp_cycle());
+    if(!m_bi_reqs.empty() &&m_bi_reqs.front().second <= m_m2ndp_config->get_ndp_cycle()) {
       mem_fetch* mf = m_bi_reqs.front().first;
       m_bi_reqs.pop();
-      m_memory_reqs[0].push(mf);
+      m_memory_reqs[0]->push(mf);
     }
     if (check_single_simulation_finished()) {
+      // Launches are never held for a due checkpoint, so writing one does
+      // not change the run's timing; a boundary that is not yet drained is
+      // passed over for the next one
+      if (check_checkpoint_due()) {
+        if (m_bi_reqs.empty() && check_all_m2ndps_idle()) {
+          save_checkpoint();
+        } else if (!m_checkpoint_deferred) {
+          spdlog::warn("Checkpoint deferred at NDP cycle {}: memory buffers "
+                       "are not drained",
+                       m_m2ndp_config->get_ndp_cycle());
+          m_checkpoint_deferred = true;
+        }
+      }
       if (!m_ndp_commands.empty()) {
         NdpCommand command = m_ndp_commands.front();
         if (command.is_barrier) {
@@ -88,16 +131,19 @@ void SimulationRunner::run() {
               check_all_memory_reqs_empty()) {
             printf("NDP barrier popped\n");
             m_ndp_commands.pop();
+            m_num_consumed_commands++;
           }
         }
         if (check_can_launch_ndp_kernel()) {
           launch_ndp_kernel(command);
           m_ndp_commands.pop();
+          m_num_consumed_commands++;
         }
       }
     }
     process_memory_access();
   }
+  StatsRegistry::get()->close(m_m2ndp_config->get_ndp_cycle());
   fprintf(m_output_file, "========== CXL LINK STATS ==========\n");
   m_cxl_link->display_stats(m_output_file);
   m_cxl_link->print_energy_stats(m_energy_file, "LINK");
@@ -106,17 +152,26 @@ void SimulationRunner::run() {
     m2ndp->display_stats(m_output_file);
     m2ndp->print_energy_stats(m_energy_file);
   }
+  fprintf(m_output_file, "========== MEM_FETCH POOL STATS ==========\n");
+  MemFetchPool::print_stats(m_output_file);
   Stats_NDPSim::statlist.printall();
   spdlog::info("CXL BUFFER FINISHED");
   spdlog::info("EXPR FINISHED {}", m_m2ndp_config->get_sim_cycle());
 
   if (m_m2ndp_config->is_functional_sim()) match_memorymap();
   fclose(m_output_file);
+  // Reported after the statistics so that the run itself is not lost
+  if (!m_checkpoint_path.empty() && !m_checkpoint_written) {
+    spdlog::error("Checkpoint {} not written: no drained NDP command boundary "
+                  "from NDP cycle {} on",
+                  m_checkpoint_path, m_checkpoint_at);
+    exit(1);
+  }
 }
 
 bool SimulationRunner::check_all_simulaiton_finished() {
   bool running = remaing_memory_reqs > 0 || !check_all_memory_reqs_empty() ||
-                 !m_ndp_commands.empty();
+                 !m_ndp_commands.empty() || !m_bi_reqs.empty();
 
   running = running || m_cxl_link->is_active();
   for (int i = 0; i < m_num_m2ndps; i++) {
@@ -149,8 +204,10 @@ void SimulationRunner::launch_ndp_kernel(NdpCommand command) {
   for (auto m2ndp : m_m2ndps) {
     m2ndp->register_ndp_kernel(0, command.ndp_kernel_path);
   }
-  m_memory_reqs = command.memory_reqs;
-  assert(m_memory_reqs[0].size() > 0);
+  m_memory_reqs[0] = command.memory_reqs;
+  for (int host = 1; host < m_num_hosts; host++)
+    m_memory_reqs[host] = std::make_shared<MemoryRequestStream>();
+  assert(!m_memory_reqs[0]->empty());
 }
 
 bool SimulationRunner::check_ndp_kenrel_active() {
@@ -163,8 +220,8 @@ bool SimulationRunner::check_ndp_kenrel_active() {
 
 bool SimulationRunner::check_all_memory_reqs_empty() {
   bool empty = true;
-  for (auto req : m_memory_reqs) {
-    empty = empty && req.empty();
+  for (auto& req : m_memory_reqs) {
+    empty = empty && req->empty();
   }
   return empty;
 }
@@ -175,16 +232,16 @@ void SimulationRunner::process_memory_access() {
     for (int node_id = 0; node_id < m_m2ndp_config->get_links_per_host();
          node_id++) {
       bool is_kernel_launch = false;
-      if(!m_memory_reqs[0].empty()) {
-        is_kernel_launch = m_memory_reqs[0].front()->get_addr() == KERNEL_LAUNCH_ADDR;
+      if(!m_memory_reqs[0]->empty()) {
+        is_kernel_launch = m_memory_reqs[0]->front()->get_addr() == KERNEL_LAUNCH_ADDR;
       }
       bool serial_execution_check 
         = (!m_serial_launch || !is_kernel_launch || !(check_ndp_kenrel_active() || remaing_memory_reqs > 0));
-      if (!m_memory_reqs[host].empty() && serial_execution_check) {
-        mem_fetch* mf = m_memory_reqs[host].front();
+      if (!m_memory_reqs[host]->empty() && serial_execution_check) {
+        mem_fetch* mf = m_memory_reqs[host]->front();
         if (m_cxl_link->has_buffer_from_host(host, node_id, mf)) {
           m_cxl_link->push_from_host(host, node_id, mf);
-          m_memory_reqs[host].pop();
+          m_memory_reqs[host]->pop();
           if(!mf->is_bi() && !mf->is_bi_writeback() && !mf->is_uthread_request())
             remaing_memory_reqs++;
         }
@@ -202,7 +259,7 @@ void SimulationRunner::process_memory_access() {
           delete mf;
         }
         else {
-          mf->current_state = "BI handled";
+          mf->current_state = MF_BI_HANDLED;
           mf->set_reply();
           mf->set_data((void*) 0x77);
           if(!mf->is_write()) {
@@ -219,6 +276,151 @@ void SimulationRunner::process_memory_access() {
   }
 }
 
+bool SimulationRunner::check_checkpoint_due() {
+  return !m_checkpoint_path.empty() && !m_checkpoint_written &&
+         m_m2ndp_config->get_ndp_cycle() >= m_checkpoint_at;
+}
+
+bool SimulationRunner::check_all_m2ndps_idle() {
+  bool idle = !m_cxl_link->is_active();
+  for (auto m2ndp : m_m2ndps) {
+    idle = idle && m2ndp->is_idle();
+  }
+  return idle;
+}
+
+// Drained with no command left to launch, e.g. while BI replies wait out
+// the host latency. A pending checkpoint keeps every tick.
+bool SimulationRunner::is_idle() {
+  if (remaing_memory_reqs > 0 || !check_all_memory_reqs_empty() ||
+      !m_ndp_commands.empty())
+    return false;
+  if (!m_checkpoint_path.empty() && !m_checkpoint_written) return false;
+  if (!m_cxl_link->is_idle()) return false;
+  for (auto m2ndp : m_m2ndps) {
+    if (!m2ndp->is_idle()) return false;
+  }
+  return true;
+}
+
+// Same next-event jump as KVRunner::fast_forward_idle, bounded by the BI
+// queue, DRAM and the stats snapshot interval
+void SimulationRunner::fast_forward_idle() {
+  uint64_t ndp_cycle = m_m2ndp_config->get_ndp_cycle();
+  uint64_t ndp_cycles = m_m2ndp_config->ndp_cycles_before(
+      StatsRegistry::get()->next_snapshot(ndp_cycle));
+  if (!m_bi_reqs.empty())
+    ndp_cycles = std::min(ndp_cycles, m_m2ndp_config->ndp_cycles_before(
+                                          m_bi_reqs.front().second));
+  uint64_t dram_cycles = UINT64_MAX;
+  for (auto m2ndp : m_m2ndps) {
+    dram_cycles = std::min(dram_cycles, m2ndp->idle_dram_cycles());
+  }
+  if (ndp_cycles == 0 || dram_cycles == 0) return;
+  m_m2ndp_config->skip_cycles(ndp_cycles, dram_cycles, &ndp_cycles,
+                              &dram_cycles);
+  for (auto m2ndp : m_m2ndps) m2ndp->skip_idle(ndp_cycles, dram_cycles);
+}
+
+// Checkpoint layout: header, clock domains, number of NDP commands already
+// launched, global launch id, then the warm cache/TLB state and the NDP-side
+// statistics of every memory buffer. Memory contents go to a separate image,
+// <checkpoint>.mem, that is mapped on restore. Since the system is drained,
+// no in-flight request, interconnect or DRAM queue state needs to be saved.
+void SimulationRunner::save_checkpoint() {
+  std::ofstream ofs(m_checkpoint_path, std::ios::binary);
+  if (!ofs.good()) {
+    spdlog::error("Cannot write checkpoint: {}", m_checkpoint_path);
+    exit(1);
+  }
+  ofs.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+  checkpoint_write(ofs, CHECKPOINT_VERSION);
+  checkpoint_write(ofs, m_num_hosts);
+  checkpoint_write(ofs, m_num_m2ndps);
+  m_m2ndp_config->save_clock_state(ofs);
+  checkpoint_write(ofs, m_num_consumed_commands);
+  checkpoint_write(ofs, M2NDP::get_global_launch_id());
+  for (auto m2ndp : m_m2ndps) m2ndp->save_state(ofs);
+  if (m_memory_map != NULL) {
+    PagedMemoryMap* paged_map = dynamic_cast<PagedMemoryMap*>(m_memory_map);
+    if (paged_map == NULL) {
+      spdlog::error("Checkpoint needs a paged memory map");
+      exit(1);
+    }
+    if (!paged_map->SaveImage(m_checkpoint_path + ".mem")) exit(1);
+  }
+  if (!ofs.flush()) {
+    spdlog::error("Cannot write checkpoint: {}", m_checkpoint_path);
+    exit(1);
+  }
+  m_checkpoint_written = true;
+  spdlog::info("Checkpoint {} written at NDP cycle {} after {} NDP commands",
+               m_checkpoint_path, m_m2ndp_config->get_ndp_cycle(),
+               m_num_consumed_commands);
+}
+
+// The memory map must be in place before the memory buffers are built. Runs
+// without memory contents (no functional simulation) have no image.
+void SimulationRunner::restore_memory_map() {
+  if (m_memory_map == NULL) return;
+  std::string image_path = m_restore_path + ".mem";
+  if (!PagedMemoryMap::IsMemoryImage(image_path)) {
+    spdlog::error("Checkpoint memory image not found: {}", image_path);
+    exit(1);
+  }
+  delete m_memory_map;
+  m_memory_map = new PagedMemoryMap(image_path);
+  if (m_m2ndp_config->get_use_synthetic_memory())
+    m_memory_map->set_synthetic_memory(
+        m_m2ndp_config->get_synthetic_base_address(),
+        m_m2ndp_config->get_synthetic_memory_size());
+}
+
+void SimulationRunner::restore_checkpoint() {
+  std::ifstream ifs(m_restore_path, std::ios::binary);
+  char magic[sizeof(CHECKPOINT_MAGIC)];
+  uint32_t version;
+  int num_hosts, num_m2ndps;
+  if (!ifs.read(magic, sizeof(magic)) ||
+      memcmp(magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) {
+    spdlog::error("Not a checkpoint: {}", m_restore_path);
+    exit(1);
+  }
+  checkpoint_read(ifs, version);
+  checkpoint_read(ifs, num_hosts);
+  checkpoint_read(ifs, num_m2ndps);
+  if (version != CHECKPOINT_VERSION || num_hosts != m_num_hosts ||
+      num_m2ndps != m_num_m2ndps) {
+    spdlog::error("Incompatible checkpoint: {}", m_restore_path);
+    exit(1);
+  }
+  m_m2ndp_config->load_clock_state(ifs);
+  uint64_t num_commands;
+  unsigned long long launch_id;
+  checkpoint_read(ifs, num_commands);
+  checkpoint_read(ifs, launch_id);
+  // Kernel ids stay registered after their command, so registrations are
+  // replayed in launch order while the command streams are skipped
+  for (; m_num_consumed_commands < num_commands; m_num_consumed_commands++) {
+    if (m_ndp_commands.empty()) {
+      spdlog::error("Checkpoint {} is ahead of the trace", m_restore_path);
+      exit(1);
+    }
+    NdpCommand command = m_ndp_commands.front();
+    if (!command.is_barrier) {
+      for (auto m2ndp : m_m2ndps) {
+        m2ndp->register_ndp_kernel(0, command.ndp_kernel_path);
+      }
+    }
+    m_ndp_commands.pop();
+  }
+  M2NDP::set_global_launch_id(launch_id);
+  for (auto m2ndp : m_m2ndps) m2ndp->load_state(ifs);
+  spdlog::info("Restored checkpoint {} at NDP cycle {} after {} NDP commands",
+               m_restore_path, m_m2ndp_config->get_ndp_cycle(),
+               m_num_consumed_commands);
+}
+
 void SimulationRunner::parse_ndp_trace() {
   std::ifstream ifs(m_trace_dir_path + "/kernelslist.g");
   std::vector<std::string> kernel_names;
@@ -238,7 +440,7 @@ void SimulationRunner::parse_ndp_trace() {
       //make input memory map at first kernel
       std::string input_memory_path =
           m_trace_dir_path + "/" + file_name + "_input.data";
-      m_memory_map = new HashMemoryMap(input_memory_path);
+      m_memory_map = new PagedMemoryMap(input_memory_path);
       if (m_m2ndp_config->get_use_synthetic_memory())
         m_memory_map->set_synthetic_memory(
             m_m2ndp_config->get_synthetic_base_address(),
@@ -253,42 +455,20 @@ void SimulationRunner::parse_ndp_trace() {
     NdpCommand command = NdpCommand{
         .ndp_kernel_path = m_trace_dir_path + "/" + kernel_name + ".traceg",
         .is_barrier = false};
-    std::ifstream ifs_data(m_trace_dir_path + "/" + kernel_name +
-                           "_launch.txt");
-    assert(ifs_data.is_open());
-    std::string line;
+    // Launch traces are streamed; a gzip-compressed trace may replace the
+    // plain one
+    std::string launch_path =
+        m_trace_dir_path + "/" + kernel_name + "_launch.txt";
+    if (!std::ifstream(launch_path).good() &&
+        std::ifstream(launch_path + ".gz").good())
+      launch_path += ".gz";
     spdlog::info("Parsing NDP kernel: {}", kernel_name);
-
-    while (std::getline(ifs_data, line)) {
-      if (line.find("#") != std::string::npos) continue;
-      fill_memory_access(command, line);
-      spdlog::debug("Memory access filled");
-    }
+    command.memory_reqs = std::make_shared<MemoryRequestStream>(
+        m_m2ndp_config, launch_path, command.ndp_kernel_path);
     m_ndp_commands.push(command);
   }
 }
 
-void SimulationRunner::fill_memory_access(NdpCommand& command,
-                                          std::string line) {
-  command.memory_reqs.resize(m_num_hosts);
-  int host_id = 0;
-  KernelLaunchInfo* info = M2NDPParser::parse_kernel_launch(line, host_id);
-  for (int i = 0; i < m_m2ndp_config->get_num_m2ndps(); i++) {
-    uint64_t addr = KERNEL_LAUNCH_ADDR;
-    mem_fetch* mf = new mem_fetch(addr, DMA_ALLOC_W, WRITE_REQUEST, PACKET_SIZE,
-                                  CXL_OVERHEAD, 0);
-    mf->set_filtering();
-    mf->set_from_ndp(false);
-    mf->set_data(info);
-    mf->set_channel(m_m2ndp_config->get_channel_index(addr));
-    command.memory_reqs[host_id].push(mf);
-
-    if(m_m2ndp_config->is_sc_work()) {
-      generate_uthresds(command, info->base_addr, info->size);
-    }
-  }
-}
-
 void SimulationRunner::match_memorymap() {
   if (m_target_map->Match(*m_memory_map)) {
     spdlog::info("MEMROY MATCH SUCCESS\n");
@@ -296,29 +476,4 @@ void SimulationRunner::match_memorymap() {
     spdlog::info("MEMROY MATCH FAIL\n");
   }
 }
-
-void SimulationRunner::generate_uthresds(NdpCommand& command, uint64_t base_addr, uint64_t size) {
-  int iter = 1;
-  if (command.ndp_kernel_path.find("fc") != std::string::npos) {
-    iter = 2;
-  }
-  if (command.ndp_kernel_path.find("proj") != std::string::npos) {
-    iter = 2;
-  }
-  if (command.ndp_kernel_path.find("attention1") != std::string::npos) {
-    iter = 3;
-  }
-  for (int i = 0; i < iter ; i++) {
-    for (uint64_t offset = 0; offset < size; offset+=PACKET_SIZE) {
-      mem_fetch* mf = new mem_fetch(base_addr + offset, DMA_ALLOC_W, WRITE_REQUEST, PACKET_SIZE,
-                                    CXL_OVERHEAD, 0);
-      mf->set_filtering();
-      mf->set_from_ndp(false);
-      mf->set_uthread_request();
-      mf->set_channel(m_m2ndp_config->get_channel_index(base_addr + offset));
-      command.memory_reqs[0].push(mf);
-    }
-  }
-  printf("command mem size %d\n", command.memory_reqs[0].size());
-}
 }  // namespace NDPSim
\ No newline at end of file
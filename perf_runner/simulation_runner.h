@@ -3,6 +3,7 @@
 #include "cxl_link.h"
 #include "m2ndp_config.h"
 #include "m2ndp.h"
+#include "memory_request_stream.h"
 namespace NDPSim {
 struct NdpCommand {
   std::string ndp_kernel_path;
@@ -10,11 +11,15 @@ struct NdpCommand {
   bool valid;
   bool finished;
   int waiting_memory_request;
-  std::vector<std::queue<mem_fetch*>> memory_reqs;
+  std::shared_ptr<MemoryRequestStream> memory_reqs;
 };
 
 class SimulationRunner {
  public:
+  static constexpr char CHECKPOINT_MAGIC[8] = {'M', '2', 'N', 'D',
+                                               'P', 'C', 'K', 'P'};
+  static const uint32_t CHECKPOINT_VERSION = 3;
+
   SimulationRunner(int argc, char* argv[]);
   void run();
   void match_memorymap();
@@ -28,8 +33,13 @@ class SimulationRunner {
   bool check_can_launch_ndp_kernel();
   void launch_ndp_kernel(NdpCommand command);
   void process_memory_access();
-  void fill_memory_access(NdpCommand& command, std::string line);
-  void generate_uthresds(NdpCommand& command, uint64_t base_addr, uint64_t size);
+  bool check_checkpoint_due();
+  bool check_all_m2ndps_idle();
+  bool is_idle();
+  void fast_forward_idle();
+  void save_checkpoint();
+  void restore_memory_map();
+  void restore_checkpoint();
   int m_num_hosts;
   int m_num_m2ndps;
   std::string m_config_file_path;
@@ -43,11 +53,21 @@ class SimulationRunner {
   bool m_use_synthetic_memory;
   bool m_serial_launch;
 
+  // Checkpoints are taken at the first NDP command boundary at or after NDP
+  // cycle m_checkpoint_at where every memory buffer has already drained; a
+  // run that ends without one exits with an error
+  std::string m_checkpoint_path;
+  std::string m_restore_path;
+  unsigned long long m_checkpoint_at;
+  bool m_checkpoint_written;
+  bool m_checkpoint_deferred;
+  uint64_t m_num_consumed_commands;
+
   MemoryMap* m_memory_map;
   MemoryMap* m_target_map;
 
   int remaing_memory_reqs;
-  std::vector<std::queue<mem_fetch*>> m_memory_reqs;
+  std::vector<std::shared_ptr<MemoryRequestStream>> m_memory_reqs;
   std::queue<NdpCommand> m_ndp_commands;
   std::queue<std::pair<mem_fetch*, uint64_t>> m_bi_reqs;
 };
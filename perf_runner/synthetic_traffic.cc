@@ -62,6 +62,8 @@ void SyntheticTrafficRunner::run() {
   m_cxl_link->display_stats(output_file);
   fprintf(output_file, "========== CXL MEMORY BUFFER STATS  ==========\n");
   m_m2ndp->display_stats(output_file);
+  fprintf(output_file, "========== MEM_FETCH POOL STATS ==========\n");
+  MemFetchPool::print_stats(output_file);
   Stats_NDPSim::statlist.printall();
 }
 } // namespace NDPSim
\ No newline at end of file
@@ -0,0 +1,23 @@
+#!/bin/bash
+
+# Runs a scalability build (scripts/build_timing_scalability.sh) serially and
+# with --parallel_buffers and checks that both runs report the same results.
+# Usage: scripts/check_parallel_buffers.sh {trace dir} {num m2ndps} [config]
+TRACE_DIR=$1
+NUM_M2NDPS=${2:-2}
+CONFIG_FILE=${3:-`pwd`/config/performance/M2NDP/m2ndp.config}
+BIN=`pwd`/build/bin/NDPSim
+OUT_DIR=`mktemp -d`
+ARGS="--trace $TRACE_DIR --num_hosts 1 --num_m2ndps $NUM_M2NDPS --config $CONFIG_FILE"
+
+cd $OUT_DIR
+$BIN $ARGS --output serial.out > serial.log 2>&1 || exit 1
+$BIN $ARGS --output parallel.out --parallel_buffers true > parallel.log 2>&1 || exit 1
+if diff serial.out parallel.out > /dev/null &&
+   diff energy_serial.out energy_parallel.out > /dev/null; then
+  echo "Serial and parallel runs match"
+  rm -rf $OUT_DIR
+else
+  echo "Serial and parallel runs differ, outputs kept in $OUT_DIR"
+  exit 1
+fi
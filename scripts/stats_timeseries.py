@@ -0,0 +1,42 @@
+import argparse
+import csv
+import json
+import sys
+
+# Reads the stats_file written by the simulator (stats_interval > 0) and
+# prints CSV time series. Counters are summed over every registered name
+# ending in "." + counter, e.g. "l1d.hit" aggregates ndp*.l1d.hit.
+
+def load(path):
+    with open(path, "r") as stats_file:
+        names = json.loads(stats_file.readline())["names"]
+        snapshots = [json.loads(line) for line in stats_file if line.strip()]
+    return names, snapshots
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("stats_file")
+    parser.add_argument("-c", "--counter", action="append", required=True,
+                        help="counter suffix, e.g. l1d.hit (repeatable)")
+    parser.add_argument("--delta", action="store_true",
+                        help="print per-interval deltas instead of totals")
+    args = parser.parse_args()
+
+    names, snapshots = load(args.stats_file)
+    columns = []
+    for counter in args.counter:
+        key = "." + counter
+        columns.append([i for i, name in enumerate(names) if name.endswith(key)])
+
+    writer = csv.writer(sys.stdout)
+    writer.writerow(["cycle"] + args.counter)
+    prev = [0] * len(columns)
+    for snapshot in snapshots:
+        values = snapshot["values"]
+        totals = [sum(values[i] for i in indices) for indices in columns]
+        row = [t - p for t, p in zip(totals, prev)] if args.delta else totals
+        writer.writerow([snapshot["cycle"]] + row)
+        prev = totals
+
+if __name__ == "__main__":
+    main()
@@ -1,6 +1,7 @@
 #ifdef TIMING_SIMULATION
 #include "cache.h"
 
+#include "checkpoint.h"
 #include "hashing.h"
 namespace NDPSim {
 
@@ -121,6 +122,30 @@ SectorMask LineCacheBlock::get_dirty_mask() {
   return dirty_mask;
 }
 
+void LineCacheBlock::save(std::ostream &os) {
+  checkpoint_write(os, m_tag);
+  checkpoint_write(os, m_block_addr);
+  checkpoint_write(os, m_alloc_time);
+  checkpoint_write(os, m_last_access_time);
+  checkpoint_write(os, m_fill_time);
+  checkpoint_write(os, m_status);
+  checkpoint_write(os, m_ignore_on_fill_status);
+  checkpoint_write(os, m_set_modified_on_fill);
+  checkpoint_write(os, m_readable);
+}
+
+void LineCacheBlock::load(std::istream &is) {
+  checkpoint_read(is, m_tag);
+  checkpoint_read(is, m_block_addr);
+  checkpoint_read(is, m_alloc_time);
+  checkpoint_read(is, m_last_access_time);
+  checkpoint_read(is, m_fill_time);
+  checkpoint_read(is, m_status);
+  checkpoint_read(is, m_ignore_on_fill_status);
+  checkpoint_read(is, m_set_modified_on_fill);
+  checkpoint_read(is, m_readable);
+}
+
 /* Sector Cache Block */
 void SectorCacheBlock::allocate(uint64_t tag, uint64_t block_addr,
                                 uint32_t time, SectorMask sector_mask) {
@@ -263,6 +288,36 @@ uint32_t SectorCacheBlock::get_modified_size() {
   return modified_size * MEM_ACCESS_SIZE;
 }
 
+void SectorCacheBlock::save(std::ostream &os) {
+  checkpoint_write(os, m_tag);
+  checkpoint_write(os, m_block_addr);
+  checkpoint_write(os, m_sector_alloc_time);
+  checkpoint_write(os, m_sector_fill_time);
+  checkpoint_write(os, m_sector_last_access_time);
+  checkpoint_write(os, m_line_alloc_time);
+  checkpoint_write(os, m_line_fill_time);
+  checkpoint_write(os, m_line_last_access_time);
+  checkpoint_write(os, m_status);
+  checkpoint_write(os, m_ignore_on_fill_status);
+  checkpoint_write(os, m_set_modified_on_fill_status);
+  checkpoint_write(os, m_readable);
+}
+
+void SectorCacheBlock::load(std::istream &is) {
+  checkpoint_read(is, m_tag);
+  checkpoint_read(is, m_block_addr);
+  checkpoint_read(is, m_sector_alloc_time);
+  checkpoint_read(is, m_sector_fill_time);
+  checkpoint_read(is, m_sector_last_access_time);
+  checkpoint_read(is, m_line_alloc_time);
+  checkpoint_read(is, m_line_fill_time);
+  checkpoint_read(is, m_line_last_access_time);
+  checkpoint_read(is, m_status);
+  checkpoint_read(is, m_ignore_on_fill_status);
+  checkpoint_read(is, m_set_modified_on_fill_status);
+  checkpoint_read(is, m_readable);
+}
+
 /*Tag Array*/
 TagArray::TagArray(CacheConfig &config, int core_id, int type_id)
     : m_config(config) {
@@ -276,6 +331,13 @@ TagArray::TagArray(CacheConfig &config, int core_id, int type_id)
     else
       assert(0);
   }
+  if (is_rrip()) {
+    m_rrpv.resize(cache_lines_num, (uint8_t)RRPV_MAX);
+    m_line_signature.resize(cache_lines_num, 0);
+    m_line_reused.resize(cache_lines_num, 0);
+    m_line_policy.resize(cache_lines_num, INSERT_SRRIP);
+    if (config.get_evict_policy() == SHIP) m_shct.resize(SHCT_SIZE, 1);
+  }
   init(core_id, type_id);
 }
 
@@ -338,6 +400,10 @@ CacheRequestStatus TagArray::probe(uint64_t addr, uint32_t &idx,
             valid_timestamp = line->get_alloc_time();
             valid_line = index;
           }
+        } else if (valid_line == (uint32_t)-1 ||
+                   m_rrpv[index] > m_rrpv[valid_line]) {
+          // RRIP: the line predicted to be re-referenced furthest away
+          valid_line = index;
         }
       }
     }
@@ -378,22 +444,26 @@ CacheRequestStatus TagArray::access(uint64_t addr, uint32_t time, uint32_t &idx,
       break;
     case HIT:
       m_lines[idx]->set_last_access_time(time, sector_mask);
+      if (is_rrip()) rrip_hit(idx);
       break;
     case SECTOR_MISS:
       assert(m_config.get_cache_type() == SECTOR);
       m_sector_miss++;
+      if (is_rrip()) rrip_miss(idx / m_config.get_num_assoc(), mf->get_signature());
       if (m_config.get_alloc_policy() == ON_MISS) {
         ((SectorCacheBlock *)m_lines[idx])->allocate_sector(time, sector_mask);
       }
       break;
     case MISS:
       m_miss++;
+      if (is_rrip()) rrip_miss(idx / m_config.get_num_assoc(), mf->get_signature());
       if (m_config.get_alloc_policy() == ON_MISS) {
         if (m_lines[idx]->is_modified_line()) {
           wb = true;
           evicted.set_info(m_lines[idx]->get_block_addr(), m_lines[idx]->get_modified_size(),
                            m_lines[idx]->get_status(sector_mask));
         }
+        if (is_rrip()) rrip_insert(idx, mf->get_signature());
         m_lines[idx]->allocate(tag, block_addr, time, sector_mask);
       }
       break;
@@ -405,7 +475,7 @@ CacheRequestStatus TagArray::access(uint64_t addr, uint32_t time, uint32_t &idx,
 }
 
 void TagArray::fill(uint64_t addr, uint32_t time, mem_fetch *mf) {
-  fill(addr, time, mf->get_access_sector_mask());
+  fill(addr, time, mf->get_access_sector_mask(), mf->get_signature());
 }
 
 void TagArray::fill(uint32_t index, uint32_t time, mem_fetch *mf) {
@@ -413,10 +483,12 @@ void TagArray::fill(uint32_t index, uint32_t time, mem_fetch *mf) {
   m_lines[index]->fill(time, mf->get_access_sector_mask());
 }
 
-void TagArray::fill(uint64_t addr, uint32_t time, SectorMask mask) {
+void TagArray::fill(uint64_t addr, uint32_t time, SectorMask mask,
+                    uint32_t signature) {
   uint32_t idx;
   CacheRequestStatus status = probe(addr, idx, mask);
   if (status == MISS) {
+    if (is_rrip()) rrip_insert(idx, signature);
     m_lines[idx]->allocate(m_config.get_tag(addr),
                            m_config.get_block_addr(addr), time, mask);
   } else if (status == SECTOR_MISS) {
@@ -426,6 +498,102 @@ void TagArray::fill(uint64_t addr, uint32_t time, SectorMask mask) {
   m_lines[idx]->fill(time, mask);
 }
 
+// A hit is promoted without training the replacement policy; a line with a
+// miss in flight is left to its fill
+void TagArray::warm(uint64_t addr, uint32_t time) {
+  SectorMask mask;
+  mask.set(addr % MAX_MEMORY_ACCESS_SIZE / MEM_ACCESS_SIZE);
+  uint32_t idx;
+  CacheRequestStatus status = probe(addr, idx, mask);
+  if (status == HIT) {
+    m_lines[idx]->set_last_access_time(time, mask);
+    if (is_rrip()) m_rrpv[idx] = 0;
+  } else if (status == MISS || status == SECTOR_MISS) {
+    fill(addr, time, mask);
+  }
+}
+
+InsertionPolicy TagArray::get_insertion_policy(uint32_t set_index,
+                                               uint32_t signature) const {
+  switch (m_config.get_evict_policy()) {
+    case SRRIP:
+      return INSERT_SRRIP;
+    case BRRIP:
+      return INSERT_BRRIP;
+    case DRRIP:
+      if (set_index % DUELING_PERIOD == 0) return INSERT_SRRIP;
+      if (set_index % DUELING_PERIOD == 1) return INSERT_BRRIP;
+      // Followers take the policy whose leader sets miss less
+      return m_psel > PSEL_MAX / 2 ? INSERT_BRRIP : INSERT_SRRIP;
+    case SHIP:
+      return m_shct[signature % SHCT_SIZE] == 0 ? INSERT_SHIP_DISTANT
+                                                : INSERT_SHIP_NEAR;
+    default:
+      assert(0);
+      return INSERT_SRRIP;
+  }
+}
+
+// A hit counts toward the policy that inserted the line, which may differ
+// from the current one once PSEL or the SHCT has moved
+void TagArray::rrip_hit(uint32_t idx) {
+  if (m_policy_stats != NULL)
+    m_policy_stats->inc_policy_stats(m_line_policy[idx], true);
+  m_rrpv[idx] = 0;
+  if (m_config.get_evict_policy() == SHIP) {
+    m_line_reused[idx] = true;
+    uint8_t &counter = m_shct[m_line_signature[idx] % SHCT_SIZE];
+    if (counter < SHCT_MAX) counter++;
+  }
+}
+
+void TagArray::rrip_miss(uint32_t set_index, uint32_t signature) {
+  if (m_policy_stats != NULL)
+    m_policy_stats->inc_policy_stats(get_insertion_policy(set_index, signature),
+                                     false);
+  if (m_config.get_evict_policy() != DRRIP) return;
+  if (set_index % DUELING_PERIOD == 0 && m_psel < PSEL_MAX)
+    m_psel++;
+  else if (set_index % DUELING_PERIOD == 1 && m_psel > 0)
+    m_psel--;
+}
+
+// Called before the victim at idx is replaced
+void TagArray::rrip_insert(uint32_t idx, uint32_t signature) {
+  uint32_t assoc = m_config.get_num_assoc();
+  uint32_t set_index = idx / assoc;
+  if (!m_lines[idx]->is_invalid_line()) {
+    // Ages the set at once by as many steps as the victim needed to reach
+    // RRPV_MAX
+    uint8_t age = RRPV_MAX - m_rrpv[idx];
+    for (uint32_t way = 0; way < assoc; way++) {
+      uint8_t &rrpv = m_rrpv[set_index * assoc + way];
+      rrpv = std::min<int>(RRPV_MAX, rrpv + age);
+    }
+    if (m_config.get_evict_policy() == SHIP && !m_line_reused[idx]) {
+      uint8_t &counter = m_shct[m_line_signature[idx] % SHCT_SIZE];
+      if (counter > 0) counter--;
+    }
+  }
+  InsertionPolicy policy = get_insertion_policy(set_index, signature);
+  switch (policy) {
+    case INSERT_SRRIP:
+    case INSERT_SHIP_NEAR:
+      m_rrpv[idx] = RRPV_MAX - 1;
+      break;
+    case INSERT_BRRIP:
+      m_rrpv[idx] =
+          m_brrip_insertions++ % BRRIP_PERIOD == 0 ? RRPV_MAX - 1 : RRPV_MAX;
+      break;
+    default:
+      m_rrpv[idx] = RRPV_MAX;
+      break;
+  }
+  m_line_signature[idx] = signature;
+  m_line_reused[idx] = false;
+  m_line_policy[idx] = policy;
+}
+
 void TagArray::invalidate() {
   if (!is_used) return;
   for (uint32_t i = 0; i < m_config.get_num_lines(); i++) {
@@ -435,6 +603,45 @@ void TagArray::invalidate() {
   }
 }
 
+// The geometry is saved with the lines since an adaptive L1D resizes its
+// sets at launch time
+void TagArray::save(std::ostream &os) {
+  checkpoint_write(os, m_config.get_num_sets());
+  checkpoint_write(os, m_config.get_num_assoc());
+  checkpoint_write(os, is_used);
+  for (uint32_t i = 0; i < m_config.get_num_lines(); i++) m_lines[i]->save(os);
+  if (!is_rrip()) return;
+  os.write((const char *)m_rrpv.data(), m_rrpv.size());
+  os.write((const char *)m_line_signature.data(),
+           m_line_signature.size() * sizeof(uint32_t));
+  os.write((const char *)m_line_reused.data(), m_line_reused.size());
+  os.write((const char *)m_line_policy.data(), m_line_policy.size());
+  os.write((const char *)m_shct.data(), m_shct.size());
+  checkpoint_write(os, m_psel);
+  checkpoint_write(os, m_brrip_insertions);
+}
+
+void TagArray::load(std::istream &is) {
+  uint32_t nset, assoc;
+  checkpoint_read(is, nset);
+  checkpoint_read(is, assoc);
+  if (nset > m_config.get_max_sets() || assoc > m_config.get_max_assoc())
+    throw std::runtime_error("Checkpoint cache geometry does not fit config");
+  m_config.set_sets(nset);
+  m_config.set_assoc(assoc);
+  checkpoint_read(is, is_used);
+  for (uint32_t i = 0; i < m_config.get_num_lines(); i++) m_lines[i]->load(is);
+  if (!is_rrip()) return;
+  is.read((char *)m_rrpv.data(), m_rrpv.size());
+  is.read((char *)m_line_signature.data(),
+          m_line_signature.size() * sizeof(uint32_t));
+  is.read((char *)m_line_reused.data(), m_line_reused.size());
+  is.read((char *)m_line_policy.data(), m_line_policy.size());
+  is.read((char *)m_shct.data(), m_shct.size());
+  checkpoint_read(is, m_psel);
+  checkpoint_read(is, m_brrip_insertions);
+}
+
 void TagArray::init(int core_id, int type_id) {
   m_core_id = core_id;
   m_type_id = type_id;
@@ -515,6 +722,7 @@ Cache::Cache(std::string name, CacheConfig &config, int core_id, int type_id,
              fifo_pipeline<mem_fetch> *to_mem_queue)
     : m_config(config), m_bandwidth_management(config) {
   m_tag_array = new TagArray(config, core_id, type_id);
+  m_tag_array->set_policy_stats(&m_stats);
   m_mshrs = new MshrTable(config.get_mshr_entries(),
                                         config.get_mshr_max_merge());
   m_name = name + std::to_string(core_id);
@@ -575,6 +783,19 @@ bool Cache::waiting_for_fill(mem_fetch *mf) {
   return m_extra_mf_fields.find(mf) != m_extra_mf_fields.end();
 }
 
+void Cache::warm(uint64_t addr, bool write, uint32_t time) {
+  if (write && m_config.get_write_alloc_policy() == NO_WRITE_ALLOCATE) return;
+  m_tag_array->warm(addr, time);
+}
+
+bool Cache::is_present(uint64_t addr) const {
+  SectorMask mask;
+  mask.set(addr % MAX_MEMORY_ACCESS_SIZE / MEM_ACCESS_SIZE);
+  uint32_t idx;
+  CacheRequestStatus status = m_tag_array->probe(addr, idx, mask);
+  return status == HIT || status == HIT_RESERVED;
+}
+
 void Cache::send_read_request(uint64_t addr, uint64_t block_addr,
                               uint32_t cache_index, mem_fetch *mf,
                               uint32_t time, bool &do_miss,
@@ -730,8 +951,10 @@ CacheRequestStatus DataCache::access(uint64_t addr, uint32_t time,
   CacheRequestStatus access_status;
   access_status =
       process_tag_probe(wr, probe_status, addr, cache_index, mf, time, events);
-  m_stats.inc_stats(mf->get_access_type(),
-                    m_stats.select_stats_status(probe_status, access_status));
+  // Own prefetch probes are accounted in NdpStats, not as demand hits/misses
+  if (!mf->is_prefetch(m_prefetch_level))
+    m_stats.inc_stats(mf->get_access_type(),
+                      m_stats.select_stats_status(probe_status, access_status));
   return access_status;
 }
 
@@ -926,6 +1149,7 @@ CacheRequestStatus DataCache::wr_miss_wa_naive(uint64_t addr,
       mf->get_ctrl_size(), mf->get_access_byte_mask(),
       mf->get_access_sector_mask(), time);
   new_mf->set_channel(mf->get_channel());
+  new_mf->set_signature(mf->get_signature());
   bool do_miss = false;
   bool wb = false;
   EvictedBlockInfo evicted;
@@ -998,6 +1222,7 @@ CacheRequestStatus DataCache::wr_miss_wa_fetch_on_write(
         mf->get_ctrl_size(), mf->get_access_byte_mask(),
         mf->get_access_sector_mask(), time);
     new_mf->set_channel(mf->get_channel());
+    new_mf->set_signature(mf->get_signature());
     bool do_miss = false;
     bool wb = false;
     EvictedBlockInfo evicted;
@@ -1086,7 +1311,7 @@ CacheRequestStatus DataCache::rd_miss_base(uint64_t addr, uint32_t cache_index,
                                            std::deque<CacheEvent> &events,
                                            CacheRequestStatus status) {
   if (miss_queue_full(1)) {
-    mf->current_state = "MISS_QUEUE_FULL";
+    mf->current_state = MF_MISS_QUEUE_FULL;
     m_stats.inc_fail_stats(mf->get_access_type(), MISS_QUEUE_FULL);
     return RESERVATION_FAIL;
   }
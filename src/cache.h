@@ -4,9 +4,12 @@
 #include <bitset>
 #include <cassert>
 #include <cstdint>
+#include <istream>
 #include <list>
 #include <memory>
+#include <ostream>
 #include <string>
+#include <vector>
 #include <spdlog/fmt/ranges.h>
 #include <spdlog/spdlog.h>
 
@@ -107,6 +110,8 @@ class CacheBlock {
   virtual void set_readable(bool readable, SectorMask sector_mask) = 0;
   virtual void set_last_access_time(uint64_t time, SectorMask sector_mask) = 0;
   virtual uint32_t get_modified_size() = 0;
+  virtual void save(std::ostream &os) = 0;
+  virtual void load(std::istream &is) = 0;
 
  protected:
   uint64_t m_tag;
@@ -152,6 +157,8 @@ class LineCacheBlock : public CacheBlock {
   virtual uint32_t get_modified_size() override {
     return SECTOR_CHUNCK_SIZE * MEM_ACCESS_SIZE;
   }
+  virtual void save(std::ostream &os) override;
+  virtual void load(std::istream &is) override;
 
  protected:
   uint64_t m_alloc_time = 0;
@@ -186,6 +193,8 @@ class SectorCacheBlock : public CacheBlock {
   virtual void set_last_access_time(uint64_t time,
                                     SectorMask sector_mask) override;
   virtual uint32_t get_modified_size() override;
+  virtual void save(std::ostream &os) override;
+  virtual void load(std::istream &is) override;
 
  private:
   uint32_t m_sector_alloc_time[SECTOR_CHUNCK_SIZE] = {0};
@@ -226,12 +235,27 @@ class TagArray {
                             EvictedBlockInfo &evicted_block);
   void fill(uint64_t addr, uint32_t time, mem_fetch *mf);
   void fill(uint32_t idx, uint32_t time, mem_fetch *mf);
-  void fill(uint64_t addr, uint32_t time, SectorMask mask);
+  void fill(uint64_t addr, uint32_t time, SectorMask mask,
+            uint32_t signature = 0);
+  void warm(uint64_t addr, uint32_t time);
   uint32_t size() const { return m_config.get_num_lines(); }
   CacheBlock *get_block(uint32_t idx) const { return m_lines[idx]; }
   void invalidate();
+  // Tag and replacement state of every line, for warm-state checkpoints
+  void save(std::ostream &os);
+  void load(std::istream &is);
+  void set_policy_stats(CacheStats *stats) { m_policy_stats = stats; }
 
  protected:
+  static const uint8_t RRPV_MAX = 3;  // 2-bit re-reference prediction
+  static const uint32_t SHCT_SIZE = 16384;
+  static const uint8_t SHCT_MAX = 3;
+  static const uint32_t PSEL_MAX = 1023;
+  // One SRRIP and one BRRIP leader set in every DUELING_PERIOD sets
+  static const uint32_t DUELING_PERIOD = 32;
+  // BRRIP inserts at RRPV_MAX - 1 once every BRRIP_PERIOD insertions
+  static const uint32_t BRRIP_PERIOD = 32;
+
   CacheConfig &m_config;
   CacheBlock **m_lines; /* N banks x M sets x assoc lines in total */
   uint32_t m_core_id;
@@ -242,7 +266,24 @@ class TagArray {
   uint32_t m_res_fail;
   uint32_t m_sector_miss;
   bool is_used;
+
+  // RRIP-family state, indexed by line
+  std::vector<uint8_t> m_rrpv;
+  std::vector<uint32_t> m_line_signature;
+  std::vector<uint8_t> m_line_reused;
+  std::vector<uint8_t> m_line_policy;  // InsertionPolicy the line came in with
+  std::vector<uint8_t> m_shct;  // signature history counters
+  uint32_t m_psel = PSEL_MAX / 2 + 1;
+  uint32_t m_brrip_insertions = 0;
+  CacheStats *m_policy_stats = NULL;
+
   void init(int core_id, int type_id);
+  bool is_rrip() const { return m_config.get_evict_policy() >= SRRIP; }
+  InsertionPolicy get_insertion_policy(uint32_t set_index,
+                                       uint32_t signature) const;
+  void rrip_hit(uint32_t idx);
+  void rrip_miss(uint32_t set_index, uint32_t signature);
+  void rrip_insert(uint32_t idx, uint32_t signature);
 };
 
 class MshrTable {
@@ -253,6 +294,7 @@ class MshrTable {
   bool full(uint64_t block_addr) const;
   void add(uint64_t block_addr, mem_fetch *mf);
   bool busy() const { return false; }
+  uint32_t num_free_entries() const { return m_num_entries - m_table.size(); }
   void mark_ready(uint64_t block_addr, bool &has_atomic);
   bool access_ready() const { return !m_current_response.empty(); }
   mem_fetch *pop_next_access();
@@ -288,9 +330,21 @@ class Cache {
   virtual void fill(mem_fetch *mf, uint32_t time);
   virtual bool waiting_for_fill(mem_fetch *mf);
   virtual bool access_ready() { return m_mshrs->access_ready(); }
+  // No miss waiting to go out and no filled access waiting to be drained
+  virtual bool is_idle() { return m_miss_queue.empty() && !access_ready(); }
   virtual mem_fetch *pop_next_access() { return m_mshrs->pop_next_access(); }
   virtual mem_fetch *top_next_access() { return m_mshrs->top_next_access(); }
+  uint32_t get_mshr_free_entries() const { return m_mshrs->num_free_entries(); }
   virtual void invalidate() { m_tag_array->invalidate(); }
+  // Tag array and statistics; the cache must be idle with no MSHR entries
+  virtual void save_state(std::ostream &os) {
+    m_tag_array->save(os);
+    m_stats.save(os);
+  }
+  virtual void load_state(std::istream &is) {
+    m_tag_array->load(is);
+    m_stats.load(is);
+  }
 
   virtual bool data_port_free() {
     return m_bandwidth_management.data_port_free();
@@ -302,7 +356,16 @@ class Cache {
   virtual void force_tag_access(uint64_t addr, uint32_t time, SectorMask mask) {
     m_tag_array->fill(addr, time, mask);
   }
+  // Functional warming: installs addr as a clean line without traffic or
+  // stats. Writes are skipped when the cache does not allocate on write.
+  void warm(uint64_t addr, bool write, uint32_t time);
+  // The sector holding addr is valid or already being fetched; no side
+  // effects on replacement state or stats
+  bool is_present(uint64_t addr) const;
   virtual CacheStats get_stats() const { return m_stats; }
+  void register_stats(const std::string &prefix) {
+    m_stats.register_stats(prefix);
+  }
   virtual void print_cache_stats() {}
   
  protected:
@@ -380,10 +443,12 @@ class DataCache : public Cache {
     if(is_l1) {
       m_write_alloc_type = L1_CACHE_WA;
       m_write_back_type = L1_CACHE_WB;
+      m_prefetch_level = L1D_PREFETCH;
     }
     else {
       m_write_alloc_type = L2_CACHE_WA;
       m_write_back_type = L2_CACHE_WB;
+      m_prefetch_level = L2D_PREFETCH;
     }
   }
   virtual CacheRequestStatus access(uint64_t addr, uint32_t time, mem_fetch *mf,
@@ -394,6 +459,7 @@ class DataCache : public Cache {
  protected:
   mem_access_type m_write_alloc_type;
   mem_access_type m_write_back_type;
+  PrefetchLevel m_prefetch_level;
   CacheRequestStatus process_tag_probe(bool wr, CacheRequestStatus status,
                                        uint64_t addr, uint32_t cache_index,
                                        mem_fetch *mf, uint32_t time,
@@ -121,8 +121,22 @@ static std::map<char, WriteAllocatePolicy> WriteAllocatePolicyMap = {
 enum CacheType { NORMAL, SECTOR };
 static std::map<char, CacheType> CacheTypeMap = {{'N', NORMAL}, {'S', SECTOR}};
 
-enum EvictPolicy { LRU, FIFO };
-static std::map<char, EvictPolicy> EvictPolicyMap = {{'L', LRU}, {'F', FIFO}};
+// SRRIP/BRRIP/DRRIP: static, bimodal and set-dueling re-reference interval
+// prediction. SHIP: SRRIP with signature-based insertion, the signature being
+// the kernel body that issued the access.
+enum EvictPolicy { LRU, FIFO, SRRIP, BRRIP, DRRIP, SHIP };
+static std::map<char, EvictPolicy> EvictPolicyMap = {
+    {'L', LRU},   {'F', FIFO}, {'S', SRRIP},
+    {'B', BRRIP}, {'D', DRRIP}, {'H', SHIP}};
+
+// Insertion decision an RRIP-family access was governed by
+enum InsertionPolicy {
+  INSERT_SRRIP,
+  INSERT_BRRIP,
+  INSERT_SHIP_NEAR,
+  INSERT_SHIP_DISTANT,
+  NUM_INSERTION_POLICY
+};
 
 enum MshrConfig { ASSOC, SECTOR_ASSOC };
 static std::map<char, MshrConfig> MshrConfigMap = {{'A', ASSOC},
@@ -1,7 +1,15 @@
 #ifdef TIMING_SIMULATION
 #include "cache_stats.h"
+
+#include <cinttypes>
+
+#include "checkpoint.h"
+#include "stats_registry.h"
 namespace NDPSim {
 
+static const char *insertion_policy_str[] = {"SRRIP", "BRRIP", "SHIP_NEAR",
+                                             "SHIP_DISTANT"};
+
 CacheStats::CacheStats() {
   m_stats.resize(NUM_MEM_ACCESS_TYPE);
   m_fail_stats.resize(NUM_MEM_ACCESS_TYPE);
@@ -9,6 +17,7 @@ CacheStats::CacheStats() {
     m_stats[i].resize(NUM_CACHE_REQUEST_STATUS, 0);
     m_fail_stats[i].resize(NUM_CACHE_REQUEST_STATUS, 0);
   }
+  m_policy_stats.resize(NUM_INSERTION_POLICY, std::vector<uint64_t>(2, 0));
   m_cache_port_available_cycles = 0;
   m_cache_data_port_busy_cycles = 0;
   m_cache_fill_port_busy_cycles = 0;
@@ -22,6 +31,7 @@ void CacheStats::clear() {
     std::fill(m_stats[i].begin(), m_stats[i].end(), 0);
     std::fill(m_fail_stats[i].begin(), m_fail_stats[i].end(), 0);
   }
+  for (auto &policy : m_policy_stats) std::fill(policy.begin(), policy.end(), 0);
   m_cache_port_available_cycles = 0;
   m_cache_data_port_busy_cycles = 0;
   m_cache_fill_port_busy_cycles = 0;
@@ -32,6 +42,10 @@ void CacheStats::inc_stats(int access_type, int access_outcome) {
   m_stats[access_type][access_outcome]++;
 }
 
+void CacheStats::inc_policy_stats(int insertion_policy, bool hit) {
+  m_policy_stats[insertion_policy][hit]++;
+}
+
 void CacheStats::inc_fail_stats(int access_type, int fail_outcome) {
   assert(check_fail_valid(access_type, fail_outcome));
   m_fail_stats[access_type][fail_outcome]++;
@@ -77,6 +91,10 @@ CacheStats CacheStats::operator+(const CacheStats &other) {
       sum.m_fail_stats[i][j] = m_fail_stats[i][j] + other.m_fail_stats[i][j];
     }
   }
+  for (int i = 0; i < NUM_INSERTION_POLICY; i++) {
+    for (int j = 0; j < 2; j++)
+      sum.m_policy_stats[i][j] = m_policy_stats[i][j] + other.m_policy_stats[i][j];
+  }
   sum.m_cache_port_available_cycles =
       m_cache_port_available_cycles + other.m_cache_port_available_cycles;
   sum.m_cache_data_port_busy_cycles =
@@ -93,6 +111,9 @@ CacheStats &CacheStats::operator+=(const CacheStats &other) {
       m_fail_stats[i][j] += other.m_fail_stats[i][j];
     }
   }
+  for (int i = 0; i < NUM_INSERTION_POLICY; i++) {
+    for (int j = 0; j < 2; j++) m_policy_stats[i][j] += other.m_policy_stats[i][j];
+  }
   m_cache_port_available_cycles += other.m_cache_port_available_cycles;
   m_cache_data_port_busy_cycles += other.m_cache_data_port_busy_cycles;
   m_cache_fill_port_busy_cycles += other.m_cache_fill_port_busy_cycles;
@@ -215,6 +236,29 @@ void CacheStats::print_stats(FILE *out, const char *cache_name) const {
     fprintf(out, "\t%s[%s][TOTAL] = %u\n", cache_name,
             mem_access_type_str[type], total_access[type]);
   }
+  print_policy_stats(out, cache_name);
+}
+
+// Hit rate of the accesses each insertion policy governed, and its delta to
+// the hit rate over all of them (e.g. DRRIP leader sets against each other)
+void CacheStats::print_policy_stats(FILE *out, const char *cache_name) const {
+  uint64_t total_hit = 0, total = 0;
+  for (int i = 0; i < NUM_INSERTION_POLICY; i++) {
+    total_hit += m_policy_stats[i][1];
+    total += m_policy_stats[i][0] + m_policy_stats[i][1];
+  }
+  if (total == 0) return;
+  float total_rate = (float)total_hit / total;
+  for (int i = 0; i < NUM_INSERTION_POLICY; i++) {
+    uint64_t accesses = m_policy_stats[i][0] + m_policy_stats[i][1];
+    if (accesses == 0) continue;
+    float rate = (float)m_policy_stats[i][1] / accesses;
+    fprintf(out,
+            "\t%s[POLICY][%s] hit %" PRIu64 " miss %" PRIu64
+            " hit_rate %.4f delta %+.4f\n",
+            cache_name, insertion_policy_str[i], m_policy_stats[i][1],
+            m_policy_stats[i][0], rate, rate - total_rate);
+  }
 }
 
 void CacheStats::print_fail_stats(FILE *out, const char *cache_name) const {
@@ -245,6 +289,39 @@ bool CacheStats::check_fail_valid(int access_type, int fail_outcome) const {
           fail_outcome >= 0 &&
           fail_outcome < NUM_CACHE_RESERVATION_FAIL_REASON);
 }
+// Hit/miss totals are derived from the access matrix at snapshot time
+void CacheStats::register_stats(const std::string &prefix) {
+  StatsRegistry *registry = StatsRegistry::get();
+  registry->add(prefix + ".hit", [this]() { return get_hit(); });
+  registry->add(prefix + ".miss", [this]() { return get_miss(); });
+  registry->add(prefix + ".read_hit", [this]() { return get_read_hit(); });
+  registry->add(prefix + ".read_miss", [this]() { return get_read_miss(); });
+  registry->add(prefix + ".write_hit", [this]() { return get_write_hit(); });
+  registry->add(prefix + ".write_miss",
+                [this]() { return get_write_miss(); });
+  registry->add(prefix + ".accesses", [this]() { return get_accesses(); });
+}
+
+void CacheStats::save(std::ostream &os) const {
+  checkpoint_write(os, m_stats);
+  checkpoint_write(os, m_fail_stats);
+  checkpoint_write(os, m_policy_stats);
+  checkpoint_write(os, m_cache_port_available_cycles);
+  checkpoint_write(os, m_cache_data_port_busy_cycles);
+  checkpoint_write(os, m_cache_fill_port_busy_cycles);
+}
+
+void CacheStats::load(std::istream &is) {
+  checkpoint_read(is, m_stats);
+  checkpoint_read(is, m_fail_stats);
+  checkpoint_read(is, m_policy_stats);
+  checkpoint_read(is, m_cache_port_available_cycles);
+  checkpoint_read(is, m_cache_data_port_busy_cycles);
+  checkpoint_read(is, m_cache_fill_port_busy_cycles);
+  // The log_interval dump reports hits and misses since the restore
+  m_prev_hit = get_hit();
+  m_prev_miss = get_miss();
+}
 }  // namespace NDPSim
 
 #endif
\ No newline at end of file
@@ -3,6 +3,9 @@
 #define CACHE_STATS_H
 #include <vector>
 #include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
 
 #include "cache_defs.h"
 #include "mem_fetch.h"
@@ -35,6 +38,11 @@ class CacheStats {
   void print_fail_stats(FILE *out, const char *cache_name = "CacheStats") const;
   void print_energy_stats(FILE *out,
                           const char *cache_name = "CacheStats") const;
+  void register_stats(const std::string &prefix);
+  void save(std::ostream &os) const;
+  void load(std::istream &is);
+  void inc_policy_stats(int insertion_policy, bool hit);
+  void print_policy_stats(FILE *out, const char *cache_name) const;
 
  private:
   bool check_valid(int type, int status) const;
@@ -42,6 +50,8 @@ class CacheStats {
 
   std::vector<std::vector<uint64_t>> m_stats;
   std::vector<std::vector<uint64_t>> m_fail_stats;
+  // [insertion policy][0: miss, 1: hit], RRIP-family policies only
+  std::vector<std::vector<uint64_t>> m_policy_stats;
 
   uint64_t m_cache_port_available_cycles;
   uint64_t m_cache_data_port_busy_cycles;
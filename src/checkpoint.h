@@ -0,0 +1,58 @@
+#ifdef TIMING_SIMULATION
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+namespace NDPSim {
+
+// Raw binary (de)serialization of checkpoint fields. Values are stored in
+// host byte order, so a checkpoint is only valid for the build that wrote it.
+template <typename T>
+void checkpoint_write(std::ostream& os, const T& value) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "checkpoint fields must be trivially copyable");
+  os.write((const char*)&value, sizeof(T));
+}
+
+template <typename T>
+void checkpoint_read(std::istream& is, T& value) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "checkpoint fields must be trivially copyable");
+  if (!is.read((char*)&value, sizeof(T)))
+    throw std::runtime_error("Truncated checkpoint");
+}
+
+inline void checkpoint_write(std::ostream& os, const std::string& value) {
+  checkpoint_write(os, (uint64_t)value.size());
+  os.write(value.data(), value.size());
+}
+
+inline void checkpoint_read(std::istream& is, std::string& value) {
+  uint64_t size;
+  checkpoint_read(is, size);
+  value.resize(size);
+  if (!is.read(&value[0], size))
+    throw std::runtime_error("Truncated checkpoint");
+}
+
+template <typename T>
+void checkpoint_write(std::ostream& os, const std::vector<T>& values) {
+  checkpoint_write(os, (uint64_t)values.size());
+  for (const T& value : values) checkpoint_write(os, value);
+}
+
+template <typename T>
+void checkpoint_read(std::istream& is, std::vector<T>& values) {
+  uint64_t size;
+  checkpoint_read(is, size);
+  values.resize(size);
+  for (T& value : values) checkpoint_read(is, value);
+}
+}  // namespace NDPSim
+#endif
+#endif
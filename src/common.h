@@ -37,6 +37,8 @@ struct NdpKernel {
   std::deque <std::deque<NdpInstruction>> kernel_body_insts;
   std::map<int, int> loop_map;
   std::deque<NdpInstruction> finalizer_insts;
+  // An initializer or body AMO writes its result to a register
+  bool amo_result_used = false;
 };
 
 struct KernelLaunchInfo {
@@ -72,6 +74,7 @@ struct RequestInfo {
 };
 
 class MemoryMap;
+class WriteLog;
 class RegisterUnit;
 struct CSR {
   int pc = 0;          // Program counter
@@ -98,11 +101,13 @@ struct Context {
   MemoryMap *memory_map;
   MemoryMap *scratchpad_map;
   RegisterUnit *register_map;
-  std::map<int, int> *loop_map;
+  const std::map<int, int> *loop_map;
   RequestInfo *request_info;
   bool last_inst;
   int max_pc;
   bool exit;
+  // Set while units run in parallel: global writes are recorded, not applied
+  WriteLog *write_log = NULL;
 };
 
 struct InstColumn {
@@ -110,14 +115,18 @@ struct InstColumn {
   int id;
   int kernel_id;
   RequestType type;
-  std::deque<NdpInstruction> insts;
-  std::map<int, int> loop_map;
+  // Instruction stream and loop targets are shared with the NdpKernel; each
+  // instruction is renamed into inst_buffer when it is fetched
+  const std::deque<NdpInstruction> *insts = NULL;
+  const std::map<int, int> *loop_map = NULL;
   RequestInfo *req;
   CSR csr;
   int xregs;
   int fregs;
   int vregs;
   uint64_t base_addr;
+  int rename_slot = -1;
+  NdpInstruction inst_buffer;
   NdpInstruction *current_inst = NULL;
   bool pending = false;
   uint32_t counter = 0;
@@ -168,6 +168,22 @@ void CxlLink::cycle() {
 
 bool CxlLink::is_active() { return m_interconnect_interface->Busy(); }
 
+// No flit in the interconnect and nothing waiting in the port buffers
+bool CxlLink::is_idle() {
+  if (is_active()) return false;
+  for (auto& buffers : m_from_host_buffers)
+    for (auto& buffer : buffers)
+      if (!buffer.empty()) return false;
+  for (auto& buffers : m_from_m2ndp_buffers)
+    for (auto& buffer : buffers)
+      if (!buffer.empty()) return false;
+  for (auto& buffer : m_to_host_buffers)
+    if (!buffer.empty()) return false;
+  for (auto& buffer : m_to_m2ndp_buffers)
+    if (!buffer.empty()) return false;
+  return true;
+}
+
 void CxlLink::display_stats(FILE* fp) {
   m_interconnect_interface->DisplayStats(fp);
 }
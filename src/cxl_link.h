@@ -39,6 +39,7 @@ class CxlLink {
     int get_m2ndp_interleave_size();
     bool get_compression();
     bool is_active();
+    bool is_idle();
 
   private:
     InterconnectInterface *m_interconnect_interface;
@@ -9,14 +9,20 @@ template <typename T>
 void DelayQueue<T>::push(T data, int delay) {
   assert(m_only_latency);
   m_size++;
-  m_queue.push(QueueEntry{data, m_cycle + delay});
+  if (m_timing_wheel)
+    wheel_insert(QueueEntry{data, m_cycle + delay});
+  else
+    m_queue.push(QueueEntry{data, m_cycle + delay});
 }
 
 template <typename T>
 void DelayQueue<T>::push(T data, int delay, int interval) {
   assert(m_issued == false);
   m_size++;
-  m_queue.push(QueueEntry{data, m_cycle + delay});
+  if (m_timing_wheel)
+    wheel_insert(QueueEntry{data, m_cycle + delay});
+  else
+    m_queue.push(QueueEntry{data, m_cycle + delay});
   if(!m_only_latency) m_issued = true;
   m_interval = interval;
 }
@@ -24,23 +30,35 @@ void DelayQueue<T>::push(T data, int delay, int interval) {
 template <typename T>
 void DelayQueue<T>::pop() {
   assert(!empty());
-  m_queue.pop();
   m_size--;
+  if (m_timing_wheel) {
+    int node = m_ready.head;
+    m_ready.head = m_nodes[node].next;
+    if (m_ready.head == NIL) m_ready.tail = NIL;
+    m_nodes[node].entry = QueueEntry();
+    m_nodes[node].next = m_free_node;
+    m_free_node = node;
+    return;
+  }
+  m_queue.pop();
 }
 
 template <typename T>
 T DelayQueue<T>::top() {
   assert(!empty());
+  if (m_timing_wheel) return m_nodes[m_ready.head].entry.data;
   return m_queue.front().data;
 }
 
 template <typename T>
 bool DelayQueue<T>::empty() {
+  if (m_timing_wheel) return m_ready.head == NIL;
   return m_queue.empty() || (m_queue.front().finish_cycle > m_cycle);
 }
 
 template <typename T>
 bool DelayQueue<T>::queue_empty() {
+  if (m_timing_wheel) return m_size == 0;
   return m_queue.empty();
 }
 
@@ -54,6 +72,83 @@ void DelayQueue<T>::cycle() {
   if (m_interval > 0) m_interval--;
   if (m_interval <= 0) m_issued = false;
   m_cycle++;
+  if (!m_timing_wheel || m_size == 0) return;
+  uint64_t slot = m_cycle & (WHEEL_SLOTS - 1);
+  if (slot == 0) {
+    uint64_t upper_slot = (m_cycle >> WHEEL_BITS) & (WHEEL_SLOTS - 1);
+    if (upper_slot == 0 && !m_overflow.empty()) {
+      // Pull entries that now fall within the upper wheel's span
+      std::vector<int> overflow;
+      overflow.swap(m_overflow);
+      for (int node : overflow) wheel_place(node);
+    }
+    WheelList& upper = m_wheel[WHEEL_SLOTS + upper_slot];
+    int node = upper.head;
+    upper = WheelList();
+    while (node != NIL) {
+      int next = m_nodes[node].next;
+      wheel_place(node);
+      node = next;
+    }
+  }
+  wheel_splice(m_wheel[slot]);
+}
+
+template <typename T>
+void DelayQueue<T>::init_timing_wheel() {
+  m_timing_wheel = true;
+  m_wheel.resize(2 * WHEEL_SLOTS);
+  if (m_max_size > 0) m_nodes.reserve(m_max_size);
+}
+
+template <typename T>
+void DelayQueue<T>::wheel_insert(QueueEntry entry) {
+  int node = m_free_node;
+  if (node != NIL) {
+    m_free_node = m_nodes[node].next;
+    m_nodes[node].entry = entry;
+  } else {
+    node = m_nodes.size();
+    m_nodes.push_back(WheelNode{entry, NIL});
+  }
+  wheel_place(node);
+}
+
+template <typename T>
+void DelayQueue<T>::wheel_append(WheelList& list, int node) {
+  m_nodes[node].next = NIL;
+  if (list.tail == NIL)
+    list.head = node;
+  else
+    m_nodes[list.tail].next = node;
+  list.tail = node;
+}
+
+template <typename T>
+void DelayQueue<T>::wheel_splice(WheelList& list) {
+  if (list.head == NIL) return;
+  if (m_ready.tail == NIL)
+    m_ready.head = list.head;
+  else
+    m_nodes[m_ready.tail].next = list.head;
+  m_ready.tail = list.tail;
+  list = WheelList();
+}
+
+template <typename T>
+void DelayQueue<T>::wheel_place(int node) {
+  uint64_t finish = m_nodes[node].entry.finish_cycle;
+  if (finish <= m_cycle) {
+    wheel_append(m_ready, node);
+  } else if ((finish >> WHEEL_BITS) == (m_cycle >> WHEEL_BITS)) {
+    wheel_append(m_wheel[finish & (WHEEL_SLOTS - 1)], node);
+  } else if ((finish >> (2 * WHEEL_BITS)) == (m_cycle >> (2 * WHEEL_BITS))) {
+    wheel_append(
+        m_wheel[WHEEL_SLOTS + ((finish >> WHEEL_BITS) & (WHEEL_SLOTS - 1))],
+        node);
+  } else {
+    m_overflow.push_back(node);
+  }
 }
 
 template class DelayQueue<std::pair<NdpInstruction, Context>>;
@@ -5,8 +5,16 @@
 #include <cstdint>
 #include <queue>
 #include <string>
+#include <vector>
 namespace NDPSim {
 
+// In-order latency queue: entries leave in push order, each no earlier than
+// its finish cycle. With timing_wheel set, entries are instead kept in a two
+// level hashed timing wheel (64 x 64 cycle slots plus an overflow list) and
+// leave in finish-cycle order, so a short operation issued behind a long one
+// on a pipelined unit is not blocked by it. Ties keep insertion order. The
+// wheel changes pop order, so it is opt-in (timing_wheel_delay_queue).
+
 template <typename T>
 class DelayQueue {
  public:
@@ -19,6 +27,11 @@ class DelayQueue {
         m_max_size(max_size),
         m_issued(false),
         m_size(0) {}
+  DelayQueue(std::string name, bool only_latency, int max_size,
+             bool timing_wheel)
+      : DelayQueue(name, only_latency, max_size) {
+    if (timing_wheel) init_timing_wheel();
+  }
   DelayQueue(std::string name) : DelayQueue(name, false, -1) {}
   void push(T data, int delay);
   void push(T data, int delay, int interval);
@@ -29,12 +42,31 @@ class DelayQueue {
   bool queue_empty();
   bool full();
   void cycle();
+  // Nothing in flight and no issue interval pending; the owner may skip
+  // cycle() since queued finish cycles are relative to the queue's clock.
+  bool idle() { return m_size == 0 && !m_issued && m_interval <= 0; }
 
  private:
   struct QueueEntry {
     T data;
     uint64_t finish_cycle = 0;
   };
+  static const int WHEEL_BITS = 6;
+  static const int WHEEL_SLOTS = 1 << WHEEL_BITS;
+  static const int NIL = -1;
+  struct WheelNode {
+    QueueEntry entry;
+    int next;
+  };
+  struct WheelList {
+    int head = NIL;
+    int tail = NIL;
+  };
+  void init_timing_wheel();
+  void wheel_insert(QueueEntry entry);
+  void wheel_append(WheelList& list, int node);
+  void wheel_splice(WheelList& list);
+  void wheel_place(int node);
   std::string m_name;
   int m_interval;
   uint64_t m_cycle;
@@ -43,6 +75,13 @@ class DelayQueue {
   bool m_issued;
   bool m_only_latency;
   std::queue<QueueEntry> m_queue;
+
+  bool m_timing_wheel = false;
+  std::vector<WheelNode> m_nodes;
+  int m_free_node = NIL;
+  WheelList m_ready;
+  std::vector<WheelList> m_wheel;  // [level * WHEEL_SLOTS + slot]
+  std::vector<int> m_overflow;
 };
 }  // namespace NDPSim
 #endif
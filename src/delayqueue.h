@@ -30,23 +30,29 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <utility>
+#include <vector>
+
 #ifndef DELAYQUEUE_H
 #define DELAYQUEUE_H
 
 namespace NDPSim {
 
-template <class T>
-struct fifo_data {
-  T* m_data;
-  fifo_data* m_next;
-};
-
+// Bounded ring buffer with the gpgpu-sim fifo_pipeline interface. Slots are
+// allocated once at construction (max_len entries) so push/pop never touch
+// the allocator. Entries added with emplace() are stored in the slot itself
+// and stay owned by the fifo; the pointer returned by top()/pop() is valid
+// until the slot is reused by a later push, so callers must not delete it.
 template <class T>
 class fifo_pipeline {
  public:
-  fifo_pipeline() {
-    
-  }
+  fifo_pipeline()
+      : m_name(""),
+        m_min_len(0),
+        m_max_len(0),
+        m_length(0),
+        m_n_element(0),
+        m_head(0) {}
   fifo_pipeline(const char* nm, unsigned int minlen, unsigned int maxlen) {
     assert(maxlen);
     m_name = nm;
@@ -54,55 +60,35 @@ class fifo_pipeline {
     m_max_len = maxlen;
     m_length = 0;
     m_n_element = 0;
-    m_head = NULL;
-    m_tail = NULL;
+    m_head = 0;
+    m_slots.assign(maxlen, NULL);
+    m_owned.assign(maxlen, false);
     for (unsigned i = 0; i < m_min_len; i++) push(NULL);
   }
 
-  ~fifo_pipeline() {
-    while (m_head) {
-      m_tail = m_head;
-      m_head = m_head->m_next;
-      delete m_tail;
-    }
+  void push(T* data) {
+    unsigned slot = push_slot();
+    m_slots[slot] = data;
+    m_owned[slot] = false;
   }
 
-  void push(T* data) {
-    assert(!full());
-    assert(m_length < m_max_len);
-    if (m_head) {
-      if (m_tail->m_data || m_length < m_min_len) {
-        m_tail->m_next = new fifo_data<T>();
-        m_tail = m_tail->m_next;
-        m_length++;
-        m_n_element++;
-      }
-    } else {
-      m_head = m_tail = new fifo_data<T>();
-      m_length++;
-      m_n_element++;
-    }
-    m_tail->m_next = NULL;
-    m_tail->m_data = data;
+  // Moves data into the slot instead of taking a heap allocated pointer
+  void emplace(T&& data) {
+    unsigned slot = push_slot();
+    if (m_values.empty()) m_values.resize(m_max_len);
+    m_values[slot] = std::move(data);
+    m_slots[slot] = NULL;
+    m_owned[slot] = true;
   }
 
   T* pop() {
-    fifo_data<T>* next;
     T* data;
-    if (m_head) {
-      next = m_head->m_next;
-      data = m_head->m_data;
-      if (m_head == m_tail) {
-        assert(next == NULL);
-        m_tail = NULL;
-      }
-      delete m_head;
-      m_head = next;
+    if (m_length) {
+      data = slot_data(m_head);
+      m_slots[m_head] = NULL;
+      m_owned[m_head] = false;
+      m_head = next_slot(m_head);
       m_length--;
-      if (m_length == 0) {
-        assert(m_head == NULL);
-        m_tail = m_head;
-      }
       m_n_element--;
       if (m_min_len && m_length < m_min_len) {
         push(NULL);
@@ -115,8 +101,8 @@ class fifo_pipeline {
   }
 
   T* top() const {
-    if (m_head) {
-      return m_head->m_data;
+    if (m_length) {
+      return slot_data(m_head);
     } else {
       return NULL;
     }
@@ -134,22 +120,13 @@ class fifo_pipeline {
     } else {
       // in this branch imply that the original min_len is larger then 0
       // ie. head != 0
-      assert(m_head);
+      assert(m_length);
       m_min_len = new_min_len;
-      while ((m_length > m_min_len) && (m_tail->m_data == 0)) {
-        fifo_data<T>* iter;
-        iter = m_head;
-        while (iter && (iter->m_next != m_tail)) iter = iter->m_next;
-        if (!iter) {
+      while ((m_length > m_min_len) && (slot_data(tail_slot()) == 0)) {
+        if (m_length == 1) {
           // there is only one node, and that node is empty
-          assert(m_head->m_data == 0);
           pop();
         } else {
-          // there are more than one node, and tail node is empty
-          assert(iter->m_next == m_tail);
-          delete m_tail;
-          m_tail = iter;
-          m_tail->m_next = 0;
           m_length--;
         }
       }
@@ -160,22 +137,45 @@ class fifo_pipeline {
   bool is_avilable_size(unsigned size) const {
     return (m_max_len && m_length + size - 1 >= m_max_len);
   }
-  bool empty() const { return m_head == NULL; }
+  bool empty() const { return m_length == 0; }
   unsigned get_n_element() const { return m_n_element; }
   unsigned get_length() const { return m_length; }
   unsigned get_max_len() const { return m_max_len; }
 
   void print() const {
-    fifo_data<T>* ddp = m_head;
     printf("%s(%d): ", m_name, m_length);
-    while (ddp) {
-      printf("%p ", ddp->m_data);
-      ddp = ddp->m_next;
+    for (unsigned i = 0, slot = m_head; i < m_length;
+         i++, slot = next_slot(slot)) {
+      printf("%p ", slot_data(slot));
     }
     printf("\n");
   }
 
  private:
+  unsigned next_slot(unsigned slot) const {
+    return slot + 1 == m_max_len ? 0 : slot + 1;
+  }
+  unsigned tail_slot() const {
+    unsigned slot = m_head + m_length - 1;
+    return slot >= m_max_len ? slot - m_max_len : slot;
+  }
+  T* slot_data(unsigned slot) const {
+    return m_owned[slot] ? const_cast<T*>(&m_values[slot]) : m_slots[slot];
+  }
+  // Returns the slot the next element goes to. An empty (delay) tail slot is
+  // reused once the pipeline is at least m_min_len long.
+  unsigned push_slot() {
+    assert(!full());
+    assert(m_length < m_max_len);
+    if (m_length && slot_data(tail_slot()) == NULL &&
+        m_length >= m_min_len) {
+      return tail_slot();
+    }
+    m_length++;
+    m_n_element++;
+    return tail_slot();
+  }
+
   const char* m_name;
 
   unsigned int m_min_len;
@@ -183,8 +183,10 @@ class fifo_pipeline {
   unsigned int m_length;
   unsigned int m_n_element;
 
-  fifo_data<T>* m_head;
-  fifo_data<T>* m_tail;
+  unsigned int m_head;
+  std::vector<T*> m_slots;
+  std::vector<bool> m_owned;
+  std::vector<T> m_values;
 };
 }  // namespace NDPSim
 #endif
@@ -22,35 +22,69 @@ ExecutionUnit::ExecutionUnit(M2NDPConfig *config, int ndp_id, int sub_core_id, R
       m_to_v_ldst_unit(to_v_ldst_unit),
       m_to_v_spad_unit(to_v_spad_unit),
       m_stats(stats) {
+  bool timing_wheel = config->is_timing_wheel_delay_queue();
   for (int i = 0; i < config->get_num_i_units(); i++) {
-    m_i_units.push_back(ExecutionDelayQueue("i_unit_" + std::to_string(i)));
+    m_i_units.push_back(ExecutionDelayQueue(
+        "i_unit_" + std::to_string(i), false, -1, timing_wheel));
   }
   for (int i = 0; i < config->get_num_f_units(); i++) {
-    m_f_units.push_back(ExecutionDelayQueue("f_unit_" + std::to_string(i)));
+    m_f_units.push_back(ExecutionDelayQueue(
+        "f_unit_" + std::to_string(i), false, -1, timing_wheel));
   }
   for (int i = 0; i < config->get_num_sf_units(); i++) {
-    m_sf_units.push_back(ExecutionDelayQueue("sf_unit_" + std::to_string(i)));
+    m_sf_units.push_back(ExecutionDelayQueue(
+        "sf_unit_" + std::to_string(i), false, -1, timing_wheel));
   }
   for (int i = 0; i < config->get_num_address_units(); i++) {
-    m_address_units.push_back(
-        ExecutionDelayQueue("address_unit_" + std::to_string(i)));
+    m_address_units.push_back(ExecutionDelayQueue(
+        "address_unit_" + std::to_string(i), false, -1, timing_wheel));
   }
   for (int i = 0; i < config->get_num_v_i_units(); i++) {
-    m_v_i_units.push_back(ExecutionDelayQueue("v_i_unit_" + std::to_string(i)));
+    m_v_i_units.push_back(ExecutionDelayQueue(
+        "v_i_unit_" + std::to_string(i), false, -1, timing_wheel));
   }
   for (int i = 0; i < config->get_num_v_f_units(); i++) {
-    m_v_f_units.push_back(ExecutionDelayQueue("v_f_unit_" + std::to_string(i)));
+    m_v_f_units.push_back(ExecutionDelayQueue(
+        "v_f_unit_" + std::to_string(i), false, -1, timing_wheel));
   }
   for (int i = 0; i < config->get_num_v_sf_units(); i++) {
-    m_v_sf_units.push_back(
-        ExecutionDelayQueue("v_sf_unit_" + std::to_string(i)));
+    m_v_sf_units.push_back(ExecutionDelayQueue(
+        "v_sf_unit_" + std::to_string(i), false, -1, timing_wheel));
   }
   for (int i = 0; i < config->get_num_v_address_units(); i++) {
-    m_v_address_units.push_back(
-        ExecutionDelayQueue("v_address_unit_" + std::to_string(i)));
+    m_v_address_units.push_back(ExecutionDelayQueue(
+        "v_address_unit_" + std::to_string(i), false, -1, timing_wheel));
+  }
+  if (config->get_indexed_coalesce_window() < 0) {
+    spdlog::error("indexed_coalesce_window must be >= 0");
+    exit(1);
   }
 }
 
+// Merges the element requests of an indexed load/store that fall in the same
+// sector, looking only at windows of indexed_coalesce_window consecutive
+// elements. Without reordering only runs of consecutive elements merge.
+// addr_set keeps the requests sorted, so the sectors of a line stay adjacent.
+void ExecutionUnit::coalesce_indexed(NdpInstruction &inst,
+                                     const std::vector<uint64_t> &elements) {
+  size_t window = m_config->get_indexed_coalesce_window();
+  if (window == 0) window = elements.size();
+  bool reorder = m_config->get_indexed_coalesce_reorder();
+  for (size_t start = 0; start < elements.size(); start += window) {
+    size_t end = std::min(elements.size(), start + window);
+    for (size_t i = start; i < end; i++) {
+      bool merged;
+      if (reorder)
+        merged = std::find(elements.begin() + start, elements.begin() + i,
+                           elements[i]) != elements.begin() + i;
+      else
+        merged = i > start && elements[i] == elements[i - 1];
+      if (!merged) inst.addr_set.append(elements[i]);
+    }
+  }
+  m_stats->inc_indexed_access_count(elements.size(), inst.addr_set.size());
+}
+
 bool ExecutionUnit::active() {
   return  !m_to_ldst_unit->empty()|| !m_to_spad_unit->empty() || 
           !m_to_v_ldst_unit->empty() || !m_to_v_spad_unit->empty() ||
@@ -59,7 +93,7 @@ bool ExecutionUnit::active() {
 
 void ExecutionUnit::cycle() {
   for (auto &i_unit : m_i_units) {
-    i_unit.cycle();
+    if (!i_unit.idle()) i_unit.cycle();
     if (i_unit.empty()) continue;
     NdpInstruction inst = i_unit.top().first;
     Context context = i_unit.top().second;
@@ -88,11 +122,11 @@ void ExecutionUnit::cycle() {
   process_default_execution_units(m_v_sf_units);
 
   for (auto &address_unit : m_address_units) {
-    address_unit.cycle();
+    if (!address_unit.idle()) address_unit.cycle();
     process_address_inst(address_unit);
   }
   for (auto &v_address_unit : m_v_address_units) {
-    v_address_unit.cycle();
+    if (!v_address_unit.idle()) v_address_unit.cycle();
     process_address_inst(v_address_unit);
   }
 }
@@ -100,7 +134,7 @@ void ExecutionUnit::cycle() {
 void ExecutionUnit::process_default_execution_units(
     std::vector<ExecutionDelayQueue> &units) {
   for (auto &unit : units) {
-    unit.cycle();
+    if (!unit.idle()) unit.cycle();
     if (unit.empty()) continue;
     NdpInstruction inst = unit.top().first;
     Context context = unit.top().second;
@@ -185,6 +219,7 @@ Status ExecutionUnit::issue(NdpInstruction &inst, Context context) {
           endable_mask = true;
           vs3 = context.register_map->ReadVreg(inst.src[3], context);
         }
+        std::vector<uint64_t> elements;
         for (int i = 0; i < vs2.GetVlen(); i++) {
           uint64_t idx;
           if (vs2.GetType() == INT32)
@@ -202,8 +237,12 @@ Status ExecutionUnit::issue(NdpInstruction &inst, Context context) {
             if (vs3.GetType() == VMASK && vm == 0) continue;
           }
           uint64_t addr = MemoryMap::FormatAddr(base_addr + idx);
-          inst.addr_set.insert(addr);
+          if (inst.CheckIndexedOp())
+            elements.push_back(addr);
+          else
+            inst.addr_set.insert(addr);
         }
+        if (inst.CheckIndexedOp()) coalesce_indexed(inst, elements);
       } 
       else {
         uint64_t addr = MemoryMap::FormatAddr(base_addr);
@@ -223,8 +262,14 @@ Status ExecutionUnit::issue(NdpInstruction &inst, Context context) {
     }
   }
   
-  if (m_config->is_functional_sim() || spad_op || (alu_op_type != ADDRESS_OP))
-    inst.Execute(context);
+  if (m_config->is_functional_sim() || spad_op || (alu_op_type != ADDRESS_OP)) {
+    if (alu_op_type == ADDRESS_OP) {
+      std::lock_guard<MemoryMap> lock(*context.memory_map);
+      inst.Execute(context);
+    } else {
+      inst.Execute(context);
+    }
+  }
 
   for (auto &unit : get_unit(inst)) {
     if (!unit.full()) {
@@ -281,8 +326,7 @@ void ExecutionUnit::process_address_inst(ExecutionDelayQueue &address_unit) {
     else m_stats->add_status(LDST_QUEUE_FULL);
     return;
   } else {
-    std::pair<NdpInstruction, Context>* inst_contx = new std::pair<NdpInstruction, Context>{inst, context};
-    fifo_pipeline->push(inst_contx);
+    fifo_pipeline->emplace({std::move(inst), std::move(context)});
     address_unit_pop = true;
   }
 
@@ -493,6 +537,23 @@ bool ExecutionUnit::check_units_finished(
   return finish;
 }
 
+bool ExecutionUnit::check_units_idle(std::vector<ExecutionDelayQueue> &units) {
+  for (auto &unit : units) {
+    if (!unit.idle()) return false;
+  }
+  return true;
+}
+
+// Unlike active(), also waits for issue intervals to run out so that
+// skipping cycle() leaves no unit state behind
+bool ExecutionUnit::is_idle() {
+  return !active() && check_units_idle(m_i_units) &&
+         check_units_idle(m_f_units) && check_units_idle(m_sf_units) &&
+         check_units_idle(m_address_units) && check_units_idle(m_v_i_units) &&
+         check_units_idle(m_v_f_units) && check_units_idle(m_v_sf_units) &&
+         check_units_idle(m_v_address_units);
+}
+
 std::vector<ExecutionDelayQueue> &ExecutionUnit::get_unit(NdpInstruction &inst) {
   UnitType unit_type = get_unit_type(inst);
   if (unit_type == LDST_UNIT && !inst.CheckVectorOp()) return m_address_units;
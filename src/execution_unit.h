@@ -39,10 +39,13 @@ class ExecutionUnit {
                 fifo_pipeline<std::pair<NdpInstruction, Context>> *to_v_spad_unit,
                 NdpStats *stats);
   bool active();
+  bool is_idle();
   void cycle();
   Status issue(NdpInstruction &inst, Context context);
   bool full();
   bool check_unit_finished();
+  void coalesce_indexed(NdpInstruction& inst,
+                        const std::vector<uint64_t>& elements);
 
   void dump_current_state();
 
@@ -77,6 +80,7 @@ class ExecutionUnit {
   void process_address_inst(ExecutionDelayQueue &address_unit);
   bool check_units_full(std::vector<ExecutionDelayQueue> &units);
   bool check_units_finished(std::vector<ExecutionDelayQueue> &units);
+  bool check_units_idle(std::vector<ExecutionDelayQueue> &units);
   Status check_dependency_fail(NdpInstruction& inst, Context& context);
   Status check_resource_fail(NdpInstruction& inst);
   std::vector<ExecutionDelayQueue> &get_unit(NdpInstruction& inst);
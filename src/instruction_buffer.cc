@@ -1,13 +1,10 @@
 #ifdef TIMING_SIMULATION
 #include "instruction_buffer.h"
 
-#include <set>
-
 #include "instruction_queue.h"
 #define BUFFER_ACCESS_DELAY 1
 #define BUFFER_ACCESS_INTERVAL 1
 namespace NDPSim {
-typedef std::set<int> RegSet;
 InstructionBuffer::InstructionBuffer(int max_kernel_register,
                                      int queue_size, int ndp_id)
     : m_max_kernel_register(max_kernel_register), m_ndp_id(ndp_id) {
@@ -18,28 +15,14 @@ bool InstructionBuffer::can_register() {
   return m_ndp_kernels.size() < m_max_kernel_register;
 }
 
-void InstructionBuffer::register_kernel(NdpKernel* ndp_kernel) {
+void InstructionBuffer::register_kernel(const NdpKernel* ndp_kernel) {
   int kernel_id = ndp_kernel->kernel_id;
   if (m_ndp_kernels.find(kernel_id) != m_ndp_kernels.end()) {
     spdlog::info("Kernel {} already registered", kernel_id);
     return;
   }
+  // Register usage is counted once when the kernel is parsed (KernelCache)
   m_ndp_kernels[kernel_id] = ndp_kernel;
-  m_ndp_kernels[kernel_id]->valid = true;
-  count_required_regs(m_ndp_kernels[kernel_id]->initializer_insts,
-                      m_ndp_kernels[kernel_id]->initializer_xregs,
-                      m_ndp_kernels[kernel_id]->initializer_fregs,
-                      m_ndp_kernels[kernel_id]->initializer_vregs);
-  for(int i = 0; i < m_ndp_kernels[kernel_id]->num_kernel_bodies; i++) {
-    count_required_regs(m_ndp_kernels[kernel_id]->kernel_body_insts[i],
-                        m_ndp_kernels[kernel_id]->kernel_body_xregs[i],
-                        m_ndp_kernels[kernel_id]->kernel_body_fregs[i],
-                        m_ndp_kernels[kernel_id]->kernel_body_vregs[i]);
-  }
-  count_required_regs(m_ndp_kernels[kernel_id]->finalizer_insts,
-                      m_ndp_kernels[kernel_id]->finalizer_xregs,
-                      m_ndp_kernels[kernel_id]->finalizer_fregs,
-                      m_ndp_kernels[kernel_id]->finalizer_vregs);
 }
 
 void InstructionBuffer::unregister_kernel(int kernel_id) {
@@ -52,26 +35,26 @@ void InstructionBuffer::cycle() {
   InstColumn* col = new InstColumn();
   RequestInfo* req = m_delay_queue.top();
   if (req->type == INITIALIZER) {
-    col->insts = m_ndp_kernels[req->kernel_id]->initializer_insts;
+    col->insts = &m_ndp_kernels[req->kernel_id]->initializer_insts;
     col->type = INITIALIZER;
     col->xregs = m_ndp_kernels[req->kernel_id]->initializer_xregs;
     col->fregs = m_ndp_kernels[req->kernel_id]->initializer_fregs;
     col->vregs = m_ndp_kernels[req->kernel_id]->initializer_vregs;
-    col->loop_map = m_ndp_kernels[req->kernel_id]->loop_map;
+    col->loop_map = &m_ndp_kernels[req->kernel_id]->loop_map;
   } else if (req->type == FINALIZER) {
-    col->insts = m_ndp_kernels[req->kernel_id]->finalizer_insts;
+    col->insts = &m_ndp_kernels[req->kernel_id]->finalizer_insts;
     col->type = FINALIZER;
     col->xregs = m_ndp_kernels[req->kernel_id]->finalizer_xregs;
     col->fregs = m_ndp_kernels[req->kernel_id]->finalizer_fregs;
     col->vregs = m_ndp_kernels[req->kernel_id]->finalizer_vregs;
-    col->loop_map = m_ndp_kernels[req->kernel_id]->loop_map;
+    col->loop_map = &m_ndp_kernels[req->kernel_id]->loop_map;
   } else {
-    col->insts = m_ndp_kernels[req->kernel_id]->kernel_body_insts[req->kernel_body_id];
+    col->insts = &m_ndp_kernels[req->kernel_id]->kernel_body_insts[req->kernel_body_id];
     col->type = KERNEL_BODY;
     col->xregs = m_ndp_kernels[req->kernel_id]->kernel_body_xregs[req->kernel_body_id];
     col->fregs = m_ndp_kernels[req->kernel_id]->kernel_body_fregs[req->kernel_body_id];
     col->vregs = m_ndp_kernels[req->kernel_id]->kernel_body_vregs[req->kernel_body_id];
-    col->loop_map = m_ndp_kernels[req->kernel_id]->loop_map;
+    col->loop_map = &m_ndp_kernels[req->kernel_id]->loop_map;
   }
   col->kernel_id = req->kernel_id;
   col->req = req;
@@ -111,42 +94,5 @@ InstColumn* InstructionBuffer::top() {
   return m_inst_columns.front();
 }
 
-void InstructionBuffer::count_required_regs(std::deque<NdpInstruction> insts,
-                                            int& num_xreg, int& num_freg,
-                                            int& num_vreg) {
-  RegSet used_xregs;
-  RegSet used_fregs;
-  RegSet used_vregs;
-  RegSet used_double_vreg;
-  int vmul = 1;
-  for (NdpInstruction inst : insts) {
-    if (inst.CheckScalarOp()) {
-      if (inst.CheckFloatOp()) {
-        used_fregs.insert(inst.dest);
-      } else if (inst.opcode != CSRWI && inst.opcode != CSRW) {
-        used_xregs.insert(inst.dest);
-      }
-    } else {
-      if (inst.opcode == VSETVLI) {
-        if (inst.src[3] == IMM_M1) {
-          vmul = 1;
-        } else if (inst.src[3] == IMM_M2) {
-          vmul = 2;
-        }
-      } else if (inst.operand_type == F_S) {
-        used_fregs.insert(inst.dest);
-      } else if (inst.opcode != VSE16 && inst.opcode != VSE32 &&
-                 inst.opcode != VSUXEI32) {
-        used_vregs.insert(inst.dest);
-        for (int i = 1; i < vmul; i++) {
-          used_double_vreg.insert(inst.dest);
-        }
-      }
-    }
-  }
-  num_xreg = used_xregs.size();
-  num_freg = used_fregs.size();
-  num_vreg = used_vregs.size() + used_double_vreg.size();
-}
 }  // namespace NDPSim
 #endif
\ No newline at end of file
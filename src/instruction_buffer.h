@@ -14,13 +14,14 @@ namespace NDPSim {
 class InstructionBuffer {
  public:
   InstructionBuffer(int max_kernel_register, int queue_size, int ndp_id);
-  void register_kernel(NdpKernel* ndp_function);
+  void register_kernel(const NdpKernel* ndp_function);
   void unregister_kernel(int kernel_id);
   bool can_register();
   void cycle();
   bool can_push_request();
   void push(RequestInfo* req);
   bool can_pop();
+  bool is_idle() { return m_delay_queue.idle() && m_inst_columns.empty(); }
   InstColumn* pop();
   InstColumn* top();
 
@@ -29,10 +30,8 @@ class InstructionBuffer {
   unsigned m_max_kernel_register;
   DelayQueue<RequestInfo*> m_delay_queue;
   std::deque<int> m_free_ndp_kernel_id;
-  std::map<int, NdpKernel*> m_ndp_kernels;
+  std::map<int, const NdpKernel*> m_ndp_kernels;
   std::deque<InstColumn*> m_inst_columns;
-  void count_required_regs(std::deque<NdpInstruction> insts, int& num_xreg,
-                           int& num_freg, int& num_vreg);
 };
 }  // namespace NDPSim
 #endif
@@ -3,7 +3,8 @@
 #define INITIALIZER_DEPENDENCY -1215752192
 namespace NDPSim {
 
-InstructionQueue::InstructionQueue(M2NDPConfig *config, int id, int sub_core_id, Cache *icache) {
+InstructionQueue::InstructionQueue(M2NDPConfig *config, int id, int sub_core_id, Cache *icache,
+                                   RegisterUnit *register_unit) {
   m_id = id;
   m_sub_core_id = sub_core_id;
   m_inst_col_id = 0;
@@ -11,6 +12,7 @@ InstructionQueue::InstructionQueue(M2NDPConfig *config, int id, int sub_core_id,
   m_config = config;
   m_inst_columns_iter = m_inst_columns.begin();
   m_icache = icache;
+  m_register_unit = register_unit;
   m_icache_queue = DelayQueue<mem_fetch *>("l0_icache_queue", true,
                                            m_config->get_request_queue_size());
   m_l0_icache_hit_latency = m_config->get_l0icache_hit_latency();
@@ -43,7 +45,7 @@ bool InstructionQueue::can_push(InstColumn *inst_column) {
 
 void InstructionQueue::push(InstColumn *inst_column) {
   assert(can_push(inst_column));
-  if (inst_column->insts.empty()) assert(0 && "This should not happen");
+  if (inst_column->insts->empty()) assert(0 && "This should not happen");
   inst_column->valid = true;
   inst_column->id = m_inst_col_id++;
   m_num_columns++;
@@ -74,13 +76,11 @@ Context InstructionQueue::fetch_context() {
   context.inst_col_id = (*m_inst_columns_iter)->id;
   context.request_info = (*m_inst_columns_iter)->req;
   context.csr = &(*m_inst_columns_iter)->csr;
-  context.loop_map = &(*m_inst_columns_iter)->loop_map;
+  context.loop_map = (*m_inst_columns_iter)->loop_map;
   context.last_inst = ((*m_inst_columns_iter)->csr.pc ==
-                       (*m_inst_columns_iter)->insts.size() - 1) &&
-                      !(*m_inst_columns_iter)
-                           ->insts[(*m_inst_columns_iter)->csr.pc]
-                           .CheckBranchOp();
-  context.max_pc = (*m_inst_columns_iter)->insts.size() - 1;
+                       (*m_inst_columns_iter)->insts->size() - 1) &&
+                      !(*m_inst_columns_iter)->current_inst->CheckBranchOp();
+  context.max_pc = (*m_inst_columns_iter)->insts->size() - 1;
   context.exit = false;
   (*m_inst_columns_iter)->feteched_last = context.last_inst;
   return context;
@@ -114,9 +114,11 @@ void InstructionQueue::cycle() {
         status = m_icache->access(mf->get_addr(), m_config->get_ndp_cycle(), mf, events);
     if (status == HIT || m_ideal_icache) {
       InstColumn *col = mf->get_inst_column();
-      col->current_inst = &col->insts.at(col->csr.pc);
+      load_inst(col);
       col->pending = false;
       m_icache_queue.pop();
+      // L0 hits retire here and never reach the L1 icache
+      delete mf;
     } else if (status != RESERVATION_FAIL) {
       m_icache_queue.pop();
     }
@@ -128,7 +130,7 @@ void InstructionQueue::cycle() {
       InstColumn *col = mf->get_inst_column();
       assert(col->pending);
       col->pending = false;
-      col->current_inst = &col->insts.at(col->csr.pc);
+      load_inst(col);
       delete mf;
     } else
       break;
@@ -136,7 +138,7 @@ void InstructionQueue::cycle() {
   auto iter = m_inst_columns_iter;
   for (int i = 0; i < num_inst_fetch; i++) {
     if ((*iter)->current_inst == NULL && !(*iter)->csr.block &&
-        !(*iter)->pending && (*iter)->csr.pc < (*iter)->insts.size()) {
+        !(*iter)->pending && (*iter)->csr.pc < (*iter)->insts->size()) {
       uint64_t inst_addr = (*iter)->base_addr + (*iter)->csr.pc * WORD_SIZE;
       mem_fetch *mf =
           new mem_fetch(inst_addr, INST_ACC_R, READ_REQUEST, WORD_SIZE,
@@ -173,6 +175,12 @@ void InstructionQueue::finish_inst_column(int col_id) {
   delete col;
 }
 
+void InstructionQueue::load_inst(InstColumn *col) {
+  col->inst_buffer = col->insts->at(col->csr.pc);
+  m_register_unit->RenameFetched(col, col->inst_buffer);
+  col->current_inst = &col->inst_buffer;
+}
+
 bool InstructionQueue::all_empty() { return m_inst_columns.empty(); }
 
 bool InstructionQueue::empty() { return !(*m_inst_columns_iter)->valid; }
@@ -197,7 +205,7 @@ std::deque<InstColumn *>::iterator InstructionQueue::find_inst_column(
 }
 
 bool InstructionQueue::check_finished(std::deque<InstColumn *>::iterator iter) {
-  return (*iter)->insts.size() <= (*iter)->csr.pc;
+  return (*iter)->insts->size() <= (*iter)->csr.pc;
 }
 DependencyKey InstructionQueue::get_dependency_key(InstColumn *inst_column) {
   return std::pair<int, int>(inst_column->kernel_id,
@@ -12,6 +12,7 @@
 #include "cache.h"
 
 #include "ndp_stats.h"
+#include "register_unit.h"
 namespace NDPSim {
 typedef std::pair<int, int> DependencyKey;
 typedef struct {
@@ -22,7 +23,8 @@ typedef struct {
 
 class InstructionQueue {
  public:
-  InstructionQueue(M2NDPConfig *config, int id, int sub_core_id, Cache* icache);
+  InstructionQueue(M2NDPConfig *config, int id, int sub_core_id, Cache* icache,
+                   RegisterUnit* register_unit);
   bool can_push(InstColumn* inst_column);
   void push(InstColumn* inst_column);
   NdpInstruction fetch_instruction();
@@ -35,6 +37,7 @@ class InstructionQueue {
   bool can_fetch();
   Status inst_fetch_fail();
   bool all_empty();
+  bool is_idle() { return all_empty() && m_icache_queue.idle(); }
   bool empty();
   void next();
   int get_num_columns();
@@ -48,12 +51,14 @@ class InstructionQueue {
   int m_l0_icache_hit_latency;
   M2NDPConfig *m_config;
   Cache *m_icache;
+  RegisterUnit *m_register_unit;
   DelayQueue<mem_fetch*> m_icache_queue;
   int32_t m_num_columns;
   std::deque<InstColumn*> m_inst_columns;
   std::deque<InstColumn*>::iterator m_inst_columns_iter;
   std::map<DependencyKey, DependencyInfo> m_dependency_info;
   std::deque<InstColumn*>::iterator find_inst_column(int inst_col_id);
+  void load_inst(InstColumn* col);
   bool check_finished(std::deque<InstColumn*>::iterator iter);
   DependencyKey get_dependency_key(InstColumn* inst_column);
 };
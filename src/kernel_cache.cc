@@ -0,0 +1,105 @@
+#include "kernel_cache.h"
+
+#include <fstream>
+#include <functional>
+#include <set>
+#include <sstream>
+
+#include "m2ndp_config.h"
+#include "m2ndp_parser.h"
+namespace NDPSim {
+typedef std::set<int> RegSet;
+
+std::mutex KernelCache::s_mutex;
+std::map<std::string, std::unique_ptr<NdpKernel>> KernelCache::s_kernels;
+
+const NdpKernel* KernelCache::get_kernel(std::string file_path,
+                                         M2NDPConfig* config) {
+  std::ifstream ifs(file_path);
+  if (!ifs.is_open()) {
+    spdlog::error("Failed to open NDP kernel {}", file_path);
+    throw std::runtime_error("Failed to open NDP kernel");
+  }
+  std::stringstream contents;
+  contents << ifs.rdbuf();
+  std::string key = file_path + "#" +
+                    std::to_string(std::hash<std::string>{}(contents.str()));
+
+  std::lock_guard<std::mutex> lock(s_mutex);
+  auto iter = s_kernels.find(key);
+  if (iter != s_kernels.end()) return iter->second.get();
+
+  NdpKernel* kernel = new NdpKernel();
+  M2NDPParser::parse_ndp_kernel(config->get_num_ndp_units(), file_path, kernel,
+                                config);
+  kernel->valid = true;
+  count_required_regs(kernel->initializer_insts, kernel->initializer_xregs,
+                      kernel->initializer_fregs, kernel->initializer_vregs);
+  kernel->kernel_body_xregs.resize(kernel->num_kernel_bodies);
+  kernel->kernel_body_fregs.resize(kernel->num_kernel_bodies);
+  kernel->kernel_body_vregs.resize(kernel->num_kernel_bodies);
+  for (int i = 0; i < kernel->num_kernel_bodies; i++) {
+    count_required_regs(kernel->kernel_body_insts[i],
+                        kernel->kernel_body_xregs[i],
+                        kernel->kernel_body_fregs[i],
+                        kernel->kernel_body_vregs[i]);
+  }
+  count_required_regs(kernel->finalizer_insts, kernel->finalizer_xregs,
+                      kernel->finalizer_fregs, kernel->finalizer_vregs);
+  kernel->amo_result_used = amo_result_used(kernel->initializer_insts);
+  for (auto& insts : kernel->kernel_body_insts)
+    kernel->amo_result_used |= amo_result_used(insts);
+  s_kernels[key].reset(kernel);
+  spdlog::debug("Parsed NDP kernel {} from {}", kernel->kernel_name,
+                file_path);
+  return kernel;
+}
+
+// Only scalar AMOs write a result; x0 discards it
+bool KernelCache::amo_result_used(const std::deque<NdpInstruction>& insts) {
+  for (NdpInstruction inst : insts) {
+    if (inst.CheckAmoOp() && !inst.CheckVectorOp() && inst.dest != -1 &&
+        inst.dest != REG_X0)
+      return true;
+  }
+  return false;
+}
+
+void KernelCache::count_required_regs(const std::deque<NdpInstruction>& insts,
+                                      int& num_xreg, int& num_freg,
+                                      int& num_vreg) {
+  RegSet used_xregs;
+  RegSet used_fregs;
+  RegSet used_vregs;
+  RegSet used_double_vreg;
+  int vmul = 1;
+  for (NdpInstruction inst : insts) {
+    if (inst.CheckScalarOp()) {
+      if (inst.CheckFloatOp()) {
+        used_fregs.insert(inst.dest);
+      } else if (inst.opcode != CSRWI && inst.opcode != CSRW) {
+        used_xregs.insert(inst.dest);
+      }
+    } else {
+      if (inst.opcode == VSETVLI) {
+        if (inst.src[3] == IMM_M1) {
+          vmul = 1;
+        } else if (inst.src[3] == IMM_M2) {
+          vmul = 2;
+        }
+      } else if (inst.operand_type == F_S) {
+        used_fregs.insert(inst.dest);
+      } else if (inst.opcode != VSE16 && inst.opcode != VSE32 &&
+                 inst.opcode != VSUXEI32) {
+        used_vregs.insert(inst.dest);
+        for (int i = 1; i < vmul; i++) {
+          used_double_vreg.insert(inst.dest);
+        }
+      }
+    }
+  }
+  num_xreg = used_xregs.size();
+  num_freg = used_fregs.size();
+  num_vreg = used_vregs.size() + used_double_vreg.size();
+}
+}  // namespace NDPSim
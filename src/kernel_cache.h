@@ -0,0 +1,30 @@
+#ifndef KERNEL_CACHE_H
+#define KERNEL_CACHE_H
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "common.h"
+namespace NDPSim {
+class M2NDPConfig;
+
+// Process-wide cache of parsed NDP kernels keyed by trace path and content
+// hash. A kernel is parsed and its register usage counted once; the cached
+// NdpKernel is then shared read-only by every memory buffer, host and NDP
+// unit that registers or runs it.
+class KernelCache {
+ public:
+  static const NdpKernel* get_kernel(std::string file_path,
+                                     M2NDPConfig* config);
+  static void count_required_regs(const std::deque<NdpInstruction>& insts,
+                                  int& num_xreg, int& num_freg, int& num_vreg);
+  static bool amo_result_used(const std::deque<NdpInstruction>& insts);
+
+ private:
+  static std::mutex s_mutex;
+  static std::map<std::string, std::unique_ptr<NdpKernel>> s_kernels;
+};
+}  // namespace NDPSim
+#endif
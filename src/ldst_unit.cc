@@ -22,22 +22,23 @@ LDSTUnit::LDSTUnit(M2NDPConfig *config, int ndp_id,
       m_pending_write_count(0),
       m_tlb_waiting_queue(0) {
 
+  bool timing_wheel = config->is_timing_wheel_delay_queue();
   for (int i = 0; i < config->get_num_ldst_units(); i++) {
-    m_ldst_units.push_back(
-        ExecutionDelayQueue("ldst_unit_" + std::to_string(i)));
+    m_ldst_units.push_back(ExecutionDelayQueue(
+        "ldst_unit_" + std::to_string(i), false, -1, timing_wheel));
   }
   for (int i = 0; i < config->get_num_spad_units(); i++) {
-    m_spad_units.push_back(
-        ExecutionDelayQueue("spad_unit_" + std::to_string(i)));
+    m_spad_units.push_back(ExecutionDelayQueue(
+        "spad_unit_" + std::to_string(i), false, -1, timing_wheel));
   }
   
   for (int i = 0; i < config->get_num_v_ldst_units(); i++) {
-    m_v_ldst_units.push_back(
-        ExecutionDelayQueue("v_ldst_unit_" + std::to_string(i)));
+    m_v_ldst_units.push_back(ExecutionDelayQueue(
+        "v_ldst_unit_" + std::to_string(i), false, -1, timing_wheel));
   }
   for (int i = 0; i < config->get_num_v_spad_units(); i++) {
-    m_v_spad_units.push_back(
-        ExecutionDelayQueue("v_spad_unit_" + std::to_string(i)));
+    m_v_spad_units.push_back(ExecutionDelayQueue(
+        "v_spad_unit_" + std::to_string(i), false, -1, timing_wheel));
   }
 
   m_l1_hit_latency = config->get_skip_l1d() ? 0 : config->get_l1d_hit_latency();
@@ -51,6 +52,17 @@ LDSTUnit::LDSTUnit(M2NDPConfig *config, int ndp_id,
     m_to_tlb_queue = fifo_pipeline<mem_fetch>("to_tlb", 0, config->get_request_queue_size());
     m_l1d_cache = new DataCache(std::string("l1d_cache"), m_l1d_config,
                                 m_ndp_id, 0, &m_to_tlb_queue, true);
+    PrefetcherType prefetcher = (PrefetcherType)config->get_l1d_prefetcher();
+    if (prefetcher < NO_PREFETCH || prefetcher > STREAM_PREFETCH) {
+      spdlog::error("Invalid l1d_prefetcher {}", (int)prefetcher);
+      exit(1);
+    }
+    if (prefetcher != NO_PREFETCH)
+      m_prefetcher = new Prefetcher(
+          prefetcher, config->get_l1d_prefetch_degree(),
+          config->get_l1d_prefetch_distance(),
+          config->get_l1d_prefetch_table_size(), m_l1d_cache, &m_l1d_config,
+          stats);
   }
 }
 
@@ -74,29 +86,45 @@ bool LDSTUnit::active() {
          !check_unit_finished();
 }
 
+// Nothing issued, queued or waiting on the L1D/TLB; cycle() would only
+// advance m_cycle
+bool LDSTUnit::is_idle() {
+  if (active() || !check_units_idle(m_ldst_units) ||
+      !check_units_idle(m_spad_units) || !check_units_idle(m_v_ldst_units) ||
+      !check_units_idle(m_v_spad_units) || !m_spad_delay_queue.idle() ||
+      m_tlb->data_ready())
+    return false;
+  if (m_config->get_skip_l1d()) return true;
+  for (auto &latency_queue : m_l1_latency_queue) {
+    if (!latency_queue.idle()) return false;
+  }
+  if (m_prefetcher != NULL && !m_prefetcher->is_idle()) return false;
+  return m_l1d_cache->is_idle() && m_to_tlb_queue.empty();
+}
+
 void LDSTUnit::cycle() {
   m_cycle++;
   std::deque<Status> status_list;
 
   for (auto &ldst_unit : m_ldst_units) {
-    ldst_unit.cycle();
+    if (!ldst_unit.idle()) ldst_unit.cycle();
     process_ldst_inst(ldst_unit);
   }
   for (auto &spad_unit : m_spad_units) {
-    spad_unit.cycle();
+    if (!spad_unit.idle()) spad_unit.cycle();
     process_spad_inst(spad_unit);
   }
   
   for (auto &v_ldst_unit : m_v_ldst_units) {
-    v_ldst_unit.cycle();
+    if (!v_ldst_unit.idle()) v_ldst_unit.cycle();
     process_ldst_inst(v_ldst_unit);
   }
   for (auto &v_spad_unit : m_v_spad_units) {
-    v_spad_unit.cycle();
+    if (!v_spad_unit.idle()) v_spad_unit.cycle();
     process_spad_inst(v_spad_unit);
   }
   
-  m_spad_delay_queue.cycle();
+  if (!m_spad_delay_queue.idle()) m_spad_delay_queue.cycle();
 
   // Tlb handle
   bool queue_full = false;
@@ -125,6 +153,7 @@ void LDSTUnit::cycle() {
     m_l1d_cache->cycle();
     l1_latency_queue_cycle();
     process_l1d_access();
+    if (m_prefetcher != NULL) issue_prefetch();
   }
 }
 
@@ -169,6 +198,13 @@ Status LDSTUnit::issue_ldst_unit(NdpInstruction inst, Context context, bool spad
   }
 }
 
+// Kernel body that issued an access, used as the SHiP reuse signature
+uint32_t LDSTUnit::get_signature(const Context &context) {
+  RequestInfo *info = context.request_info;
+  if (info == NULL) return 0;
+  return ((info->kernel_id + 1) << 8) ^ (info->type << 6) ^ info->kernel_body_id;
+}
+
 void LDSTUnit::process_ldst_inst(ExecutionDelayQueue &ldst_unit) {
   if (ldst_unit.empty()) return;
   NdpInstruction inst = ldst_unit.top().first;
@@ -187,6 +223,7 @@ void LDSTUnit::process_ldst_inst(ExecutionDelayQueue &ldst_unit) {
       mf->set_from_ndp(true);
       mf->set_ndp_id(m_ndp_id);
       mf->set_channel(m_config->get_channel_index(addr));
+      mf->set_signature(get_signature(context));
       if(m_config->is_bi_enabled()) {
         if( rand() % 100 < (m_config->get_bi_rate()*100) 
           && !m_config->is_handled_bi_addr(addr) && !m_config->is_bi_inprogress(addr)) {
@@ -195,13 +232,13 @@ void LDSTUnit::process_ldst_inst(ExecutionDelayQueue &ldst_unit) {
           m_config->insert_inprogress_bi_addr(addr);
           m_config->m_inprogress_mfs[(uint64_t) mf->get_addr()/m_config->get_bi_unit_size()] =  mf;
           mf->set_data_size(m_config->get_bi_unit_size());
-          mf->current_state = "BI_LOAD";
+          mf->current_state = MF_BI_LOAD;
         }
         else if (!m_config->is_handled_bi_addr(addr) && !m_config->is_bi_inprogress(addr)) {
           m_config->insert_handled_bi_addr(addr);
-          mf->current_state = "NOT BI";
+          mf->current_state = MF_NOT_BI;
         } else if (m_config->is_bi_inprogress(addr)) {
-          mf->current_state = "BI_INPROGRESS";
+          mf->current_state = MF_BI_INPROGRESS;
           assert(m_config->m_inprogress_mfs.find((uint64_t) mf->get_addr()/m_config->get_bi_unit_size())->second->get_ndp_id() == m_ndp_id);
         }
       }
@@ -217,12 +254,19 @@ void LDSTUnit::process_ldst_inst(ExecutionDelayQueue &ldst_unit) {
       if (inst.CheckAmoOp())  // Global Atomic opeation performs on L2 cache
       {
         mf->set_atomic(true);
+        // The L2 atomic unit returns only the old value
+        if (m_config->get_l2d_atomic_units())
+          mf->set_data_size(ATOMIC_PACKET_SIZE);
         m_l1_latency_queue[bank_id].push(mf, 0);
       }
       else {
         m_l1_latency_queue[bank_id].push(mf, m_l1_hit_latency);
       }
     }
+    if (m_prefetcher != NULL && !inst.CheckAmoOp()) {
+      uint64_t key = (uint64_t)inst.sInst ^ get_signature(context);
+      m_prefetcher->train_load(key, *inst.addr_set.begin());
+    }
     m_pending_ldst[info->key_mf] = inst;
     m_pending_ldst_context[info->key_mf] = context;
   } else {
@@ -236,6 +280,7 @@ void LDSTUnit::process_ldst_inst(ExecutionDelayQueue &ldst_unit) {
       mf->set_from_ndp(true);
       mf->set_ndp_id(m_ndp_id);
       mf->set_channel(m_config->get_channel_index(addr));
+      mf->set_signature(get_signature(context));
       if(m_config->is_bi_enabled()) {
         if(rand() % 100 < (m_config->get_bi_rate()*100) && !m_config->is_handled_bi_addr(addr)
         && !m_config->is_bi_inprogress(addr)) {
@@ -352,6 +397,13 @@ bool LDSTUnit::check_units_finished(
   return finish;
 }
 
+bool LDSTUnit::check_units_idle(std::vector<ExecutionDelayQueue> &units) {
+  for (auto &unit : units) {
+    if (!unit.idle()) return false;
+  }
+  return true;
+}
+
 std::vector<ExecutionDelayQueue> &LDSTUnit::get_ldst_unit(
     NdpInstruction inst, bool spad) {
   if (spad) {
@@ -378,6 +430,22 @@ CacheStats LDSTUnit::get_l1d_stats() {
     return CacheStats();
 }
 
+void LDSTUnit::register_stats(const std::string &prefix) {
+  if (!m_config->get_skip_l1d()) m_l1d_cache->register_stats(prefix);
+}
+
+void LDSTUnit::save_state(std::ostream &os) {
+  if (!m_config->get_skip_l1d()) m_l1d_cache->save_state(os);
+}
+
+void LDSTUnit::load_state(std::istream &is) {
+  if (!m_config->get_skip_l1d()) m_l1d_cache->load_state(is);
+}
+
+void LDSTUnit::warm_l1d(uint64_t addr, bool write) {
+  if (!m_config->get_skip_l1d()) m_l1d_cache->warm(addr, write, m_cycle);
+}
+
 bool LDSTUnit::check_l1_hit_pipeline_full(NdpInstruction &inst) {
   std::vector<int> bank_count = std::vector<int>(m_config->get_l1d_num_banks(), 0);
   for(auto iter : inst.addr_set) {
@@ -395,7 +463,7 @@ bool LDSTUnit::check_l1_hit_pipeline_full(NdpInstruction &inst) {
 void LDSTUnit::l1_latency_queue_cycle() {
   for(int bank = 0; bank < m_config->get_l1d_num_banks(); bank++) {
     int max_index = 0;
-    m_l1_latency_queue[bank].cycle();
+    if (!m_l1_latency_queue[bank].idle()) m_l1_latency_queue[bank].cycle();
   }
 }
 
@@ -407,7 +475,7 @@ void LDSTUnit::process_l1d_access() {
       // if ((mf->is_atomic() || m_config->get_skip_l1d() ||m_config->is_bi_inprogress(mf->get_addr())) &&
       if ((mf->is_atomic() || m_config->get_skip_l1d()) &&
           !m_to_tlb_queue.full()) {
-        mf->current_state = "to TLB queue";
+        mf->current_state = MF_TO_TLB_QUEUE;
         m_to_tlb_queue.push(mf);
         m_l1_latency_queue[bank].pop();
       }
@@ -423,20 +491,22 @@ void LDSTUnit::process_l1d_access() {
             m_l1d_cache->access(mf->get_addr(), m_cycle, mf, events);
         bool write_sent = CacheEvent::was_write_sent(events);
         bool read_sent = CacheEvent::was_read_sent(events);
+        if (m_prefetcher != NULL && !mf->is_write())
+          m_prefetcher->demand_access(mf->get_addr(), status);
         if (status == HIT) {
           m_l1_latency_queue[bank].pop();
-          mf->current_state = "L1 hit\n";
+          mf->current_state = MF_L1_HIT;
           if (!write_sent) {
             mf->set_reply();
             handle_response(mf);
           }
         } else if (status == RESERVATION_FAIL) {
-          mf->current_state = "L1 reservation fail\n";
+          mf->current_state = MF_L1_RESERVATION_FAIL;
           assert(!read_sent);
           assert(!write_sent);
         } else {
           assert(status == MISS || status == HIT_RESERVED);
-          mf->current_state = "L1 miss\n";
+          mf->current_state = MF_L1_MISS;
           m_l1_latency_queue[bank].pop();
           if (mf->is_write() &&
               m_l1d_config.get_write_policy() != WRITE_THROUGH &&
@@ -453,8 +523,13 @@ void LDSTUnit::process_l1d_access() {
     if(m_l1d_cache->access_ready()) {
       mem_fetch* mf = m_l1d_cache->top_next_access();
       assert(mf);
-      if (mf->is_request()) mf->set_reply();
-      handle_response(mf);
+      if (mf->is_prefetch(L1D_PREFETCH)) {
+        m_prefetcher->filled(mf->get_addr());
+        delete mf;
+      } else {
+        if (mf->is_request()) mf->set_reply();
+        handle_response(mf);
+      }
       m_l1d_cache->pop_next_access();
     }
     //L1 cache to TLB
@@ -470,6 +545,37 @@ void LDSTUnit::process_l1d_access() {
   }
 }
 
+// At most one prefetch request per cycle, and only into spare L1D bandwidth:
+// the target bank has no demand access waiting, a quarter of the MSHRs stay
+// free for demand misses and the miss path to the TLB is at most half full.
+// Candidates that find no room are dropped rather than queued behind demand.
+void LDSTUnit::issue_prefetch() {
+  if (!m_prefetcher->has_candidate()) return;
+  uint64_t addr = m_prefetcher->top_candidate();
+  int bank = m_config->get_bank_index(addr) % m_config->get_l1d_num_banks();
+  if (!m_l1_latency_queue[bank].empty() || !m_l1d_cache->data_port_free())
+    return;
+  m_prefetcher->pop_candidate();
+  if (m_l1d_cache->get_mshr_free_entries() <=
+          m_l1d_config.get_mshr_entries() / 4 ||
+      m_to_tlb_queue.get_length() * 2 >= m_to_tlb_queue.get_max_len()) {
+    m_prefetcher->dropped();
+    return;
+  }
+  mem_fetch *mf = new mem_fetch(addr, GLOBAL_ACC_R, READ_REQUEST,
+                                m_config->get_packet_size(), CXL_OVERHEAD,
+                                m_cycle);
+  mf->set_from_ndp(true);
+  mf->set_ndp_id(m_ndp_id);
+  mf->set_channel(m_config->get_channel_index(addr));
+  mf->set_prefetch(L1D_PREFETCH);
+  std::deque<CacheEvent> events;
+  CacheRequestStatus status = m_l1d_cache->access(addr, m_cycle, mf, events);
+  m_prefetcher->issued(addr, status);
+  // MISS and HIT_RESERVED keep the request in the MSHRs until the fill
+  if (status == HIT || status == RESERVATION_FAIL) delete mf;
+}
+
 void LDSTUnit::handle_response(mem_fetch* mf) {
   // assert(mf->get_from_ndp() && mf->get_ndp_id() == m_ndp_id);
   assert(!mf->is_request());
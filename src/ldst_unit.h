@@ -14,6 +14,7 @@
 #include "tlb.h"
 #include "ndp_stats.h"
 #include "cache.h"
+#include "prefetcher.h"
 namespace NDPSim {
 
 
@@ -31,13 +32,19 @@ class LDSTUnit {
                 Tlb *tlb, NdpStats *stats);
   void set_l1d_size(int smem_size);
   bool active();
+  bool is_idle();
   void cycle();
+  void idle_cycle() { m_cycle++; }
   Status issue_ldst_unit(NdpInstruction inst, Context context, bool spad_op);
   bool full();
   bool check_unit_finished();
   void handle_from_mem(int bank);
   void dump_current_state();
   CacheStats get_l1d_stats();
+  void register_stats(const std::string &prefix);
+  void save_state(std::ostream &os);
+  void load_state(std::istream &is);
+  void warm_l1d(uint64_t addr, bool write);
 
  private:
   int m_ndp_id;
@@ -45,6 +52,7 @@ class LDSTUnit {
   int m_l1d_banks;
   CacheConfig m_l1d_config;
   DataCache *m_l1d_cache;
+  Prefetcher *m_prefetcher = NULL;
   std::vector<std::vector<mem_fetch*>> m_l1_latency_queue_;
   std::vector<DelayQueue<mem_fetch*>> m_l1_latency_queue;
   fifo_pipeline<mem_fetch> m_to_tlb_queue;
@@ -73,9 +81,11 @@ class LDSTUnit {
 
   std::set<uint64_t> m_lock_spad_addr;
   void process_ldst_inst(ExecutionDelayQueue &ldst_unit);
+  static uint32_t get_signature(const Context &context);
   void process_spad_inst(ExecutionDelayQueue &spad_unit);
   bool check_units_full(std::vector<ExecutionDelayQueue> &units);
   bool check_units_finished(std::vector<ExecutionDelayQueue> &units);
+  bool check_units_idle(std::vector<ExecutionDelayQueue> &units);
   std::vector<ExecutionDelayQueue> &get_ldst_unit(NdpInstruction inst, bool spad);
   int m_l1_hit_latency;
   int m_max_l1_latency_queue_size;
@@ -83,6 +93,7 @@ class LDSTUnit {
   bool check_l1_hit_pipeline_full(NdpInstruction &inst);
   void l1_latency_queue_cycle();
   void process_l1d_access();
+  void issue_prefetch();
   void handle_response(mem_fetch* mf);
 };
 }  // namespace NDPSim
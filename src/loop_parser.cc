@@ -33,16 +33,13 @@ void LoopParser::ParseNDPKernels(std::string file_path) {
       ss >> std::dec >> num_kernel;
     } else {
       // trace file path
-      NdpKernel ndp_kernel;
-      M2NDPParser::parse_ndp_kernel(num_ndp, line, &ndp_kernel, config);
-
-      kernels.push_back(ndp_kernel);
+      kernels.push_back(KernelCache::get_kernel(line, config));
     }
   }
   assert(kernels.size() == num_kernel);
 }
 
-std::vector<NdpKernel>* LoopParser::GetNDPKernels() {
+std::vector<const NdpKernel*>* LoopParser::GetNDPKernels() {
   return &kernels;
 }
 
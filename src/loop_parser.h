@@ -1,6 +1,7 @@
 #ifndef FUNCSIM_INSTRUCTION_LOOP_PARSER_H_
 #define FUNCSIM_INSTRUCTION_LOOP_PARSER_H_
 
+#include "kernel_cache.h"
 #include "m2ndp_parser.h"
 #include "m2ndp_config.h"
 namespace NDPSim {
@@ -8,13 +9,13 @@ namespace NDPSim {
 class LoopParser {
 public:
   LoopParser(M2NDPConfig *config, std::string file_path);
-  std::vector<NdpKernel>* GetNDPKernels();
+  std::vector<const NdpKernel*>* GetNDPKernels();
   int GetNumKernel();
   int GetNumLoop();
 
 private:
   
-  std::vector<NdpKernel> kernels;
+  std::vector<const NdpKernel*> kernels;
   M2NDPConfig *config;
 
   int num_loop;
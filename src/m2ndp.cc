@@ -1,12 +1,14 @@
 #ifdef TIMING_SIMULATION
 #include "m2ndp.h"
 
+#include <algorithm>
 #include <bitset>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
 
+#include "kernel_cache.h"
 #include "ndp_instruction.h"
 namespace NDPSim {
 static unsigned long long global_launch_id = 0;
@@ -44,15 +46,37 @@ M2NDP::M2NDP(M2NDPConfig *config, MemoryMap *memory_map,
       buffer_id, ndp_id, m_memory_map, &tot_cycles, m_config->m_num_hosts + 1,
       m_config->m_ramulator_config_path, m_config, name);
 
+  // NDP units can be ticked in parallel. Random BI injection and DRAM-TLB
+  // miss handling update shared state in an order-dependent way, so they
+  // always run serially to keep results identical to a single thread.
+  int num_threads = std::min(m_config->get_num_ndp_threads(), m_num_ndp_units);
+  if (num_threads > 1 && (m_config->is_bi_enabled() ||
+                          m_config->is_dram_tlb_miss_handling_enabled())) {
+    spdlog::warn(
+        "CXL {} : num_ndp_threads is ignored with random BI or DRAM-TLB miss "
+        "handling enabled",
+        m_buffer_id);
+    num_threads = 1;
+  }
+  m_worker_pool = NULL;
+  m_ndp_memory_map = m_memory_map;
+  if (num_threads > 1) {
+    m_worker_pool = new NdpWorkerPool(num_threads);
+    m_ndp_memory_map = new SynchronizedMemoryMap(m_memory_map);
+  }
+
   m_ndp_units.resize(m_num_ndp_units);
   m_ndp_stats.resize(m_num_ndp_units);
   for (int i = 0; i < m_num_ndp_units; i++) {
     int id = m_buffer_id * m_num_ndp_units + i;
     id = get_ndp_id(i);
     m_ndp_stats[i].set_num_sub_core(m_config->get_num_sub_core());
-    m_ndp_units[i] = new NdpUnit(m_config, m_memory_map, &m_ndp_stats[i], id);
+    m_ndp_units[i] =
+        new NdpUnit(m_config, m_ndp_memory_map, &m_ndp_stats[i], id);
+    m_ndp_units[i]->register_stats(get_stats_prefix() + std::to_string(id));
+    // Units ticked on different threads apply their writes in id order
+    m_ndp_units[i]->set_defer_global_writes(m_worker_pool != NULL);
   }
-  m_total_stats.set_num_sub_core(m_config->get_num_sub_core());
   m_ndp_kernels.resize(m_config->m_num_hosts);
   m_host_round_robin.resize(m_config->m_num_hosts);
   m_cxl_command_response.resize(m_config->get_links_per_memory_buffer());
@@ -66,7 +90,12 @@ M2NDP::M2NDP(M2NDPConfig *config, MemoryMap *memory_map,
   m_uthread_reqs.resize(m_ndp_units.size(), 0);
 }
 
-M2NDP::~M2NDP() { delete m_ramulator; }
+M2NDP::~M2NDP() {
+  for (NdpUnit *unit : m_ndp_units) delete unit;
+  delete m_ramulator;
+  if (m_worker_pool != NULL) delete m_worker_pool;
+  if (m_ndp_memory_map != m_memory_map) delete m_ndp_memory_map;
+}
 
 void M2NDP::cxl_link_cycle() {
   transfer_cxl_to_memory();
@@ -74,22 +103,30 @@ void M2NDP::cxl_link_cycle() {
 }
 
 void M2NDP::cycle() {
-  int cxl_port_offset = m_config->get_links_per_memory_buffer() * m_num_banks;
   if (m_config->is_link_cycle()) {
     cxl_link_cycle();
   }
+  cache_cycle();
+  crossbar_cycle();
+  ndp_cycle();
+  check_kernel_active();
+}
 
+void M2NDP::cache_cycle() {
   if (m_config->is_cache_cycle()) {
     m_ramulator->cache_cycle();
   }
+}
 
+void M2NDP::crossbar_cycle() {
+  int cxl_port_offset = m_config->get_links_per_memory_buffer() * m_num_banks;
   if (m_config->is_buffer_ndp_cycle()) {
     // NDP to ICNT
     for (int i = 0; i < m_num_ndp_units; i++) {
       for (int bank = 0; bank < m_config->get_l2d_num_banks(); bank++) {
         if (!m_ndp_units[i]->to_mem_empty(bank)) {
           mem_fetch *mf = m_ndp_units[i]->top_to_mem(bank);
-          mf->current_state = "top to mem";
+          mf->current_state = MF_TOP_TO_MEM;
           int input_id = cxl_port_offset + i * m_num_banks + bank;
           int output_id = get_output_port_id(mf);
           if(m_config->is_sc_work_addr()) {
@@ -99,7 +136,7 @@ void M2NDP::cycle() {
               m_ndp_units[i]->pop_to_mem(bank);
             }
           } else if (m_icnt->HasBuffer(input_id, mf->get_size(), mf->get_from_ndp())) {
-            mf->current_state = "m_ndp -> push icnt";
+            mf->current_state = MF_NDP_TO_ICNT;
             m_icnt->Push(input_id, output_id, mf, mf->get_size());
             m_ndp_units[i]->pop_to_mem(bank);
           }
@@ -113,13 +150,13 @@ void M2NDP::cycle() {
         if (!m_ndp_units[i]->from_mem_full(bank) &&
             m_icnt->Top(port_id) != NULL) {
           mem_fetch *mf = (mem_fetch *)m_icnt->Top(port_id);
-          mf->current_state = "icnt -> to ndp";
+          mf->current_state = MF_ICNT_TO_NDP;
           if (!mf->is_request() || mf->get_ndp_id() == get_ndp_id(i)) {
-            mf->current_state = "icnt -> to ndp push";
+            mf->current_state = MF_ICNT_TO_NDP_PUSH;
             m_ndp_units[i]->push_from_mem(mf, bank);
             m_icnt->Pop(port_id);
           } else {
-            mf->current_state = "other port";
+            mf->current_state = MF_OTHER_PORT;
             m_icnt->Push(port_id, 0, mf, mf->get_size());
           }
         }
@@ -135,7 +172,7 @@ void M2NDP::cycle() {
           mem_fetch *mf = m_ramulator->top(i, bank);
           int output_id = get_output_port_id(mf);
           if (m_icnt->HasBuffer(input_id, mf->get_size(), mf->get_from_ndp())) {
-            mf->current_state = "to crossbar -> icnt";
+            mf->current_state = MF_CROSSBAR_TO_ICNT;
             m_icnt->Push(input_id, output_id, mf, mf->get_size());
             m_ramulator->pop(i, bank);
           }
@@ -150,7 +187,7 @@ void M2NDP::cycle() {
         input_id += i * m_num_banks + bank;
         if (!m_ramulator->full(i, bank) && m_icnt->Top(input_id) != NULL) {
           mem_fetch *mf = (mem_fetch *)m_icnt->Top(input_id);
-          mf->current_state = "icnt -> to ramulator";
+          mf->current_state = MF_ICNT_TO_RAMULATOR;
           assert(m_config->get_channel_index(mf->get_addr()) == i);
           m_ramulator->push(mf, i, bank);
           m_icnt->Pop(input_id);
@@ -166,23 +203,61 @@ void M2NDP::cycle() {
         m_ndp_units[i]->print_uthread_stats();
       }
     }
+  }
+}
+
+void M2NDP::ndp_cycle() {
+  if (m_config->is_buffer_ndp_cycle()) {
+    if (m_worker_pool != NULL) {
+      m_worker_pool->run(m_num_ndp_units,
+                         [this](int i) { m_ndp_units[i]->cycle(); });
+    } else {
+      for (int i = 0; i < m_num_ndp_units; i++) {
+        m_ndp_units[i]->cycle();
+      }
+    }
+    // Serially and in unit id order, so memory contents and the L2 tags
+    // warmed by fast-forwarded uthreads do not depend on the thread schedule.
+    // Nothing is deferred when the units are ticked serially.
     for (int i = 0; i < m_num_ndp_units; i++) {
-      m_ndp_units[i]->cycle();
-      
+      m_ndp_units[i]->commit_global_writes();
+      for (auto &access : m_ndp_units[i]->pop_fast_forward_accesses())
+        m_ramulator->warm(access.addr, access.write);
     }
   }
   if (m_config->is_buffer_dram_cycle()) {
     m_ramulator->dram_cycle();
   }
   tot_cycles = m_config->get_sim_cycle();
-  check_kernel_active();
+}
+
+uint64_t M2NDP::idle_dram_cycles() { return m_ramulator->idle_dram_cycles(); }
+
+// Skips ticks of an idle buffer. Link, crossbar, cache and NDP pipelines
+// have nothing to do, so only the unit cycle counters and the DRAM clocks
+// advance; the caller keeps dram_cycles within idle_dram_cycles().
+void M2NDP::skip_idle(uint64_t ndp_cycles, uint64_t dram_cycles) {
+  for (int i = 0; i < m_num_ndp_units; i++) {
+    m_ndp_units[i]->idle_cycle(ndp_cycles);
+  }
+  m_ramulator->skip_idle_dram_cycles(dram_cycles);
+  tot_cycles = m_config->get_sim_cycle();
 }
 
 void M2NDP::register_ndp_kernel(int host_id, string kernel_path) {
-  NdpKernel *ndp_kernel = new NdpKernel();
+  const NdpKernel *ndp_kernel = KernelCache::get_kernel(kernel_path, m_config);
   m_ndp_kernels[host_id].push_back(ndp_kernel);
-  M2NDPParser::parse_ndp_kernel(m_config->get_num_ndp_units(), kernel_path,
-                               ndp_kernel, m_config);
+  // Deferred AMOs cannot return the value a serial run would, so kernels
+  // that read AMO results run with the units ticked serially
+  if (m_worker_pool != NULL && ndp_kernel->amo_result_used) {
+    spdlog::warn(
+        "CXL {} : kernel {} reads AMO results, num_ndp_threads is ignored",
+        m_buffer_id, ndp_kernel->kernel_name);
+    delete m_worker_pool;
+    m_worker_pool = NULL;
+    for (int j = 0; j < m_num_ndp_units; j++)
+      m_ndp_units[j]->set_defer_global_writes(false);
+  }
   spdlog::info(
       "Host {} Registered NDP kernel {} at  core cycle {} ndp cycle "
       "{} to CXL {}",
@@ -199,14 +274,31 @@ bool M2NDP::can_register_ndp_kernel(int host_id) {
 }
 
 bool M2NDP::is_active() {
+  return is_buffer_active() ||
+         (m_config->get_num_hosts() > 0 && m_cxl_link->is_active());
+}
+
+// Activity of this memory buffer, not counting the shared CXL link
+bool M2NDP::is_buffer_active() {
   bool active = false;
   for (int i = 0; i < m_config->get_num_hosts(); i++) {
-    active = active || is_launch_active(i) || m_cxl_link->is_active() ||
-             m_ramulator->is_active();
+    active = active || is_launch_active(i) || m_ramulator->is_active();
   }
   return active;
 }
 
+// Stronger than !is_active(): also requires the local crossbar, pending
+// command responses and every NDP unit pipeline to be drained
+bool M2NDP::is_idle() {
+  if (is_buffer_active() || m_icnt->Busy() || !m_launch_infos.empty())
+    return false;
+  for (auto &responses : m_cxl_command_response)
+    if (!responses.empty()) return false;
+  for (int i = 0; i < m_num_ndp_units; i++)
+    if (m_ndp_units[i]->is_active()) return false;
+  return true;
+}
+
 bool M2NDP::is_launch_active(int host_id) {
   for (auto iter = m_launch_infos.begin(); iter != m_launch_infos.end();
        iter++) {
@@ -225,26 +317,57 @@ void M2NDP::display_stats(FILE *fp) {
   m_icnt->DisplayStats(fp);
   m_ramulator->finish();
   m_ramulator->print_all(fp);
-  m_total_stats = m_ndp_stats[0];
   for (int i = 0; i < m_num_ndp_units; i++) {
     m_ndp_units[i]->get_stats();
     fprintf(fp, "======= NDP unit %d stats ======\n", i);
     m_ndp_stats[i].print_stats(fp);
-    if(i != 0)
-     m_total_stats += m_ndp_stats[i];
   }
+  NdpStats total_stats;
+  total_stats.set_num_sub_core(m_config->get_num_sub_core());
+  total_stats.load_totals(get_stats_prefix());
+  for (int i = 0; i < m_num_ndp_units; i++)
+    total_stats.add_unit_details(m_ndp_stats[i]);
   fprintf(fp, "======= Total NDP ======\n");
-  m_total_stats.print_stats(fp);
+  total_stats.print_stats(fp);
+  if (m_config->is_sampling_enabled()) display_sampling_stats(fp);
 }
 
-void M2NDP::print_energy_stats(FILE *fp) {
-  m_ramulator->print_energy_stats(fp);
-  NdpStats total;
-  total.set_num_sub_core(m_config->get_num_sub_core());
+// A launch ends with its slowest NDP unit, so each launch reports the unit
+// with the largest extrapolated cycle count. A launch still running on any
+// unit has no cycle count yet and is reported as unfinished.
+void M2NDP::display_sampling_stats(FILE *fp) {
+  std::map<int, const LaunchSample *> slowest;
   for (int i = 0; i < m_num_ndp_units; i++) {
-    total += m_ndp_units[i]->get_stats();
+    for (auto &[launch_id, sample] : m_ndp_units[i]->get_launch_samples()) {
+      auto iter = slowest.find(launch_id);
+      if (iter == slowest.end() || !sample.finished ||
+          (iter->second->finished &&
+           iter->second->estimated_cycles() < sample.estimated_cycles()))
+        slowest[launch_id] = &sample;
+    }
+  }
+  fprintf(fp, "======= Sampled launches ======\n");
+  for (auto &[launch_id, sample] : slowest) {
+    if (!sample->finished) {
+      fprintf(fp, "launch %d %s: unfinished\n", launch_id,
+              sample->kernel_name.c_str());
+      continue;
+    }
+    fprintf(fp,
+            "launch %d %s: simulated_cycles %lu detailed_uthreads %lu "
+            "windows %lu skipped_uthreads %lu cycles_per_uthread %.2f "
+            "estimated_cycles %.0f +- %.0f (95%% CI)\n",
+            launch_id, sample->kernel_name.c_str(),
+            sample->end_cycle - sample->start_cycle, sample->detailed_uthreads,
+            sample->window_cycles_per_uthread.size(),
+            sample->skipped_uthreads, sample->mean_cycles_per_uthread(),
+            sample->estimated_cycles(), sample->confidence_interval());
   }
-  total.print_energy_stats(fp);
+}
+
+void M2NDP::print_energy_stats(FILE *fp) {
+  m_ramulator->print_energy_stats(fp);
+  NdpStats::print_energy_totals(fp, get_stats_prefix());
   m_icnt->print_energy_stats(fp, "XBAR");
   fprintf(fp, "STATIC: %lf\n", m_config->m_buffer_ndp_time * m_config->m_num_ndp_units);
   fprintf(fp, "CONST: %lf\n", m_config->m_buffer_ndp_time);
@@ -382,6 +505,11 @@ int M2NDP::get_ndp_id(int index) {
   return m_buffer_id * m_num_ndp_units + index;
 }
 
+// NDP units register as m2ndp<buffer>.ndp<id>
+std::string M2NDP::get_stats_prefix() {
+  return "m2ndp" + std::to_string(m_buffer_id) + ".ndp";
+}
+
 int M2NDP::get_output_port_id(mem_fetch *mf) {
   // Process from host request
   int ndp_port_offset = m_num_ndp_units * m_num_banks;
@@ -453,6 +581,23 @@ void M2NDP::print_access_time(FILE* fp) {
   }
 }
 
+void M2NDP::save_state(std::ostream &os) {
+  assert(is_idle());
+  m_ramulator->save_state(os);
+  for (int i = 0; i < m_num_ndp_units; i++) m_ndp_units[i]->save_state(os);
+}
+
+void M2NDP::load_state(std::istream &is) {
+  m_ramulator->load_state(is);
+  for (int i = 0; i < m_num_ndp_units; i++) m_ndp_units[i]->load_state(is);
+}
+
+unsigned long long M2NDP::get_global_launch_id() { return global_launch_id; }
+
+void M2NDP::set_global_launch_id(unsigned long long launch_id) {
+  global_launch_id = launch_id;
+}
+
 std::string M2NDP::get_kernel_name(int host_id, int kernel_id) {
   for (auto kernel : m_ndp_kernels[host_id]) {
     if (kernel->kernel_id == kernel_id) {
@@ -5,6 +5,7 @@
 #include "cxl_link.h"
 #include "ndp_ramulator.h"
 #include "m2ndp_config.h"
+#include "ndp_worker_pool.h"
 #include "common.h"
 namespace NDPSim {
 
@@ -14,14 +15,29 @@ class M2NDP {
   ~M2NDP();
   void cxl_link_cycle();
   void cycle();
+  void cache_cycle();
+  void crossbar_cycle();
+  void ndp_cycle();
+  void check_kernel_active();
+  // DRAM ticks an idle buffer can skip, see NdpRamulator::idle_dram_cycles
+  uint64_t idle_dram_cycles();
+  void skip_idle(uint64_t ndp_cycles, uint64_t dram_cycles);
   void set_cxl_link(CxlLink *link) { m_cxl_link = link; }
   void register_ndp_kernel(int host_id, string kernel_path);
   bool can_register_ndp_kernel(int host_id);
   bool is_active();
+  bool is_buffer_active();
+  bool is_idle();
   bool is_launch_active(int launch_id);
   void display_stats(FILE *fp);
+  void display_sampling_stats(FILE *fp);
   void print_energy_stats(FILE *fp);
   void print_access_time(FILE *fp);
+  // Warm cache/TLB state of an idle memory buffer, see SimulationRunner
+  void save_state(std::ostream &os);
+  void load_state(std::istream &is);
+  static unsigned long long get_global_launch_id();
+  static void set_global_launch_id(unsigned long long launch_id);
 
  private:
   int m_buffer_id;
@@ -33,6 +49,8 @@ class M2NDP {
   CxlLink *m_cxl_link;
   InterconnectInterface *m_icnt;
   MemoryMap *m_memory_map;
+  MemoryMap *m_ndp_memory_map;
+  NdpWorkerPool *m_worker_pool;
   int m_num_m2ndp;
   int m_num_ndp_units;
   int m_num_banks;
@@ -42,12 +60,11 @@ class M2NDP {
   std::vector<int> m_num_write_request;
   std::vector<int> m_num_write_response;
   std::vector<int> m_host_round_robin;
-  std::vector<std::vector<NdpKernel*>> m_ndp_kernels;
+  std::vector<std::vector<const NdpKernel*>> m_ndp_kernels;
   std::vector<KernelLaunchInfo> m_launch_infos;
 
   std::vector<NdpUnit*> m_ndp_units;
   std::vector<NdpStats> m_ndp_stats;
-  NdpStats m_total_stats;
 
   std::vector<std::deque<mem_fetch*>> m_cxl_command_response;
 
@@ -59,9 +76,9 @@ class M2NDP {
   void launch_ndp_kernel(int host_id, KernelLaunchInfo launch_info);
   void transfer_cxl_to_memory();
   void transfer_memory_to_cxl();
-  void check_kernel_active();
 
   int get_ndp_id(int index);
+  std::string get_stats_prefix();
   int get_output_port_id(mem_fetch* mf);
   void count_access_per_m2ndp(mem_fetch* mf);
 };
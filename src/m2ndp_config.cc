@@ -1,7 +1,11 @@
 #include "m2ndp_config.h"
 
+#include <algorithm>
 #include <bitset>
+#include <cassert>
+#include <cmath>
 
+#include "checkpoint.h"
 #include "m2ndp_parser.h"
 #include "hashing.h"
 #define CORE 0x01
@@ -97,39 +101,84 @@ const bool M2NDPConfig::is_buffer_ndp_cycle() {
 
 const bool M2NDPConfig::is_cache_cycle() { return m_clock_mask & CACHE; }
 
-int M2NDPConfig::next_clock_domain() {
+// Clock domains ticking next, without advancing them
+int M2NDPConfig::peek_clock_domain() {
   double smallest = min3(m_link_time, m_buffer_dram_time, m_buffer_ndp_time);
   smallest = min3(smallest, m_core_time, m_dram_time);
   smallest = gs_min2(smallest, m_cache_time);
   int mask = 0x00;
-  if (m_link_time <= smallest) {
-    m_link_time += m_link_period;
-    mask |= LINK;
-  }
-  if (m_buffer_dram_time <= smallest) {
-    m_buffer_dram_time += m_buffer_dram_period;
-    mask |= BUFFER_DRAM;
-  }
-  if (m_buffer_ndp_time <= smallest) {
-    m_buffer_ndp_time += m_buffer_ndp_period;
-    mask |= BUFFER_NDP;
+  if (m_link_time <= smallest) mask |= LINK;
+  if (m_buffer_dram_time <= smallest) mask |= BUFFER_DRAM;
+  if (m_buffer_ndp_time <= smallest) mask |= BUFFER_NDP;
+  if (m_cache_time <= smallest) mask |= CACHE;
+  if (m_core_time <= smallest) mask |= CORE;
+  if (m_dram_time <= smallest) mask |= DRAM;
+  return mask;
+}
+
+// A domain's time is its tick count times its period rather than a running
+// sum, so skip_cycles() reaches the same times as ticking every cycle
+int M2NDPConfig::next_clock_domain() {
+  int mask = peek_clock_domain();
+  if (mask & LINK) m_link_time = ++m_link_ticks * m_link_period;
+  if (mask & BUFFER_DRAM)
+    m_buffer_dram_time = ++m_buffer_dram_ticks * m_buffer_dram_period;
+  if (mask & BUFFER_NDP) {
+    m_buffer_ndp_time = ++m_buffer_ndp_ticks * m_buffer_ndp_period;
     m_ndp_cycle++;
   }
-  if (m_cache_time <= smallest) {
-    m_cache_time += m_cache_period;
-    mask |= CACHE;
-  }
-  if (m_core_time <= smallest) {
-    m_core_time += m_core_period;
-    mask |= CORE;
-  }
-  if(m_dram_time <= smallest) {
-    m_dram_time += m_dram_period;
-    mask |= DRAM;
-  }
+  if (mask & CACHE) m_cache_time = ++m_cache_ticks * m_cache_period;
+  if (mask & CORE) m_core_time = ++m_core_ticks * m_core_period;
+  if (mask & DRAM) m_dram_time = ++m_dram_ticks * m_dram_period;
   return mask;
 }
 
+// Time of the tick max_cycles ticks after the next one, or infinity
+static double stop_time(uint64_t ticks, uint64_t max_cycles, double period) {
+  if (max_cycles > UINT64_MAX - ticks) return INFINITY;
+  return (ticks + max_cycles) * period;
+}
+
+// Tick count, not below ticks, of the first tick at or after stop
+static uint64_t ticks_until(double stop, double period, uint64_t ticks) {
+  uint64_t count = std::max((double)ticks, std::ceil(stop / period));
+  while (count > ticks && (count - 1) * period >= stop) count--;
+  while (count * period < stop) count++;
+  return count;
+}
+
+// Every tick before the first stopping tick is passed, and ticks sharing its
+// time are not, which is where the tick-by-tick loop would stop as well
+void M2NDPConfig::skip_cycles(uint64_t max_ndp_cycles, uint64_t max_dram_cycles,
+                              uint64_t* ndp_cycles, uint64_t* dram_cycles) {
+  double stop = gs_min2(
+      stop_time(m_buffer_ndp_ticks, max_ndp_cycles, m_buffer_ndp_period),
+      stop_time(m_buffer_dram_ticks, max_dram_cycles, m_buffer_dram_period));
+  assert(stop < INFINITY);
+  uint64_t ndp_ticks = ticks_until(stop, m_buffer_ndp_period, m_buffer_ndp_ticks);
+  uint64_t dram_ticks =
+      ticks_until(stop, m_buffer_dram_period, m_buffer_dram_ticks);
+  *ndp_cycles = ndp_ticks - m_buffer_ndp_ticks;
+  *dram_cycles = dram_ticks - m_buffer_dram_ticks;
+  m_ndp_cycle += *ndp_cycles;
+  m_buffer_ndp_ticks = ndp_ticks;
+  m_buffer_dram_ticks = dram_ticks;
+  m_link_ticks = ticks_until(stop, m_link_period, m_link_ticks);
+  m_cache_ticks = ticks_until(stop, m_cache_period, m_cache_ticks);
+  m_core_ticks = ticks_until(stop, m_core_period, m_core_ticks);
+  m_dram_ticks = ticks_until(stop, m_dram_period, m_dram_ticks);
+  update_domain_times();
+}
+
+void M2NDPConfig::update_domain_times() {
+  m_link_time = m_link_ticks * m_link_period;
+  m_buffer_dram_time = m_buffer_dram_ticks * m_buffer_dram_period;
+  m_buffer_ndp_time = m_buffer_ndp_ticks * m_buffer_ndp_period;
+  m_cache_time = m_cache_ticks * m_cache_period;
+  m_core_time = m_core_ticks * m_core_period;
+  m_dram_time = m_dram_ticks * m_dram_period;
+}
+
 
 
 const uint64_t M2NDPConfig::get_bank_index(uint64_t origin_addr) {
@@ -210,12 +259,69 @@ void M2NDPConfig::print_config(FILE *fp) {
             m_ndp_op_initialiation_interval[i]);
   }
   fprintf(fp, "log_interval:\t %d\n", m_log_interval);
+  fprintf(fp, "num_ndp_threads:\t %d\n", m_num_ndp_threads);
+  fprintf(fp, "fast_forward_idle:\t %d\n", m_fast_forward_idle);
+  fprintf(fp, "timing_wheel_delay_queue:\t %d\n", m_timing_wheel_delay_queue);
+  fprintf(fp, "sampling_detailed_uthreads:\t %d\n", m_sampling_detailed_uthreads);
+  fprintf(fp, "sampling_skip_uthreads:\t %d\n", m_sampling_skip_uthreads);
+  fprintf(fp, "stats_interval:\t %d\n", m_stats_interval);
+  fprintf(fp, "stats_file:\t %s\n", m_stats_file.c_str());
+  fprintf(fp, "l1d_prefetcher:\t %d\n", m_l1d_prefetcher);
+  fprintf(fp, "l1d_prefetch_degree:\t %d\n", m_l1d_prefetch_degree);
+  fprintf(fp, "l1d_prefetch_distance:\t %d\n", m_l1d_prefetch_distance);
+  fprintf(fp, "l1d_prefetch_table_size:\t %d\n", m_l1d_prefetch_table_size);
+  fprintf(fp, "l2d_prefetcher:\t %d\n", m_l2d_prefetcher);
+  fprintf(fp, "l2d_prefetch_degree:\t %d\n", m_l2d_prefetch_degree);
+  fprintf(fp, "l2d_prefetch_distance:\t %d\n", m_l2d_prefetch_distance);
+  fprintf(fp, "l2d_prefetch_row_size:\t %d\n", m_l2d_prefetch_row_size);
+  fprintf(fp, "l2d_prefetch_max_queue:\t %d\n", m_l2d_prefetch_max_queue);
+  fprintf(fp, "l2d_atomic_units:\t %d\n", m_l2d_atomic_units);
+  fprintf(fp, "l2d_atomic_latency:\t %d\n", m_l2d_atomic_latency);
+  fprintf(fp, "l2d_atomic_interval:\t %d\n", m_l2d_atomic_interval);
+  fprintf(fp, "l2d_atomic_queue_size:\t %d\n", m_l2d_atomic_queue_size);
+  fprintf(fp, "indexed_coalesce_window:\t %d\n", m_indexed_coalesce_window);
+  fprintf(fp, "indexed_coalesce_reorder:\t %d\n", m_indexed_coalesce_reorder);
   fprintf(fp, "=============================\n");
   spdlog::info("=======M2NDP configuration====");
 }
 
 void M2NDPConfig::increase_core_time() {
-  m_core_time += m_core_period; 
+  m_core_time = ++m_core_ticks * m_core_period;
+}
+
+void M2NDPConfig::save_clock_state(std::ostream& os) {
+  checkpoint_write(os, m_core_cycle);
+  checkpoint_write(os, m_ndp_cycle);
+  checkpoint_write(os, m_clock_mask);
+  checkpoint_write(os, m_core_ticks);
+  checkpoint_write(os, m_dram_ticks);
+  checkpoint_write(os, m_link_ticks);
+  checkpoint_write(os, m_buffer_dram_ticks);
+  checkpoint_write(os, m_buffer_ndp_ticks);
+  checkpoint_write(os, m_cache_ticks);
+  checkpoint_write(os, (uint64_t)m_accessed_tlb_addr.size());
+  for (uint64_t addr : m_accessed_tlb_addr) checkpoint_write(os, addr);
+}
+
+void M2NDPConfig::load_clock_state(std::istream& is) {
+  checkpoint_read(is, m_core_cycle);
+  checkpoint_read(is, m_ndp_cycle);
+  checkpoint_read(is, m_clock_mask);
+  checkpoint_read(is, m_core_ticks);
+  checkpoint_read(is, m_dram_ticks);
+  checkpoint_read(is, m_link_ticks);
+  checkpoint_read(is, m_buffer_dram_ticks);
+  checkpoint_read(is, m_buffer_ndp_ticks);
+  checkpoint_read(is, m_cache_ticks);
+  update_domain_times();
+  uint64_t num_tlb_addrs;
+  checkpoint_read(is, num_tlb_addrs);
+  m_accessed_tlb_addr.clear();
+  for (uint64_t i = 0; i < num_tlb_addrs; i++) {
+    uint64_t addr;
+    checkpoint_read(is, addr);
+    m_accessed_tlb_addr.insert(addr);
+  }
 }
 
 bool M2NDPConfig::is_core_time_minimum() {
@@ -1,6 +1,7 @@
 #ifndef M2NDP_CONFIG_H
 #define M2NDP_CONFIG_H
 #include <deque>
+#include <iostream>
 #include <string>
 
 #include "cache_defs.h"
@@ -48,6 +49,7 @@ class M2NDPConfig {
   int get_matched_unit_id(uint64_t origin_addr) {
     return origin_addr / m_stride_size % m_num_ndp_units;
   }
+  const int get_stride_size() { return m_stride_size; }
   const int get_num_channels() { return m_num_channels; }
   const bool is_enable_sub_core() { return m_enable_sub_core; }
   const int get_num_sub_core() { return m_num_sub_core; }
@@ -78,6 +80,15 @@ class M2NDPConfig {
   const unsigned long long get_ndp_cycle() { return m_ndp_cycle; }
   const unsigned addr_to_ramulator_addr(uint64_t addr);
   const void cycle() { m_clock_mask = next_clock_domain(); }
+  // Advances the clocks over every tick before the (max_ndp_cycles + 1)-th
+  // BUFFER_NDP or (max_dram_cycles + 1)-th BUFFER_DRAM tick, returning how
+  // many ticks of each of the two were passed
+  void skip_cycles(uint64_t max_ndp_cycles, uint64_t max_dram_cycles,
+                   uint64_t* ndp_cycles, uint64_t* dram_cycles);
+  // BUFFER_NDP ticks before the one that reaches ndp_cycle
+  const uint64_t ndp_cycles_before(uint64_t ndp_cycle) {
+    return ndp_cycle > m_ndp_cycle ? ndp_cycle - m_ndp_cycle - 1 : 0;
+  }
   const bool is_link_cycle();
   const bool is_buffer_dram_cycle();
   const bool is_buffer_ndp_cycle();
@@ -140,6 +151,31 @@ class M2NDPConfig {
   }
   const bool get_use_unified_alu() { return m_use_unified_alu; }
   const int get_log_interval() { return m_log_interval; }
+  const int get_num_ndp_threads() { return m_num_ndp_threads; }
+  const bool is_fast_forward_idle() { return m_fast_forward_idle; }
+  const bool is_timing_wheel_delay_queue() { return m_timing_wheel_delay_queue; }
+  const int get_sampling_detailed_uthreads() { return m_sampling_detailed_uthreads; }
+  const int get_sampling_skip_uthreads() { return m_sampling_skip_uthreads; }
+  const bool is_sampling_enabled() {
+    return m_sampling_detailed_uthreads > 0 && m_sampling_skip_uthreads > 0;
+  }
+  const int get_stats_interval() { return m_stats_interval; }
+  const std::string get_stats_file() { return m_stats_file; }
+  const int get_l1d_prefetcher() { return m_l1d_prefetcher; }
+  const int get_l1d_prefetch_degree() { return m_l1d_prefetch_degree; }
+  const int get_l1d_prefetch_distance() { return m_l1d_prefetch_distance; }
+  const int get_l1d_prefetch_table_size() { return m_l1d_prefetch_table_size; }
+  const bool get_l2d_prefetcher() { return m_l2d_prefetcher; }
+  const int get_l2d_prefetch_degree() { return m_l2d_prefetch_degree; }
+  const int get_l2d_prefetch_distance() { return m_l2d_prefetch_distance; }
+  const int get_l2d_prefetch_row_size() { return m_l2d_prefetch_row_size; }
+  const int get_l2d_prefetch_max_queue() { return m_l2d_prefetch_max_queue; }
+  const bool get_l2d_atomic_units() { return m_l2d_atomic_units; }
+  const int get_l2d_atomic_latency() { return m_l2d_atomic_latency; }
+  const int get_l2d_atomic_interval() { return m_l2d_atomic_interval; }
+  const int get_l2d_atomic_queue_size() { return m_l2d_atomic_queue_size; }
+  const int get_indexed_coalesce_window() { return m_indexed_coalesce_window; }
+  const bool get_indexed_coalesce_reorder() { return m_indexed_coalesce_reorder; }
   void print_config(FILE* fp);
   bool get_debug_mode() { return false; }
   const double get_link_period() { return m_link_period; }
@@ -148,6 +184,9 @@ class M2NDPConfig {
   const double get_cache_period() { return m_cache_period; }
   const double get_core_period() { return m_core_period; }
   void increase_core_time();
+  // Clock domains and DRAM-TLB state carried across a checkpoint
+  void save_clock_state(std::ostream& os);
+  void load_clock_state(std::istream& is);
   void increase_core_cycle() { m_core_cycle++; }
   bool is_core_time_minimum();
   bool is_dram_tlb_miss_handling_enabled() {
@@ -243,6 +282,9 @@ class M2NDPConfig {
       m_cache_period;
   double m_core_time, m_dram_time;
   double m_link_time, m_buffer_dram_time, m_buffer_ndp_time, m_cache_time;
+  uint64_t m_core_ticks = 0, m_dram_ticks = 0;
+  uint64_t m_link_ticks = 0, m_buffer_dram_ticks = 0, m_buffer_ndp_ticks = 0,
+           m_cache_ticks = 0;
 
   // Cache config path
   bool m_skip_l1d = false;
@@ -296,7 +338,31 @@ class M2NDPConfig {
   int m_ndp_op_initialiation_interval[NUM_ALU_OP_TYPE];
   bool m_use_unified_alu;
   int m_log_interval;
+  int m_num_ndp_threads = 1;
+  bool m_fast_forward_idle = false;
+  bool m_timing_wheel_delay_queue = false;  // pops in finish-cycle order
+  int m_sampling_detailed_uthreads = 0;
+  int m_sampling_skip_uthreads = 0;
+  int m_stats_interval = 0;
+  std::string m_stats_file = "stats.jsonl";
+  int m_l1d_prefetcher = 0;
+  int m_l1d_prefetch_degree = 2;
+  int m_l1d_prefetch_distance = 4;
+  int m_l1d_prefetch_table_size = 32;
+  bool m_l2d_prefetcher = false;
+  int m_l2d_prefetch_degree = 2;
+  int m_l2d_prefetch_distance = 8;
+  int m_l2d_prefetch_row_size = 2048;
+  int m_l2d_prefetch_max_queue = 16;
+  bool m_l2d_atomic_units = false;
+  int m_l2d_atomic_latency = 4;
+  int m_l2d_atomic_interval = 1;
+  int m_l2d_atomic_queue_size = 16;
+  int m_indexed_coalesce_window = 0;  // 0: whole instruction
+  bool m_indexed_coalesce_reorder = true;
   int next_clock_domain();
+  int peek_clock_domain();
+  void update_domain_times();
   // Memory management configure
   std::string m_ramulator_config_path;
 
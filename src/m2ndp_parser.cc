@@ -163,7 +163,7 @@ NdpInstruction ParseNdpInstruction(std::string line) {
   int value;
   int segCnt;
 
-  inst.sInst = line + "\0";  // For debug
+  inst.sInst = NdpInstruction::InternText(line);  // For debug
 
   for (int i = 0; i < 5; i++) inst.src[i] = -1;
 
@@ -834,6 +834,50 @@ void M2NDPParser::parse_to_const(M2NDPConfig *config, std::string config_dir,
     config->m_buffer_dram_period = 1 / (std::stod(val) MHz);
   } else if (name == "log_interval") {
     config->m_log_interval = atoi(value.c_str());
+  } else if (name == "num_ndp_threads") {
+    config->m_num_ndp_threads = atoi(value.c_str());
+  } else if (name == "fast_forward_idle") {
+    config->m_fast_forward_idle = atoi(value.c_str());
+  } else if (name == "timing_wheel_delay_queue") {
+    config->m_timing_wheel_delay_queue = atoi(value.c_str());
+  } else if (name == "sampling_detailed_uthreads") {
+    config->m_sampling_detailed_uthreads = atoi(value.c_str());
+  } else if (name == "sampling_skip_uthreads") {
+    config->m_sampling_skip_uthreads = atoi(value.c_str());
+  } else if (name == "stats_interval") {
+    config->m_stats_interval = atoi(value.c_str());
+  } else if (name == "stats_file") {
+    config->m_stats_file = value;
+  } else if (name == "l1d_prefetcher") {
+    config->m_l1d_prefetcher = atoi(value.c_str());
+  } else if (name == "l1d_prefetch_degree") {
+    config->m_l1d_prefetch_degree = atoi(value.c_str());
+  } else if (name == "l1d_prefetch_distance") {
+    config->m_l1d_prefetch_distance = atoi(value.c_str());
+  } else if (name == "l1d_prefetch_table_size") {
+    config->m_l1d_prefetch_table_size = atoi(value.c_str());
+  } else if (name == "l2d_prefetcher") {
+    config->m_l2d_prefetcher = atoi(value.c_str());
+  } else if (name == "l2d_prefetch_degree") {
+    config->m_l2d_prefetch_degree = atoi(value.c_str());
+  } else if (name == "l2d_prefetch_distance") {
+    config->m_l2d_prefetch_distance = atoi(value.c_str());
+  } else if (name == "l2d_prefetch_row_size") {
+    config->m_l2d_prefetch_row_size = atoi(value.c_str());
+  } else if (name == "l2d_prefetch_max_queue") {
+    config->m_l2d_prefetch_max_queue = atoi(value.c_str());
+  } else if (name == "l2d_atomic_units") {
+    config->m_l2d_atomic_units = atoi(value.c_str());
+  } else if (name == "l2d_atomic_latency") {
+    config->m_l2d_atomic_latency = atoi(value.c_str());
+  } else if (name == "l2d_atomic_interval") {
+    config->m_l2d_atomic_interval = atoi(value.c_str());
+  } else if (name == "l2d_atomic_queue_size") {
+    config->m_l2d_atomic_queue_size = atoi(value.c_str());
+  } else if (name == "indexed_coalesce_window") {
+    config->m_indexed_coalesce_window = atoi(value.c_str());
+  } else if (name == "indexed_coalesce_reorder") {
+    config->m_indexed_coalesce_reorder = atoi(value.c_str());
   } else if (name == "enable_dram_tlb_miss_handling") {
     config->m_enable_dram_tlb_miss_handling = atoi(value.c_str());
   } else if (name == "dram_tlb_miss_handling_latency") {
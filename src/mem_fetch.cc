@@ -1,8 +1,137 @@
 #ifdef TIMING_SIMULATION
 #include "mem_fetch.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
 namespace NDPSim {
 
-static unsigned long long unique_uid = 0;
+static std::atomic<unsigned long long> unique_uid(0);
+
+namespace {
+const size_t SLAB_ENTRIES = 1024;
+
+struct FreeNode {
+  FreeNode* next;
+};
+
+struct FreeBatch {
+  FreeNode* head;
+  size_t count;
+};
+
+union MemFetchSlot {
+  FreeNode node;
+  alignas(mem_fetch) char storage[sizeof(mem_fetch)];
+};
+
+struct SharedPool {
+  std::mutex lock;
+  std::vector<std::unique_ptr<MemFetchSlot[]>> slabs;
+  std::vector<FreeBatch> batches;
+  std::atomic<uint64_t> live{0};
+  std::atomic<uint64_t> peak{0};
+};
+
+SharedPool& shared_pool() {
+  static SharedPool pool;
+  return pool;
+}
+
+// Returns batches to the shared list once a thread frees far more than it
+// allocates (e.g. requests created by NDP workers and retired by the main
+// thread) so memory migrates back to the allocating threads.
+struct LocalPool {
+  FreeNode* head = NULL;
+  size_t count = 0;
+
+  ~LocalPool() {
+    if (!head) return;
+    SharedPool& pool = shared_pool();
+    std::lock_guard<std::mutex> guard(pool.lock);
+    pool.batches.push_back({head, count});
+  }
+
+  void refill() {
+    SharedPool& pool = shared_pool();
+    std::lock_guard<std::mutex> guard(pool.lock);
+    if (!pool.batches.empty()) {
+      FreeBatch batch = pool.batches.back();
+      pool.batches.pop_back();
+      head = batch.head;
+      count = batch.count;
+      return;
+    }
+    pool.slabs.emplace_back(new MemFetchSlot[SLAB_ENTRIES]());
+    MemFetchSlot* slab = pool.slabs.back().get();
+    for (size_t i = 0; i < SLAB_ENTRIES; i++) {
+      slab[i].node.next = i + 1 < SLAB_ENTRIES ? &slab[i + 1].node : NULL;
+    }
+    head = &slab[0].node;
+    count = SLAB_ENTRIES;
+  }
+
+  void spill() {
+    FreeBatch batch = {head, SLAB_ENTRIES};
+    FreeNode* last = head;
+    for (size_t i = 1; i < SLAB_ENTRIES; i++) last = last->next;
+    head = last->next;
+    last->next = NULL;
+    count -= SLAB_ENTRIES;
+    SharedPool& pool = shared_pool();
+    std::lock_guard<std::mutex> guard(pool.lock);
+    pool.batches.push_back(batch);
+  }
+};
+
+thread_local LocalPool local_pool;
+}  // namespace
+
+void* MemFetchPool::allocate() {
+  if (!local_pool.head) local_pool.refill();
+  FreeNode* node = local_pool.head;
+  local_pool.head = node->next;
+  local_pool.count--;
+  SharedPool& pool = shared_pool();
+  uint64_t live = pool.live.fetch_add(1, std::memory_order_relaxed) + 1;
+  uint64_t peak = pool.peak.load(std::memory_order_relaxed);
+  while (live > peak && !pool.peak.compare_exchange_weak(
+                            peak, live, std::memory_order_relaxed)) {
+  }
+  return node;
+}
+
+void MemFetchPool::release(void* ptr) {
+  if (!ptr) return;
+  FreeNode* node = static_cast<FreeNode*>(ptr);
+  node->next = local_pool.head;
+  local_pool.head = node;
+  local_pool.count++;
+  shared_pool().live.fetch_sub(1, std::memory_order_relaxed);
+  if (local_pool.count >= 2 * SLAB_ENTRIES) local_pool.spill();
+}
+
+uint64_t MemFetchPool::get_live() {
+  return shared_pool().live.load(std::memory_order_relaxed);
+}
+
+uint64_t MemFetchPool::get_peak() {
+  return shared_pool().peak.load(std::memory_order_relaxed);
+}
+
+uint64_t MemFetchPool::get_capacity() {
+  SharedPool& pool = shared_pool();
+  std::lock_guard<std::mutex> guard(pool.lock);
+  return pool.slabs.size() * SLAB_ENTRIES;
+}
+
+void MemFetchPool::print_stats(FILE* fp) {
+  fprintf(fp, "mem_fetch_live:\t%lu\n", get_live());
+  fprintf(fp, "mem_fetch_peak:\t%lu\n", get_peak());
+  fprintf(fp, "mem_fetch_pool_capacity:\t%lu\n", get_capacity());
+  fprintf(fp, "mem_fetch_pool_bytes:\t%lu\n",
+          get_capacity() * sizeof(mem_fetch));
+}
 
 mem_fetch::mem_fetch(new_addr_type addr, mem_access_type acc_type, mf_type type,
                      unsigned data_size, unsigned ctrl_size,
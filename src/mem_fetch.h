@@ -3,8 +3,10 @@
 #define MEM_FETCH_H
 #define CXL_OVERHEAD 8
 #define WRITE_PACKET_SIZE 8
+#define ATOMIC_PACKET_SIZE 8
 #include <bitset>
 #include <cassert>
+#include <cstdio>
 #include <deque>
 #include <vector>
 #include <functional>
@@ -32,6 +34,54 @@ static const char* mem_access_type_str[] = {
     "L1_CACHE_WA",  "L2_CACHE_WA", "L1_CACHE_WB", "L2_CACHE_WB",
     "DMA_ALLOC_W",  "HOST_ACC_R",    "HOST_ACC_W"};
 enum mf_type { READ_REQUEST = 0, WRITE_REQUEST, READ_REPLY, WRITE_ACK };
+enum PrefetchLevel { DEMAND_REQUEST, L1D_PREFETCH, L2D_PREFETCH };
+// Last pipeline stage that touched a request, kept for debugging stalls
+enum mf_state {
+  MF_NONE = 0,
+  MF_TO_TLB_QUEUE,
+  MF_TLB_FILL,
+  MF_L1_HIT,
+  MF_L1_RESERVATION_FAIL,
+  MF_L1_MISS,
+  MF_MISS_QUEUE_FULL,
+  MF_BI_LOAD,
+  MF_NOT_BI,
+  MF_BI_INPROGRESS,
+  MF_TOP_TO_MEM,
+  MF_NDP_TO_ICNT,
+  MF_ICNT_TO_NDP,
+  MF_ICNT_TO_NDP_PUSH,
+  MF_OTHER_PORT,
+  MF_CROSSBAR_TO_ICNT,
+  MF_ICNT_TO_RAMULATOR,
+  MF_RAMULATOR_FROM_CROSSBAR,
+  MF_L2_HIT,
+  MF_L2_MISS,
+  MF_L2_MISS_WRITE,
+  MF_L2_NEXT_ACCESS,
+  MF_BI_TO_CROSSBAR,
+  MF_BI_RESPONSE,
+  MF_BI_PENDING_TO_CROSSBAR,
+  MF_BI_PENDING,
+  MF_TO_CROSSBAR,
+  MF_FROM_MEM_HANDLE,
+  MF_BI_HANDLED,
+  NUM_MF_STATE
+};
+
+// Slab allocator backing mem_fetch new/delete. Each thread keeps its own
+// free list and exchanges whole batches with a shared list, so the NDP worker
+// threads never contend on the common path. Deleting a retired request is
+// the release point; live/peak counts bound in-flight request memory.
+class MemFetchPool {
+ public:
+  static void* allocate();
+  static void release(void* ptr);
+  static uint64_t get_live();
+  static uint64_t get_peak();
+  static uint64_t get_capacity();
+  static void print_stats(FILE* fp);
+};
 
 typedef std::bitset<MAX_MEMORY_ACCESS_SIZE> MemAccessByteMask;
 
@@ -52,6 +102,11 @@ class mem_fetch {
   mem_fetch(std::deque<mem_fetch*> mfs);  // for wrapping multiple mfs into one
   new_addr_type get_addr() { return m_addr; }
   ~mem_fetch() { m_valid = false; }
+  static void* operator new(size_t size) {
+    assert(size == sizeof(mem_fetch));
+    return MemFetchPool::allocate();
+  }
+  static void operator delete(void* ptr) { MemFetchPool::release(ptr); }
   void set_reply();
   void convert_to_write_request(new_addr_type addr);
   void set_from_dma() { m_from_dma = true; }
@@ -134,7 +189,14 @@ class mem_fetch {
   void set_uthread_request() { m_uthread_request = true; }
   bool is_sc_addr() { return m_sc_addr; }
   void set_sc_addr() { m_sc_addr = true; }
-  std::string current_state = "NONE";
+  // Reuse signature for SHiP insertion, 0 when unknown
+  void set_signature(uint32_t signature) { m_signature = signature; }
+  uint32_t get_signature() { return m_signature; }
+  // Issued by the prefetcher of that cache level; no instruction waits for
+  // the reply. Other levels handle it as a demand read
+  void set_prefetch(PrefetchLevel level) { m_prefetch_level = level; }
+  bool is_prefetch(PrefetchLevel level) { return m_prefetch_level == level; }
+  mf_state current_state = MF_NONE;
   uint64_t request_cycle;
   uint64_t response_cycle;
  private:
@@ -169,6 +231,8 @@ class mem_fetch {
   bool m_bi_writeback = false;
   bool m_uthread_request = false;
   bool m_sc_addr = false;
+  uint32_t m_signature = 0;
+  PrefetchLevel m_prefetch_level = DEMAND_REQUEST;
 
 };
 }
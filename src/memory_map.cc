@@ -1,16 +1,30 @@
 #include "memory_map.h"
 
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <queue>
 #include <sstream>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #define EPS 0.000001f
 namespace NDPSim {
 
-HashMemoryMap::HashMemoryMap(std::string file_path) {
-  m_base = 0;
-  m_size = UINT64_MAX;
+void MemoryMap::ParseMemoryFile(
+    std::string file_path,
+    const std::function<void(uint64_t, VectorData&)>& insert) {
+  if (PagedMemoryMap::IsMemoryImage(file_path)) {
+    PagedMemoryMap image(file_path);
+    image.ForEachPacket([&](uint64_t addr, VectorData data) {
+      insert(addr, data);
+      return true;
+    });
+    return;
+  }
   std::ifstream ifs(file_path);
   if (!ifs.good()) {
     spdlog::error("Memory Map file not found: {}", file_path);
@@ -155,15 +169,14 @@ HashMemoryMap::HashMemoryMap(std::string file_path) {
                               iter * 4 + 3);
         }
       }
-      assert(m_data_map.find(addr_base) == m_data_map.end());
       if (meta_type == CHAR8 || meta_type == UINT8 || meta_type == BOOL)
-        m_data_map[addr_base] = input_data8;
+        insert(addr_base, input_data8);
       else if (meta_type == FLOAT16 || meta_type == INT16)
-        m_data_map[addr_base] = input_data16;
+        insert(addr_base, input_data16);
       else if (meta_type == FLOAT32 || meta_type == INT32)
-        m_data_map[addr_base] = input_data32;
+        insert(addr_base, input_data32);
       else if (meta_type == INT64)
-        m_data_map[addr_base] = input_data64;
+        insert(addr_base, input_data64);
       else {
         spdlog::error("Unknown data type", file_path);
         exit(1);
@@ -172,147 +185,161 @@ HashMemoryMap::HashMemoryMap(std::string file_path) {
   }
 }
 
+HashMemoryMap::HashMemoryMap(std::string file_path) {
+  m_base = 0;
+  m_size = UINT64_MAX;
+  ParseMemoryFile(file_path, [this](uint64_t addr, VectorData& data) {
+    assert(m_data_map.find(addr) == m_data_map.end());
+    m_data_map[addr] = data;
+  });
+}
+
 bool HashMemoryMap::Match(MemoryMap& other2) {
-  HashMemoryMap& other = dynamic_cast<HashMemoryMap&>(other2);
+  HashMemoryMap* other_hash = dynamic_cast<HashMemoryMap*>(&other2);
   bool result = true;
   for (auto& [key, val] : m_data_map) {
-    if (other.m_data_map.find(key) == other.m_data_map.end()) {
+    if (!other2.CheckAddr(key)) {
       spdlog::error("Key miss match Addr {:x}", key);
       result = false;
       break;
     }
-    VectorData other_val = other.m_data_map[key];
-    if (val.GetType() == FLOAT16) {
-      if (other_val.GetType() != FLOAT16) {
-        spdlog::error("Type miss match Addr {:x} Target {} : Real {}", key,
-                      (int)val.GetType(), (int)other_val.GetType());
-        result = false;
-        break;
-      }
-      for (int i = 0; i < PACKET_ENTRIES * 2; i++) {
-        double ratio = (other_val.GetHalfData(i) - val.GetHalfData(i)) /
-                       (val.GetHalfData(i) + EPS);
-        if (other_val.GetHalfData(i) == val.GetHalfData(i)) {
-          ratio = 0;
-        }
-        bool check_data = ratio >= -0.01 && ratio <= 0.01;
-        result = result && check_data;
-        if (!check_data) {
-          spdlog::debug("{:x} : Data) {} Ans) {} diff : {}", key,
-                        float(other_val.GetHalfData(i)), float(val.GetHalfData(i)),
-                        float(other_val.GetHalfData(i) - val.GetHalfData(i)));
-        }
-      }
-    } else if (val.GetType() == FLOAT32) {
-      if (other_val.GetType() != FLOAT32) {
-        spdlog::error("Type miss match Addr {:x} Target {} : Real {}", key,
-                      (int)val.GetType(), (int)other_val.GetType());
-        result = false;
-        break;
-      }
-      for (int i = 0; i < PACKET_ENTRIES; i++) {
-        double ratio = (other_val.GetFloatData(i) - val.GetFloatData(i)) /
-                       (val.GetFloatData(i) + EPS);
-        if (other_val.GetFloatData(i) == val.GetFloatData(i)) {
-          ratio = 0;
-        }
-        bool check_data = ratio >= -0.01 && ratio <= 0.01;
-        result = result && check_data;
-        if (!check_data) {
-          spdlog::debug("{:x} : Data) {} Ans) {} diff : {}", key,
-                        other_val.GetFloatData(i), val.GetFloatData(i),
-                        other_val.GetFloatData(i) - val.GetFloatData(i));
-        }
-      }
-    } else if (val.GetType() == INT32) {
-      if (other_val.GetType() != INT32) {
-        spdlog::error("Type miss match Addr {:x} Target {} : Real {}", key,
-                      (int)val.GetType(), (int)other_val.GetType());
-        result = false;
-        break;
-      }
-      for (int i = 0; i < PACKET_ENTRIES; i++) {
-        bool check_data = other_val.GetIntData(i) == val.GetIntData(i);
-        result = result && check_data;
-
-        if (!check_data) {
-          spdlog::debug("{:x} : Data) {} Ans) {} diff : {}", key,
-                        other_val.GetIntData(i), val.GetIntData(i),
-                        other_val.GetIntData(i) - val.GetIntData(i));
-        }
-      }
-    } else if (val.GetType() == INT64) {
-      if (other_val.GetType() != INT64) {
-        spdlog::error("Type miss match Addr {:x} Target {} : Real {}", key,
-                      (int)val.GetType(), (int)other_val.GetType());
-        result = false;
-        break;
-      }
-      for (int i = 0; i < PACKET_ENTRIES / 2; i++) {
-        if (val.GetLongData(i) == -1) continue;
-        bool check_data = other_val.GetLongData(i) == val.GetLongData(i);
-        result = result && check_data;
-
-        if (!check_data) {
-          spdlog::debug("{:x} : Data) {} Ans) {} diff : {}", key,
-                     other_val.GetLongData(i), val.GetLongData(i),
-                     other_val.GetLongData(i) - val.GetLongData(i));
-        }
-      }
-    } else if (val.GetType() == VMASK) {
-      if (other_val.GetType() != UINT8 || other_val.GetType() != VMASK) {
-        spdlog::error("Type miss match Addr {:x} Target {} : Real {}", key,
-                      (int)val.GetType(), (int)other_val.GetType());
-        result = false;
-        break;
-      }
-    } else if (val.GetType() == UINT8) {
-      if (other_val.GetType() != UINT8) {
-        spdlog::error("Type miss match Addr {:x} Target {} : Real {}", key,
-                      (int)val.GetType(), (int)other_val.GetType());
-        result = false;
-        break;
-      }
-      for (int i = 0; i < PACKET_ENTRIES * 4; i++) {
-        bool check_data = other_val.GetU8Data(i) == val.GetU8Data(i);
-        result = result && check_data;
-
-        if (!check_data) {
-          spdlog::debug("{:x} : Data) {:b} Ans) {:b} diff : {}", key,
-                        other_val.GetU8Data(i),
-                        val.GetU8Data(i),
-                        (other_val.GetU8Data(i) - val.GetU8Data(i)));
-        }
-      }
-    } else if (val.GetType() == BOOL) {
-      if (other_val.GetType() != BOOL) {
-        spdlog::error("Type miss match Addr {:x} Target {} : Real {}", key,
-                      (int)val.GetType(), (int)other_val.GetType());
-        result = false;
-        break;
-      }
-      for (int i = 0; i < PACKET_ENTRIES * 4; i++) {
-        bool check_data = other_val.GetBoolData(i) == val.GetBoolData(i);
-        result = result && check_data;
-
-        if (!check_data) {
-          spdlog::debug("{:x} : Data) {} Ans) {} diff : {}", key,
-                         (other_val.GetBoolData(i) ? "True" : "False"),
-                         (val.GetBoolData(i) ? "True" : "False"),
-                         other_val.GetBoolData(i) - val.GetBoolData(i));
-        }
-      }
+    VectorData other_val = other_hash != NULL ? other_hash->m_data_map[key]
+                                              : other2.Load(key);
+    if (!MatchPacket(key, val, other_val, result)) {
+      result = false;
+      break;
     }
   }
   if (!result) {
     spdlog::trace("This Memory map");
     DumpMemory();
     spdlog::trace("Target Memory Map");
-    other.DumpMemory();
+    other2.DumpMemory();
   }
   return result;
 }
 
+// Compares one packet against the expected value and clears result on a
+// data mismatch. Returns false on a type mismatch, which aborts the match.
+bool MemoryMap::MatchPacket(uint64_t key, const VectorData& val,
+                            const VectorData& other_val, bool& result) {
+  if (val.GetType() == FLOAT16) {
+    if (other_val.GetType() != FLOAT16) {
+      spdlog::error("Type miss match Addr {:x} Target {} : Real {}", key,
+                    (int)val.GetType(), (int)other_val.GetType());
+      return false;
+    }
+    for (uint32_t i = 0; i < PACKET_ENTRIES * 2; i++) {
+      double ratio = (other_val.GetHalfData(i) - val.GetHalfData(i)) /
+                     (val.GetHalfData(i) + EPS);
+      if (other_val.GetHalfData(i) == val.GetHalfData(i)) {
+        ratio = 0;
+      }
+      bool check_data = ratio >= -0.01 && ratio <= 0.01;
+      result = result && check_data;
+      if (!check_data) {
+        spdlog::debug("{:x} : Data) {} Ans) {} diff : {}", key,
+                      float(other_val.GetHalfData(i)), float(val.GetHalfData(i)),
+                      float(other_val.GetHalfData(i) - val.GetHalfData(i)));
+      }
+    }
+  } else if (val.GetType() == FLOAT32) {
+    if (other_val.GetType() != FLOAT32) {
+      spdlog::error("Type miss match Addr {:x} Target {} : Real {}", key,
+                    (int)val.GetType(), (int)other_val.GetType());
+      return false;
+    }
+    for (uint32_t i = 0; i < PACKET_ENTRIES; i++) {
+      double ratio = (other_val.GetFloatData(i) - val.GetFloatData(i)) /
+                     (val.GetFloatData(i) + EPS);
+      if (other_val.GetFloatData(i) == val.GetFloatData(i)) {
+        ratio = 0;
+      }
+      bool check_data = ratio >= -0.01 && ratio <= 0.01;
+      result = result && check_data;
+      if (!check_data) {
+        spdlog::debug("{:x} : Data) {} Ans) {} diff : {}", key,
+                      other_val.GetFloatData(i), val.GetFloatData(i),
+                      other_val.GetFloatData(i) - val.GetFloatData(i));
+      }
+    }
+  } else if (val.GetType() == INT32) {
+    if (other_val.GetType() != INT32) {
+      spdlog::error("Type miss match Addr {:x} Target {} : Real {}", key,
+                    (int)val.GetType(), (int)other_val.GetType());
+      return false;
+    }
+    for (uint32_t i = 0; i < PACKET_ENTRIES; i++) {
+      bool check_data = other_val.GetIntData(i) == val.GetIntData(i);
+      result = result && check_data;
+
+      if (!check_data) {
+        spdlog::debug("{:x} : Data) {} Ans) {} diff : {}", key,
+                      other_val.GetIntData(i), val.GetIntData(i),
+                      other_val.GetIntData(i) - val.GetIntData(i));
+      }
+    }
+  } else if (val.GetType() == INT64) {
+    if (other_val.GetType() != INT64) {
+      spdlog::error("Type miss match Addr {:x} Target {} : Real {}", key,
+                    (int)val.GetType(), (int)other_val.GetType());
+      return false;
+    }
+    for (uint32_t i = 0; i < PACKET_ENTRIES / 2; i++) {
+      if (val.GetLongData(i) == -1) continue;
+      bool check_data = other_val.GetLongData(i) == val.GetLongData(i);
+      result = result && check_data;
+
+      if (!check_data) {
+        spdlog::debug("{:x} : Data) {} Ans) {} diff : {}", key,
+                   other_val.GetLongData(i), val.GetLongData(i),
+                   other_val.GetLongData(i) - val.GetLongData(i));
+      }
+    }
+  } else if (val.GetType() == VMASK) {
+    if (other_val.GetType() != UINT8 || other_val.GetType() != VMASK) {
+      spdlog::error("Type miss match Addr {:x} Target {} : Real {}", key,
+                    (int)val.GetType(), (int)other_val.GetType());
+      return false;
+    }
+  } else if (val.GetType() == UINT8) {
+    if (other_val.GetType() != UINT8) {
+      spdlog::error("Type miss match Addr {:x} Target {} : Real {}", key,
+                    (int)val.GetType(), (int)other_val.GetType());
+      return false;
+    }
+    for (uint32_t i = 0; i < PACKET_ENTRIES * 4; i++) {
+      bool check_data = other_val.GetU8Data(i) == val.GetU8Data(i);
+      result = result && check_data;
+
+      if (!check_data) {
+        spdlog::debug("{:x} : Data) {:b} Ans) {:b} diff : {}", key,
+                      other_val.GetU8Data(i),
+                      val.GetU8Data(i),
+                      (other_val.GetU8Data(i) - val.GetU8Data(i)));
+      }
+    }
+  } else if (val.GetType() == BOOL) {
+    if (other_val.GetType() != BOOL) {
+      spdlog::error("Type miss match Addr {:x} Target {} : Real {}", key,
+                    (int)val.GetType(), (int)other_val.GetType());
+      return false;
+    }
+    for (uint32_t i = 0; i < PACKET_ENTRIES * 4; i++) {
+      bool check_data = other_val.GetBoolData(i) == val.GetBoolData(i);
+      result = result && check_data;
+
+      if (!check_data) {
+        spdlog::debug("{:x} : Data) {} Ans) {} diff : {}", key,
+                       (other_val.GetBoolData(i) ? "True" : "False"),
+                       (val.GetBoolData(i) ? "True" : "False"),
+                       other_val.GetBoolData(i) - val.GetBoolData(i));
+      }
+    }
+  }
+  return true;
+}
+
 VectorData HashMemoryMap::Load(uint64_t addr) {
   assert(addr >= m_base && addr < m_base + m_size);
   if (m_use_synthetic_memory) {
@@ -361,6 +388,257 @@ void HashMemoryMap::DumpMemory() {
   }
 }
 
+PagedMemoryMap::PagedMemoryMap(std::string file_path) {
+  if (IsMemoryImage(file_path)) {
+    MapImage(file_path);
+    return;
+  }
+  ParseMemoryFile(file_path, [this](uint64_t addr, VectorData& data) {
+    assert(!CheckAddr(addr));
+    Store(addr, data);
+  });
+}
+
+PagedMemoryMap::~PagedMemoryMap() { Reset(); }
+
+bool PagedMemoryMap::IsMemoryImage(std::string file_path) {
+  std::ifstream ifs(file_path, std::ios::binary);
+  char magic[sizeof(IMAGE_MAGIC)];
+  if (!ifs.read(magic, sizeof(magic))) return false;
+  return memcmp(magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) == 0;
+}
+
+void PagedMemoryMap::MapImage(std::string file_path) {
+  int fd = open(file_path.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    spdlog::error("Memory image not found: {}", file_path);
+    exit(1);
+  }
+  m_image_size = st.st_size;
+  void* image =
+      mmap(NULL, m_image_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (image == MAP_FAILED) {
+    spdlog::error("Failed to mmap memory image: {}", file_path);
+    exit(1);
+  }
+  m_image = (uint8_t*)image;
+  MemoryImageHeader* header = (MemoryImageHeader*)m_image;
+  if (header->version != IMAGE_VERSION || header->packet_size != PACKET_SIZE ||
+      header->page_size != PAGE_SIZE ||
+      header->page_offset + header->num_pages * sizeof(Page) > m_image_size) {
+    spdlog::error("Incompatible memory image: {}", file_path);
+    exit(1);
+  }
+  uint64_t* page_bases = (uint64_t*)(m_image + sizeof(MemoryImageHeader));
+  Page* pages = (Page*)(m_image + header->page_offset);
+  for (uint64_t i = 0; i < header->num_pages; i++) {
+    uint64_t region_number = page_bases[i] >> REGION_BITS;
+    Region*& region = m_regions[region_number];
+    if (region == NULL) region = new Region();
+    region->pages[(page_bases[i] >> PAGE_BITS) & (PAGES_PER_REGION - 1)] =
+        &pages[i];
+  }
+  spdlog::info("Mapped memory image {} ({} pages)", file_path,
+               header->num_pages);
+}
+
+bool PagedMemoryMap::SaveImage(std::string file_path) {
+  // Images only hold page data; packets kept in the side map have no slot
+  if (!m_oversized.empty()) {
+    spdlog::error("Cannot write memory image {}: {} packets larger than {}B "
+                  "(first at {:x})",
+                  file_path, m_oversized.size(), PACKET_SIZE,
+                  m_oversized.begin()->first);
+    return false;
+  }
+  std::vector<std::pair<uint64_t, Page*>> pages;
+  for (auto& [region_number, region] : m_regions) {
+    for (int i = 0; i < PAGES_PER_REGION; i++) {
+      if (region->pages[i] == NULL) continue;
+      pages.push_back({(region_number << REGION_BITS) +
+                           ((uint64_t)i << PAGE_BITS),
+                       region->pages[i]});
+    }
+  }
+  std::sort(pages.begin(), pages.end());
+  MemoryImageHeader header = {};
+  memcpy(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+  header.version = IMAGE_VERSION;
+  header.packet_size = PACKET_SIZE;
+  header.page_size = PAGE_SIZE;
+  header.num_pages = pages.size();
+  header.page_offset =
+      ROUND_UP(sizeof(header) + pages.size() * sizeof(uint64_t), 4096);
+
+  std::ofstream ofs(file_path, std::ios::binary);
+  if (!ofs.good()) {
+    spdlog::error("Cannot write memory image: {}", file_path);
+    return false;
+  }
+  ofs.write((const char*)&header, sizeof(header));
+  for (auto& [base, page] : pages) ofs.write((const char*)&base, sizeof(base));
+  std::vector<char> padding(
+      header.page_offset - sizeof(header) - pages.size() * sizeof(uint64_t), 0);
+  ofs.write(padding.data(), padding.size());
+  for (auto& [base, page] : pages) ofs.write((const char*)page, sizeof(Page));
+  if (!ofs.flush()) {
+    spdlog::error("Cannot write memory image: {}", file_path);
+    return false;
+  }
+  return true;
+}
+
+PagedMemoryMap::Page* PagedMemoryMap::GetPage(uint64_t addr, bool allocate) {
+  uint64_t page_number = addr >> PAGE_BITS;
+  if (page_number == m_last_page_number) return m_last_page;
+  uint64_t region_number = addr >> REGION_BITS;
+  auto iter = m_regions.find(region_number);
+  Region* region = NULL;
+  if (iter != m_regions.end()) {
+    region = iter->second;
+  } else {
+    if (!allocate) return NULL;
+    region = new Region();
+    m_regions[region_number] = region;
+  }
+  Page*& page = region->pages[page_number & (PAGES_PER_REGION - 1)];
+  if (page == NULL) {
+    if (!allocate) return NULL;
+    page = new Page();
+  }
+  m_last_page_number = page_number;
+  m_last_page = page;
+  return page;
+}
+
+VectorData PagedMemoryMap::LoadPacket(Page* page, uint64_t addr) {
+  PacketInfo& info = page->info[GetPacketIndex(addr)];
+  if (info.flags & OVERSIZED) return m_oversized[addr];
+  VectorData data;
+  data.SetType((DataType)info.type);
+  data.SetVlen(info.vlen);
+  data.SetRawData(
+      (const Data*)&page->data[GetPacketIndex(addr) * PACKET_SIZE]);
+  return data;
+}
+
+VectorData PagedMemoryMap::Load(uint64_t addr) {
+  assert(addr >= m_base && addr < m_base + m_size);
+  if (m_use_synthetic_memory) {
+    if (addr >= m_synthetic_base_address &&
+        addr < m_synthetic_base_address + m_synthetic_memory_size) {
+      uint32_t temp = addr & 0xfffff;
+      VectorData data(32, 1);
+      data.SetData((float)temp, 0);
+      return data;
+    }
+  }
+  Page* page = GetPage(addr, false);
+  if (page == NULL || !(page->info[GetPacketIndex(addr)].flags & VALID))
+    throw std::runtime_error("PagedMemoryMap::Load failed");
+  if (page->info[GetPacketIndex(addr)].flags & DOUBLE_REG)
+    throw std::runtime_error("PagedMemoryMap::Double reg Stored!");
+  return LoadPacket(page, addr);
+}
+
+void PagedMemoryMap::Store(uint64_t addr, VectorData data) {
+  assert(addr >= m_base && addr < m_base + m_size);
+  Page* page = GetPage(addr, true);
+  PacketInfo& info = page->info[GetPacketIndex(addr)];
+  if (info.flags & DOUBLE_REG)
+    throw std::runtime_error("PagedMemoryMap::Double reg Stored!");
+  if (info.flags & OVERSIZED) m_oversized.erase(addr);
+  info.type = data.GetType();
+  info.vlen = data.GetVlen();
+  info.flags = VALID;
+  if (data.GetDoubleReg()) info.flags |= DOUBLE_REG;
+  if (data.GetVectorSize() != PACKET_ENTRIES) {
+    info.flags |= OVERSIZED;
+    m_oversized[addr] = data;
+    return;
+  }
+  memcpy(&page->data[GetPacketIndex(addr) * PACKET_SIZE], data.GetRawData(),
+         PACKET_SIZE);
+}
+
+bool PagedMemoryMap::CheckAddr(uint64_t addr) {
+  Page* page = GetPage(addr, false);
+  return page != NULL && (page->info[GetPacketIndex(addr)].flags & VALID);
+}
+
+void PagedMemoryMap::Reset() {
+  for (auto& [region_number, region] : m_regions) {
+    for (int i = 0; i < PAGES_PER_REGION; i++) {
+      if (!IsImagePage(region->pages[i])) delete region->pages[i];
+    }
+    delete region;
+  }
+  m_regions.clear();
+  m_oversized.clear();
+  m_last_page_number = UINT64_MAX;
+  m_last_page = NULL;
+  if (m_image != NULL) {
+    munmap(m_image, m_image_size);
+    m_image = NULL;
+    m_image_size = 0;
+  }
+}
+
+void PagedMemoryMap::ForEachPacket(
+    const std::function<bool(uint64_t, VectorData)>& func) {
+  std::vector<uint64_t> region_numbers;
+  for (auto& [region_number, region] : m_regions)
+    region_numbers.push_back(region_number);
+  std::sort(region_numbers.begin(), region_numbers.end());
+  for (uint64_t region_number : region_numbers) {
+    Region* region = m_regions[region_number];
+    for (int i = 0; i < PAGES_PER_REGION; i++) {
+      Page* page = region->pages[i];
+      if (page == NULL) continue;
+      uint64_t page_base = (region_number << REGION_BITS) +
+                           ((uint64_t)i << PAGE_BITS);
+      for (int j = 0; j < PACKETS_PER_PAGE; j++) {
+        if (!(page->info[j].flags & VALID)) continue;
+        uint64_t addr = page_base + j * PACKET_SIZE;
+        if (!func(addr, LoadPacket(page, addr))) return;
+      }
+    }
+  }
+}
+
+bool PagedMemoryMap::Match(MemoryMap& other) {
+  bool result = true;
+  ForEachPacket([&](uint64_t key, VectorData val) {
+    if (!other.CheckAddr(key)) {
+      spdlog::error("Key miss match Addr {:x}", key);
+      result = false;
+      return false;
+    }
+    VectorData other_val = other.Load(key);
+    if (!MatchPacket(key, val, other_val, result)) {
+      result = false;
+      return false;
+    }
+    return true;
+  });
+  if (!result) {
+    spdlog::trace("This Memory map");
+    DumpMemory();
+    spdlog::trace("Target Memory Map");
+    other.DumpMemory();
+  }
+  return result;
+}
+
+void PagedMemoryMap::DumpMemory() {
+  ForEachPacket([](uint64_t key, VectorData val) {
+    spdlog::trace("{:x}: {}", key, val.toString());
+    return true;
+  });
+}
+
 bool PointerMemoryMap::Match(MemoryMap& other2) {
   PointerMemoryMap& other = dynamic_cast<PointerMemoryMap&>(other2);
   bool result = true;
@@ -449,7 +727,7 @@ VectorData PointerMemoryMap::Load(uint64_t addr) {
     case FLOAT32: {
       float* ptr = (float*)info.ptr;
       offset = offset / sizeof(float);
-      for (int i = 0; i < PACKET_SIZE / sizeof(float); i++) {
+      for (size_t i = 0; i < PACKET_SIZE / sizeof(float); i++) {
         data.SetData(ptr[offset + i], i);
       }
       data.SetVlen((uint32_t)(PACKET_SIZE / sizeof(float)));
@@ -458,7 +736,7 @@ VectorData PointerMemoryMap::Load(uint64_t addr) {
     case FLOAT16: {
       half* ptr = (half*)info.ptr;
       offset = offset / sizeof(half);
-      for (int i = 0; i < PACKET_SIZE / sizeof(half); i++) {
+      for (size_t i = 0; i < PACKET_SIZE / sizeof(half); i++) {
         data.SetData(ptr[offset + i], i);
       }
       data.SetVlen((uint32_t)(PACKET_SIZE / sizeof(half)));
@@ -467,7 +745,7 @@ VectorData PointerMemoryMap::Load(uint64_t addr) {
     case INT64: {
       int64_t* ptr = (int64_t*)info.ptr;
       offset = offset / sizeof(int64_t);
-      for (int i = 0; i < PACKET_SIZE / sizeof(int64_t); i++) {
+      for (size_t i = 0; i < PACKET_SIZE / sizeof(int64_t); i++) {
         data.SetData(ptr[offset + i], i);
       }
       data.SetVlen((uint32_t)(PACKET_SIZE / sizeof(int64_t)));
@@ -476,7 +754,7 @@ VectorData PointerMemoryMap::Load(uint64_t addr) {
     case INT32: {
       int32_t* ptr = (int32_t*)info.ptr;
       offset = offset / sizeof(int32_t);
-      for (int i = 0; i < PACKET_SIZE / sizeof(int32_t); i++) {
+      for (size_t i = 0; i < PACKET_SIZE / sizeof(int32_t); i++) {
         data.SetData(ptr[offset + i], i);
       }
       data.SetVlen((uint32_t)(PACKET_SIZE / sizeof(int32_t)));
@@ -485,7 +763,7 @@ VectorData PointerMemoryMap::Load(uint64_t addr) {
     case INT16: {
       int16_t* ptr = (int16_t*)info.ptr;
       offset = offset / sizeof(int16_t);
-      for (int i = 0; i < PACKET_SIZE / sizeof(int16_t); i++) {
+      for (size_t i = 0; i < PACKET_SIZE / sizeof(int16_t); i++) {
         data.SetData(ptr[offset + i], i);
       }
       data.SetVlen((uint32_t)(PACKET_SIZE / sizeof(int16_t)));
@@ -494,7 +772,7 @@ VectorData PointerMemoryMap::Load(uint64_t addr) {
     case CHAR8: {
       char* ptr = (char*)info.ptr;
       offset = offset / sizeof(char);
-      for (int i = 0; i < PACKET_SIZE / sizeof(char); i++) {
+      for (size_t i = 0; i < PACKET_SIZE / sizeof(char); i++) {
         data.SetData(ptr[offset + i], i);
       }
       data.SetVlen((uint32_t)(PACKET_SIZE / sizeof(char)));
@@ -503,7 +781,7 @@ VectorData PointerMemoryMap::Load(uint64_t addr) {
     case UINT8: {
       uint8_t* ptr = (uint8_t*)info.ptr;
       offset = offset / sizeof(uint8_t);
-      for (int i = 0; i < PACKET_SIZE / sizeof(uint8_t);
+      for (size_t i = 0; i < PACKET_SIZE / sizeof(uint8_t);
            i++) {  // TODO: vmask length depends on vlen
         data.SetData(ptr[offset + i], i);
       }
@@ -513,7 +791,7 @@ VectorData PointerMemoryMap::Load(uint64_t addr) {
     case VMASK: {
       bool* ptr = (bool*)info.ptr;
       offset = offset / sizeof(bool);
-      for (int i = 0; i < BYTE_BIT;
+      for (uint32_t i = 0; i < BYTE_BIT;
            i++) {  // TODO: vmask length depends on vlen
         data.SetVmask(ptr[offset + i], i);
       }
@@ -544,7 +822,7 @@ void PointerMemoryMap::Store(uint64_t addr, VectorData data) {
     case FLOAT32: {
       float* ptr = (float*)info.ptr;
       offset = offset / sizeof(float);
-      for (int i = 0; i < data.GetVlen(); i++) {
+      for (uint32_t i = 0; i < data.GetVlen(); i++) {
         ptr[offset + i] = data.GetFloatData(i);
       }
       break;
@@ -552,7 +830,7 @@ void PointerMemoryMap::Store(uint64_t addr, VectorData data) {
     case FLOAT16: {
       half* ptr = (half*)info.ptr;
       offset = offset / sizeof(half);
-      for (int i = 0; i < data.GetVlen(); i++) {
+      for (uint32_t i = 0; i < data.GetVlen(); i++) {
         ptr[offset + i] = data.GetHalfData(i);
       }
       break;
@@ -560,7 +838,7 @@ void PointerMemoryMap::Store(uint64_t addr, VectorData data) {
     case INT64: {
       int64_t* ptr = (int64_t*)info.ptr;
       offset = offset / sizeof(int64_t);
-      for (int i = 0; i < data.GetVlen(); i++) {
+      for (uint32_t i = 0; i < data.GetVlen(); i++) {
         ptr[offset + i] = data.GetLongData(i);
       }
       break;
@@ -568,7 +846,7 @@ void PointerMemoryMap::Store(uint64_t addr, VectorData data) {
     case INT32: {
       int32_t* ptr = (int32_t*)info.ptr;
       offset = offset / sizeof(int32_t);
-      for (int i = 0; i < data.GetVlen(); i++) {
+      for (uint32_t i = 0; i < data.GetVlen(); i++) {
         ptr[offset + i] = data.GetIntData(i);
       }
       break;
@@ -576,7 +854,7 @@ void PointerMemoryMap::Store(uint64_t addr, VectorData data) {
     case INT16: {
       int16_t* ptr = (int16_t*)info.ptr;
       offset = offset / sizeof(int16_t);
-      for (int i = 0; i < data.GetVlen(); i++) {
+      for (uint32_t i = 0; i < data.GetVlen(); i++) {
         ptr[offset + i] = data.GetShortData(i);
       }
       break;
@@ -584,7 +862,7 @@ void PointerMemoryMap::Store(uint64_t addr, VectorData data) {
     case CHAR8: {
       char* ptr = (char*)info.ptr;
       offset = offset / sizeof(char);
-      for (int i = 0; i < data.GetVlen(); i++) {
+      for (uint32_t i = 0; i < data.GetVlen(); i++) {
         ptr[offset + i] = data.GetCharData(i);
       }
       break;
@@ -592,7 +870,7 @@ void PointerMemoryMap::Store(uint64_t addr, VectorData data) {
     case UINT8: {
       uint8_t* ptr = (uint8_t*)info.ptr;
       offset = offset / sizeof(uint8_t);
-      for (int i = 0; i < data.GetVlen(); i++) { // TODO: vmask length depends on vlen
+      for (uint32_t i = 0; i < data.GetVlen(); i++) { // TODO: vmask length depends on vlen
         ptr[offset + i] = data.GetU8Data(i);
       }
       break;
@@ -600,7 +878,7 @@ void PointerMemoryMap::Store(uint64_t addr, VectorData data) {
     case VMASK: {
       bool* ptr = (bool*)info.ptr;
       offset = offset / sizeof(bool);
-      for (int i = 0; i < BYTE_BIT; i++) { // TODO: vmask length depends on vlen
+      for (uint32_t i = 0; i < BYTE_BIT; i++) { // TODO: vmask length depends on vlen
         ptr[offset + i] = data.GetVmaskData(i);
       }
       break;
@@ -646,4 +924,89 @@ uint64_t PointerMemoryMap::GetBaseAddr(uint64_t addr) {
   }
   return (uint64_t)-1;
 }
-}  // namespace NDPSim
\ No newline at end of file
+
+SynchronizedMemoryMap::SynchronizedMemoryMap(MemoryMap* memory_map)
+    : MemoryMap(), m_memory_map(memory_map) {}
+
+bool SynchronizedMemoryMap::Match(MemoryMap& other) {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  return m_memory_map->Match(other);
+}
+
+VectorData SynchronizedMemoryMap::Load(uint64_t addr) {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  return m_memory_map->Load(addr);
+}
+
+void SynchronizedMemoryMap::Store(uint64_t addr, VectorData data) {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  m_memory_map->Store(addr, data);
+}
+
+bool SynchronizedMemoryMap::CheckAddr(uint64_t addr) {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  return m_memory_map->CheckAddr(addr);
+}
+
+void SynchronizedMemoryMap::Reset() {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  m_memory_map->Reset();
+}
+
+void SynchronizedMemoryMap::DumpMemory() {
+  std::lock_guard<std::recursive_mutex> lock(m_mutex);
+  m_memory_map->DumpMemory();
+}
+
+VectorData TracingMemoryMap::Load(uint64_t addr) {
+  m_accesses.push_back({FormatAddr(addr), false});
+  return m_memory_map->Load(addr);
+}
+
+void TracingMemoryMap::Store(uint64_t addr, VectorData data) {
+  m_accesses.push_back({FormatAddr(addr), true});
+  m_memory_map->Store(addr, data);
+}
+
+// A store is an entry without an update; init holds the stored packet
+void WriteLog::RecordStore(MemoryMap* map, uint64_t addr,
+                           const VectorData& data) {
+  m_pending[addr].push_back(m_entries.size());
+  m_entries.push_back({map, addr, data, nullptr});
+}
+
+void WriteLog::RecordUpdate(MemoryMap* map, uint64_t addr,
+                            const VectorData& init, Update update) {
+  m_pending[addr].push_back(m_entries.size());
+  m_entries.push_back({map, addr, init, std::move(update)});
+}
+
+VectorData WriteLog::Load(MemoryMap* map, uint64_t addr) const {
+  const std::vector<uint32_t>& pending = m_pending.at(addr);
+  VectorData data = map->CheckAddr(addr) ? map->Load(addr)
+                                         : m_entries[pending[0]].init;
+  for (uint32_t index : pending) {
+    const Entry& entry = m_entries[index];
+    if (entry.update)
+      entry.update(data);
+    else
+      data = entry.init;
+  }
+  return data;
+}
+
+void WriteLog::Apply() {
+  for (Entry& entry : m_entries) {
+    if (!entry.update) {
+      entry.map->Store(entry.addr, entry.init);
+      continue;
+    }
+    VectorData data = entry.init;
+    if (entry.map->CheckAddr(entry.addr)) data = entry.map->Load(entry.addr);
+    entry.update(data);
+    entry.map->Store(entry.addr, data);
+  }
+  m_entries.clear();
+  m_pending.clear();
+}
+}  // namespace NDPSim
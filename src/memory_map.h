@@ -5,7 +5,10 @@
 
 #include <bitset>
 #include <cassert>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "common.h"
 namespace NDPSim {
@@ -23,13 +26,24 @@ class MemoryMap {
   virtual bool CheckAddr(uint64_t addr) = 0;
   virtual void Reset() {}
   virtual void DumpMemory() {}
+  // Serializes a multi-access sequence (e.g. read-modify-write) against other
+  // threads. No-op unless the map is shared between threads.
+  virtual void lock() {}
+  virtual void unlock() {}
   void set_synthetic_memory(uint64_t base, uint64_t size) {
     m_use_synthetic_memory = true;
     m_synthetic_base_address = base;
     m_synthetic_memory_size = size;
   }
   bool is_synthetic_memory() { return m_use_synthetic_memory; }
+  // Reads a memory map packet by packet. Accepts both the text format
+  // (_META_/_DATA_ sections) and binary memory images.
+  static void ParseMemoryFile(
+      std::string file_path,
+      const std::function<void(uint64_t, VectorData&)>& insert);
  protected:
+  static bool MatchPacket(uint64_t key, const VectorData& val,
+                          const VectorData& other_val, bool& result);
   bool m_use_synthetic_memory = false;
   uint64_t m_synthetic_base_address;
   uint64_t m_synthetic_memory_size;
@@ -53,6 +67,91 @@ private:
   robin_hood::unordered_map<uint64_t, VectorData> m_data_map;
 };
 
+// Memory map backed by a two-level page table of raw byte pages. The first
+// level is a hash of 1GB regions, the second a flat array of 64KB pages that
+// are allocated on first store. Each 32B packet keeps its data type and vlen
+// next to the page so that Load rebuilds the same VectorData that was stored.
+// Packets that do not fit one packet (e.g. double registers) are kept in a
+// side map.
+//
+// A binary memory image is the page index followed by the pages themselves:
+//   MemoryImageHeader | page base addresses | padding | Page[num_pages]
+// Pages start at a 4KB aligned offset, so an image is mmap'd copy-on-write
+// and its pages are used in place.
+class PagedMemoryMap : public MemoryMap {
+ public:
+  PagedMemoryMap() : MemoryMap() {}
+  // Text memory map or binary memory image
+  PagedMemoryMap(std::string file_path);
+  PagedMemoryMap(uint64_t base, uint64_t size) : m_base(base), m_size(size) {}
+  virtual ~PagedMemoryMap() override;
+  virtual bool Match(MemoryMap& other) override;
+  virtual VectorData Load(uint64_t addr) override;
+  virtual void Store(uint64_t addr, VectorData data) override;
+  virtual bool CheckAddr(uint64_t addr) override;
+  virtual void Reset() override;
+  void DumpMemory() override;
+  // Visits valid packets in ascending address order until func returns false
+  void ForEachPacket(const std::function<bool(uint64_t, VectorData)>& func);
+  // Writes the pages as a binary memory image. Returns false, after logging
+  // the error, if the map holds oversized packets, which an image cannot
+  // represent, or if the file cannot be written.
+  bool SaveImage(std::string file_path);
+  static bool IsMemoryImage(std::string file_path);
+
+  static const int PAGE_BITS = 16;
+  static const int REGION_BITS = 30;
+  static const uint64_t PAGE_SIZE = 1ULL << PAGE_BITS;
+  static const int PACKETS_PER_PAGE = PAGE_SIZE / PACKET_SIZE;
+  static const int PAGES_PER_REGION = 1 << (REGION_BITS - PAGE_BITS);
+
+ private:
+  enum PacketFlag : uint8_t { VALID = 1, DOUBLE_REG = 2, OVERSIZED = 4 };
+  struct PacketInfo {
+    uint32_t vlen;
+    uint8_t type;
+    uint8_t flags;
+  };
+  struct Page {
+    uint8_t data[PAGE_SIZE];
+    PacketInfo info[PACKETS_PER_PAGE];
+  };
+  struct Region {
+    Page* pages[PAGES_PER_REGION];
+  };
+  struct MemoryImageHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t packet_size;
+    uint64_t page_size;
+    uint64_t num_pages;
+    uint64_t page_offset;
+  };
+  static constexpr char IMAGE_MAGIC[8] = {'M', '2', 'N', 'D', 'P', 'I', 'M', 'G'};
+  static const uint32_t IMAGE_VERSION = 1;
+
+  uint64_t m_base = 0;
+  uint64_t m_size = UINT64_MAX;
+  robin_hood::unordered_map<uint64_t, Region*> m_regions;
+  robin_hood::unordered_map<uint64_t, VectorData> m_oversized;
+  // Last translated page, accesses are mostly sequential
+  uint64_t m_last_page_number = UINT64_MAX;
+  Page* m_last_page = NULL;
+  // mmap'd memory image, pages inside it are not owned
+  uint8_t* m_image = NULL;
+  size_t m_image_size = 0;
+
+  Page* GetPage(uint64_t addr, bool allocate);
+  static int GetPacketIndex(uint64_t addr) {
+    return (addr & (PAGE_SIZE - 1)) / PACKET_SIZE;
+  }
+  VectorData LoadPacket(Page* page, uint64_t addr);
+  void MapImage(std::string file_path);
+  bool IsImagePage(Page* page) {
+    return (uint8_t*)page >= m_image && (uint8_t*)page < m_image + m_image_size;
+  }
+};
+
 class PointerMemoryMap : public MemoryMap {
  public:
   PointerMemoryMap() : MemoryMap() {}
@@ -74,5 +173,87 @@ class PointerMemoryMap : public MemoryMap {
 
   std::map<uint64_t, MemoryInfo> m_ptr_map;
 };
+
+// Wraps a memory map shared by NDP units ticked on different threads.
+class SynchronizedMemoryMap : public MemoryMap {
+ public:
+  SynchronizedMemoryMap(MemoryMap* memory_map);
+  virtual ~SynchronizedMemoryMap() override = default;
+  virtual bool Match(MemoryMap& other) override;
+  virtual VectorData Load(uint64_t addr) override;
+  virtual void Store(uint64_t addr, VectorData data) override;
+  virtual bool CheckAddr(uint64_t addr) override;
+  virtual void Reset() override;
+  void DumpMemory() override;
+  virtual void lock() override { m_mutex.lock(); }
+  virtual void unlock() override { m_mutex.unlock(); }
+
+ private:
+  MemoryMap* m_memory_map;
+  std::recursive_mutex m_mutex;
+};
+
+// Forwards to a memory map and records the packets loaded and stored, so the
+// caches can be warmed with what functionally executed code touched.
+class TracingMemoryMap : public MemoryMap {
+ public:
+  struct Access {
+    uint64_t addr;  // packet aligned
+    bool write;
+  };
+  TracingMemoryMap(MemoryMap* memory_map)
+      : MemoryMap(), m_memory_map(memory_map) {}
+  virtual ~TracingMemoryMap() override = default;
+  virtual bool Match(MemoryMap& other) override {
+    return m_memory_map->Match(other);
+  }
+  virtual VectorData Load(uint64_t addr) override;
+  virtual void Store(uint64_t addr, VectorData data) override;
+  virtual bool CheckAddr(uint64_t addr) override {
+    return m_memory_map->CheckAddr(addr);
+  }
+  virtual void Reset() override { m_memory_map->Reset(); }
+  void DumpMemory() override { m_memory_map->DumpMemory(); }
+  virtual void lock() override { m_memory_map->lock(); }
+  virtual void unlock() override { m_memory_map->unlock(); }
+  const std::vector<Access>& GetAccesses() const { return m_accesses; }
+  void ClearAccesses() { m_accesses.clear(); }
+
+ private:
+  MemoryMap* m_memory_map;
+  std::vector<Access> m_accesses;
+};
+
+// Global stores and read-modify-writes recorded while NDP units run in
+// parallel, applied later by Apply() in record order. Applying the logs of
+// all units in unit id order makes memory contents independent of thread
+// timing. The recording unit sees its own pending writes through Load().
+class WriteLog {
+ public:
+  typedef std::function<void(VectorData&)> Update;
+  void RecordStore(MemoryMap* map, uint64_t addr, const VectorData& data);
+  // init is the packet the update starts from if addr was never written
+  void RecordUpdate(MemoryMap* map, uint64_t addr, const VectorData& init,
+                    Update update);
+  bool Pending(uint64_t addr) const {
+    return m_pending.find(addr) != m_pending.end();
+  }
+  // The packet at addr with this log's pending writes applied; addr must be
+  // Pending()
+  VectorData Load(MemoryMap* map, uint64_t addr) const;
+  void Apply();
+  bool Empty() const { return m_entries.empty(); }
+
+ private:
+  struct Entry {
+    MemoryMap* map;
+    uint64_t addr;
+    VectorData init;
+    Update update;
+  };
+  std::vector<Entry> m_entries;
+  // Entries of each packet address, in record order
+  robin_hood::unordered_map<uint64_t, std::vector<uint32_t>> m_pending;
+};
 }
 #endif  // FUNCSIM_MEMORY_MAP_H_
\ No newline at end of file
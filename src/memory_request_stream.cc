@@ -0,0 +1,119 @@
+#ifdef TIMING_SIMULATION
+#include "memory_request_stream.h"
+
+#include "m2ndp_parser.h"
+namespace NDPSim {
+
+MemoryRequestStream::MemoryRequestStream(M2NDPConfig* config,
+                                         std::string launch_path,
+                                         std::string kernel_path,
+                                         size_t window)
+    : m_config(config), m_kernel_path(kernel_path), m_window(window) {
+  // gzopen reads uncompressed files transparently
+  m_trace = gzopen(launch_path.c_str(), "rb");
+  if (m_trace == NULL) {
+    spdlog::error("Failed to open launch trace {}", launch_path);
+    throw std::runtime_error("Failed to open launch trace");
+  }
+  gzbuffer(m_trace, 1 << 16);
+  if (m_kernel_path.find("fc") != std::string::npos) m_uthread_iters = 2;
+  if (m_kernel_path.find("proj") != std::string::npos) m_uthread_iters = 2;
+  if (m_kernel_path.find("attention1") != std::string::npos)
+    m_uthread_iters = 3;
+}
+
+MemoryRequestStream::~MemoryRequestStream() {
+  if (m_trace != NULL) gzclose(m_trace);
+}
+
+bool MemoryRequestStream::empty() {
+  refill();
+  return m_requests.empty() && m_pushed.empty();
+}
+
+mem_fetch* MemoryRequestStream::front() {
+  refill();
+  if (!m_requests.empty()) return m_requests.front();
+  assert(!m_pushed.empty());
+  return m_pushed.front();
+}
+
+void MemoryRequestStream::pop() {
+  refill();
+  if (!m_requests.empty())
+    m_requests.pop_front();
+  else
+    m_pushed.pop();
+}
+
+void MemoryRequestStream::push(mem_fetch* mf) { m_pushed.push(mf); }
+
+void MemoryRequestStream::refill() {
+  if (!m_requests.empty() || m_trace == NULL) return;
+  while (m_requests.size() < m_window && next_request()) {
+  }
+  if (m_requests.empty()) {
+    gzclose(m_trace);
+    m_trace = NULL;
+  }
+}
+
+bool MemoryRequestStream::read_line(std::string& line) {
+  char buffer[4096];
+  line.clear();
+  while (gzgets(m_trace, buffer, sizeof(buffer)) != NULL) {
+    line += buffer;
+    if (line.back() == '\n') {
+      line.pop_back();
+      return true;
+    }
+  }
+  return !line.empty();
+}
+
+// Appends the next request in trace order; false once the trace is drained
+bool MemoryRequestStream::next_request() {
+  while (true) {
+    if (m_uthread_pending) {
+      if (m_uthread_offset < m_info->size) {
+        uint64_t addr = m_info->base_addr + m_uthread_offset;
+        mem_fetch* mf = new mem_fetch(addr, DMA_ALLOC_W, WRITE_REQUEST,
+                                      PACKET_SIZE, CXL_OVERHEAD, 0);
+        mf->set_filtering();
+        mf->set_from_ndp(false);
+        mf->set_uthread_request();
+        mf->set_channel(m_config->get_channel_index(addr));
+        m_requests.push_back(mf);
+        m_uthread_offset += PACKET_SIZE;
+        return true;
+      }
+      m_uthread_offset = 0;
+      if (++m_uthread_iter < m_uthread_iters) continue;
+      m_uthread_pending = false;
+    }
+    if (m_info != NULL && m_next_m2ndp < m_config->get_num_m2ndps()) {
+      uint64_t addr = KERNEL_LAUNCH_ADDR;
+      mem_fetch* mf = new mem_fetch(addr, DMA_ALLOC_W, WRITE_REQUEST,
+                                    PACKET_SIZE, CXL_OVERHEAD, 0);
+      mf->set_filtering();
+      mf->set_from_ndp(false);
+      mf->set_data(m_info);
+      mf->set_channel(m_config->get_channel_index(addr));
+      m_requests.push_back(mf);
+      m_next_m2ndp++;
+      if (m_config->is_sc_work()) {
+        m_uthread_pending = true;
+        m_uthread_iter = 0;
+        m_uthread_offset = 0;
+      }
+      return true;
+    }
+    std::string line;
+    if (!read_line(line)) return false;
+    if (line.find("#") != std::string::npos) continue;
+    m_info = M2NDPParser::parse_kernel_launch(line, 0);
+    m_next_m2ndp = 0;
+  }
+}
+}  // namespace NDPSim
+#endif
@@ -0,0 +1,58 @@
+#ifdef TIMING_SIMULATION
+#ifndef MEMORY_REQUEST_STREAM_H
+#define MEMORY_REQUEST_STREAM_H
+#include <zlib.h>
+
+#include <deque>
+#include <memory>
+#include <queue>
+#include <string>
+
+#include "common.h"
+#include "m2ndp_config.h"
+#include "mem_fetch.h"
+namespace NDPSim {
+
+// Host memory requests of one NDP command, produced on demand from its launch
+// trace. Each launch line expands into one kernel launch packet per memory
+// buffer and, with sc_work, the uthread requests covering the launch range.
+// At most `window` requests are materialized ahead of the consumer, so memory
+// use follows what is in flight rather than the trace length. The trace may
+// be gzip-compressed. Requests pushed by the runner (BI replies) are served
+// after the trace is drained.
+class MemoryRequestStream {
+ public:
+  static const size_t DEFAULT_WINDOW = 4096;
+
+  MemoryRequestStream() {}
+  MemoryRequestStream(M2NDPConfig* config, std::string launch_path,
+                      std::string kernel_path, size_t window = DEFAULT_WINDOW);
+  ~MemoryRequestStream();
+  bool empty();
+  mem_fetch* front();
+  void pop();
+  void push(mem_fetch* mf);
+
+ private:
+  bool read_line(std::string& line);
+  bool next_request();
+  void refill();
+
+  M2NDPConfig* m_config = NULL;
+  gzFile m_trace = NULL;
+  std::string m_kernel_path;
+  size_t m_window = 0;
+  std::deque<mem_fetch*> m_requests;
+  std::queue<mem_fetch*> m_pushed;
+
+  // Expansion state of the current launch line
+  KernelLaunchInfo* m_info = NULL;
+  int m_next_m2ndp = 0;
+  bool m_uthread_pending = false;
+  int m_uthread_iters = 1;
+  int m_uthread_iter = 0;
+  uint64_t m_uthread_offset = 0;
+};
+}  // namespace NDPSim
+#endif
+#endif
@@ -1,6 +1,8 @@
 #include "ndp_instruction.h"
 
+#include <mutex>
 #include <set>
+#include <unordered_set>
 
 #include "memory_map.h"
 #include "register_unit.h"
@@ -95,74 +97,180 @@ VectorData MemoryMapLoad(Context& context, uint64_t addr);
 void MemoryMapStore(Context& context, uint64_t addr, VectorData& data);
 bool CheckMemoryMap(Context& context, uint64_t addr);
 
+// context.write_log when writes of addr go to it, NULL otherwise
+WriteLog* GetWriteLog(Context& context, MemoryMap* map);
+
+// Atomic read-modify-write of the packet holding addr, starting from init if
+// the packet was never written. Returns the packet as this unit saw it before
+// the update. With context.write_log set, updates of global memory are
+// recorded and applied later instead.
+template <typename UpdateFn>
+VectorData AtomicUpdate(Context& context, uint64_t addr, VectorData init,
+                        UpdateFn update) {
+  addr = MemoryMap::FormatAddr(addr);
+  MemoryMap* map = GetMemoryMap(context, addr);
+  WriteLog* log = GetWriteLog(context, map);
+  VectorData vd = init;
+  if (log != NULL && log->Pending(addr))
+    vd = log->Load(map, addr);
+  else if (map->CheckAddr(addr))
+    vd = map->Load(addr);
+  if (log != NULL) {
+    log->RecordUpdate(map, addr, init, update);
+    return vd;
+  }
+  VectorData updated = vd;
+  update(updated);
+  map->Store(addr, updated);
+  return vd;
+}
+
+enum OpcodeFlag : uint32_t {
+  OP_VECTOR = 1 << 0,
+  OP_FLOAT = 1 << 1,
+  OP_NARROWING = 1 << 2,
+  OP_WIDENING = 1 << 3,
+  OP_AMO = 1 << 4,
+  OP_CSR = 1 << 5,
+  OP_VMASK = 1 << 6,
+  OP_SEG = 1 << 7,
+  OP_LOAD = 1 << 8,
+  OP_STORE = 1 << 9,
+  OP_BRANCH = 1 << 10,
+  OP_INDEXED = 1 << 11,
+  OP_DEST_WRITE = 1 << 12
+};
+
+struct OpcodeInfo {
+  uint32_t flags;
+  AluOpType alu_op_type;
+  void (NdpInstruction::*execute)(Context&);
+};
+
+static uint32_t DecodeOpcodeFlags(Opcode opcode) {
+  uint32_t flags = 0;
+  if (vector_ops.find(opcode) != vector_ops.end()) flags |= OP_VECTOR;
+  if (float_ops.find(opcode) != float_ops.end()) flags |= OP_FLOAT;
+  if (narrowing_ops.find(opcode) != narrowing_ops.end()) flags |= OP_NARROWING;
+  if (widening_ops.find(opcode) != widening_ops.end()) flags |= OP_WIDENING;
+  if (amo_ops.find(opcode) != amo_ops.end()) flags |= OP_AMO;
+  if (csr_ops.find(opcode) != csr_ops.end()) flags |= OP_CSR;
+  if (vmask_ops.find(opcode) != vmask_ops.end()) flags |= OP_VMASK;
+  if (seg_ops.find(opcode) != seg_ops.end()) flags |= OP_SEG;
+  if (branch_ops.find(opcode) != branch_ops.end()) flags |= OP_BRANCH;
+  if (opcode == VLE8 || opcode == VLE16 || opcode == VLE32 ||
+      opcode == VLE64 || opcode == LW || opcode == LD || opcode == LB ||
+      opcode == FLW || opcode == VLUXEI32 || opcode == VLUXEI64 ||
+      opcode == VLSSEG || (flags & OP_AMO))
+    flags |= OP_LOAD;
+  if (opcode == VSE8 || opcode == VSE16 || opcode == VSE32 ||
+      opcode == VSE64 || opcode == SW || opcode == SD || opcode == SB ||
+      opcode == FSW || opcode == VSUXEI32)
+    flags |= OP_STORE;
+  if (opcode == VLUXEI32 || opcode == VLUXEI64 || opcode == VSUXEI32)
+    flags |= OP_INDEXED;
+  if (!(opcode == VSETVLI || opcode == CSRWI || opcode == CSRW ||
+        (flags & (OP_STORE | OP_AMO))))
+    flags |= OP_DEST_WRITE;
+  return flags;
+}
+
+static AluOpType DecodeAluOpType(Opcode opcode, uint32_t flags) {
+  if (flags & (OP_LOAD | OP_STORE)) return ADDRESS_OP;
+  if (opcode == DIV || opcode == FDIV || opcode == VDIV || opcode == VFDIV ||
+      opcode == VFEXP || opcode == FEXP || opcode == VFSQRT)
+    return SFU_OP;
+  if (flags & OP_FLOAT) {
+    if (opcode == VFMACC || opcode == VFMSUB) return FP_MAD_OP;
+    if (opcode == VMAX) return FP_MAX_OP;
+    if (opcode == FMUL || opcode == VFMUL) return FP_MUL_OP;
+    return FP_ADD_OP;
+  } else {
+    if (opcode == MUL || opcode == MULI || opcode == VMUL) return INT_MUL_OP;
+    return INT_ADD_OP;
+  }
+}
+
+const OpcodeInfo& NdpInstruction::GetOpcodeInfo(Opcode opcode) {
+  // Decoded once per opcode from the opcode sets above
+  static const std::array<OpcodeInfo, NUM_OPCODES> table = [] {
+    std::array<OpcodeInfo, NUM_OPCODES> table;
+    for (int i = 0; i < NUM_OPCODES; i++) {
+      Opcode opcode = static_cast<Opcode>(i);
+      OpcodeInfo& info = table[i];
+      info.flags = DecodeOpcodeFlags(opcode);
+      info.alu_op_type = DecodeAluOpType(opcode, info.flags);
+      if (opcode == EXIT)
+        info.execute = nullptr;
+      else if (info.flags & OP_BRANCH)
+        info.execute = &NdpInstruction::ExecuteBranch;
+      else if (info.flags & (OP_CSR | OP_VECTOR | OP_SEG))
+        info.execute = &NdpInstruction::ExecuteVector;
+      else
+        info.execute = &NdpInstruction::ExecuteScalar;
+    }
+    return table;
+  }();
+  return table[opcode];
+}
+
+const char* NdpInstruction::InternText(const std::string& text) {
+  static std::mutex mutex;
+  static std::unordered_set<std::string> pool;
+  std::lock_guard<std::mutex> lock(mutex);
+  return pool.insert(text).first->c_str();
+}
+
 bool NdpInstruction::CheckScalarOp() {
-  return vector_ops.find(opcode) == vector_ops.end();
+  return !(GetOpcodeInfo(opcode).flags & OP_VECTOR);
 }
 
 bool NdpInstruction::CheckFloatOp() {
-  return float_ops.find(opcode) != float_ops.end();
+  return GetOpcodeInfo(opcode).flags & OP_FLOAT;
 }
 
 bool NdpInstruction::CheckVectorOp() {
-  return vector_ops.find(opcode) != vector_ops.end();
+  return GetOpcodeInfo(opcode).flags & OP_VECTOR;
 }
 
 bool NdpInstruction::CheckNarrowingOp() {
-  return narrowing_ops.find(opcode) != narrowing_ops.end();
+  return GetOpcodeInfo(opcode).flags & OP_NARROWING;
 }
 
 bool NdpInstruction::CheckWideningOp() {
-  return widening_ops.find(opcode) != widening_ops.end();
+  return GetOpcodeInfo(opcode).flags & OP_WIDENING;
 }
 
 bool NdpInstruction::CheckAmoOp() {
-  return amo_ops.find(opcode) != amo_ops.end();
+  return GetOpcodeInfo(opcode).flags & OP_AMO;
 }
 
 bool NdpInstruction::CheckCsrOp() {
-  return csr_ops.find(opcode) != csr_ops.end();
+  return GetOpcodeInfo(opcode).flags & OP_CSR;
 }
 
 bool NdpInstruction::CheckVmaskOp() {
-  return vmask_ops.find(opcode) != vmask_ops.end();
+  return GetOpcodeInfo(opcode).flags & OP_VMASK;
 }
 
 bool NdpInstruction::CheckSegOp() {
-  return seg_ops.find(opcode) != seg_ops.end();
+  return GetOpcodeInfo(opcode).flags & OP_SEG;
 }
 
 bool NdpInstruction::CheckLoadOp() {
-  return opcode == VLE8 || opcode == VLE16 || opcode == VLE32 ||
-         opcode == VLE64 || opcode == LW || opcode == LD || opcode == LB ||
-         opcode == FLW || opcode == VLUXEI32 || opcode == VLUXEI64 ||
-         opcode == VLSSEG || CheckAmoOp();
+  return GetOpcodeInfo(opcode).flags & OP_LOAD;
 }
 
 bool NdpInstruction::CheckStoreOp() {
-  return opcode == VSE8 || opcode == VSE16 || opcode == VSE32 ||
-         opcode == VSE64 || opcode == SW || opcode == SD || opcode == SB ||
-         opcode == FSW || opcode == VSUXEI32;
+  return GetOpcodeInfo(opcode).flags & OP_STORE;
 }
 
 bool NdpInstruction::CheckDestWrite() {
-  return !(opcode == VSETVLI || opcode == CSRWI || opcode == CSRW ||
-           CheckStoreOp() || CheckAmoOp());
+  return GetOpcodeInfo(opcode).flags & OP_DEST_WRITE;
 }
 
 AluOpType NdpInstruction::GetAluOpType() {
-  if (CheckLoadOp() || CheckStoreOp()) return ADDRESS_OP;
-  if (opcode == DIV || opcode == FDIV || opcode == VDIV || opcode == VFDIV ||
-      opcode == VFEXP || opcode == FEXP || opcode == VFSQRT)
-    return SFU_OP;
-  if (CheckFloatOp()) {
-    if (opcode == VFMACC || opcode == VFMSUB) return FP_MAD_OP;
-    if (opcode == VMAX) return FP_MAX_OP;
-    if (opcode == FMUL || opcode == VFMUL) return FP_MUL_OP;
-    return FP_ADD_OP;
-  } else {
-    if (opcode == MUL || opcode == MULI || opcode == VMUL) return INT_MUL_OP;
-    return INT_ADD_OP;
-  }
+  return GetOpcodeInfo(opcode).alu_op_type;
 }
 
 ArithOp NdpInstruction::GetArithOp() {
@@ -178,35 +286,20 @@ ArithOp NdpInstruction::GetArithOp() {
 }
 
 bool NdpInstruction::CheckBranchOp() {
-  return branch_ops.find(opcode) != branch_ops.end();
+  return GetOpcodeInfo(opcode).flags & OP_BRANCH;
 }
 
 bool NdpInstruction::CheckIndexedOp() {
-  return opcode == VLUXEI32 || opcode == VSUXEI32;
+  return GetOpcodeInfo(opcode).flags & OP_INDEXED;
 }
 
 void NdpInstruction::Execute(Context& context) {
-  if (opcode == EXIT) {
-    return;
-  } else if (CheckBranchOp()) {
-    ExecuteBranch(context);
-    return;
-  } else if (CheckCsrOp()) {
-    ExecuteVector(context);
-    return;
-  } else if (CheckVectorOp()) {
-    ExecuteVector(context);
-    return;
-  } else if (CheckSegOp()) {
-    ExecuteVector(context);
-    return;
-  } else if (CheckScalarOp()) {
-    ExecuteScalar(context);
-    return;
-  } else {
+  if (opcode < 0 || opcode >= NUM_OPCODES) {
     spdlog::error("Unsupported instruction {} : {}", opcode, sInst);
     throw std::runtime_error("Unsupported instruction");
   }
+  const OpcodeInfo& info = GetOpcodeInfo(opcode);
+  if (info.execute) (this->*info.execute)(context);
 }
 
 void amo_loop(Context context, VectorData vmask, VectorData offsets,
@@ -243,113 +336,146 @@ void amo_loop(Context context, VectorData vmask, VectorData offsets,
       default:
         throw std::runtime_error("Unsupported offset type");
     }
-    MemoryMap* map = GetMemoryMap(context, addr);
-    VectorData vd(vs.GetPrecision()*8, 1);  // Force single register
-    try {
-      vd = map->Load((addr & ~(PACKET_SIZE - 1)));
-    } catch (const std::runtime_error& error) {
-      vd = VectorData(vs.GetPrecision()*8, 1);
-      vd.SetType(vs.GetType());
-    }
-    if (vd.GetType() == FLOAT32)
-      vd.SetData(arith_op<float>(op, vd.GetFloatData(idx), vs.GetFloatData(i)),
-                 idx);
-    else if (vd.GetType() == UINT8)
-      vd.SetData(arith_op<uint8_t>(op, vd.GetU8Data(idx), vs.GetU8Data(i)),
-                 idx);
-    else if (vs.GetType() == INT16)
-      vd.SetData(
-          arith_op<int16_t>(op, vd.GetShortData(idx), vs.GetShortData(i)), idx);
-    else if (vs.GetType() == FLOAT16)
-      vd.SetData(
-          arith_op<half>(op, vd.GetHalfData(idx), vs.GetHalfData(i)), idx);
-   else if (vs.GetType() == INT32)
-      vd.SetData(arith_op<int32_t>(op, vd.GetIntData(idx), vs.GetIntData(i)),
-                 idx);
-    else if (vs.GetType() == INT64)
-      vd.SetData(arith_op<int64_t>(op, vd.GetLongData(idx), vs.GetLongData(i)),
-                 idx);
-    else
-      throw std::runtime_error("Unsupported Data Type");
-    MemoryMapStore(context, (addr & ~(PACKET_SIZE - 1)), vd);
+    VectorData init(vs.GetPrecision()*8, 1);  // Force single register
+    init.SetType(vs.GetType());
+    AtomicUpdate(context, addr, init, [=](VectorData& vd) {
+      if (vd.GetType() == FLOAT32)
+        vd.SetData(
+            arith_op<float>(op, vd.GetFloatData(idx), vs.GetFloatData(i)), idx);
+      else if (vd.GetType() == UINT8)
+        vd.SetData(arith_op<uint8_t>(op, vd.GetU8Data(idx), vs.GetU8Data(i)),
+                   idx);
+      else if (vs.GetType() == INT16)
+        vd.SetData(
+            arith_op<int16_t>(op, vd.GetShortData(idx), vs.GetShortData(i)),
+            idx);
+      else if (vs.GetType() == FLOAT16)
+        vd.SetData(
+            arith_op<half>(op, vd.GetHalfData(idx), vs.GetHalfData(i)), idx);
+      else if (vs.GetType() == INT32)
+        vd.SetData(
+            arith_op<int32_t>(op, vd.GetIntData(idx), vs.GetIntData(i)), idx);
+      else if (vs.GetType() == INT64)
+        vd.SetData(
+            arith_op<int64_t>(op, vd.GetLongData(idx), vs.GetLongData(i)),
+            idx);
+      else
+        throw std::runtime_error("Unsupported Data Type");
+    });
   }
 }
 
 void NdpInstruction::ExecuteScalar(Context& context) {
-  if (opcode == ADD) {
+  switch (opcode) {
+  case ADD: {
     int64_t rs1 = context.register_map->ReadXreg(src[0], context);
     int64_t rs2 = context.register_map->ReadXreg(src[1], context);
     context.register_map->WriteXreg(dest, rs1 + rs2, context);
-  } else if (opcode == ADDI) {
+    break;
+  }
+  case ADDI: {
     int64_t rs1 = context.register_map->ReadXreg(src[0], context);
     int64_t rs2 = src[1];
     context.register_map->WriteXreg(dest, rs1 + rs2, context);
-  } else if (opcode == SUB) {
+    break;
+  }
+  case SUB: {
     int64_t rs1 = context.register_map->ReadXreg(src[0], context);
     int64_t rs2 = context.register_map->ReadXreg(src[1], context);
     context.register_map->WriteXreg(dest, rs1 - rs2, context);
-  } else if (opcode == MUL) {
+    break;
+  }
+  case MUL: {
     int64_t rs1 = context.register_map->ReadXreg(src[0], context);
     int64_t rs2 = context.register_map->ReadXreg(src[1], context);
     context.register_map->WriteXreg(dest, rs1 * rs2, context);
-  } else if (opcode == MULI) {
+    break;
+  }
+  case MULI: {
     int64_t rs1 = context.register_map->ReadXreg(src[0], context);
     int64_t rs2 = src[1];
     context.register_map->WriteXreg(dest, rs1 * rs2, context);
-  } else if (opcode == SLL) {
+    break;
+  }
+  case SLL: {
     int64_t rs1 = context.register_map->ReadXreg(src[0], context);
     int64_t rs2 = context.register_map->ReadXreg(src[1], context);
     context.register_map->WriteXreg(dest, rs1 << rs2, context);
-  } else if (opcode == SLLI) {
+    break;
+  }
+  case SLLI: {
     int64_t rs1 = context.register_map->ReadXreg(src[0], context);
     int64_t rs2 = src[1];
     context.register_map->WriteXreg(dest, rs1 << rs2, context);
-  } else if (opcode == SRL) {
+    break;
+  }
+  case SRL: {
     int64_t rs1 = context.register_map->ReadXreg(src[0], context);
     int64_t rs2 = context.register_map->ReadXreg(src[1], context);
     context.register_map->WriteXreg(dest, rs1 >> rs2, context);
-  } else if (opcode == SRLI) {
+    break;
+  }
+  case SRLI: {
     int64_t rs1 = context.register_map->ReadXreg(src[0], context);
     int64_t rs2 = src[1];
     context.register_map->WriteXreg(dest, rs1 >> rs2, context);
-  } else if (opcode == DIV) {
+    break;
+  }
+  case DIV: {
     int64_t rs1 = context.register_map->ReadXreg(src[0], context);
     int64_t rs2 = context.register_map->ReadXreg(src[1], context);
     context.register_map->WriteXreg(dest, rs1 / rs2, context);
-  } else if (opcode == REM) {
+    break;
+  }
+  case REM: {
     int64_t rs1 = context.register_map->ReadXreg(src[0], context);
     int64_t rs2 = context.register_map->ReadXreg(src[1], context);
     context.register_map->WriteXreg(dest, rs1 % rs2, context);
-  } else if (opcode == AND) {
+    break;
+  }
+  case AND: {
     int64_t rs1 = context.register_map->ReadXreg(src[0], context);
     int64_t rs2 = context.register_map->ReadXreg(src[1], context);
     context.register_map->WriteXreg(dest, rs1 & rs2, context);
-  } else if (opcode == ANDI) {
+    break;
+  }
+  case ANDI: {
     int64_t rs1 = context.register_map->ReadXreg(src[0], context);
     int64_t rs2 = src[1];
     context.register_map->WriteXreg(dest, rs1 & rs2, context);
-  } else if (opcode == OR) {
+    break;
+  }
+  case OR: {
     int64_t rs1 = context.register_map->ReadXreg(src[0], context);
     int64_t rs2 = context.register_map->ReadXreg(src[1], context);
     context.register_map->WriteXreg(dest, rs1 | rs2, context);
-  } else if (opcode == ORI) {
+    break;
+  }
+  case ORI: {
     int64_t rs1 = context.register_map->ReadXreg(src[0], context);
     int64_t rs2 = src[1];
     context.register_map->WriteXreg(dest, rs1 | rs2, context);
+    break;
   }
-  else if (opcode == CSRWI) {
+  case CSRWI: {
     if (dest == REG_VSTART) {
       context.csr->vstart = src[0];
     }
-  } else if (opcode == CSRW) {
+    break;
+  }
+  case CSRW: {
     if (dest == REG_VSTART) {
       context.csr->vstart = context.register_map->ReadXreg(src[0], context);
     } else
       throw std::runtime_error("Not supported instruction yet.");
-  } else if (opcode == LI) {
+    break;
+  }
+  case LI: {
     int64_t xreg_value = src[0];
     context.register_map->WriteXreg(dest, xreg_value, context);
-  } else if (opcode == LW) {
+    break;
+  }
+  case LW: {
     int64_t addr = context.register_map->ReadXreg(src[0], context);
     int64_t offset = src[1];
     addr += offset;
@@ -357,7 +483,9 @@ void NdpInstruction::ExecuteScalar(Context& context) {
     int index = (addr % PACKET_SIZE) / WORD_SIZE;
     assert(vs.GetType() == INT32);
     context.register_map->WriteXreg(dest, vs.GetIntData(index), context);
-  } else if (opcode == LD) {
+    break;
+  }
+  case LD: {
     int64_t addr = context.register_map->ReadXreg(src[0], context);
     int64_t offset = src[1];
     addr += offset;
@@ -365,10 +493,14 @@ void NdpInstruction::ExecuteScalar(Context& context) {
     int index = (addr - MemoryMap::FormatAddr(addr)) / DOUBLE_SIZE;
     assert(vs.GetType() == INT64);
     context.register_map->WriteXreg(dest, vs.GetLongData(index), context);
-  } else if (opcode == LBU) {
+    break;
+  }
+  case LBU: {
     char rs1 = context.register_map->ReadXreg(src[0], context);
     context.register_map->WriteXreg(dest, rs1, context);
-  } else if (opcode == SB) {
+    break;
+  }
+  case SB: {
     uint8_t x_val = context.register_map->ReadXreg(dest, context);
     int64_t addr = context.register_map->ReadXreg(src[0], context);
     addr += src[1];
@@ -379,7 +511,9 @@ void NdpInstruction::ExecuteScalar(Context& context) {
       vs = MemoryMapLoad(context, addr);
     vs.SetData(x_val, offset);
     MemoryMapStore(context, addr, vs);
-  } else if (opcode == SW) {
+    break;
+  }
+  case SW: {
     int64_t x_val = context.register_map->ReadXreg(dest, context);
     int64_t addr = context.register_map->ReadXreg(src[0], context);
     addr += src[1];
@@ -388,7 +522,9 @@ void NdpInstruction::ExecuteScalar(Context& context) {
     if (CheckMemoryMap(context, addr)) vs = MemoryMapLoad(context, addr);
     vs.SetData((int32_t)x_val, offset);
     MemoryMapStore(context, addr, vs);
-  } else if (opcode == SD) {
+    break;
+  }
+  case SD: {
     int64_t x_val = context.register_map->ReadXreg(dest, context);
     int64_t addr = context.register_map->ReadXreg(src[0], context);
     addr += src[1];
@@ -397,23 +533,33 @@ void NdpInstruction::ExecuteScalar(Context& context) {
     if (CheckMemoryMap(context, addr)) vs = MemoryMapLoad(context, addr);
     vs.SetData(x_val, offset);
     MemoryMapStore(context, addr, vs);
-  } else if (opcode == FADD) {
+    break;
+  }
+  case FADD: {
     float rs1 = context.register_map->ReadFreg(src[0], context);
     float rs2 = context.register_map->ReadFreg(src[1], context);
     context.register_map->WriteFreg(dest, rs1 + rs2, context);
-  } else if (opcode == FSUB) {
+    break;
+  }
+  case FSUB: {
     float rs1 = context.register_map->ReadFreg(src[0], context);
     float rs2 = context.register_map->ReadFreg(src[1], context);
     context.register_map->WriteFreg(dest, rs1 - rs2, context);
-  } else if (opcode == FDIV) {
+    break;
+  }
+  case FDIV: {
     float rs1 = context.register_map->ReadFreg(src[0], context);
     float rs2 = context.register_map->ReadFreg(src[1], context);
     context.register_map->WriteFreg(dest, rs1 / rs2, context);
-  } else if (opcode == FMUL) {
+    break;
+  }
+  case FMUL: {
     float rs1 = context.register_map->ReadFreg(src[0], context);
     float rs2 = context.register_map->ReadFreg(src[1], context);
     context.register_map->WriteFreg(dest, rs1 * rs2, context);
-  } else if (opcode == FMV) {
+    break;
+  }
+  case FMV: {
     if (operand_type == X_W) {
       float rs1 = context.register_map->ReadFreg(src[0], context);
       context.register_map->WriteXreg(dest, int32_t(rs1), context);
@@ -421,7 +567,9 @@ void NdpInstruction::ExecuteScalar(Context& context) {
       int64_t rs1 = context.register_map->ReadXreg(src[0], context);
       context.register_map->WriteFreg(dest, float(rs1), context);
     }
-  } else if (opcode == FLW) {
+    break;
+  }
+  case FLW: {
     int64_t addr = context.register_map->ReadXreg(src[0], context);
     int64_t offset = src[1];
     addr += offset;
@@ -429,7 +577,9 @@ void NdpInstruction::ExecuteScalar(Context& context) {
     int index = (addr % 32) / 4;
     assert(vs.GetType() == FLOAT32);
     context.register_map->WriteFreg(dest, vs.GetFloatData(index), context);
-  } else if (opcode == FSW) {
+    break;
+  }
+  case FSW: {
     float f_val = context.register_map->ReadFreg(dest, context);
     int64_t addr = context.register_map->ReadXreg(src[0], context);
     addr += src[1];
@@ -440,85 +590,65 @@ void NdpInstruction::ExecuteScalar(Context& context) {
     }
     vs.SetData((float)f_val, offset);
     MemoryMapStore(context, addr, vs);
-  } else if (opcode == AMOADD) {
+    break;
+  }
+  case AMOADD: {
     int64_t addr = context.register_map->ReadXreg(src[2], context);
-    VectorData vd(context);
-    if (CheckMemoryMap(context, addr)) {
-      vd = MemoryMapLoad(context, addr);
-    }
-    int value = 0, index = 0;
-    if (operand_type == W) {
-      // Atomic Add in word size
-      index = (addr % PACKET_SIZE) / WORD_SIZE;
-      value = vd.GetIntData(index) + context.register_map->ReadXreg(src[1], context);
-    } else if (operand_type == D) {
-      // Atmoic Add in double size
-      index = (addr % PACKET_SIZE) / DOUBLE_SIZE;
-      value = vd.GetLongData(index) + context.register_map->ReadXreg(src[1], context);
-    } else {
+    int64_t rs2 = context.register_map->ReadXreg(src[1], context);
+    bool word = operand_type == W;
+    // Atomic add in word or double size
+    if (operand_type != W && operand_type != D)
       throw std::runtime_error("Unsupported scalar instruction");
-    }
-    vd.SetData(value, index);
-    MemoryMapStore(context, addr, vd);
-    context.register_map->WriteXreg(dest, value, context);
-  } else if (opcode == FAMOADD) {
-    int64_t addr = context.register_map->ReadXreg(src[2], context);
-    VectorData vd(context);
-    
-    int idx = 0;
-
-    if (CheckMemoryMap(context, addr)) {
-      vd = MemoryMapLoad(context, addr);
-    }
-
-    float value = 0;
-    int index = 0;
-    if (operand_type == W) {
-      // Atomic Add in word size
-      index = (addr % PACKET_SIZE) / WORD_SIZE;
-      value = vd.GetFloatData(index) + context.register_map->ReadFreg(src[1], context);
-
-      vd.SetData((float)value, index);
-    } else {
-      // Atomic Add in word size
-      index = (addr % PACKET_SIZE) / HALF_SIZE;
-      value = vd.GetHalfData(index) + context.register_map->ReadFreg(src[1], context);
-      // throw std::runtime_error("Unsupported scalar instruction");
-      vd.SetData((half)value, index);
-    }
-
-    MemoryMapStore(context, addr, vd);
-    context.register_map->WriteFreg(dest, value, context);
-  } else if (opcode == FAMOADDH) {
+    int index = (addr % PACKET_SIZE) / (word ? WORD_SIZE : DOUBLE_SIZE);
+    auto add = [=](const VectorData& vd) -> int {
+      return (word ? vd.GetIntData(index) : vd.GetLongData(index)) + rs2;
+    };
+    VectorData vd = AtomicUpdate(
+        context, addr, VectorData(context),
+        [=](VectorData& packet) { packet.SetData(add(packet), index); });
+    if (dest != -1) context.register_map->WriteXreg(dest, add(vd), context);
+    break;
+  }
+  case FAMOADD:
+  case FAMOADDH: {
     int64_t addr = context.register_map->ReadXreg(src[2], context);
-    VectorData vd(context);    
-    int idx = 0;
-    if (CheckMemoryMap(context, addr)) {
-      vd = MemoryMapLoad(context, addr);
-    }
-    float value = 0;
-    int index = 0;
-
-    index = (addr % PACKET_SIZE) / HALF_SIZE;
-    value = vd.GetHalfData(index) + context.register_map->ReadFreg(src[1], context);
-    vd.SetData((half)value, index);
-
-    MemoryMapStore(context, addr, vd);
-    context.register_map->WriteFreg(dest, value, context);
-  } else if (opcode == AMOMAX) {
-  } else if (opcode == FEXP) {
+    float rs2 = context.register_map->ReadFreg(src[1], context);
+    // Atomic add in word size, or half size for famoadd.h
+    bool word = opcode == FAMOADD && operand_type == W;
+    int index = (addr % PACKET_SIZE) / (word ? WORD_SIZE : HALF_SIZE);
+    auto add = [=](const VectorData& vd) -> float {
+      return word ? vd.GetFloatData(index) + rs2 : vd.GetHalfData(index) + rs2;
+    };
+    VectorData vd = AtomicUpdate(context, addr, VectorData(context),
+                                 [=](VectorData& packet) {
+                                   if (word)
+                                     packet.SetData(add(packet), index);
+                                   else
+                                     packet.SetData((half)add(packet), index);
+                                 });
+    if (dest != -1) context.register_map->WriteFreg(dest, add(vd), context);
+    break;
+  }
+  case AMOMAX: {
+    break;
+  }
+  case FEXP: {
     float rs1 = context.register_map->ReadFreg(src[0], context);
     context.register_map->WriteFreg(dest, std::exp(rs1), context);
-  } else {
+    break;
+  }
+  default: {
     throw std::runtime_error("Unsupported scalar instruction");
   }
+  }
 }
 
 void NdpInstruction::ExecuteVector(Context& context) {
   bool word_type_op = context.csr->vtype_vsew == 32;
   bool double_reg = context.csr->vtype_vlmul == 2;
 
-  if (opcode == VSETVLI) {
+  switch (opcode) {
+  case VSETVLI: {
     // Todo: implement other configuration of vtype
     if (src[1] == IMM_E8) {
       context.csr->vtype_vsew = 8;
@@ -547,7 +677,10 @@ void NdpInstruction::ExecuteVector(Context& context) {
       context.csr->vtype_vlmul = 0.125;
     } else
       throw std::runtime_error("Not implemented vtype_vlmul");
-  } else if (opcode == VADD || opcode == VFADD) {
+    break;
+  }
+  case VADD:
+  case VFADD: {
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
     VectorData vd(context);
     if (operand_type == VV) {
@@ -566,7 +699,10 @@ void NdpInstruction::ExecuteVector(Context& context) {
       throw std::runtime_error("Unsupported vector instruction");
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VSUB || opcode == VFSUB) {
+    break;
+  }
+  case VSUB:
+  case VFSUB: {
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
     if (CheckFloatOp() && word_type_op)
       vs1.SetType(FLOAT32);
@@ -598,7 +734,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       throw std::runtime_error("Unsupported vector instruction");
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VFWSUB) {
+    break;
+  }
+  case VFWSUB: {
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);    
     assert(vs1.GetType() == FLOAT16);
     VectorData temp(context);
@@ -617,7 +755,10 @@ void NdpInstruction::ExecuteVector(Context& context) {
       throw std::runtime_error("Unsupported vector instruction yet");
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VRSUB || opcode == VFRSUB) {
+    break;
+  }
+  case VRSUB:
+  case VFRSUB: {
     VectorData vs2 = context.register_map->ReadVreg(src[1], context);
     if (!CheckFloatOp()) vs2.SetType(INT32);
     if (CheckFloatOp() && word_type_op) vs2.SetType(FLOAT32);
@@ -633,7 +774,10 @@ void NdpInstruction::ExecuteVector(Context& context) {
       throw std::runtime_error("Unsupported vector instruction");
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VMUL || opcode == VFMUL) {
+    break;
+  }
+  case VMUL:
+  case VFMUL: {
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
     VectorData vd(context);
     if (operand_type == VV) {
@@ -652,7 +796,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       throw std::runtime_error("Unsupported vector instruction");
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VFWMUL) {
+    break;
+  }
+  case VFWMUL: {
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
     VectorData vd(context);
     vd.SetVectorDoubleReg();
@@ -684,7 +830,10 @@ void NdpInstruction::ExecuteVector(Context& context) {
       throw std::runtime_error("Unsupported vector instruction");
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VDIV || opcode == VFDIV) {
+    break;
+  }
+  case VDIV:
+  case VFDIV: {
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
     if (!CheckFloatOp()) vs1.SetType(INT32);
     if (CheckFloatOp() && word_type_op) vs1.SetType(FLOAT32);
@@ -707,7 +856,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       throw std::runtime_error("Unsupported vector instruction");
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VSLL) {
+    break;
+  }
+  case VSLL: {
     VectorData vd(context);
     VectorData vs2 = context.register_map->ReadVreg(src[0], context);
     if (operand_type == VV) {
@@ -746,7 +897,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
     } else {
       throw std::runtime_error("Unsupported vector instruction");
     }
-  } else if (opcode == VSRL) {
+    break;
+  }
+  case VSRL: {
     if(operand_type == VI) {
       uint32_t uimm = src[1];
       VectorData vd(context);
@@ -763,8 +916,12 @@ void NdpInstruction::ExecuteVector(Context& context) {
       }
       context.register_map->WriteVreg(dest, vd, context);
     }
-  } else if (opcode == VSRA) {
-  } else if (opcode == VNADD) {
+    break;
+  }
+  case VSRA: {
+    break;
+  }
+  case VNADD: {
     VectorData vd(context);
     VectorData vs2 = context.register_map->ReadVreg(src[0], context);
     if (operand_type == WX) {
@@ -782,7 +939,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
     } else
       throw std::runtime_error("Unsupported vector instruction");
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VFRDIV) {
+    break;
+  }
+  case VFRDIV: {
     VectorData vd(context);
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
     float f2 = context.register_map->ReadFreg(src[1], context);
@@ -793,7 +952,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       throw std::runtime_error("Unsupported vector instruction");
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VMV) {
+    break;
+  }
+  case VMV: {
     VectorData vm;
     if (src[1] != -1) vm = context.register_map->ReadVreg(src[1], context);
     if (operand_type == V_V) {
@@ -967,7 +1128,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       context.register_map->WriteVreg(dest, vd, context);
     } else
       throw std::runtime_error("Unsupported vector instruction");
-  } else if (opcode == Opcode::VID) {
+    break;
+  }
+  case VID: {
     VectorData vd(context);
     for (int i = context.csr->vstart; i < vd.GetVlen(); i++) {
       switch (context.csr->vtype_vsew) {
@@ -988,13 +1151,22 @@ void NdpInstruction::ExecuteVector(Context& context) {
       }
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == Opcode::VMSET) {
+    break;
+  }
+  case VMSET: {
     VectorData vd(context);
     for (int i = context.csr->vstart; i < vd.GetVlen(); i++) {
       vd.SetVmask(true, i);
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (CheckVmaskOp()) {
+    break;
+  }
+  case VMSEQ:
+  case VMSNE:
+  case VMSLT:
+  case VMSGT:
+  case VMSLE:
+  case VMSGE: {
     LogicalOp op;
     if (opcode == VMSEQ)
       op = LogicalOp::EQ;
@@ -1109,7 +1281,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
         throw std::runtime_error("Unsupported type.");
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VMAND) {
+    break;
+  }
+  case VMAND: {
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
     VectorData vd(context);
     if (operand_type == MM) {
@@ -1121,7 +1295,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       throw std::runtime_error("VMAND must use mm operand_type");
     vd.SetType(VMASK);
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VMOR) {
+    break;
+  }
+  case VMOR: {
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
     VectorData vd(context);
     if (operand_type == MM) {
@@ -1133,7 +1309,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       throw std::runtime_error("VMAND must use mm operand_type");
     vd.SetType(VMASK);
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VAND) {
+    break;
+  }
+  case VAND: {
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
     VectorData vd(context);
     if (operand_type == VV) {
@@ -1166,7 +1344,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       }
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VOR) {
+    break;
+  }
+  case VOR: {
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
     VectorData vd = context.register_map->ReadVreg(dest, context);
     if (operand_type == VV) {
@@ -1195,7 +1375,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       }
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VFIRST) {
+    break;
+  }
+  case VFIRST: {
     VectorData vs0 = context.register_map->ReadVreg(src[0], context);
     int first = -1;
     assert(vs0.GetType() == VMASK);
@@ -1206,7 +1388,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       }
     }
     context.register_map->WriteXreg(dest, first, context);
-  } else if (opcode == VMIN) {
+    break;
+  }
+  case VMIN: {
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
     VectorData vd(double_reg);
     vd.SetType(INT32);
@@ -1241,7 +1425,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       throw std::runtime_error("Unsupported vector instruction");
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VMAX) {
+    break;
+  }
+  case VMAX: {
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
     VectorData vd(context);
     if (operand_type == VV) {
@@ -1275,7 +1461,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       throw std::runtime_error("Unsupported vector instruction");
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VCOMPRESS) {
+    break;
+  }
+  case VCOMPRESS: {
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
     if (!CheckFloatOp()) vs1.SetType(INT32);
     if (CheckFloatOp() && word_type_op) vs1.SetType(FLOAT32);
@@ -1299,7 +1487,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       throw std::runtime_error("Unsupported vector instruction");
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VSLIDE1DOWN) {
+    break;
+  }
+  case VSLIDE1DOWN: {
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
     VectorData vd(context);
 
@@ -1348,7 +1538,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       vd.SetType(CHAR8);
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VSLIDEDOWN) {
+    break;
+  }
+  case VSLIDEDOWN: {
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
     VectorData vd(context);
     int move = 0;
@@ -1392,7 +1584,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       vd.SetType(CHAR8);
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VSLIDE1UP) {  // TODO: implement VSLIDEUP instructions
+    break;
+  }
+  case VSLIDE1UP: {  // TODO: implement VSLIDEUP instructions
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
     VectorData vd(context);
 
@@ -1434,8 +1628,12 @@ void NdpInstruction::ExecuteVector(Context& context) {
       vd.SetType(CHAR8);
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VSLIDEUP) {
-  } else if (opcode == VLSSEG) {
+    break;
+  }
+  case VSLIDEUP: {
+    break;
+  }
+  case VLSSEG: {
     int64_t base = context.register_map->ReadXreg(src[0], context);
     VectorData vs2 = context.register_map->ReadVreg(src[1], context);
     VectorData temp(context);
@@ -1474,7 +1672,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
     for (int i = 0; i < segCnt; i++) {
       context.register_map->WriteVreg(segDest[i], vd[i], context);
     }
-  } else if (opcode == TEST) {
+    break;
+  }
+  case TEST: {
     if (operand_type == V_X) {
         printf("hex(%llx) dec(%lld)\n",
                context.register_map->ReadXreg(src[0], context),
@@ -1506,7 +1706,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
 
       vs0.PrintVectorData();
     }
-  } else if (opcode == VFMACC) {
+    break;
+  }
+  case VFMACC: {
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
     VectorData vs_temp = context.register_map->ReadVreg(src[0], context);
     VectorData vd = context.register_map->ReadVreg(dest, context);
@@ -1521,7 +1723,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       throw std::runtime_error("Unsupported vector instruction");
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VFMSUB) {
+    break;
+  }
+  case VFMSUB: {
     VectorData vs1 = context.register_map->ReadVreg(src[1], context);
     VectorData vs_temp = context.register_map->ReadVreg(src[1], context);
     VectorData vd = context.register_map->ReadVreg(dest, context);
@@ -1536,7 +1740,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       throw std::runtime_error("Unsupported vector instruction");
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VFWMACC) {
+    break;
+  }
+  case VFWMACC: {
     if (word_type_op)
       throw std::runtime_error("VFWMACC must use double dest register");
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
@@ -1571,7 +1777,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       throw std::runtime_error("Unsupported vector instruction");
     }
     // context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VFNCVT) {
+    break;
+  }
+  case VFNCVT: {
     // if (word_type_op)
     //   throw std::runtime_error("VFNCVT must use single dest register");
 
@@ -1593,7 +1801,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       }
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VFCVT) {
+    break;
+  }
+  case VFCVT: {
     VectorData vd(context);
     VectorData vs = context.register_map->ReadVreg(src[0], context);
     for (uint32_t i = context.csr->vstart; i < vd.GetVlen(); i++) {
@@ -1607,7 +1817,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       }
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VFWCVT) {
+    break;
+  }
+  case VFWCVT: {
     // if (!word_type_op)
     //   throw std::runtime_error("VFWCVT must use double dest register");
     VectorData vd(context);
@@ -1628,7 +1840,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       }
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VFMV) {
+    break;
+  }
+  case VFMV: {
     if (operand_type == V_V) {
       VectorData vd(word_type_op);
       VectorData vs1 = context.register_map->ReadVreg(src[0], context);
@@ -1692,7 +1906,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       }
       context.register_map->WriteVreg(dest, vd, context);
     }
-  } else if (opcode == VFSQRT) {
+    break;
+  }
+  case VFSQRT: {
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
     VectorData vd(context);
     if (operand_type == V) {
@@ -1705,7 +1921,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       }
     } else throw std::runtime_error("Unsupported vector instruction");
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VFREDOMAX) {
+    break;
+  }
+  case VFREDOMAX: {
     if (operand_type != VS)
       throw std::runtime_error("VFREDOMAX must use vector-vector[0]");
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
@@ -1727,7 +1945,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       vd.SetData(max, 0);
       context.register_map->WriteVreg(dest, vd, context);
     }
-  } else if (opcode == VFREDOSUM) {
+    break;
+  }
+  case VFREDOSUM: {
     if (operand_type != VS)
       throw std::runtime_error("VFREDOMAX must use vector-vector[0]");
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
@@ -1749,7 +1969,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       vd.SetData(sum, 0);
       context.register_map->WriteVreg(dest, vd, context);
     }
-  } else if (opcode == VREDSUM) {
+    break;
+  }
+  case VREDSUM: {
     if (operand_type != VS)
       throw std::runtime_error("VREDSUM must use vector-vector[0]");
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
@@ -1790,7 +2012,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       throw std::runtime_error("Can't use char8 type");
     } else
       throw std::runtime_error("Unsupported type");
-  } else if (opcode == VREDMAX) {
+    break;
+  }
+  case VREDMAX: {
     if (operand_type != VS)
       throw std::runtime_error("VREDMAX must use vector-vector[0]");
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
@@ -1826,7 +2050,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
     } else
       throw std::runtime_error("Unsupported type");
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VREDMIN) {
+    break;
+  }
+  case VREDMIN: {
     if (operand_type != VS)
       throw std::runtime_error("VREDMIN must use vector-vector[0]");
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
@@ -1870,7 +2096,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
     } else
       throw std::runtime_error("Unsupported type");
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VREDOR) {
+    break;
+  }
+  case VREDOR: {
     if (operand_type != VS)
       throw std::runtime_error("VREDOR must use vector-vector[0]");
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
@@ -1906,7 +2134,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
     } else
       throw std::runtime_error("Unsupported type");
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VWREDOSUM) {
+    break;
+  }
+  case VWREDOSUM: {
     if (operand_type != VS)
       throw std::runtime_error("VFREDOMAX must use vector-vector[0]");
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
@@ -1921,7 +2151,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       vd.SetData(float(sum), 0);
       context.register_map->WriteVreg(dest, vd, context);
     }
-  } else if (opcode == VWREDOMAX) {
+    break;
+  }
+  case VWREDOMAX: {
     if (operand_type != VS)
       throw std::runtime_error("VWREDOMAX must use vector-vector[0]");
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
@@ -1936,19 +2168,25 @@ void NdpInstruction::ExecuteVector(Context& context) {
       vd.SetData(float(max), 0);
       context.register_map->WriteVreg(dest, vd, context);
     }
-  } else if (opcode == VLE8) {
+    break;
+  }
+  case VLE8: {
     uint64_t addr = context.register_map->ReadXreg(src[0], context);
     uint64_t offset = src[1];
     VectorData vd(context);
     vd = MemoryMapLoad(context, addr + offset);
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VLE16) {
+    break;
+  }
+  case VLE16: {
     uint64_t addr = context.register_map->ReadXreg(src[0], context);
     uint64_t offset = src[1];
     VectorData vd(context);
     vd = MemoryMapLoad(context, addr + offset);
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VLE32) {
+    break;
+  }
+  case VLE32: {
     uint64_t addr = context.register_map->ReadXreg(src[0], context);
     uint64_t offset = src[1];
     VectorData vd;
@@ -1959,7 +2197,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       vd.Append(vd2);
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VLE64) {
+    break;
+  }
+  case VLE64: {
     uint64_t addr = context.register_map->ReadXreg(src[0], context);
     uint64_t offset = src[1];
     VectorData vd;
@@ -1978,17 +2218,23 @@ void NdpInstruction::ExecuteVector(Context& context) {
       vd = vd8[0];
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VSE8) {
+    break;
+  }
+  case VSE8: {
     uint64_t addr = context.register_map->ReadXreg(src[0], context);
     uint64_t offset = src[1];
     VectorData vs = context.register_map->ReadVreg(dest, context);
     MemoryMapStore(context, addr + offset, vs);
-  } else if (opcode == VSE16) {
+    break;
+  }
+  case VSE16: {
     uint64_t addr = context.register_map->ReadXreg(src[0], context);
     uint64_t offset = src[1];
     VectorData vs = context.register_map->ReadVreg(dest, context);
     MemoryMapStore(context, addr + offset, vs);
-  } else if (opcode == VSE32) {
+    break;
+  }
+  case VSE32: {
     uint64_t addr = context.register_map->ReadXreg(src[0], context);
     uint64_t offset = src[1];
     VectorData vs = context.register_map->ReadVreg(dest, context);
@@ -1999,7 +2245,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
     } else {
       MemoryMapStore(context, addr + offset, vs);
     }
-  } else if (opcode == VSE64) {
+    break;
+  }
+  case VSE64: {
     uint64_t addr = context.register_map->ReadXreg(src[0], context);
     uint64_t offset = src[1];
     VectorData vs = context.register_map->ReadVreg(dest, context);
@@ -2010,7 +2258,20 @@ void NdpInstruction::ExecuteVector(Context& context) {
     } else {
       MemoryMapStore(context, addr + offset, vs);
     }
-  } else if (CheckVectorOp() && CheckAmoOp()) {
+    break;
+  }
+  case VAMOADDEI8:
+  case VAMOADDEI16:
+  case VAMOADDEI32:
+  case VAMOADDEI64:
+  case VAMOANDEI16:
+  case VAMOANDEI32:
+  case VAMOOREI16:
+  case VAMOOREI32:
+  case VAMOMAXEI16:
+  case VAMOMAXEI32:
+  case VAMOMINEI16:
+  case VAMOMINEI32: {
     uint64_t base = context.register_map->ReadXreg(src[0], context);
     VectorData offset = context.register_map->ReadVreg(src[1], context);
     VectorData vs = context.register_map->ReadVreg(src[2], context);
@@ -2019,7 +2280,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
     if (src[3] != -1) vmask = context.register_map->ReadVreg(src[3], context);
     vmask.SetType(VMASK);
     amo_loop(context, vmask, offset, vs, base, GetArithOp());
-  } else if (opcode == VLUXEI32) {  // vluxei32.v   vd, (rs1), vs2, vm  #
+    break;
+  }
+  case VLUXEI32: {  // vluxei32.v   vd, (rs1), vs2, vm  #
                                     // unordered 32-bit indexed load of SEW data
     uint64_t base = context.register_map->ReadXreg(
         src[0], context);  // read base address from src[0]
@@ -2047,7 +2310,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
     }
     context.register_map->WriteVreg(dest, vd, context);
     assert(vd.GetType() == INT32 || vd.GetType() == FLOAT32);
-  } else if (opcode == VLUXEI64) {  // vluxei64.v   vd, (rs1), vs2, vm  #
+    break;
+  }
+  case VLUXEI64: {  // vluxei64.v   vd, (rs1), vs2, vm  #
                                     // unordered 64-bit indexed load of SEW data
     uint64_t base = context.register_map->ReadXreg(
         src[0], context);  // base address read from src[0]
@@ -2068,7 +2333,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       vd.SetData(vs.GetLongData(s_idx), i);
     }
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VSUXEI32) {
+    break;
+  }
+  case VSUXEI32: {
     uint64_t base = context.register_map->ReadXreg(
         src[0], context);  // read base address from src[0]
     uint64_t offset = src[1];
@@ -2101,7 +2368,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
       }
       MemoryMapStore(context, addr, s_vd);
     }
-  } else if (opcode == VFEXP) {   // vfexp.v vd, rs1
+    break;
+  }
+  case VFEXP: {   // vfexp.v vd, rs1
     VectorData vs1 = context.register_map->ReadVreg(src[0], context);
     VectorData vd(context);
     vd.SetType(vs1.GetType());
@@ -2110,7 +2379,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
     else
       throw std::runtime_error("Unsupported vector instruction");
     context.register_map->WriteVreg(dest, vd, context);
-  } else if (opcode == VFSGNJ) {
+    break;
+  }
+  case VFSGNJ: {
     if (operand_type == VV) {
       VectorData vs1 = context.register_map->ReadVreg(src[0], context);
       VectorData vs2 = context.register_map->ReadVreg(src[1], context);
@@ -2160,7 +2431,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
     } else {
       throw std::runtime_error("Unsupported vector instruction");
     }
-  } else if (opcode == VFSGNJN) {
+    break;
+  }
+  case VFSGNJN: {
     if (operand_type == VV) {
       VectorData vs1 = context.register_map->ReadVreg(src[0], context);
       VectorData vs2 = context.register_map->ReadVreg(src[1], context);
@@ -2210,7 +2483,9 @@ void NdpInstruction::ExecuteVector(Context& context) {
     } else {
       throw std::runtime_error("Unsupported vector instruction");
     }
-  } else if (opcode == VFSGNJX) {
+    break;
+  }
+  case VFSGNJX: {
     if (operand_type == VV) {
       VectorData vs1 = context.register_map->ReadVreg(src[0], context);
       VectorData vs2 = context.register_map->ReadVreg(src[1], context);
@@ -2263,9 +2538,12 @@ void NdpInstruction::ExecuteVector(Context& context) {
     } else {
       throw std::runtime_error("Unsupported vector instruction");
     }
-  } else {
+    break;
+  }
+  default: {
     throw std::runtime_error("Unsupported vector instruction");
   }
+  }
 
   // Reset vstart;
   context.csr->vstart = 0;
@@ -2318,24 +2596,38 @@ MemoryMap* GetMemoryMap(Context& context, uint64_t addr) {
     return context.memory_map;
 }
 
+WriteLog* GetWriteLog(Context& context, MemoryMap* map) {
+  // Scratchpads are private to a unit and written directly
+  return map == context.memory_map ? context.write_log : NULL;
+}
+
 VectorData MemoryMapLoad(Context& context, uint64_t addr) {
   VectorData vd(context);
   addr = MemoryMap::FormatAddr(addr);
   MemoryMap* map = GetMemoryMap(context, addr);
-  vd = map->Load(addr);
+  WriteLog* log = GetWriteLog(context, map);
+  if (log != NULL && log->Pending(addr))
+    vd = log->Load(map, addr);
+  else
+    vd = map->Load(addr);
   return vd;
 }
 
 void MemoryMapStore(Context& context, uint64_t addr, VectorData& vs) {
   addr = MemoryMap::FormatAddr(addr);
   MemoryMap* map = GetMemoryMap(context, addr);
-  map->Store(addr, vs);
+  WriteLog* log = GetWriteLog(context, map);
+  if (log != NULL)
+    log->RecordStore(map, addr, vs);
+  else
+    map->Store(addr, vs);
 }
 
 bool CheckMemoryMap(Context& context, uint64_t addr) {
   addr = MemoryMap::FormatAddr(addr);
   MemoryMap* map = GetMemoryMap(context, addr);
-  return map->CheckAddr(addr);
+  WriteLog* log = GetWriteLog(context, map);
+  return (log != NULL && log->Pending(addr)) || map->CheckAddr(addr);
 }
 
 }  // namespace NDPSim
\ No newline at end of file
@@ -1,10 +1,13 @@
 #ifndef NDP_INSTRUCTION_H_
 #define NDP_INSTRUCTION_H_
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <map>
 #include <set>
+#include <string>
 #include <half.hpp>
 using namespace half_float;
 namespace NDPSim {
@@ -172,7 +175,8 @@ enum Opcode {
   VFEXP,
   /* Special opcode */
   TEST,
-  EXIT
+  EXIT,
+  NUM_OPCODES
 };
 
 static std::map<std::string, Opcode> opcode_type_map = {
@@ -386,6 +390,7 @@ static const char* AluOpTypeString[] = {
     "FP_ADD_OP",  "FP_MAX_OP",     "FP_MUL_OP",    "FP_MAD_OP",  "FP_DIV_OP",
     "SFU_OP",     "INT_REDUCE_OP", "FP_REDUCE_OP", "LDST_OP",    "ADDRESS_OP"};
 struct Context;
+struct OpcodeInfo;
 
 enum ArithOp {
   ARITH_ADD = 0,
@@ -440,39 +445,110 @@ template <>
 float arith_op<float>(ArithOp op, const float& lhs, const float& rhs);
 template <>
 half arith_op<half>(ArithOp op, const half& lhs, const half& rhs);
-struct NdpInstruction {
-  NdpInstruction() {}
-  NdpInstruction(const NdpInstruction& other) {
-    sInst = other.sInst;
-    opcode = other.opcode;
-    operand_type = other.operand_type;
-    for (int i = 0; i < 5; i++) {
-      src[i] = other.src[i];
-    }
-    dest = other.dest;
-    for (int i = 0; i < 8; i++) {
-      segDest[i] = other.segDest[i];
+// Sorted set of the packet addresses a memory instruction touches. The few
+// packets of a unit-stride access stay inline; indexed accesses spill to the
+// heap.
+class AddrSet {
+ public:
+  static const size_t INLINE_CAPACITY = 8;
+
+  AddrSet() {}
+  AddrSet(const AddrSet& other) { assign(other); }
+  AddrSet(AddrSet&& other) noexcept { take(other); }
+  ~AddrSet() { release(); }
+  AddrSet& operator=(const AddrSet& other) {
+    if (this != &other) {
+      m_size = 0;
+      assign(other);
     }
-    for (auto addr : other.addr_set) {
-      addr_set.insert(addr);
+    return *this;
+  }
+  AddrSet& operator=(AddrSet&& other) noexcept {
+    if (this != &other) {
+      release();
+      take(other);
     }
-    segCnt = other.segCnt;
-    arrive = other.arrive;
-    depart = other.depart;
-    last = other.last;
-    double_reg = other.double_reg;
-    doBranch = other.doBranch;
+    return *this;
   }
-  ~NdpInstruction() {
-    addr_set.clear();
+
+  const uint64_t* begin() const { return m_ptr; }
+  const uint64_t* end() const { return m_ptr + m_size; }
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+  void clear() { m_size = 0; }
+  void insert(uint64_t addr) {
+    const uint64_t* pos = std::lower_bound(begin(), end(), addr);
+    if (pos != end() && *pos == addr) return;
+    size_t index = pos - m_ptr;
+    if (m_size == m_capacity) reserve(m_capacity * 2);
+    std::memmove(m_ptr + index + 1, m_ptr + index,
+                 (m_size - index) * sizeof(uint64_t));
+    m_ptr[index] = addr;
+    m_size++;
+  }
+  // Keeps duplicates; each entry becomes one memory request
+  void append(uint64_t addr) {
+    const uint64_t* pos = std::upper_bound(begin(), end(), addr);
+    size_t index = pos - m_ptr;
+    if (m_size == m_capacity) reserve(m_capacity * 2);
+    std::memmove(m_ptr + index + 1, m_ptr + index,
+                 (m_size - index) * sizeof(uint64_t));
+    m_ptr[index] = addr;
+    m_size++;
+  }
+
+ private:
+  void reserve(size_t capacity) {
+    if (capacity <= m_capacity) return;
+    uint64_t* heap = new uint64_t[capacity];
+    std::memcpy(heap, m_ptr, m_size * sizeof(uint64_t));
+    size_t size = m_size;
+    release();
+    m_ptr = heap;
+    m_size = size;
+    m_capacity = capacity;
   }
-  std::string sInst;
+  void assign(const AddrSet& other) {
+    reserve(other.m_size);
+    std::memcpy(m_ptr, other.m_ptr, other.m_size * sizeof(uint64_t));
+    m_size = other.m_size;
+  }
+  void release() {
+    if (m_ptr != m_inline) delete[] m_ptr;
+    m_ptr = m_inline;
+    m_size = 0;
+    m_capacity = INLINE_CAPACITY;
+  }
+  void take(AddrSet& other) {
+    m_size = other.m_size;
+    if (other.m_ptr == other.m_inline) {
+      std::memcpy(m_inline, other.m_inline, m_size * sizeof(uint64_t));
+    } else {
+      m_ptr = other.m_ptr;
+      m_capacity = other.m_capacity;
+      other.m_ptr = other.m_inline;
+      other.m_capacity = INLINE_CAPACITY;
+    }
+    other.m_size = 0;
+  }
+
+  uint64_t m_inline[INLINE_CAPACITY];
+  uint64_t* m_ptr = m_inline;
+  size_t m_size = 0;
+  size_t m_capacity = INLINE_CAPACITY;
+};
+
+// Decoded instruction. The source text is interned once at parse time and
+// opcode properties come from a per-opcode table, so copying an instruction
+// through the pipelines does not touch strings or tree nodes.
+struct NdpInstruction {
+  const char* sInst = "";
   Opcode opcode;
   OperandType operand_type;
   int64_t src[5] = {-1};
   int64_t dest;
   int64_t segDest[8];
-  std::set<uint64_t> addr_set;
+  AddrSet addr_set;
   int segCnt = 0;
   unsigned long long arrive;
   unsigned long long depart;
@@ -498,8 +574,10 @@ struct NdpInstruction {
   int IsBranch();
   AluOpType GetAluOpType();
   ArithOp GetArithOp();
+  static const char* InternText(const std::string& text);
 
  private:
+  static const OpcodeInfo& GetOpcodeInfo(Opcode opcode);
   void ExecuteScalar(Context& context);
   void ExecuteVector(Context& context);
   void ExecuteBranch(Context& context);
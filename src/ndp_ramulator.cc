@@ -2,6 +2,8 @@
 #include "ndp_ramulator.h"
 
 #include <string>
+
+#include "stats_registry.h"
 namespace NDPSim {
 
 NdpRamulator::NdpRamulator(unsigned buffer_id, unsigned memory_id,
@@ -26,11 +28,44 @@ NdpRamulator::NdpRamulator(unsigned buffer_id, unsigned memory_id,
   m_to_crossbar_queue.resize(m_config->get_num_channels());
   m_from_crossbar_queue.resize(m_config->get_num_channels());
   m_to_crossbar_bi_queue.resize(m_config->get_num_channels());
+  if (m_config->get_l2d_atomic_units()) {
+    if (m_config->get_l2d_atomic_latency() < 0 ||
+        m_config->get_l2d_atomic_interval() < 1 ||
+        m_config->get_l2d_atomic_queue_size() < 1) {
+      spdlog::error(
+          "l2d_atomic_latency must be >= 0, l2d_atomic_interval and "
+          "l2d_atomic_queue_size >= 1");
+      exit(1);
+    }
+    m_atomic_queue.resize(m_config->get_num_channels());
+    m_atomic_unit.resize(m_config->get_num_channels());
+    m_atomic_inflight.resize(m_config->get_num_channels());
+  }
   for (int i = 0; i < m_config->get_num_channels(); i++) {
     int ch_id = get_memory_channel(i);
     m_stats[i].set_id(ch_id);
     m_caches[i] = new DataCache(std::string("ndp_l2_cache"), m_cache_config,
                                 ch_id, 0, &(m_to_mem_queue[i]));
+    std::string stats_prefix =
+        "m2ndp" + std::to_string(m_buffer_id) + ".l2d" + std::to_string(i);
+    m_caches[i]->register_stats(stats_prefix);
+    if (m_config->get_l2d_prefetcher()) {
+      Prefetcher* prefetcher = new Prefetcher(
+          ROW_PREFETCH, m_config->get_l2d_prefetch_degree(),
+          m_config->get_l2d_prefetch_distance(), 1, m_caches[i],
+          &m_cache_config, &m_stats[i]);
+      prefetcher->set_row_locality(m_config, ch_id,
+                                   m_config->get_l2d_prefetch_row_size());
+      m_prefetchers.push_back(prefetcher);
+      m_stats[i].register_prefetch_stats(stats_prefix);
+    }
+    if (m_config->get_l2d_atomic_units()) {
+      m_atomic_queue[i].resize(m_config->get_l2d_num_banks());
+      for (int bank = 0; bank < m_config->get_l2d_num_banks(); bank++)
+        m_atomic_unit[i].push_back(DelayQueue<mem_fetch*>(
+            "atomic_unit", false, m_config->get_l2d_atomic_queue_size()));
+      m_stats[i].register_atomic_stats(stats_prefix);
+    }
     m_to_crossbar_bi_queue[i].resize(m_config->get_l2d_num_banks());
     for (int bank = 0; bank < m_config->get_l2d_num_banks(); bank++) {
       m_cache_latency_queue[i].push_back(DelayQueue<mem_fetch*>(
@@ -45,23 +80,64 @@ NdpRamulator::NdpRamulator(unsigned buffer_id, unsigned memory_id,
   mem_count = 0;
 }
 
+NdpRamulator::~NdpRamulator() {
+  for (int i = 0; i < m_config->get_num_channels(); i++)
+    StatsRegistry::get()->remove("m2ndp" + std::to_string(m_buffer_id) +
+                                 ".l2d" + std::to_string(i));
+}
+
 void NdpRamulator::dram_cycle() {
   Ramulator::cycle();
   process_memory_requests();
 }
 
+uint64_t NdpRamulator::idle_dram_cycles() {
+  if (is_active()) return 0;
+  for (int i = 0; i < m_config->get_num_channels(); i++) {
+    if (!m_to_mem_queue[i].empty()) return 0;
+    for (int bank = 0; bank < m_config->get_l2d_num_banks(); bank++) {
+      if (!m_cache_latency_queue[i][bank].idle()) return 0;
+      if (!m_atomic_unit.empty() && !m_atomic_unit[i][bank].idle()) return 0;
+    }
+  }
+  return Ramulator::idle_ticks();
+}
+
 void NdpRamulator::cache_cycle() {
   for (int i = 0; i < m_config->get_num_channels(); i++) {
     for (int bank = 0; bank < m_config->get_l2d_num_banks(); bank++) {
 
-      m_cache_latency_queue[i][bank].cycle();
+      if (!m_cache_latency_queue[i][bank].idle())
+        m_cache_latency_queue[i][bank].cycle();
+      if (!m_atomic_unit.empty()) {
+        if (!m_atomic_unit[i][bank].idle()) m_atomic_unit[i][bank].cycle();
+        // Atomic unit to NDP
+        if (!m_atomic_unit[i][bank].empty() &&
+            !m_cache_latency_queue[i][bank].full()) {
+          mem_fetch* req = m_atomic_unit[i][bank].top();
+          m_atomic_inflight[i].erase(req->get_addr());
+          req->set_reply();
+          m_cache_latency_queue[i][bank].push(req, 0);
+          m_atomic_unit[i][bank].pop();
+        }
+        issue_atomic(i, bank);
+      }
       // NDP to Cache
 
-      if (!m_from_crossbar_queue[i][bank].empty() &&
-          m_caches[i]->data_port_free()) {
+      if (!m_atomic_unit.empty() && !m_from_crossbar_queue[i][bank].empty() &&
+          m_from_crossbar_queue[i][bank].top()->is_atomic()) {
+        if (m_atomic_queue[i][bank].size() <
+            (size_t)m_config->get_l2d_atomic_queue_size()) {
+          mem_fetch* req = m_from_crossbar_queue[i][bank].top();
+          req->current_state = MF_RAMULATOR_FROM_CROSSBAR;
+          m_atomic_queue[i][bank].push({req, m_config->get_ndp_cycle()});
+          m_from_crossbar_queue[i][bank].pop();
+        }
+      } else if (!m_from_crossbar_queue[i][bank].empty() &&
+                 m_caches[i]->data_port_free()) {
         int memory_channel = get_memory_channel(i);
         mem_fetch* req = m_from_crossbar_queue[i][bank].top();
-        req->current_state = "NDP ramulator top from crossbar";
+        req->current_state = MF_RAMULATOR_FROM_CROSSBAR;
         int channel = m_config->get_channel_index(req->get_addr());
         assert(channel == memory_channel);
         std::deque<CacheEvent> events;
@@ -69,21 +145,23 @@ void NdpRamulator::cache_cycle() {
             req->get_addr(), m_config->get_ndp_cycle(), req, events);
         bool write_sent = CacheEvent::was_write_sent(events);
         bool read_sent = CacheEvent::was_read_sent(events);
+        if (!m_prefetchers.empty() && !req->is_write())
+          m_prefetchers[i]->demand_access(req->get_addr(), status);
         if (status == HIT) {
           if (!write_sent) {
             req->set_reply();
-            req->current_state = "L2 hit";
+            req->current_state = MF_L2_HIT;
             m_cache_latency_queue[i][bank].push(
                 req, m_config->get_l2d_hit_latency());
           }
           m_from_crossbar_queue[i][bank].pop();
         } else if (status != RESERVATION_FAIL) {
-          req->current_state = "L2MISS";
+          req->current_state = MF_L2_MISS;
           if (req->is_write() &&
               (m_cache_config.get_write_alloc_policy() == FETCH_ON_WRITE ||
                m_cache_config.get_write_alloc_policy() == LAZY_FETCH_ON_READ)) {
             req->set_reply();
-            req->current_state = "L2MISS write";
+            req->current_state = MF_L2_MISS_WRITE;
             m_cache_latency_queue[i][bank].push(
                 req, m_config->get_l2d_hit_latency());
           }
@@ -99,9 +177,19 @@ void NdpRamulator::cache_cycle() {
 
       // Cache to NDP
       if (m_caches[i]->access_ready() &&
-          !m_cache_latency_queue[i][bank].full()) {
+          m_caches[i]->top_next_access()->is_prefetch(L2D_PREFETCH)) {
         mem_fetch* req = m_caches[i]->top_next_access();
-        req->current_state = "L2 top next access";
+        m_prefetchers[i]->filled(req->get_addr());
+        m_caches[i]->pop_next_access();
+        delete req;
+      } else if (!m_atomic_unit.empty() && m_caches[i]->access_ready() &&
+                 m_caches[i]->top_next_access()->is_atomic()) {
+        if (execute_atomic(i, m_caches[i]->top_next_access()))
+          m_caches[i]->pop_next_access();
+      } else if (m_caches[i]->access_ready() &&
+                 !m_cache_latency_queue[i][bank].full()) {
+        mem_fetch* req = m_caches[i]->top_next_access();
+        req->current_state = MF_L2_NEXT_ACCESS;
         if (req->is_request()) req->set_reply();
         m_cache_latency_queue[i][bank].push(req,
                                             m_config->get_l2d_hit_latency());
@@ -110,7 +198,7 @@ void NdpRamulator::cache_cycle() {
       if(!m_to_crossbar_bi_queue[i][bank].empty()) {
         if (!m_to_crossbar_queue[i][bank].full()) {
           mem_fetch* req = m_to_crossbar_bi_queue[i][bank].front();
-          req->current_state = "bi req to crossbar";
+          req->current_state = MF_BI_TO_CROSSBAR;
           m_to_crossbar_queue[i][bank].push(req);
           m_to_crossbar_bi_queue[i][bank].pop();
         }
@@ -119,11 +207,11 @@ void NdpRamulator::cache_cycle() {
         mem_fetch* req = m_cache_latency_queue[i][bank].top();
         if(m_config->is_bi_enabled() && m_config->is_bi_inprogress(req->get_addr()) 
           && req->is_write() && req->get_data() == (void*)0x77){
-          req->current_state = "bi response";
+          req->current_state = MF_BI_RESPONSE;
           m_to_crossbar_bi_queue[i][bank].push(req);
           m_cache_latency_queue[i][bank].pop();
           for(auto &bi_req : _bi_pending_lds[req->get_addr()/m_config->get_bi_unit_size()]){
-            bi_req.mf->current_state = "bi pending reqs -> to_crossbar_bi_reqs";
+            bi_req.mf->current_state = MF_BI_PENDING_TO_CROSSBAR;
             m_to_crossbar_bi_queue[bi_req.ch][bi_req.bank].push(bi_req.mf);
           }
           _bi_pending_lds.erase(req->get_addr()/m_config->get_bi_unit_size());
@@ -131,17 +219,18 @@ void NdpRamulator::cache_cycle() {
           m_config->m_inprogress_mfs.erase(req->get_addr()/m_config->get_bi_unit_size());
         }
         else if(m_config->is_bi_enabled() && m_config->is_bi_inprogress(req->get_addr()) && !req->is_write()) {
-          req->current_state = "bi pending reqs";
+          req->current_state = MF_BI_PENDING;
           _bi_pending_lds[req->get_addr()/m_config->get_bi_unit_size()].push_back({req, i, bank});
           m_cache_latency_queue[i][bank].pop();
         }
         else if (!m_to_crossbar_queue[i][bank].full()) {
-          req->current_state = "to crossbar";
+          req->current_state = MF_TO_CROSSBAR;
           m_to_crossbar_queue[i][bank].push(req);
           m_cache_latency_queue[i][bank].pop();
         }
       }
     }
+    if (!m_prefetchers.empty()) issue_prefetch(i);
     m_caches[i]->cycle();
   }
   //for (int i = 0; i < m_config->get_ndp_units_per_buffer(); i++) {
@@ -178,8 +267,14 @@ bool NdpRamulator::is_active() {
           !m_cache_latency_queue[i][j].queue_empty()) {
         return true;
       }
+      if (!m_atomic_unit.empty() && (!m_atomic_queue[i][j].empty() ||
+                                     !m_atomic_unit[i][j].queue_empty()))
+        return true;
     }
   }
+  for (auto prefetcher : m_prefetchers) {
+    if (!prefetcher->is_idle()) return true;
+  }
   return Ramulator::is_active(); 
 }
 
@@ -192,6 +287,15 @@ void NdpRamulator::print_all(FILE* fp) {
   }
   fprintf(fp, "=======Total D-Cache=======\n");
   stats.print_stats(fp, "Total D-Cache");
+  std::string stats_prefix = "m2ndp" + std::to_string(m_buffer_id) + ".l2d";
+  if (!m_prefetchers.empty()) {
+    fprintf(fp, "=======Total L2 Prefetch=======\n");
+    NdpStats::print_prefetch_totals(fp, stats_prefix);
+  }
+  if (!m_atomic_unit.empty()) {
+    fprintf(fp, "=======Total L2 Atomic=======\n");
+    NdpStats::print_atomic_totals(fp, stats_prefix);
+  }
   Ramulator::print(fp);
 }
 
@@ -210,6 +314,23 @@ void NdpRamulator::print_energy_stats(FILE* fp) {
 
 void NdpRamulator::finish() { Ramulator::finish(); }
 
+// Only the L2 tag arrays and statistics are checkpointed; Ramulator restarts
+// with closed rows, a fresh refresh schedule and its own counters cleared
+void NdpRamulator::save_state(std::ostream& os) {
+  assert(!is_active());
+  for (int i = 0; i < m_config->get_num_channels(); i++) {
+    m_caches[i]->save_state(os);
+    m_stats[i].save(os);
+  }
+}
+
+void NdpRamulator::load_state(std::istream& is) {
+  for (int i = 0; i < m_config->get_num_channels(); i++) {
+    m_caches[i]->load_state(is);
+    m_stats[i].load(is);
+  }
+}
+
 void NdpRamulator::process_memory_requests() {
   for (int i = 0; i < ramulator_configs.get_channels(); i++) {
     int memory_channel = get_memory_channel(i);
@@ -243,6 +364,96 @@ void NdpRamulator::process_memory_requests() {
   }
 }
 
+// One prefetch request per channel and cycle, only into a free L2 data port
+// while a quarter of the MSHRs stay free and few requests wait for DRAM in
+// this channel. Candidates that find no room are dropped.
+void NdpRamulator::issue_prefetch(int ch) {
+  Prefetcher* prefetcher = m_prefetchers[ch];
+  if (!prefetcher->has_candidate() || !m_caches[ch]->data_port_free()) return;
+  uint64_t addr = prefetcher->top_candidate();
+  prefetcher->pop_candidate();
+  int dram_queue = m_to_mem_queue[ch].get_length() + get_queue_occupancy(ch);
+  if (m_caches[ch]->get_mshr_free_entries() <=
+          m_cache_config.get_mshr_entries() / 4 ||
+      dram_queue >= m_config->get_l2d_prefetch_max_queue()) {
+    prefetcher->dropped();
+    return;
+  }
+  mem_fetch* mf =
+      new mem_fetch(addr, GLOBAL_ACC_R, READ_REQUEST,
+                    m_config->get_packet_size(), CXL_OVERHEAD,
+                    m_config->get_ndp_cycle());
+  mf->set_from_ndp(true);
+  mf->set_channel(m_config->get_channel_index(addr));
+  mf->set_prefetch(L2D_PREFETCH);
+  std::deque<CacheEvent> events;
+  CacheRequestStatus status =
+      m_caches[ch]->access(addr, m_config->get_ndp_cycle(), mf, events);
+  prefetcher->issued(addr, status);
+  // MISS and HIT_RESERVED keep the request in the MSHRs until the fill
+  if (status == HIT || status == RESERVATION_FAIL) delete mf;
+}
+
+// Starts the AMO at the head of a bank queue. AMOs to an address with one
+// still in flight wait, so the ALU sees every update in order. On an L2 miss
+// the AMO waits in the MSHRs and enters the ALU when the line is filled.
+void NdpRamulator::issue_atomic(int ch, int bank) {
+  if (m_atomic_queue[ch][bank].empty()) return;
+  mem_fetch* mf = m_atomic_queue[ch][bank].front().mf;
+  uint64_t addr = mf->get_addr();
+  if (m_atomic_inflight[ch].find(addr) != m_atomic_inflight[ch].end()) {
+    m_stats[ch].add_atomic_status(ATOMIC_ADDR_CONFLICT);
+    return;
+  }
+  if (m_atomic_unit[ch][bank].full()) {
+    m_stats[ch].add_atomic_status(ATOMIC_UNIT_BUSY);
+    return;
+  }
+  if (!m_caches[ch]->data_port_free()) return;
+  std::deque<CacheEvent> events;
+  CacheRequestStatus status =
+      m_caches[ch]->access(addr, m_config->get_ndp_cycle(), mf, events);
+  m_stats[ch].add_status(CACHE_DATA_ACCESS);
+  if (!m_prefetchers.empty())
+    m_prefetchers[ch]->demand_access(addr, status);
+  if (status == RESERVATION_FAIL) {
+    m_stats[ch].add_status(CACHE_RESERVATION_FAIL);
+    return;
+  }
+  m_stats[ch].add_atomic_status(ATOMIC_ISSUED);
+  m_stats[ch].add_atomic_status(
+      ATOMIC_QUEUE_CYCLES,
+      m_config->get_ndp_cycle() - m_atomic_queue[ch][bank].front().enqueue_cycle);
+  m_atomic_inflight[ch].insert(addr);
+  m_atomic_queue[ch][bank].pop();
+  if (status == HIT) {
+    mf->current_state = MF_L2_HIT;
+    execute_atomic(ch, mf);
+  } else {
+    mf->current_state = MF_L2_MISS;
+    m_stats[ch].add_atomic_status(ATOMIC_L2_MISS);
+  }
+}
+
+bool NdpRamulator::execute_atomic(int ch, mem_fetch* mf) {
+  int bank =
+      m_config->get_bank_index(mf->get_addr()) % m_config->get_l2d_num_banks();
+  if (m_atomic_unit[ch][bank].full()) {
+    m_stats[ch].add_atomic_status(ATOMIC_UNIT_BUSY);
+    return false;
+  }
+  m_atomic_unit[ch][bank].push(
+      mf, m_config->get_l2d_hit_latency() + m_config->get_l2d_atomic_latency(),
+      m_config->get_l2d_atomic_interval());
+  return true;
+}
+
+void NdpRamulator::warm(uint64_t addr, bool write) {
+  uint64_t ch = m_config->get_channel_index(addr);
+  if (ch < m_caches.size())
+    m_caches[ch]->warm(addr, write, m_config->get_ndp_cycle());
+}
+
 int NdpRamulator::get_memory_channel(int ch) {
   int contiguous_ch =
       m_config->get_channel_interleave_size() / m_config->get_packet_size();
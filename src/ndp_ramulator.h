@@ -6,6 +6,7 @@
 #include "ndp_unit.h"
 #include "m2ndp_config.h"
 #include "cache.h"
+#include "prefetcher.h"
 namespace NDPSim {
 
 class NdpRamulator : public Ramulator {
@@ -14,8 +15,13 @@ class NdpRamulator : public Ramulator {
                MemoryMap *memory_map, unsigned long long* cycles, 
                unsigned num_cores, std::string ramulator_config, 
                M2NDPConfig* m2ndp_config_, std::string out);
+  ~NdpRamulator();
   void dram_cycle();
   void cache_cycle();
+  // dram_cycle() calls that can be replaced by skip_idle_dram_cycles():
+  // 0 unless the L2 slices are drained and every pipeline is idle
+  uint64_t idle_dram_cycles();
+  void skip_idle_dram_cycles(uint64_t n) { Ramulator::skip_idle_ticks(n); }
   bool full(int port_num, int bank = 0);
   void push(mem_fetch* mf, int port_num, int bank = 0);
   mem_fetch* pop(int port_num, int bank = 0);
@@ -24,7 +30,11 @@ class NdpRamulator : public Ramulator {
   void print_all(FILE* fp);
   void print_energy_stats(FILE* fp);
   void finish();
+  void save_state(std::ostream& os);
+  void load_state(std::istream& is);
   int get_memory_channel(int ch);
+  // Functional warming of the L2 slice that owns addr
+  void warm(uint64_t addr, bool write);
 
  private:
   struct BIPendingInfo {
@@ -32,6 +42,10 @@ class NdpRamulator : public Ramulator {
     int ch;
     int bank;
   };
+  struct AtomicRequest {
+    mem_fetch* mf;
+    uint64_t enqueue_cycle;
+  };
   unsigned m_buffer_id;
   unsigned long long count;
   unsigned long long mem_count;
@@ -40,6 +54,7 @@ class NdpRamulator : public Ramulator {
   CacheConfig m_cache_config;
   
   std::vector<Cache*> m_caches;
+  std::vector<Prefetcher*> m_prefetchers;  // empty unless l2d_prefetcher
   std::vector<NdpStats> m_stats;
   std::vector<std::vector<fifo_pipeline<mem_fetch>>> m_from_crossbar_queue;
   std::vector<std::vector<fifo_pipeline<mem_fetch>>> m_to_crossbar_queue;
@@ -48,7 +63,15 @@ class NdpRamulator : public Ramulator {
   robin_hood::unordered_map<uint64_t, std::vector<BIPendingInfo>> _bi_pending_lds;
   std::vector<fifo_pipeline<mem_fetch>> m_to_mem_queue;
   std::vector<std::vector<DelayQueue<mem_fetch*>>> m_cache_latency_queue;
+  // Near-memory atomic units (l2d_atomic_units): per-bank AMO queue and
+  // ALU pipeline, and the addresses each channel has an AMO in flight for
+  std::vector<std::vector<std::queue<AtomicRequest>>> m_atomic_queue;
+  std::vector<std::vector<DelayQueue<mem_fetch*>>> m_atomic_unit;
+  std::vector<robin_hood::unordered_set<uint64_t>> m_atomic_inflight;
   void process_memory_requests();
+  void issue_prefetch(int ch);
+  void issue_atomic(int ch, int bank);
+  bool execute_atomic(int ch, mem_fetch* mf);
 };
 }  // namespace NDPSim
 #endif
@@ -1,16 +1,20 @@
 #ifdef TIMING_SIMULATION
 #include "ndp_stats.h"
 
+#include <algorithm>
+#include <cinttypes>
+
+#include "checkpoint.h"
 #include "execution_unit.h"
+#include "stats_registry.h"
 
 namespace NDPSim {
 
 NdpStats::NdpStats() {
   m_status.resize(NUM_STATUS, 0);
   m_memory_status.resize(NUM_MEM_STATUS, 0);
-  m_prev_issue_success_count = 0;
-  m_prev_cache_access = 0;
-  m_prev_cache_fill = 0;
+  m_prefetch_status.resize(NUM_PREFETCH_STATUS, 0);
+  m_atomic_status.resize(NUM_ATOMIC_STATUS, 0);
   clear();
 }
 
@@ -21,6 +25,12 @@ void NdpStats::clear() {
   for (int i = 0; i < NUM_MEM_STATUS; i++) {
     m_memory_status[i] = 0;
   }
+  for (int i = 0; i < NUM_PREFETCH_STATUS; i++) {
+    m_prefetch_status[i] = 0;
+  }
+  for (int i = 0; i < NUM_ATOMIC_STATUS; i++) {
+    m_atomic_status[i] = 0;
+  }
   m_cycle = 0;
   m_max_ndp_inst_queue_size = 0;
   m_ndp_inst_queue_size = 0;
@@ -36,7 +46,7 @@ void NdpStats::clear() {
   m_l2d_stats.clear();
 }
 
-void NdpStats::inc_cycle() { m_cycle++; }
+void NdpStats::inc_cycle(uint64_t cycles) { m_cycle += cycles; }
 
 void NdpStats::inc_ndp_inst_queue_size(int size) {
   m_ndp_inst_queue_size += size;
@@ -88,120 +98,6 @@ void NdpStats::set_max_wb_per_cyc(uint64_t total_count, uint64_t vreg_count, uin
   m_max_freg_wb_per_cyc_per_sub_core = freg_count;
 }
 
-NdpStats NdpStats::operator+(const NdpStats &other) {
-  NdpStats sum;
-  sum.m_l0_icache_stats = m_l0_icache_stats + other.m_l0_icache_stats;
-  sum.m_itlb_stasts = m_itlb_stasts + other.m_itlb_stasts;
-  sum.m_icache_stats = m_icache_stats + other.m_icache_stats;
-  sum.m_dtlb_stats = m_dtlb_stats + other.m_dtlb_stats;
-  sum.m_l1d_stats = m_l1d_stats + other.m_l1d_stats;
-  sum.m_l2d_stats = m_l2d_stats + other.m_l2d_stats;
-  sum.m_register_stats = m_register_stats + other.m_register_stats;
-  for(auto it = other.m_wait_insts.begin(); it != other.m_wait_insts.end(); it++) {
-    if(sum.m_wait_insts.find(it->first) != sum.m_wait_insts.end())
-      sum.m_wait_insts[it->first] += it->second;
-    else
-      sum.m_wait_insts[it->first] = it->second;
-  }
-
-  for (int i = 0; i < m_status.size(); i++)
-    sum.m_status[i] += m_status[i] + other.m_status[i];
-  for (int i = 0; i < m_memory_status.size(); i++)
-    sum.m_memory_status[i] += m_memory_status[i] + other.m_memory_status[i];
-  for (const auto &iter : m_wait_insts)
-    if (sum.m_wait_insts.find(iter.first) != sum.m_wait_insts.end())
-      sum.m_wait_insts[iter.first] += iter.second;
-    else
-      sum.m_wait_insts[iter.first] = iter.second;
-  sum.m_inst_issue_count = m_inst_issue_count + other.m_inst_issue_count;
-  sum.m_i_unit_issue_count = m_i_unit_issue_count + other.m_i_unit_issue_count;
-  sum.m_f_unit_issue_count = m_f_unit_issue_count + other.m_f_unit_issue_count;
-  sum.m_sf_unit_issue_count =
-      m_sf_unit_issue_count + other.m_sf_unit_issue_count;
-  sum.m_addr_unit_issue_count =
-      m_addr_unit_issue_count + other.m_addr_unit_issue_count;
-  sum.m_ldst_unit_issue_count =
-      m_ldst_unit_issue_count + other.m_ldst_unit_issue_count;
-  sum.m_spad_unit_issue_count =
-      m_spad_unit_issue_count + other.m_spad_unit_issue_count;
-  sum.m_v_unit_issue_count = m_v_unit_issue_count + other.m_v_unit_issue_count;
-  sum.m_v_sf_unit_issue_count =
-      m_v_sf_unit_issue_count + other.m_v_sf_unit_issue_count;
-  sum.m_v_addr_unit_issue_count =
-      m_v_addr_unit_issue_count + other.m_v_addr_unit_issue_count;
-  sum.m_v_ldst_unit_issue_count =
-      m_v_ldst_unit_issue_count + other.m_v_ldst_unit_issue_count;
-  sum.m_v_spad_unit_issue_count =
-      m_v_spad_unit_issue_count + other.m_v_spad_unit_issue_count;
-  sum.m_v_active_lane_issue_count
-      = m_v_active_lane_issue_count + other.m_v_active_lane_issue_count;
-  sum.m_v_total_laine_issue_count
-      = m_v_total_laine_issue_count + other.m_v_total_laine_issue_count;
-  sum.m_spad_read_count = m_spad_read_count + other.m_spad_read_count;
-  sum.m_spad_write_count = m_spad_write_count + other.m_spad_write_count;
-
-  return sum;
-}
-
-NdpStats &NdpStats::operator+=(const NdpStats &other) {
-  m_l0_icache_stats += other.m_l0_icache_stats;
-  m_itlb_stasts += other.m_itlb_stasts;
-  m_icache_stats += other.m_icache_stats;
-  m_dtlb_stats += other.m_dtlb_stats;
-  m_l1d_stats += other.m_l1d_stats;
-  m_l2d_stats += other.m_l2d_stats;
-  m_register_stats += other.m_register_stats;
-
-  for (int i = 0; i < m_status.size(); i++) m_status[i] += other.m_status[i];
-  for (int i = 0; i < m_memory_status.size(); i++)
-    m_memory_status[i] += other.m_memory_status[i];
-  for (const auto &iter : other.m_wait_insts)
-    if (m_wait_insts.find(iter.first) != m_wait_insts.end())
-      m_wait_insts[iter.first] += iter.second;
-    else
-      m_wait_insts[iter.first] = iter.second;
-  
-  m_inst_issue_count += other.m_inst_issue_count;
-  m_i_unit_issue_count += other.m_i_unit_issue_count;
-  m_f_unit_issue_count += other.m_f_unit_issue_count;
-  m_sf_unit_issue_count += other.m_sf_unit_issue_count;
-  m_addr_unit_issue_count += other.m_addr_unit_issue_count;
-  m_ldst_unit_issue_count += other.m_ldst_unit_issue_count;
-  m_spad_unit_issue_count += other.m_spad_unit_issue_count;
-
-  m_v_unit_issue_count += other.m_v_unit_issue_count;
-  m_v_sf_unit_issue_count += other.m_v_sf_unit_issue_count;
-  m_v_addr_unit_issue_count += other.m_v_addr_unit_issue_count;
-  m_v_ldst_unit_issue_count += other.m_v_ldst_unit_issue_count;
-  m_v_spad_unit_issue_count += other.m_v_spad_unit_issue_count;
-  m_v_active_lane_issue_count += other.m_v_active_lane_issue_count;
-  m_v_total_laine_issue_count += other.m_v_total_laine_issue_count;
-
-  m_spad_read_count += other.m_spad_read_count;
-  m_spad_write_count += other.m_spad_write_count;
-  return *this;
-}
-
-void NdpStats::print_stats_interval() {
-  if (m_id == 0) {
-    spdlog::info("NDP {:2}: Cache Data Access {:5}, Data Fill {:5}", m_id,
-                 m_status[CACHE_DATA_ACCESS] - m_prev_cache_access,
-                 m_status[CACHE_DATA_FILL] - m_prev_cache_fill);
-    spdlog::info("NDP {:2}: IPC {:5}", m_id,
-                 (m_issue_success_count - m_prev_issue_success_count) / 1000.0);
-  } else {
-    spdlog::debug("NDP {:2}: Cache Data Access {:5}, Data Fill {:5}", m_id,
-                  m_status[CACHE_DATA_ACCESS] - m_prev_cache_access,
-                  m_status[CACHE_DATA_FILL] - m_prev_cache_fill);
-    spdlog::debug(
-        "NDP {:2}: IPC {:5}", m_id,
-        (m_issue_success_count - m_prev_issue_success_count) / 1000.0);
-  }
-  m_prev_cache_access = m_status[CACHE_DATA_ACCESS];
-  m_prev_cache_fill = m_status[CACHE_DATA_FILL];
-  m_prev_issue_success_count = m_issue_success_count;
-}
-
 void NdpStats::print_stats(FILE *out, const char *ndp_name) const {
   float issue_rate = ((float)m_issue_success_cycle) / m_cycle * 100;
   float avg_issue_count =
@@ -267,6 +163,12 @@ void NdpStats::print_stats(FILE *out, const char *ndp_name) const {
 
   fprintf(out, "V total lane issue count: %llu\n", m_v_total_laine_issue_count);
   fprintf(out, "V active lane issue count: %llu\n", m_v_active_lane_issue_count);
+  if (m_indexed_inst_count > 0) {
+    fprintf(out, "Indexed LDST inst count: %llu\n", m_indexed_inst_count);
+    fprintf(out, "Indexed LDST requests per inst: %.2f before, %.2f after coalescing\n",
+            ((float)m_indexed_element_count) / m_indexed_inst_count,
+            ((float)m_indexed_request_count) / m_indexed_inst_count);
+  }
 
   fprintf(out, "V_SF unit issue count: %llu\n", m_v_sf_unit_issue_count);
   fprintf(out, "V_ADDR unit issue count: %llu\n", m_v_addr_unit_issue_count);
@@ -277,6 +179,7 @@ void NdpStats::print_stats(FILE *out, const char *ndp_name) const {
     fprintf(out, "\t%s: %llu (%.2f per cycle)\n", MemStatusString[i],
             m_memory_status[i], ((float)m_memory_status[i]) / m_cycle);
   }
+  print_prefetch_stats(out);
   fprintf(out, "Register Status:\n");
   for (int i = 0; i < RegisterStats::REG_STAT_NUM; i++) {
     fprintf(out, "\t%s: %u \n", RegStatusString[i],
@@ -303,38 +206,227 @@ void NdpStats::print_stats(FILE *out, const char *ndp_name) const {
   m_l1d_stats.print_stats(out, "L1-D Cache");
 }
 
-void NdpStats::print_energy_stats(FILE *out) const {
-  fprintf(out, "I_ISSUE_CNT: %llu\n", m_i_unit_issue_count);
-  fprintf(out, "F_ISSUE_CNT: %llu\n", m_f_unit_issue_count);
-  fprintf(out, "SF_ISSUE_CNT: %llu\n", m_sf_unit_issue_count);
-  fprintf(out, "ADDR_ISSUE_CNT: %llu\n", m_addr_unit_issue_count);
-  fprintf(out, "LDST_ISSUE_CNT: %llu\n", m_ldst_unit_issue_count);
-  fprintf(out, "SPAD_ISSUE_CNT: %llu\n", m_spad_unit_issue_count);
-  fprintf(out, "V_ISSUE_CNT: %llu\n", m_v_unit_issue_count);
-  fprintf(out, "V_SF_ISSUE_CNT: %llu\n", m_v_sf_unit_issue_count);
-  fprintf(out, "V_ADDR_ISSUE_CNT: %llu\n", m_v_addr_unit_issue_count);
-  fprintf(out, "V_LDST_ISSUE_CNT: %llu\n", m_v_ldst_unit_issue_count);
-  fprintf(out, "V_SPAD_ISSUE_CNT: %llu\n", m_v_spad_unit_issue_count);
-  fprintf(out, "SPAD_ACCESS_CNT: %llu\n",
-          m_memory_status[SCRATCHPAD_ACCESS_COUNT]);
-  fprintf(out, "XREG_RD: %llu\n",
-          m_register_stats.register_stats[RegisterStats::X_READ]);
-  fprintf(out, "XREG_WR: %llu\n",
-          m_register_stats.register_stats[RegisterStats::X_WRITE]);
-  fprintf(out, "FREG_RD: %llu\n",
-          m_register_stats.register_stats[RegisterStats::F_READ]);
-  fprintf(out, "FREG_WR: %llu\n",
-          m_register_stats.register_stats[RegisterStats::F_WRITE]);
-  fprintf(out, "VREG_RD: %llu\n",
-          m_register_stats.register_stats[RegisterStats::V_READ]);
-  fprintf(out, "VREG_WR: %llu\n",
-          m_register_stats.register_stats[RegisterStats::V_WRITE]);
-  m_itlb_stasts.print_energy_stats(out, "ITLB");
-  m_icache_stats.print_energy_stats(out, "L1I-CACHE");
-  m_dtlb_stats.print_energy_stats(out, "DTLB");
-  m_l1d_stats.print_energy_stats(out, "L1D");
-  m_l0_icache_stats.print_energy_stats(out, "L0I-CACHE");
-} 
+static void print_prefetch_status(FILE *out,
+                                  const std::vector<uint64_t> &status) {
+  if (status[PREFETCH_ISSUED] == 0) return;
+  fprintf(out, "Prefetch Status:\n");
+  for (int i = 0; i < NUM_PREFETCH_STATUS; i++)
+    fprintf(out, "\t%s: %" PRIu64 "\n", PrefetchStatusString[i], status[i]);
+  uint64_t covered = status[PREFETCH_USEFUL] + status[PREFETCH_LATE];
+  fprintf(out, "\tAccuracy: %.4f\n",
+          ((float)covered) / status[PREFETCH_ISSUED]);
+  fprintf(out, "\tCoverage: %.4f\n",
+          ((float)covered) / (covered + status[PREFETCH_DEMAND_MISS]));
+  fprintf(out, "\tTimeliness: %.4f\n",
+          covered ? ((float)status[PREFETCH_USEFUL]) / covered : 0.0);
+}
+
+void NdpStats::print_prefetch_stats(FILE *out) const {
+  print_prefetch_status(out, m_prefetch_status);
+}
+
+void NdpStats::print_prefetch_totals(FILE *out, const std::string &prefix) {
+  std::vector<uint64_t> status(NUM_PREFETCH_STATUS);
+  for (int i = 0; i < NUM_PREFETCH_STATUS; i++)
+    status[i] = StatsRegistry::get()->sum(
+        std::string("prefetch.") + PrefetchStatusString[i], prefix);
+  print_prefetch_status(out, status);
+}
+
+static void print_atomic_status(FILE *out,
+                                const std::vector<uint64_t> &status) {
+  if (status[ATOMIC_ISSUED] == 0) return;
+  fprintf(out, "Atomic Status:\n");
+  for (int i = 0; i < NUM_ATOMIC_STATUS; i++)
+    fprintf(out, "\t%s: %" PRIu64 "\n", AtomicStatusString[i], status[i]);
+  fprintf(out, "\tAVG Queue Cycles: %.2f\n",
+          ((float)status[ATOMIC_QUEUE_CYCLES]) / status[ATOMIC_ISSUED]);
+  fprintf(out, "\tL2 Miss Rate: %.4f\n",
+          ((float)status[ATOMIC_L2_MISS]) / status[ATOMIC_ISSUED]);
+}
+
+void NdpStats::print_atomic_totals(FILE *out, const std::string &prefix) {
+  std::vector<uint64_t> status(NUM_ATOMIC_STATUS);
+  for (int i = 0; i < NUM_ATOMIC_STATUS; i++)
+    status[i] = StatsRegistry::get()->sum(
+        std::string("atomic.") + AtomicStatusString[i], prefix);
+  print_atomic_status(out, status);
+}
 
+// Same lines as CacheStats::print_energy_stats, summed over the caches
+// registered as <prefix>*.<cache>
+static void print_cache_energy_totals(FILE *out, const std::string &prefix,
+                                      const std::string &cache,
+                                      const char *cache_name) {
+  StatsRegistry *registry = StatsRegistry::get();
+  fprintf(out, "%s_RH: %" PRIu64 "\n", cache_name,
+          registry->sum(cache + ".read_hit", prefix));
+  fprintf(out, "%s_RM: %" PRIu64 "\n", cache_name,
+          registry->sum(cache + ".read_miss", prefix));
+  fprintf(out, "%s_WH: %" PRIu64 "\n", cache_name,
+          registry->sum(cache + ".write_hit", prefix));
+  fprintf(out, "%s_WM: %" PRIu64 "\n", cache_name,
+          registry->sum(cache + ".write_miss", prefix));
+}
+
+void NdpStats::print_energy_totals(FILE *out, const std::string &prefix) {
+  static const std::pair<const char *, const char *> counters[] = {
+      {"I_ISSUE_CNT", "i_unit_issue_count"},
+      {"F_ISSUE_CNT", "f_unit_issue_count"},
+      {"SF_ISSUE_CNT", "sf_unit_issue_count"},
+      {"ADDR_ISSUE_CNT", "addr_unit_issue_count"},
+      {"LDST_ISSUE_CNT", "ldst_unit_issue_count"},
+      {"SPAD_ISSUE_CNT", "spad_unit_issue_count"},
+      {"V_ISSUE_CNT", "v_unit_issue_count"},
+      {"V_SF_ISSUE_CNT", "v_sf_unit_issue_count"},
+      {"V_ADDR_ISSUE_CNT", "v_addr_unit_issue_count"},
+      {"V_LDST_ISSUE_CNT", "v_ldst_unit_issue_count"},
+      {"V_SPAD_ISSUE_CNT", "v_spad_unit_issue_count"},
+      {"SPAD_ACCESS_CNT", "memory.SCRATCHPAD_ACCESS_COUNT"},
+      {"XREG_RD", "reg.X_READ"},
+      {"XREG_WR", "reg.X_WRITE"},
+      {"FREG_RD", "reg.F_READ"},
+      {"FREG_WR", "reg.F_WRITE"},
+      {"VREG_RD", "reg.V_READ"},
+      {"VREG_WR", "reg.V_WRITE"}};
+  StatsRegistry *registry = StatsRegistry::get();
+  for (const auto &counter : counters)
+    fprintf(out, "%s: %" PRIu64 "\n", counter.first,
+            registry->sum(counter.second, prefix));
+  print_cache_energy_totals(out, prefix, "itlb", "ITLB");
+  print_cache_energy_totals(out, prefix, "l1i", "L1I-CACHE");
+  print_cache_energy_totals(out, prefix, "dtlb", "DTLB");
+  print_cache_energy_totals(out, prefix, "l1d", "L1D");
+  print_cache_energy_totals(out, prefix, "l0i", "L0I-CACHE");
+}
+
+std::vector<std::pair<std::string, uint64_t *>> NdpStats::counters() {
+  std::vector<std::pair<std::string, uint64_t *>> counters = {
+      {"cycle", &m_cycle},
+      {"inst_issue_count", &m_inst_issue_count},
+      {"inst_queue_size", &m_ndp_inst_queue_size},
+      {"issue_success_cycle", &m_issue_success_cycle},
+      {"issue_success_count", &m_issue_success_count},
+      {"i_unit_issue_count", &m_i_unit_issue_count},
+      {"f_unit_issue_count", &m_f_unit_issue_count},
+      {"sf_unit_issue_count", &m_sf_unit_issue_count},
+      {"addr_unit_issue_count", &m_addr_unit_issue_count},
+      {"ldst_unit_issue_count", &m_ldst_unit_issue_count},
+      {"spad_unit_issue_count", &m_spad_unit_issue_count},
+      {"v_unit_issue_count", &m_v_unit_issue_count},
+      {"v_sf_unit_issue_count", &m_v_sf_unit_issue_count},
+      {"v_addr_unit_issue_count", &m_v_addr_unit_issue_count},
+      {"v_ldst_unit_issue_count", &m_v_ldst_unit_issue_count},
+      {"v_spad_unit_issue_count", &m_v_spad_unit_issue_count},
+      {"v_active_lane_issue_count", &m_v_active_lane_issue_count},
+      {"v_total_lane_issue_count", &m_v_total_laine_issue_count},
+      {"indexed_inst_count", &m_indexed_inst_count},
+      {"indexed_element_count", &m_indexed_element_count},
+      {"indexed_request_count", &m_indexed_request_count},
+      {"inst_queue_full_count", &m_inst_queue_full_count},
+      {"register_stall_count", &m_register_stall_count},
+      {"inst_column_q_full_count", &m_inst_column_q_full_count}};
+  // The status vectors are sized once in the constructor
+  for (int i = 0; i < SUCCESS; i++)
+    counters.push_back({std::string("status.") + StatusString[i], &m_status[i]});
+  for (int i = 0; i < NUM_MEM_STATUS; i++)
+    counters.push_back(
+        {std::string("memory.") + MemStatusString[i], &m_memory_status[i]});
+  for (int i = 0; i < NUM_PREFETCH_STATUS; i++)
+    counters.push_back({std::string("prefetch.") + PrefetchStatusString[i],
+                        &m_prefetch_status[i]});
+  return counters;
+}
+
+void NdpStats::register_stats(const std::string &prefix) {
+  StatsRegistry *registry = StatsRegistry::get();
+  for (auto &counter : counters())
+    registry->add(prefix + "." + counter.first, counter.second);
+}
+
+void NdpStats::load_totals(const std::string &prefix) {
+  StatsRegistry *registry = StatsRegistry::get();
+  std::map<std::string, uint64_t> totals;
+  for (auto &total : registry->totals(prefix)) totals.insert(total);
+  for (auto &counter : counters()) *counter.second = totals[counter.first];
+  // Registered per sub-core as sub_core<i>.reg.*
+  for (int i = 0; i < RegisterStats::REG_STAT_NUM; i++)
+    m_register_stats.register_stats[i] =
+        registry->sum(std::string("reg.") + RegStatusString[i], prefix);
+}
+
+void NdpStats::add_unit_details(const NdpStats &unit) {
+  m_itlb_stasts += unit.m_itlb_stasts;
+  m_icache_stats += unit.m_icache_stats;
+  m_dtlb_stats += unit.m_dtlb_stats;
+  m_l1d_stats += unit.m_l1d_stats;
+  m_l0_icache_stats += unit.m_l0_icache_stats;
+  for (const auto &iter : unit.m_wait_insts)
+    m_wait_insts[iter.first] += iter.second;
+  m_max_ndp_inst_queue_size =
+      std::max(m_max_ndp_inst_queue_size, unit.m_max_ndp_inst_queue_size);
+  m_max_reg_wb_per_cyc_per_sub_core = std::max(
+      m_max_reg_wb_per_cyc_per_sub_core, unit.m_max_reg_wb_per_cyc_per_sub_core);
+  m_max_vreg_wb_per_cyc_per_sub_core =
+      std::max(m_max_vreg_wb_per_cyc_per_sub_core,
+               unit.m_max_vreg_wb_per_cyc_per_sub_core);
+  m_max_xreg_wb_per_cyc_per_sub_core =
+      std::max(m_max_xreg_wb_per_cyc_per_sub_core,
+               unit.m_max_xreg_wb_per_cyc_per_sub_core);
+  m_max_freg_wb_per_cyc_per_sub_core =
+      std::max(m_max_freg_wb_per_cyc_per_sub_core,
+               unit.m_max_freg_wb_per_cyc_per_sub_core);
+}
+
+void NdpStats::save(std::ostream &os) {
+  for (auto &counter : counters()) checkpoint_write(os, *counter.second);
+  checkpoint_write(os, m_atomic_status);
+  checkpoint_write(os, (uint64_t)m_wait_insts.size());
+  for (const auto &iter : m_wait_insts) {
+    checkpoint_write(os, iter.first.s_inst);
+    checkpoint_write(os, iter.first.wait_reg_mask);
+    checkpoint_write(os, iter.second);
+  }
+  checkpoint_write(os, m_max_ndp_inst_queue_size);
+  checkpoint_write(os, m_max_reg_wb_per_cyc_per_sub_core);
+  checkpoint_write(os, m_max_vreg_wb_per_cyc_per_sub_core);
+  checkpoint_write(os, m_max_xreg_wb_per_cyc_per_sub_core);
+  checkpoint_write(os, m_max_freg_wb_per_cyc_per_sub_core);
+}
+
+void NdpStats::load(std::istream &is) {
+  for (auto &counter : counters()) checkpoint_read(is, *counter.second);
+  checkpoint_read(is, m_atomic_status);
+  uint64_t num_wait_insts;
+  checkpoint_read(is, num_wait_insts);
+  m_wait_insts.clear();
+  for (uint64_t i = 0; i < num_wait_insts; i++) {
+    WaitInstruction wait_inst("");
+    uint64_t count;
+    checkpoint_read(is, wait_inst.s_inst);
+    checkpoint_read(is, wait_inst.wait_reg_mask);
+    checkpoint_read(is, count);
+    m_wait_insts[wait_inst] = count;
+  }
+  checkpoint_read(is, m_max_ndp_inst_queue_size);
+  checkpoint_read(is, m_max_reg_wb_per_cyc_per_sub_core);
+  checkpoint_read(is, m_max_vreg_wb_per_cyc_per_sub_core);
+  checkpoint_read(is, m_max_xreg_wb_per_cyc_per_sub_core);
+  checkpoint_read(is, m_max_freg_wb_per_cyc_per_sub_core);
+}
+
+void NdpStats::register_prefetch_stats(const std::string &prefix) {
+  StatsRegistry *registry = StatsRegistry::get();
+  for (int i = 0; i < NUM_PREFETCH_STATUS; i++)
+    registry->add(prefix + ".prefetch." + PrefetchStatusString[i],
+                  &m_prefetch_status[i]);
+}
+
+void NdpStats::register_atomic_stats(const std::string &prefix) {
+  StatsRegistry *registry = StatsRegistry::get();
+  for (int i = 0; i < NUM_ATOMIC_STATUS; i++)
+    registry->add(prefix + ".atomic." + AtomicStatusString[i],
+                  &m_atomic_status[i]);
+}
 }  // namespace NDPSim
-#endif
\ No newline at end of file
+#endif
@@ -72,6 +72,33 @@ enum MEM_STATUS {
   NUM_MEM_STATUS
 };
 
+// L1D prefetch outcomes. A prefetched line is USEFUL when a demand access
+// hits it after the fill, LATE when the demand finds it still in flight and
+// USELESS when it leaves the tracking window or cache unused. DEMAND_MISS
+// counts demand misses no prefetch covered.
+enum PREFETCH_STATUS {
+  PREFETCH_ISSUED,
+  PREFETCH_USEFUL,
+  PREFETCH_LATE,
+  PREFETCH_USELESS,
+  PREFETCH_REDUNDANT,
+  PREFETCH_DROPPED,
+  PREFETCH_DEMAND_MISS,
+  NUM_PREFETCH_STATUS
+};
+
+// Near-memory atomic units at the L2 banks. QUEUE_CYCLES sums the cycles
+// issued AMOs waited in the bank queue; ADDR_CONFLICT and UNIT_BUSY count
+// stalled cycles of the queue head.
+enum ATOMIC_STATUS {
+  ATOMIC_ISSUED,
+  ATOMIC_L2_MISS,
+  ATOMIC_ADDR_CONFLICT,
+  ATOMIC_UNIT_BUSY,
+  ATOMIC_QUEUE_CYCLES,
+  NUM_ATOMIC_STATUS
+};
+
 enum WaitRegEnum {
   // D 0 1 2 3 4 M
   DEST,
@@ -151,6 +178,18 @@ static const char *MemStatusString[] = {"TO_MEM_PUSH_MY_CHANNEL",
                                         "SCRATCHPAD_READ",
                                         "SCRATCHPAD_WRITE",
                                         "SCRATCHPAD_ACCESS_COUNT"};
+static const char *PrefetchStatusString[] = {"PREFETCH_ISSUED",
+                                             "PREFETCH_USEFUL",
+                                             "PREFETCH_LATE",
+                                             "PREFETCH_USELESS",
+                                             "PREFETCH_REDUNDANT",
+                                             "PREFETCH_DROPPED",
+                                             "PREFETCH_DEMAND_MISS"};
+static const char *AtomicStatusString[] = {"ATOMIC_ISSUED",
+                                           "ATOMIC_L2_MISS",
+                                           "ATOMIC_ADDR_CONFLICT",
+                                           "ATOMIC_UNIT_BUSY",
+                                           "ATOMIC_QUEUE_CYCLES"};
 static const char *RegStatusString[] = {"X_READ", "F_READ", "V_READ",
                                         "X_WRITE", "F_WRITE", "V_WRITE"};
 
@@ -161,13 +200,19 @@ class NdpStats {
     void set_num_sub_core(int num_sub_core) { m_num_sub_core = num_sub_core; }
     void set_id(int id) { m_id = id; }
     void clear();
-    void inc_cycle();
+    void inc_cycle(uint64_t cycles = 1);
     void inc_ndp_inst_queue_size(int size);
     void inc_issue_success(int issue_count);
     void inc_inst_issue_count(int issue_count) { m_inst_issue_count += issue_count; }
     void add_status_list(std::deque<Status> issue_fail_reasons);
     void add_status(Status issue_fail_reason);
     void add_memory_status(MEM_STATUS mem_status, int access_size = 1);
+    void add_prefetch_status(PREFETCH_STATUS prefetch_status) {
+      m_prefetch_status[prefetch_status]++;
+    }
+    void add_atomic_status(ATOMIC_STATUS atomic_status, uint64_t count = 1) {
+      m_atomic_status[atomic_status] += count;
+    }
     void add_wait_instruction(const WaitInstruction &wait_inst);
     void inc_inst_queue_full();
     void inc_register_stall();
@@ -176,6 +221,12 @@ class NdpStats {
     uint64_t get_memory_access_status(MEM_STATUS mem_status) {
       return m_memory_status[mem_status];
     }
+    uint64_t get_prefetch_status(PREFETCH_STATUS prefetch_status) {
+      return m_prefetch_status[prefetch_status];
+    }
+    uint64_t get_atomic_status(ATOMIC_STATUS atomic_status) {
+      return m_atomic_status[atomic_status];
+    }
     uint64_t get_register_status(RegisterStats::RegStatEnum stat) {
       return m_register_stats.register_stats[stat];
     }
@@ -220,13 +271,32 @@ class NdpStats {
       m_v_active_lane_issue_count += active;
       m_v_total_laine_issue_count += total;
     }
+    void inc_indexed_access_count(uint64_t elements, uint64_t requests) {
+      m_indexed_inst_count++;
+      m_indexed_element_count += elements;
+      m_indexed_request_count += requests;
+    }
   
-    NdpStats operator+(const NdpStats &other);
-    NdpStats &operator+=(const NdpStats &other);
-    void print_stats_interval();
     void print_stats(FILE *out, const char *ndp_name="NdpStats") const;
-    void print_energy_stats(FILE *out) const;
+    void print_prefetch_stats(FILE *out) const;
+    // Totals over every unit registered under prefix, read back from the
+    // stats registry
+    static void print_energy_totals(FILE *out, const std::string &prefix);
+    static void print_prefetch_totals(FILE *out, const std::string &prefix);
+    static void print_atomic_totals(FILE *out, const std::string &prefix);
+    void register_stats(const std::string &prefix);
+    void register_prefetch_stats(const std::string &prefix);
+    void register_atomic_stats(const std::string &prefix);
+    // Sets the registered counters to their sums over the units registered
+    // under prefix; add_unit_details() merges the parts that are not counters
+    void load_totals(const std::string &prefix);
+    void add_unit_details(const NdpStats &unit);
+    void save(std::ostream &os);
+    void load(std::istream &is);
   private:
+    // Registered counters by name relative to the unit prefix
+    std::vector<std::pair<std::string, uint64_t *>> counters();
+
     uint32_t m_id;
     int m_num_sub_core = 4;
     uint64_t m_cycle = 0;
@@ -250,11 +320,16 @@ class NdpStats {
     uint64_t m_v_spad_unit_issue_count = 0;
     uint64_t m_v_active_lane_issue_count = 0;
     uint64_t m_v_total_laine_issue_count = 0;
+    uint64_t m_indexed_inst_count = 0;
+    uint64_t m_indexed_element_count = 0;
+    uint64_t m_indexed_request_count = 0;
     uint64_t m_spad_read_count = 0;
     uint64_t m_spad_write_count = 0;
 
     std::vector<uint64_t> m_status;
     std::vector<uint64_t> m_memory_status;
+    std::vector<uint64_t> m_prefetch_status;
+    std::vector<uint64_t> m_atomic_status;
     std::map<WaitInstruction, uint64_t> m_wait_insts;
     uint64_t m_total_status = 0;
     uint64_t m_total_queue_full_reasons = 0;
@@ -271,10 +346,6 @@ class NdpStats {
 
     RegisterStats m_register_stats;
 
-    uint64_t m_prev_issue_success_count;
-    uint64_t m_prev_cache_access;
-    uint64_t m_prev_cache_fill;
-
     uint64_t m_max_vreg_wb_per_cyc_per_sub_core = 0;
     uint64_t m_max_xreg_wb_per_cyc_per_sub_core = 0;
     uint64_t m_max_freg_wb_per_cyc_per_sub_core = 0;
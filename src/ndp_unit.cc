@@ -6,7 +6,9 @@
 #include <sstream>
 
 #include "ndp_instruction.h"
+#include "checkpoint.h"
 #include "m2ndp_parser.h"
+#include "stats_registry.h"
 namespace NDPSim {
 
 NdpUnit::NdpUnit(M2NDPConfig* config, MemoryMap* memory_map, int id)
@@ -71,6 +73,10 @@ NdpUnit::NdpUnit(M2NDPConfig* config, MemoryMap* memory_map, NdpStats* stats,
     m_itlb->set_ideal_tlb();
   }
   m_uthread_generator = new UThreadGenerator(m_config, m_id, &m_matched_requests);
+  if (m_config->is_sampling_enabled()) {
+    m_fast_forward_map = new TracingMemoryMap(m_memory_map);
+    m_fast_forward_core = new SubCore(m_config, m_fast_forward_map, m_id, 0);
+  }
   m_instruction_buffer =
       new InstructionBuffer(m_config->get_inst_buffer_size(),
                             m_config->get_request_queue_size(), m_id);
@@ -96,19 +102,34 @@ NdpUnit::NdpUnit(M2NDPConfig* config, MemoryMap* memory_map, NdpStats* stats,
   m_last_sub_core_fetched = 0;
   uthread_count.resize(m_sub_core_units.size(), 0);
 }
+
+NdpUnit::~NdpUnit() {
+  if (!m_stats_prefix.empty()) StatsRegistry::get()->remove(m_stats_prefix);
+  delete m_fast_forward_core;
+  delete m_fast_forward_map;
+}
 #endif
 
-void NdpUnit::Run(int id, NdpKernel* ndp_kernel, std::string line) {
+void NdpUnit::Run(int id, const NdpKernel* ndp_kernel, std::string line) {
+  RunKernelBodies(ndp_kernel, line);
+  RunFinalizer();
+}
+
+void NdpUnit::RunKernelBodies(const NdpKernel* ndp_kernel, std::string line,
+                              bool defer_writes) {
   m_ndp_kernel = ndp_kernel;
   //set ndp_kernel to sub_core
   for (int i = 0; i < m_num_sub_core; i++) {
     m_sub_core_units[i]->set_ndp_kernel(ndp_kernel);
+    m_sub_core_units[i]->set_write_log(defer_writes ? &m_write_log : NULL);
   }
   KernelLaunchInfo* kinfo = M2NDPParser::parse_kernel_launch(line, 0);
   kinfo->launch_id = 0;
   assert(kinfo->smem_size <= m_config->get_spad_size() * 1024); // in KB
   MemoryMap* scratchpad_map =
-      new HashMemoryMap(SCRATCHPAD_BASE, kinfo->smem_size);
+      new PagedMemoryMap(SCRATCHPAD_BASE, kinfo->smem_size);
+  m_func_launch_info = kinfo;
+  m_func_scratchpad_map = scratchpad_map;
   bool first = true;
   uint64_t spad_addr = SCRATCHPAD_BASE;
   int num_args = kinfo->arg_size / DOUBLE_SIZE - kinfo->num_float_args;
@@ -168,41 +189,98 @@ void NdpUnit::Run(int id, NdpKernel* ndp_kernel, std::string line) {
         m_sub_core_units[0]->ExecuteKernelBody(scratchpad_map, &info, k_id);
       }
     }
-    if (!first) {
+  } catch (const std::runtime_error& error) {
+    dump_functional_error();
+    throw error;
+  }
+  m_func_req_id = req_id;
+  m_func_body_executed = !first;
+}
+
+void NdpUnit::RunFinalizer() {
+  KernelLaunchInfo* kinfo = m_func_launch_info;
+  // Finalizers run serially, so their writes apply immediately
+  for (int i = 0; i < m_num_sub_core; i++)
+    m_sub_core_units[i]->set_write_log(NULL);
+  try {
+    if (m_func_body_executed) {
       RequestInfo info;
       info.addr = kinfo->base_addr;
       info.offset = m_id;
       info.kernel_id = kinfo->kernel_id;
       info.launch_id = kinfo->launch_id;
-      info.id = req_id++;
-      m_sub_core_units[0]->ExecuteFinalizer(scratchpad_map, &info);
+      info.id = m_func_req_id++;
+      m_sub_core_units[0]->ExecuteFinalizer(m_func_scratchpad_map, &info);
     }
-    delete scratchpad_map;
+    delete m_func_scratchpad_map;
+    m_func_scratchpad_map = NULL;
   } catch (const std::runtime_error& error) {
-    spdlog::error("=============================NDP Unit {} DUMP=============================", m_id);
-    spdlog::error("Scratchpad Memory Dump:");
-    scratchpad_map->DumpMemory();
-    delete scratchpad_map;
-    spdlog::error("Global Memory Dump:");
-    m_memory_map->DumpMemory();
+    dump_functional_error();
     throw error;
   }
 }
 
+void NdpUnit::dump_functional_error() {
+  spdlog::error("=============================NDP Unit {} DUMP=============================", m_id);
+  spdlog::error("Scratchpad Memory Dump:");
+  m_func_scratchpad_map->DumpMemory();
+  delete m_func_scratchpad_map;
+  m_func_scratchpad_map = NULL;
+  spdlog::error("Global Memory Dump:");
+  m_memory_map->DumpMemory();
+}
+
+void NdpUnit::commit_global_writes() {
+#ifdef TIMING_SIMULATION
+  size_t warmed = m_fast_forward_map != NULL
+                      ? m_fast_forward_map->GetAccesses().size()
+                      : 0;
+#endif
+  m_write_log.Apply();
+#ifdef TIMING_SIMULATION
+  // Deferred stores of fast-forwarded uthreads warm the tags once applied
+  if (m_fast_forward_map == NULL) return;
+  const std::vector<TracingMemoryMap::Access>& accesses =
+      m_fast_forward_map->GetAccesses();
+  for (size_t i = warmed; i < accesses.size(); i++) {
+    m_dtlb->warm(accesses[i].addr);
+    m_ldst_unit->warm_l1d(accesses[i].addr, accesses[i].write);
+  }
+#endif
+}
+
 #ifdef TIMING_SIMULATION
+void NdpUnit::set_defer_global_writes(bool defer) {
+  WriteLog* write_log = defer ? &m_write_log : NULL;
+  for (int i = 0; i < m_num_sub_core; i++)
+    m_sub_core_units[i]->set_write_log(write_log);
+  if (m_fast_forward_core != NULL)
+    m_fast_forward_core->set_write_log(write_log);
+}
+
 void NdpUnit::cycle() {
+  if (m_sleeping) {
+    sleep_cycle();
+    return;
+  }
   handle_finished_context();
   rf_writeback();
   from_mem_handle();
   l1_inst_cache_cycle();
   to_l1_inst_cache();
   tlb_cycle();
-  m_ldst_unit->cycle();
+  if (m_ldst_unit->is_idle())
+    m_ldst_unit->idle_cycle();
+  else
+    m_ldst_unit->cycle();
   connect_to_ldst_unit();
   // try {
     bool inst_queue_empty = true;
     for (int i = 0; i < m_num_sub_core; i++) {
-      m_sub_core_units[i]->cycle();
+      if (m_sub_core_units[i]->is_idle())
+        m_sub_core_units[i]->idle_cycle();
+      else
+        m_sub_core_units[i]->cycle();
       inst_queue_empty = inst_queue_empty && m_sub_core_units[i]->is_inst_queue_empty();
     }
     if(inst_queue_empty && m_config->is_coarse_grained()) {
@@ -218,9 +296,76 @@ void NdpUnit::cycle() {
   connect_instruction_buffer_to_sub_core();
   request_instruction_lookup();
   m_uthread_generator->cycle();
+  fast_forward();
   m_instruction_buffer->cycle();
   m_ndp_cycles++;
   m_stats->inc_cycle();
+  m_sleeping = is_idle();
+}
+
+// Ticks of a unit known to be idle: only the cycle counters advance
+void NdpUnit::idle_cycle(uint64_t cycles) {
+  m_ndp_cycles += cycles;
+  m_stats->inc_cycle(cycles);
+}
+
+// Tick of a sleeping unit: the sub-cores and LDST unit record what their own
+// cycle() would have, and the LDST round-robin keeps rotating
+void NdpUnit::sleep_cycle() {
+  for (int i = 0; i < m_num_sub_core; i++) {
+    m_sub_core_units[i]->idle_cycle();
+  }
+  m_ldst_unit->idle_cycle();
+  m_sub_core_rr = (m_sub_core_rr + 1) % m_num_sub_core;
+  idle_cycle();
+}
+
+// Every queue, cache and pipeline of the unit is drained. The unit then
+// sleeps until push_from_mem or a kernel launch wakes it.
+bool NdpUnit::is_idle() {
+  if (is_active() || !m_icache_queue.idle() || !m_icache->is_idle() ||
+      !m_dtlb->is_idle() || !m_itlb->is_idle() ||
+      !m_instruction_buffer->is_idle() || !m_ldst_unit->is_idle())
+    return false;
+  for (int i = 0; i < m_num_sub_core; i++) {
+    if (!m_sub_core_units[i]->is_idle() || !m_to_reg[i].empty() ||
+        !m_to_icache[i].empty() || !m_from_icache[i].empty() ||
+        !m_to_ldst_unit[i].empty() || !m_to_spad_unit[i].empty() ||
+        !m_to_v_ldst_unit[i].empty() || !m_to_v_spad_unit[i].empty())
+      return false;
+  }
+  return true;
+}
+
+// Fast-forwarded uthreads finish in zero simulated cycles; their memory
+// effects go to the same memory map as the timing pipeline's. The packets
+// they touch warm the L1D and TLB tags.
+void NdpUnit::fast_forward() {
+  if (m_fast_forward_core == NULL) return;
+  size_t warmed = m_fast_forward_map->GetAccesses().size();
+  RequestInfo* info;
+  while ((info = m_uthread_generator->pop_fast_forward()) != NULL) {
+    m_fast_forward_core->set_ndp_kernel(m_ndp_kernels[info->kernel_id]);
+    m_fast_forward_core->ExecuteKernelBody(info->scratchpad_map, info,
+                                           info->kernel_body_id);
+    m_uthread_generator->increase_count(info->launch_id);
+    delete info;
+  }
+  const std::vector<TracingMemoryMap::Access>& accesses =
+      m_fast_forward_map->GetAccesses();
+  for (size_t i = warmed; i < accesses.size(); i++) {
+    m_dtlb->warm(accesses[i].addr);
+    m_ldst_unit->warm_l1d(accesses[i].addr, accesses[i].write);
+  }
+}
+
+std::vector<TracingMemoryMap::Access> NdpUnit::pop_fast_forward_accesses() {
+  std::vector<TracingMemoryMap::Access> accesses;
+  if (m_fast_forward_map != NULL) {
+    accesses = m_fast_forward_map->GetAccesses();
+    m_fast_forward_map->ClearAccesses();
+  }
+  return accesses;
 }
 
 void NdpUnit::handle_finished_context() {
@@ -278,7 +423,7 @@ void NdpUnit::from_mem_handle() {
   for (int bank = 0; bank < m_config->get_l2d_num_banks(); bank++) {
     if (!m_from_mem[bank].empty()) {
       mem_fetch* mf = m_from_mem[bank].top();
-      mf->current_state = "from mem handle";
+      mf->current_state = MF_FROM_MEM_HANDLE;
       if (m_dtlb->waiting_for_fill(mf)) {
         if (m_dtlb->fill_port_free()) {
 
@@ -406,7 +551,6 @@ void NdpUnit::connect_to_ldst_unit() {
                                    /*spad_op*/false);
       if (status == ISSUE_SUCCESS) {
         m_to_ldst_unit[sub_core_id].pop();
-        delete inst_context;
       } else {
         issue_fail_reasons.push_back(status);
       }
@@ -418,7 +562,6 @@ void NdpUnit::connect_to_ldst_unit() {
                                    /*spad_op*/true);
       if (status == ISSUE_SUCCESS) {
         m_to_spad_unit[sub_core_id].pop();
-        delete inst_context;
       } else {
         issue_fail_reasons.push_back(status);
       }
@@ -430,7 +573,6 @@ void NdpUnit::connect_to_ldst_unit() {
                                    /*spad_op*/false);
       if (status == ISSUE_SUCCESS) {
         m_to_v_ldst_unit[sub_core_id].pop();
-        delete inst_context;
       } else {
         issue_fail_reasons.push_back(status);
       }
@@ -442,7 +584,6 @@ void NdpUnit::connect_to_ldst_unit() {
                                    /*spad_op*/true);
       if (status == ISSUE_SUCCESS) {
         m_to_v_spad_unit[sub_core_id].pop();
-        delete inst_context;
       } else {
         issue_fail_reasons.push_back(status);
       }
@@ -485,6 +626,7 @@ void NdpUnit::request_instruction_lookup() {
 
 void NdpUnit::push_from_mem(mem_fetch* mf, int bank) {
   m_from_mem[bank].push(mf);
+  m_sleeping = false;
 }
 
 mem_fetch* NdpUnit::top_to_mem(int bank) { return m_to_mem[bank].top(); }
@@ -521,13 +663,15 @@ bool NdpUnit::is_launch_active(int launch_id) {
 
 bool NdpUnit::can_register() { return m_instruction_buffer->can_register(); }
 
-void NdpUnit::register_ndp_kernel(NdpKernel* ndp_kernel) {
+void NdpUnit::register_ndp_kernel(const NdpKernel* ndp_kernel) {
   assert(can_register());
+  m_ndp_kernels[ndp_kernel->kernel_id] = ndp_kernel;
   m_instruction_buffer->register_kernel(ndp_kernel);
   m_uthread_generator->register_kernel(ndp_kernel);
 }
 
 void NdpUnit::launch_ndp_kernel(KernelLaunchInfo info) {
+  m_sleeping = false;
   m_uthread_generator->launch(info);
   m_ldst_unit->set_l1d_size(m_uthread_generator->get_allocated_spad_size());
 }
@@ -550,18 +694,51 @@ NdpStats NdpUnit::get_stats() {
   return *m_stats;
 }
 
+void NdpUnit::save_state(std::ostream& os) {
+  assert(is_idle());
+  m_icache->save_state(os);
+  m_itlb->save_state(os);
+  m_dtlb->save_state(os);
+  m_ldst_unit->save_state(os);
+  for (int i = 0; i < m_num_sub_core; i++) m_sub_core_units[i]->save_state(os);
+  m_stats->save(os);
+  checkpoint_write(os, m_uthread_generator->get_uthread_count());
+}
+
+void NdpUnit::load_state(std::istream& is) {
+  m_icache->load_state(is);
+  m_itlb->load_state(is);
+  m_dtlb->load_state(is);
+  m_ldst_unit->load_state(is);
+  for (int i = 0; i < m_num_sub_core; i++) m_sub_core_units[i]->load_state(is);
+  m_stats->load(is);
+  uint64_t uthread_count;
+  checkpoint_read(is, uthread_count);
+  m_uthread_generator->set_uthread_count(uthread_count);
+}
+
 void NdpUnit::print_ndp_stats() {
-  if (m_id == 0) {
-    for (int i = 0; i < m_num_sub_core; i++) {
-      m_sub_core_units[i]->print_sub_core_stats();
-    }
-  } else {
-    for (int i = 0; i < m_num_sub_core; i++) {
-      m_sub_core_units[i]->print_sub_core_stats();
-    }
+  for (int i = 0; i < m_num_sub_core; i++) {
+    m_sub_core_units[i]->print_sub_core_stats();
   }
 }
 
 void NdpUnit::print_uthread_stats() { m_uthread_generator->print_status(); }
+
+void NdpUnit::register_stats(const std::string& prefix) {
+  StatsRegistry* registry = StatsRegistry::get();
+  m_stats_prefix = prefix;
+  m_stats->register_stats(prefix);
+  UThreadGenerator* generator = m_uthread_generator;
+  registry->add(prefix + ".uthreads",
+                [generator]() { return generator->get_uthread_count(); });
+  m_icache->register_stats(prefix + ".l1i");
+  m_itlb->register_stats(prefix + ".itlb");
+  m_dtlb->register_stats(prefix + ".dtlb");
+  m_ldst_unit->register_stats(prefix + ".l1d");
+  for (int i = 0; i < m_num_sub_core; i++)
+    m_sub_core_units[i]->register_stats(prefix + ".sub_core" +
+                                        std::to_string(i));
+}
 #endif
 }  // namespace NDPSim
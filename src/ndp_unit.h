@@ -23,11 +23,24 @@ class NdpUnit {
  public:
   NdpUnit() {}
   NdpUnit(M2NDPConfig* config, MemoryMap* memory_map, int id);
-  void Run(int id, NdpKernel* ndp_kernel, std::string line);
+  void Run(int id, const NdpKernel* ndp_kernel, std::string line);
+  // Run() split in two phases so that the functional runner can execute the
+  // kernel bodies of all units concurrently and the finalizers in unit order.
+  // With defer_writes, global stores and AMOs of the bodies wait for
+  // commit_global_writes().
+  void RunKernelBodies(const NdpKernel* ndp_kernel, std::string line,
+                       bool defer_writes = false);
+  void RunFinalizer();
+  // Applies the deferred global stores and AMOs in the order they executed
+  void commit_global_writes();
 
 #ifdef TIMING_SIMULATION
   NdpUnit(M2NDPConfig* config, MemoryMap* memory_map, NdpStats* stats, int id);
+  ~NdpUnit();
   void cycle();
+  void idle_cycle(uint64_t cycles = 1);
+  // While set, global stores and AMOs wait for commit_global_writes()
+  void set_defer_global_writes(bool defer);
   void push_from_mem(mem_fetch* req, int bank);
   mem_fetch* top_to_mem(int bank);
   bool to_mem_empty(int bank);
@@ -35,15 +48,29 @@ class NdpUnit {
   bool from_mem_full(int bank);
 
   bool is_active();
+  bool is_idle();
   bool can_register();
   bool is_launch_active(int launch_id);
-  void register_ndp_kernel(NdpKernel* ndp_kernel);
+  void register_ndp_kernel(const NdpKernel* ndp_kernel);
   void launch_ndp_kernel(KernelLaunchInfo info);
   NdpStats get_stats();
+  // Warm cache and TLB state; the unit must be idle
+  void save_state(std::ostream& os);
+  void load_state(std::istream& is);
   void print_ndp_stats();
   void print_uthread_stats();
+  void register_stats(const std::string& prefix);
+  const std::map<int, LaunchSample>& get_launch_samples() {
+    return m_uthread_generator->get_launch_samples();
+  }
+  // Packets the fast-forwarded uthreads touched since the last call; the L1D
+  // and TLB are already warmed with them, the shared L2 slices are not
+  std::vector<TracingMemoryMap::Access> pop_fast_forward_accesses();
 
-  bool generate_uthreads() { return m_uthread_generator->generate_uthreads(1); }
+  bool generate_uthreads() {
+    m_sleeping = false;
+    return m_uthread_generator->generate_uthreads(1);
+  }
 #endif
 
  private:
@@ -55,14 +82,21 @@ class NdpUnit {
   int m_num_xreg;
   int m_num_freg;
   int m_num_vreg;
-  NdpKernel* m_ndp_kernel;
+  const NdpKernel* m_ndp_kernel;
   MemoryMap* m_memory_map;
   std::vector<SubCore*> m_sub_core_units;
 #ifdef TIMING_SIMULATION
   UThreadGenerator* m_uthread_generator;
+  // Sampling only: runs fast-forwarded uthreads functionally, with its own
+  // register file so the timing sub-cores' renaming state is untouched, and
+  // records what they touch for cache warming
+  SubCore* m_fast_forward_core = NULL;
+  TracingMemoryMap* m_fast_forward_map = NULL;
+  std::map<int, const NdpKernel*> m_ndp_kernels;
   InstructionBuffer* m_instruction_buffer;
   LDSTUnit* m_ldst_unit;
   int m_sub_core_rr = 0; // Sub-core round-robin
+  bool m_sleeping = false; // set by cycle() once is_idle(), cleared on wake-up
   Tlb* m_dtlb;
   Tlb* m_itlb;
   CacheConfig m_icache_config;
@@ -89,11 +123,23 @@ class NdpUnit {
   std::queue<Context> m_finished_contexts;
   std::vector<int> uthread_count;
   NdpStats* m_stats;
+  // Registry prefix of this unit's counters, dropped on destruction
+  std::string m_stats_prefix;
 #endif
   // Stat Counters
   uint64_t m_ndp_cycles = 0;
 
+  // Functional launch state kept between RunKernelBodies and RunFinalizer
+  KernelLaunchInfo* m_func_launch_info = NULL;
+  MemoryMap* m_func_scratchpad_map = NULL;
+  int m_func_req_id = 0;
+  bool m_func_body_executed = false;
+  WriteLog m_write_log;
+  void dump_functional_error();
+
 #ifdef TIMING_SIMULATION
+  void sleep_cycle();
+  void fast_forward();
   void handle_finished_context();
   void rf_writeback();
   void from_mem_handle();
@@ -0,0 +1,66 @@
+#include "ndp_worker_pool.h"
+
+#include <cassert>
+namespace NDPSim {
+
+NdpWorkerPool::NdpWorkerPool(int num_threads) : m_num_threads(num_threads) {
+  assert(m_num_threads >= 1);
+  for (int i = 1; i < m_num_threads; i++) {
+    m_workers.emplace_back(&NdpWorkerPool::worker_loop, this, i);
+  }
+}
+
+NdpWorkerPool::~NdpWorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_exit = true;
+  }
+  m_start_cv.notify_all();
+  for (auto &worker : m_workers) worker.join();
+}
+
+void NdpWorkerPool::run(int num_tasks, const std::function<void(int)>& task) {
+  if (m_num_threads == 1 || num_tasks <= 1) {
+    for (int i = 0; i < num_tasks; i++) task(i);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_task = &task;
+    m_num_tasks = num_tasks;
+    m_pending = m_num_threads - 1;
+    m_generation++;
+  }
+  m_start_cv.notify_all();
+  run_partition(0);
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_done_cv.wait(lock, [this] { return m_pending == 0; });
+  m_task = NULL;
+}
+
+void NdpWorkerPool::worker_loop(int worker_id) {
+  unsigned long long seen_generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_start_cv.wait(lock, [&] {
+        return m_exit || m_generation != seen_generation;
+      });
+      if (m_exit) return;
+      seen_generation = m_generation;
+    }
+    run_partition(worker_id);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_pending--;
+    }
+    m_done_cv.notify_one();
+  }
+}
+
+void NdpWorkerPool::run_partition(int worker_id) {
+  for (int i = worker_id; i < m_num_tasks; i += m_num_threads) {
+    (*m_task)(i);
+  }
+}
+}  // namespace NDPSim
@@ -0,0 +1,39 @@
+#ifndef NDP_WORKER_POOL_H
+#define NDP_WORKER_POOL_H
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace NDPSim {
+
+// Fixed pool of worker threads used to run independent NDP units together.
+// run() hands out task indices with a static round-robin partition (task i is
+// always executed by worker i % num_threads) and returns only after every task
+// finished, so each call acts as a per-cycle barrier. The calling thread
+// participates as worker 0.
+class NdpWorkerPool {
+ public:
+  NdpWorkerPool(int num_threads);
+  ~NdpWorkerPool();
+  void run(int num_tasks, const std::function<void(int)>& task);
+  int get_num_threads() { return m_num_threads; }
+
+ private:
+  int m_num_threads;
+  std::vector<std::thread> m_workers;
+  std::mutex m_mutex;
+  std::condition_variable m_start_cv;
+  std::condition_variable m_done_cv;
+  const std::function<void(int)>* m_task = NULL;
+  int m_num_tasks = 0;
+  int m_pending = 0;
+  unsigned long long m_generation = 0;
+  bool m_exit = false;
+
+  void worker_loop(int worker_id);
+  void run_partition(int worker_id);
+};
+}  // namespace NDPSim
+#endif
@@ -0,0 +1,266 @@
+#ifdef TIMING_SIMULATION
+#include "prefetcher.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace NDPSim {
+
+Prefetcher::Prefetcher(PrefetcherType type, int degree, int distance,
+                       int table_size, const Cache *cache,
+                       CacheConfig *cache_config, NdpStats *stats)
+    : m_type(type),
+      m_cache(cache),
+      m_stats(stats),
+      m_degree(degree),
+      m_distance(distance) {
+  if (m_degree < 1 || m_distance < 1 || table_size < 1) {
+    spdlog::error("Invalid prefetcher config: degree {} distance {} table "
+                  "size {}",
+                  m_degree, m_distance, table_size);
+    exit(1);
+  }
+  m_line_size = cache_config->get_line_size();
+  m_atom_size = cache_config->get_atom_size();
+  // A few triggers worth of requests; older ones are stale by then
+  m_max_candidates = 4 * m_degree * (m_line_size / m_atom_size);
+  m_max_tracked = cache_config->get_num_lines();
+  // Never fewer lines than the candidate queue can hold
+  m_max_recent = m_distance * m_max_candidates;
+  if (m_type == STRIDE_PREFETCH)
+    m_stride_table.resize(table_size);
+  else if (m_type == STREAM_PREFETCH)
+    m_stream_table.resize(table_size);
+}
+
+void Prefetcher::set_row_locality(M2NDPConfig *config, int channel,
+                                  uint32_t row_size) {
+  assert(channel >= 0);
+  m_config = config;
+  m_channel = channel;
+  // One aligned block holds a row of every channel when the row and column
+  // bits sit above the channel bits
+  m_row_block_size = (uint64_t)row_size * config->get_num_channels();
+  if (row_size < m_line_size || m_row_block_size % m_line_size != 0) {
+    spdlog::error("Invalid prefetch row size {}", row_size);
+    exit(1);
+  }
+}
+
+void Prefetcher::train_load(uint64_t key, uint64_t addr) {
+  if (m_type == STRIDE_PREFETCH) stride_train(key, get_line(addr));
+}
+
+void Prefetcher::demand_access(uint64_t addr, CacheRequestStatus status) {
+  if (status == RESERVATION_FAIL) return;  // retried next cycle
+  int64_t line = get_line(addr);
+  bool miss = status == MISS || status == SECTOR_MISS;
+  auto it = m_tracked.find(line);
+  if (it != m_tracked.end()) {
+    bool filled = it->second.filled;
+    m_tracked.erase(it);
+    if (status == HIT) {
+      m_stats->add_prefetch_status(PREFETCH_USEFUL);
+    } else if (!filled) {
+      m_stats->add_prefetch_status(PREFETCH_LATE);
+    } else {
+      // Filled, then evicted before the demand arrived
+      m_stats->add_prefetch_status(PREFETCH_USELESS);
+      m_stats->add_prefetch_status(PREFETCH_DEMAND_MISS);
+    }
+    // Covered accesses keep a stream moving; it sees no misses otherwise
+    miss_train(line);
+    return;
+  }
+  if (!miss) return;
+  m_stats->add_prefetch_status(PREFETCH_DEMAND_MISS);
+  miss_train(line);
+}
+
+void Prefetcher::miss_train(int64_t line) {
+  if (m_type == STREAM_PREFETCH)
+    stream_train(line);
+  else if (m_type == ROW_PREFETCH)
+    row_train(line);
+}
+
+void Prefetcher::issued(uint64_t addr, CacheRequestStatus status) {
+  switch (status) {
+    case MISS:
+    case SECTOR_MISS:
+      m_in_flight++;
+      track(get_line(addr));
+      break;
+    case HIT_RESERVED:
+      // Merged into a fetch already in flight; the reply still comes back
+      m_in_flight++;
+      m_stats->add_prefetch_status(PREFETCH_REDUNDANT);
+      break;
+    case HIT:
+      m_stats->add_prefetch_status(PREFETCH_REDUNDANT);
+      break;
+    default:
+      m_stats->add_prefetch_status(PREFETCH_DROPPED);
+      break;
+  }
+}
+
+void Prefetcher::filled(uint64_t addr) {
+  assert(m_in_flight > 0);
+  m_in_flight--;
+  auto it = m_tracked.find(get_line(addr));
+  if (it != m_tracked.end()) it->second.filled = true;
+}
+
+void Prefetcher::stride_train(uint64_t key, int64_t line) {
+  m_access_count++;
+  StrideEntry *entry = NULL;
+  for (auto &candidate : m_stride_table) {
+    if (candidate.valid && candidate.key == key) {
+      entry = &candidate;
+      break;
+    }
+  }
+  if (entry == NULL) {
+    entry = &find_victim(m_stride_table);
+    *entry = StrideEntry();
+    entry->valid = true;
+    entry->key = key;
+    entry->last_line = line;
+    entry->last_use = m_access_count;
+    return;
+  }
+  entry->last_use = m_access_count;
+  int64_t delta = line - entry->last_line;
+  if (delta == 0) return;  // still inside the same line
+  if (delta == entry->stride) {
+    entry->confidence = std::min(entry->confidence + 1, 3);
+  } else {
+    entry->stride = delta;
+    entry->confidence = 0;
+  }
+  entry->last_line = line;
+  if (entry->confidence == 0) return;
+  for (int i = 0; i < m_degree; i++)
+    request_line(line + entry->stride * (m_distance + i));
+}
+
+void Prefetcher::stream_train(int64_t line) {
+  m_access_count++;
+  StreamEntry *stream = NULL;
+  for (auto &candidate : m_stream_table) {
+    if (candidate.valid &&
+        std::abs(line - candidate.last_line) <= m_distance) {
+      stream = &candidate;
+      break;
+    }
+  }
+  if (stream == NULL) {
+    stream = &find_victim(m_stream_table);
+    *stream = StreamEntry();
+    stream->valid = true;
+    stream->last_line = line;
+    stream->head = line;
+    stream->last_use = m_access_count;
+    return;
+  }
+  stream->last_use = m_access_count;
+  int direction = line > stream->last_line   ? 1
+                  : line < stream->last_line ? -1
+                                             : 0;
+  if (direction == 0) return;
+  if (direction != stream->direction) {
+    stream->direction = direction;
+    stream->head = line;
+  }
+  stream->last_line = line;
+  // Stay at most m_distance lines ahead, m_degree new lines per trigger
+  int64_t target = line + direction * m_distance;
+  int64_t next = (stream->head - line) * direction > 0
+                     ? stream->head + direction
+                     : line + direction;
+  for (int i = 0; i < m_degree && (target - next) * direction >= 0; i++) {
+    request_line(next);
+    next += direction;
+  }
+  if ((next - direction - stream->head) * direction > 0)
+    stream->head = next - direction;
+}
+
+void Prefetcher::row_train(int64_t line) {
+  assert(m_config != NULL);
+  uint64_t addr = (line + 1) * m_line_size;
+  uint64_t block_end = (line * m_line_size / m_row_block_size + 1) *
+                       m_row_block_size;
+  uint64_t device = m_config->get_m2ndp_index(line * m_line_size);
+  uint64_t interleave = m_config->get_channel_interleave_size();
+  int requested = 0;
+  int lookahead = 0;
+  // Channels are interleaved in whole chunks, so a chunk of another channel
+  // is skipped at once
+  while (addr < block_end && requested < m_degree && lookahead < m_distance) {
+    if (m_config->get_channel_index(addr) != m_channel ||
+        m_config->get_m2ndp_index(addr) != device) {
+      addr = (addr / interleave + 1) * interleave;
+      continue;
+    }
+    if (request_line(get_line(addr))) requested++;
+    lookahead++;
+    addr += m_line_size;
+  }
+}
+
+// Returns false when the line is already requested or in the cache
+bool Prefetcher::request_line(int64_t line) {
+  if (line < 0 || m_tracked.find(line) != m_tracked.end() ||
+      m_recent.find(line) != m_recent.end())
+    return false;
+  uint64_t base = line * m_line_size;
+  bool requested = false;
+  // Sector caches fetch one atom per request
+  for (uint64_t offset = 0; offset < m_line_size; offset += m_atom_size) {
+    if (m_cache->is_present(base + offset)) continue;
+    if (m_candidates.size() >= m_max_candidates) {
+      m_candidates.pop_front();
+      dropped();
+    }
+    m_candidates.push_back(base + offset);
+    requested = true;
+  }
+  if (!requested) return false;
+  m_recent.insert(line);
+  m_recent_order.push_back(line);
+  if (m_recent_order.size() > m_max_recent) {
+    m_recent.erase(m_recent_order.front());
+    m_recent_order.pop_front();
+  }
+  return true;
+}
+
+void Prefetcher::track(int64_t line) {
+  if (m_tracked.find(line) != m_tracked.end()) return;  // another sector
+  m_stats->add_prefetch_status(PREFETCH_ISSUED);
+  m_tracked[line] = {m_seq, false};
+  m_tracked_order.push_back({line, m_seq++});
+  while (m_tracked_order.size() > m_max_tracked) {
+    std::pair<int64_t, uint64_t> oldest = m_tracked_order.front();
+    m_tracked_order.pop_front();
+    auto it = m_tracked.find(oldest.first);
+    if (it != m_tracked.end() && it->second.seq == oldest.second) {
+      m_tracked.erase(it);
+      m_stats->add_prefetch_status(PREFETCH_USELESS);
+    }
+  }
+}
+
+template <typename T>
+T &Prefetcher::find_victim(std::vector<T> &table) {
+  T *victim = &table[0];
+  for (auto &entry : table) {
+    if (!entry.valid) return entry;
+    if (entry.last_use < victim->last_use) victim = &entry;
+  }
+  return *victim;
+}
+}  // namespace NDPSim
+#endif
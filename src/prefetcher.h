@@ -0,0 +1,120 @@
+#ifdef TIMING_SIMULATION
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+#include <robin_hood.h>
+
+#include <deque>
+#include <vector>
+
+#include "cache.h"
+#include "m2ndp_config.h"
+#include "ndp_stats.h"
+namespace NDPSim {
+
+enum PrefetcherType {
+  NO_PREFETCH,
+  STRIDE_PREFETCH,
+  STREAM_PREFETCH,
+  ROW_PREFETCH
+};
+
+// Proposes cache lines to prefetch and tracks what became of them. The
+// owning unit (LDSTUnit for the L1D, NdpRamulator for the L2 slices) pulls
+// candidates one request at a time and only injects them into its cache
+// when the port, the MSHRs and the path to memory are not needed by demand
+// requests, so the prefetcher never delays a demand access.
+//
+// STRIDE keeps one entry per load instruction of a kernel body (the
+// instruction text stands in for a PC) and prefetches `distance` strides
+// ahead once the same line stride is seen twice in a row. STREAM allocates
+// a stream on a demand miss, fixes its direction on the next miss nearby and
+// then keeps up to `distance` lines ahead of the demand stream. ROW follows
+// a demand miss with the next lines of the same DRAM row in the same memory
+// channel, looking at most `distance` channel lines ahead, so they reach the
+// controller while the row is still open.
+//
+// Lines already in the cache or in flight, and lines proposed in the last
+// few prefetch windows, are not proposed again.
+class Prefetcher {
+ public:
+  Prefetcher(PrefetcherType type, int degree, int distance, int table_size,
+             const Cache *cache, CacheConfig *cache_config, NdpStats *stats);
+  // ROW only: the memory channel this cache serves and the DRAM row size
+  void set_row_locality(M2NDPConfig *config, int channel, uint32_t row_size);
+  // One call per global load instruction, with its lowest address
+  void train_load(uint64_t key, uint64_t addr);
+  // Outcome of a demand read in the L1D
+  void demand_access(uint64_t addr, CacheRequestStatus status);
+
+  bool has_candidate() const { return !m_candidates.empty(); }
+  uint64_t top_candidate() const { return m_candidates.front(); }
+  void pop_candidate() { m_candidates.pop_front(); }
+  // L1D outcome of a candidate request; MISS and HIT_RESERVED leave it in
+  // the MSHRs until filled() sees the reply
+  void issued(uint64_t addr, CacheRequestStatus status);
+  // Candidate discarded without reaching the L1D
+  void dropped() { m_stats->add_prefetch_status(PREFETCH_DROPPED); }
+  void filled(uint64_t addr);
+  bool is_idle() const { return m_candidates.empty() && m_in_flight == 0; }
+
+ private:
+  struct StrideEntry {
+    bool valid = false;
+    uint64_t key;
+    int64_t last_line;
+    int64_t stride = 0;
+    int confidence = 0;
+    uint64_t last_use = 0;
+  };
+  struct StreamEntry {
+    bool valid = false;
+    int64_t last_line;
+    int64_t head;  // furthest line requested so far
+    int direction = 0;
+    uint64_t last_use = 0;
+  };
+  struct TrackedLine {
+    uint64_t seq;
+    bool filled;
+  };
+
+  int64_t get_line(uint64_t addr) const { return addr / m_line_size; }
+  void stride_train(uint64_t key, int64_t line);
+  void stream_train(int64_t line);
+  void row_train(int64_t line);
+  void miss_train(int64_t line);
+  bool request_line(int64_t line);
+  void track(int64_t line);
+  template <typename T>
+  T &find_victim(std::vector<T> &table);
+
+  PrefetcherType m_type;
+  const Cache *m_cache;
+  M2NDPConfig *m_config = NULL;
+  uint64_t m_channel = 0;  // same type as get_channel_index()
+  uint64_t m_row_block_size = 0;
+  NdpStats *m_stats;
+  uint32_t m_line_size;
+  uint32_t m_atom_size;
+  int m_degree;
+  int m_distance;
+  uint32_t m_max_candidates;
+  uint32_t m_max_tracked;
+  uint32_t m_max_recent;
+  uint64_t m_access_count = 0;
+  uint64_t m_seq = 0;
+  uint32_t m_in_flight = 0;
+
+  std::vector<StrideEntry> m_stride_table;
+  std::vector<StreamEntry> m_stream_table;
+  std::deque<uint64_t> m_candidates;
+  // Lines proposed lately, oldest first; covers every queued candidate
+  robin_hood::unordered_set<int64_t> m_recent;
+  std::deque<int64_t> m_recent_order;
+  // Prefetched lines not yet touched by a demand access, oldest first
+  robin_hood::unordered_map<int64_t, TrackedLine> m_tracked;
+  std::deque<std::pair<int64_t, uint64_t>> m_tracked_order;
+};
+}  // namespace NDPSim
+#endif
+#endif
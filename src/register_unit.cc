@@ -1,10 +1,29 @@
 #include "register_unit.h"
 
+#include <algorithm>
+#include <map>
 #include <set>
 
 #include "ndp_instruction.h"
+#ifdef TIMING_SIMULATION
+#include "ndp_stats.h"
+#include "stats_registry.h"
+#endif
 namespace NDPSim {
 
+void RenameSlot::clear() {
+  std::fill(std::begin(xreg), std::end(xreg), -1);
+  std::fill(std::begin(freg), std::end(freg), -1);
+  std::fill(std::begin(vreg), std::end(vreg), -1);
+}
+
+// Index of an architectural register in a RenameSlot table, -1 if reg is not
+// an architectural register of the class starting at base
+static inline int ArchIndex(int reg, int base) {
+  int index = reg - base;
+  return (index >= 0 && index < NUM_ARCH_REGS) ? index : -1;
+}
+
 RegisterUnit::RegisterUnit(int num_xreg, int num_freg, int num_vreg) {
   m_num_xregs = num_xreg;
   m_num_fregs = num_freg;
@@ -23,6 +42,16 @@ RegisterUnit::RegisterUnit(int num_xreg, int num_freg, int num_vreg) {
   m_xreg_table.resize(m_num_xregs);
   m_freg_table.resize(m_num_fregs);
   m_vreg_table.resize(m_num_vregs);
+  m_double_vreg.assign(m_num_vregs, -1);
+  m_vreg_allocated.assign(m_num_vregs, false);
+  m_not_ready.assign(m_num_xregs + m_num_fregs + m_num_vregs, false);
+  // Every uthread holds at least x1 and x2, which bounds the live slots
+  int num_slots = std::max(1, m_num_xregs / 2);
+  m_rename_slots.resize(num_slots);
+  for (int slot = num_slots - 1; slot >= 0; slot--) {
+    m_rename_slots[slot].clear();
+    m_free_slots.push_back(slot);
+  }
 }
 
 bool RegisterUnit::RenameFull(InstColumn* inst_column) {
@@ -33,7 +62,11 @@ bool RegisterUnit::RenameFull(InstColumn* inst_column) {
 
 void RegisterUnit::RenamePush(InstColumn* inst_column, int packet_id) {
   assert(!RenameFull(inst_column));
-  inst_column->insts = Convert(inst_column->insts, packet_id, inst_column->req);
+  // Bind every register the stream uses now; the shared instructions are
+  // renamed one at a time at fetch (RenameFetched)
+  inst_column->rename_slot = BindSlot(packet_id, inst_column->req);
+  RenameStream(m_rename_slots[inst_column->rename_slot], *inst_column->insts,
+               NULL);
   m_after_rename.push_back(inst_column);
 }
 
@@ -43,281 +76,85 @@ InstColumn* RegisterUnit::RenameTop() { return m_after_rename.front(); }
 
 void RegisterUnit::RenamePop() { m_after_rename.pop_front(); }
 
+int RegisterUnit::ScoreboardIndex(int reg) {
+  if (reg >= REG_PX_BASE && reg < REG_PX_BASE + m_num_xregs)
+    return reg - REG_PX_BASE;
+  if (reg >= REG_PF_BASE && reg < REG_PF_BASE + m_num_fregs)
+    return m_num_xregs + reg - REG_PF_BASE;
+  if (reg >= REG_PV_BASE && reg < REG_PV_BASE + m_num_vregs)
+    return m_num_xregs + m_num_fregs + reg - REG_PV_BASE;
+  return -1;
+}
+
 bool RegisterUnit::CheckReady(int reg) {
-  return m_not_ready.find(reg) == m_not_ready.end();
+  int index = ScoreboardIndex(reg);
+  if (index >= 0) return !m_not_ready[index];
+  return m_not_ready_other.empty() ||
+         m_not_ready_other.find(reg) == m_not_ready_other.end();
+}
+
+void RegisterUnit::SetNotReady(int reg) {
+  int index = ScoreboardIndex(reg);
+  if (index >= 0)
+    m_not_ready[index] = true;
+  else
+    m_not_ready_other.insert(reg);
 }
 
-void RegisterUnit::SetNotReady(int reg) { m_not_ready.insert(reg); }
+void RegisterUnit::SetReady(int reg) {
+  int index = ScoreboardIndex(reg);
+  if (index >= 0)
+    m_not_ready[index] = false;
+  else
+    m_not_ready_other.erase(reg);
+}
+
+RenameSlot& RegisterUnit::AcquireSlot(int packet_id) {
+  auto it = m_packet_slot.find(packet_id);
+  if (it != m_packet_slot.end()) return m_rename_slots[it->second];
+  if (m_free_slots.empty()) {
+    m_free_slots.push_back(m_rename_slots.size());
+    m_rename_slots.emplace_back();
+    m_rename_slots.back().clear();
+  }
+  int slot = m_free_slots.back();
+  m_free_slots.pop_back();
+  m_packet_slot[packet_id] = slot;
+  m_rename_slots[slot].packet_id = packet_id;
+  return m_rename_slots[slot];
+}
+
+int RegisterUnit::PopFreeVreg() {
+  int reg = m_free_vregs.front();
+  m_free_vregs.pop_front();
+  m_vreg_allocated[reg - REG_PV_BASE] = true;
+  return reg;
+}
 
-void RegisterUnit::SetReady(int reg) { m_not_ready.erase(reg); }
+int RegisterUnit::BindSlot(int packet_id, RequestInfo* req) {
+  RenameSlot& slot = AcquireSlot(packet_id);
 
-std::deque<NdpInstruction> RegisterUnit::Convert(
-    std::deque<NdpInstruction> insts, int packet_id, RequestInfo* req) {
-  std::deque<NdpInstruction> renamed_insts;
-  RegisterMapKey key = packet_id;
-  
   //Initialize x1, and x2 
-  int x1_reg = REG_X_BASE + 1; // ADDR 
-  int x2_reg = REG_X_BASE + 2; // OFFSET
   int px1 = m_free_xregs.front();
   m_free_xregs.pop_front();
-  m_xreg_mapping[key][x1_reg] = px1;
+  slot.xreg[1] = px1; // ADDR
   int px2 = m_free_xregs.front();
   m_free_xregs.pop_front();
-  m_xreg_mapping[key][x2_reg] = px2;
+  slot.xreg[2] = px2; // OFFSET
   m_xreg_table[px1 - REG_PX_BASE] = req->addr;
   m_xreg_table[px2 - REG_PX_BASE] = req->offset;
 
   cvt_vlmul_status = IMM_M1;
+  return m_packet_slot[packet_id];
+}
 
+void RegisterUnit::RenameStream(RenameSlot& slot,
+                                const std::deque<NdpInstruction>& insts,
+                                std::deque<NdpInstruction>* renamed_insts) {
   for (int i = 0; i < insts.size(); i++) {
     NdpInstruction inst = insts[i];
-    NdpInstruction renamed = inst;
     try {
-      if (inst.opcode == VSETVLI) cvt_vlmul_status = inst.src[2];
-      if (inst.CheckBranchOp()) {
-        if (inst.opcode == Opcode::J) {
-          renamed.src[2] = inst.src[2];
-        } else {
-          renamed.src[0] = LookUpX(key, inst.src[0]);
-          renamed.src[2] = inst.src[2];
-          if (inst.opcode == Opcode::BEQ || inst.opcode == Opcode::BGT ||
-              inst.opcode == Opcode::BLT || inst.opcode == Opcode::BNE ||
-              inst.opcode == Opcode::BLE || inst.opcode == Opcode::BGE) {
-            renamed.src[1] = LookUpX(key, inst.src[1]);
-          }
-        }
-      } else if (inst.CheckSegOp()) {
-        switch (inst.operand_type) {
-          case OperandType::V:
-            renamed.src[0] = LookUpX(key, inst.src[0]);
-            renamed.src[1] = LookUpV(key, inst.src[1]);
-            renamed.dest = DestRenameV(key, renamed);
-            for (int i = 0; i < inst.segCnt; i++)
-              renamed.segDest[i] = DestRenameSegV(key, renamed, i);
-            renamed.segCnt = inst.segCnt;
-            break;
-          default:
-            break;
-        }
-      } else if (inst.CheckVectorOp()) {
-        /*Register Renaming for Vector Opcodes*/
-        switch (inst.operand_type) {
-          case OperandType::M:
-            if (inst.opcode == VMSET)
-              renamed.dest = DestRenameV(key, inst);
-            else if (inst.opcode == VFIRST) {
-              renamed.dest = DestRenameX(key, inst);
-              renamed.src[0] = LookUpV(key, inst.src[0]);
-            }
-            break;
-          case OperandType::X_S:
-            renamed.dest = DestRenameX(key, inst);
-            renamed.src[0] = LookUpV(key, inst.src[0]);
-            break;
-          case OperandType::V:
-            if (inst.opcode == VFSQRT) {
-              renamed.dest = DestRenameV(key, inst);
-              renamed.src[0] = LookUpV(key, inst.src[0]);
-              renamed.src[1] = LookUpV(key, inst.src[1]);
-              break;
-            }
-            if (inst.opcode == VID || inst.opcode == VFEXP) {
-              renamed.src[0] = LookUpV(key, inst.src[0]);
-              renamed.dest = DestRenameV(key, inst);
-              break;
-            }
-            renamed.src[0] = LookUpX(key, inst.src[0]);
-            if (inst.opcode == Opcode::VSE8 || inst.opcode == Opcode::VSE16 ||
-                inst.opcode == Opcode::VSE32 || inst.opcode == Opcode::VSE64) {
-              renamed.dest = LookUpV(key, inst.dest);
-            } else if (inst.opcode == Opcode::VLE8 ||
-                      inst.opcode == Opcode::VLE16 ||
-                      inst.opcode == Opcode::VLE32 ||
-                      inst.opcode == Opcode::VLE64) {
-              renamed.dest = DestRenameV(key, inst);
-            } else if (inst.opcode == Opcode::VLUXEI32 ||
-                      inst.opcode == Opcode::VLUXEI64) {
-              renamed.dest = DestRenameV(key, inst);
-              renamed.src[2] = LookUpV(key, inst.src[2]);
-              if (inst.src[3] != -1) renamed.src[3] = LookUpV(key, inst.src[3]);
-            } else if (inst.opcode == Opcode::VSUXEI32 ||
-                      inst.opcode == Opcode::VSUXEI64) {
-              renamed.src[0] = LookUpX(key, inst.src[0]);
-              renamed.dest = LookUpV(key, inst.dest);
-              renamed.src[2] = LookUpV(key, inst.src[2]);
-              renamed.src[3] = LookUpV(key, inst.src[3]);
-              // assert(0);
-            } else if (inst.CheckAmoOp()) {
-              if (inst.dest >= REG_V_BASE && inst.dest < REG_PX_BASE)
-                renamed.dest = LookUpV(key, inst.dest);
-              else
-                renamed.dest = -1;
-              renamed.src[0] = LookUpX(key, inst.src[0]);
-              renamed.src[1] = LookUpV(key, inst.src[1]);
-              renamed.src[2] = LookUpV(key, inst.src[2]);
-              if (inst.src[3] != -1) renamed.src[3] = LookUpV(key, inst.src[3]);
-            } else {  // VAMO instructions can have x0 or vd destination register.
-                      // Be Careful!
-              renamed.src[1] = LookUpV(key, inst.src[1]);
-              renamed.src[2] = LookUpV(key, inst.src[2]);
-            }
-            // Todo: load store by stride or index
-            break;
-          case OperandType::WV:
-          case OperandType::VV:
-          case OperandType::VS:
-          case OperandType::VM:
-          case OperandType::MM:
-            renamed.src[0] = LookUpV(key, inst.src[0]);
-            renamed.src[1] = LookUpV(key, inst.src[1]);
-            if (CheckExistVreg(key, inst.src[2]))
-              renamed.src[2] = LookUpV(key, inst.src[2]);
-            renamed.dest = DestRenameV(key, inst);
-            break;
-          case OperandType::VI:
-          case OperandType::V_V:
-          case OperandType::XU_F_V:
-          case OperandType::X_F_V:
-          case OperandType::F_XU_V:
-          case OperandType::F_X_V:
-          case OperandType::F_F_V:
-          case OperandType::F_F_W:
-            renamed.src[0] = LookUpV(key, inst.src[0]);
-            renamed.dest = DestRenameV(key, renamed);
-            break;
-          case OperandType::V_I:
-            if (inst.src[1] != -1) renamed.src[1] = LookUpV(key, inst.src[1]);
-            renamed.dest = DestRenameV(key, renamed);
-            break;
-          case OperandType::V_X:
-          case OperandType::S_X:
-            renamed.src[0] = LookUpX(key, inst.src[0]);
-            if (inst.src[1] != -1) renamed.src[1] = LookUpV(key, inst.src[1]);
-            renamed.dest = DestRenameV(key, renamed);
-            break;
-          case OperandType::VX:
-          case OperandType::WX:
-            renamed.src[0] = LookUpV(key, inst.src[0]);
-            renamed.src[1] = LookUpX(key, inst.src[1]);
-            renamed.dest = DestRenameV(key, renamed);
-            break;
-        case OperandType::VF:
-          if (inst.opcode == VFMSUB) {
-          renamed.src[0] = LookUpF(key, inst.src[0]);
-          renamed.src[1] = LookUpV(key, inst.src[1]);
-          } else {
-            renamed.src[0] = LookUpV(key, inst.src[0]);
-            renamed.src[1] = LookUpF(key, inst.src[1]);
-          }
-          renamed.dest = DestRenameV(key, renamed);
-          break;
-          case OperandType::S_F:
-          case OperandType::V_F:
-            renamed.src[0] = LookUpF(key, inst.src[0]);
-            renamed.dest = DestRenameV(key, renamed);
-            break;
-          case OperandType::F_S:
-            renamed.src[0] = LookUpV(key, inst.src[0]);
-            renamed.dest = DestRenameF(key, renamed);
-            break;
-          default:
-            // vsetvli ..
-            break;
-        }
-      } else if (inst.CheckScalarOp()) {
-        /*Register Renaming for Scalar Opcodes*/
-        switch (inst.opcode) {
-          case Opcode::ADD:
-          case Opcode::SUB:
-          case Opcode::MUL:
-          case Opcode::DIV:
-          case Opcode::REM:
-          case Opcode::AND:
-          case Opcode::SLL:
-          case Opcode::SRL:
-          case Opcode::OR:
-            renamed.src[0] = LookUpX(key, inst.src[0]);
-            renamed.src[1] = LookUpX(key, inst.src[1]);
-            renamed.dest = DestRenameX(key, inst);
-            break;
-          case Opcode::ADDI:
-          case Opcode::MULI:
-          case Opcode::ANDI:
-          case Opcode::SLLI:
-          case Opcode::SRLI:
-          case Opcode::ORI:
-            renamed.src[0] = LookUpX(key, inst.src[0]);
-            renamed.dest = DestRenameX(key, inst);
-            break;
-          case Opcode::LI:
-            renamed.dest = DestRenameX(key, inst);
-            break;
-          case Opcode::LBU:
-          case Opcode::LB:
-          case Opcode::LW:
-          case Opcode::LD:
-            renamed.src[0] = LookUpX(key, inst.src[0]);
-            renamed.src[1] = inst.src[1];
-            renamed.dest = DestRenameX(key, inst);
-            break;
-          case Opcode::SB:
-          case Opcode::SW:
-          case Opcode::SD:
-            renamed.src[0] = LookUpX(key, inst.src[0]);
-            renamed.src[1] = inst.src[1];
-            renamed.dest = LookUpX(key, inst.dest);
-            break;
-          case Opcode::AMOADD:
-          case Opcode::AMOMAX:
-            renamed.dest = DestRenameX(key, inst);
-            renamed.src[1] = LookUpX(key, inst.src[1]);
-            renamed.src[2] = LookUpX(key, inst.src[2]);
-            break;
-          case Opcode::FAMOADD:
-          case Opcode::FAMOADDH:
-          case Opcode::FAMOMAX:
-            renamed.dest = DestRenameF(key, inst);
-            renamed.src[1] = LookUpF(key, inst.src[1]);
-            renamed.src[2] = LookUpX(key, inst.src[2]);
-            break;
-          case Opcode::CSRW:
-            renamed.src[0] = LookUpX(key, inst.src[0]);
-            break;
-          case Opcode::FADD:
-          case Opcode::FSUB:
-          case Opcode::FDIV:
-          case Opcode::FMUL:
-            renamed.src[0] = LookUpF(key, inst.src[0]);
-            renamed.src[1] = LookUpF(key, inst.src[1]);
-            renamed.dest = DestRenameF(key, inst);
-            break;
-          case Opcode::FLW:
-            renamed.src[0] = LookUpX(key, inst.src[0]);
-            renamed.src[1] = inst.src[1];
-            renamed.dest = DestRenameF(key, inst);
-            break;
-          case Opcode::FSW:
-            renamed.src[0] = LookUpX(key, inst.src[0]);
-            renamed.dest = LookUpF(key, inst.dest);
-            break;
-          case Opcode::FMV:
-            if (inst.operand_type == X_W) {
-              renamed.src[0] = LookUpF(key, inst.src[0]);
-              renamed.dest = DestRenameX(key, inst);
-            } else if (inst.operand_type == W_X) {
-              renamed.src[0] = LookUpX(key, inst.src[0]);
-              renamed.dest = DestRenameF(key, inst);
-            }
-            break;
-          case Opcode::FEXP:
-            renamed.src[0] = LookUpF(key, inst.src[0]);
-            renamed.dest = DestRenameF(key, inst);
-            break;
-          case Opcode::EXIT:
-            break;
-        }
-      }
+      RenameInst(slot, inst);
     }
     catch (const std::runtime_error& error) {
       spdlog::error("=============================REGISTER UNIT PANIC=============================");
@@ -327,126 +164,376 @@ std::deque<NdpInstruction> RegisterUnit::Convert(
       spdlog::error("Caught: {}\n", error.what());
       throw error;
     }
-    renamed_insts.push_back(renamed);
+    if (renamed_insts != NULL) (*renamed_insts)[i] = inst;
   }
-  return renamed_insts;
 }
 
-void RegisterUnit::FreeRegs(int packet_id) {
-  RegisterMapKey key = packet_id;
-  RegisterBinding mapping_to_free = m_xreg_mapping[key];
-  for (auto it : mapping_to_free) {
-    int reg = it.second;
-    m_free_xregs.push_back(reg);
-  }
-  m_xreg_mapping.erase(key);
-  mapping_to_free = m_freg_mapping[key];
-  for (auto it : mapping_to_free) {
-    int reg = it.second;
-    m_free_fregs.push_back(reg);
+void RegisterUnit::Convert(std::deque<NdpInstruction>& insts, int packet_id,
+                           RequestInfo* req) {
+  int slot = BindSlot(packet_id, req);
+  RenameStream(m_rename_slots[slot], insts, &insts);
+}
+
+void RegisterUnit::RenameFetched(InstColumn* inst_column,
+                                 NdpInstruction& inst) {
+  assert(inst_column->rename_slot != -1);
+  RenameInst(m_rename_slots[inst_column->rename_slot], inst);
+}
+
+void RegisterUnit::RenameInst(RenameSlot& slot, NdpInstruction& inst) {
+  // Operands are renamed in place, each one read before it is overwritten.
+  // Some destinations are sized from the architectural src[0] (never a
+  // register pair) and others from the renamed one, hence arch_src0.
+  const int arch_src0 = inst.src[0];
+  if (inst.opcode == VSETVLI) cvt_vlmul_status = inst.src[2];
+  if (inst.CheckBranchOp()) {
+    if (inst.opcode != Opcode::J) {
+      inst.src[0] = LookUpX(slot, inst.src[0]);
+      if (inst.opcode == Opcode::BEQ || inst.opcode == Opcode::BGT ||
+          inst.opcode == Opcode::BLT || inst.opcode == Opcode::BNE ||
+          inst.opcode == Opcode::BLE || inst.opcode == Opcode::BGE) {
+        inst.src[1] = LookUpX(slot, inst.src[1]);
+      }
+    }
+  } else if (inst.CheckSegOp()) {
+    switch (inst.operand_type) {
+      case OperandType::V:
+        inst.src[0] = LookUpX(slot, inst.src[0]);
+        inst.src[1] = LookUpV(slot, inst.src[1]);
+        inst.dest = DestRenameV(slot, inst, inst.src[0]);
+        for (int i = 0; i < inst.segCnt; i++)
+          inst.segDest[i] = DestRenameSegV(slot, inst, i);
+        break;
+      default:
+        break;
+    }
+  } else if (inst.CheckVectorOp()) {
+    /*Register Renaming for Vector Opcodes*/
+    switch (inst.operand_type) {
+      case OperandType::M:
+        if (inst.opcode == VMSET)
+          inst.dest = DestRenameV(slot, inst, arch_src0);
+        else if (inst.opcode == VFIRST) {
+          inst.dest = DestRenameX(slot, inst);
+          inst.src[0] = LookUpV(slot, inst.src[0]);
+        }
+        break;
+      case OperandType::X_S:
+        inst.dest = DestRenameX(slot, inst);
+        inst.src[0] = LookUpV(slot, inst.src[0]);
+        break;
+      case OperandType::V:
+        if (inst.opcode == VFSQRT) {
+          inst.dest = DestRenameV(slot, inst, arch_src0);
+          inst.src[0] = LookUpV(slot, inst.src[0]);
+          inst.src[1] = LookUpV(slot, inst.src[1]);
+          break;
+        }
+        if (inst.opcode == VID || inst.opcode == VFEXP) {
+          inst.src[0] = LookUpV(slot, inst.src[0]);
+          inst.dest = DestRenameV(slot, inst, arch_src0);
+          break;
+        }
+        inst.src[0] = LookUpX(slot, inst.src[0]);
+        if (inst.opcode == Opcode::VSE8 || inst.opcode == Opcode::VSE16 ||
+            inst.opcode == Opcode::VSE32 || inst.opcode == Opcode::VSE64) {
+          inst.dest = LookUpV(slot, inst.dest);
+        } else if (inst.opcode == Opcode::VLE8 ||
+                  inst.opcode == Opcode::VLE16 ||
+                  inst.opcode == Opcode::VLE32 ||
+                  inst.opcode == Opcode::VLE64) {
+          inst.dest = DestRenameV(slot, inst, arch_src0);
+        } else if (inst.opcode == Opcode::VLUXEI32 ||
+                  inst.opcode == Opcode::VLUXEI64) {
+          inst.dest = DestRenameV(slot, inst, arch_src0);
+          inst.src[2] = LookUpV(slot, inst.src[2]);
+          if (inst.src[3] != -1) inst.src[3] = LookUpV(slot, inst.src[3]);
+        } else if (inst.opcode == Opcode::VSUXEI32 ||
+                  inst.opcode == Opcode::VSUXEI64) {
+          inst.dest = LookUpV(slot, inst.dest);
+          inst.src[2] = LookUpV(slot, inst.src[2]);
+          inst.src[3] = LookUpV(slot, inst.src[3]);
+          // assert(0);
+        } else if (inst.CheckAmoOp()) {
+          if (inst.dest >= REG_V_BASE && inst.dest < REG_PX_BASE)
+            inst.dest = LookUpV(slot, inst.dest);
+          else
+            inst.dest = -1;
+          inst.src[1] = LookUpV(slot, inst.src[1]);
+          inst.src[2] = LookUpV(slot, inst.src[2]);
+          if (inst.src[3] != -1) inst.src[3] = LookUpV(slot, inst.src[3]);
+        } else {  // VAMO instructions can have x0 or vd destination register.
+                  // Be Careful!
+          inst.src[1] = LookUpV(slot, inst.src[1]);
+          inst.src[2] = LookUpV(slot, inst.src[2]);
+        }
+        // Todo: load store by stride or index
+        break;
+      case OperandType::WV:
+      case OperandType::VV:
+      case OperandType::VS:
+      case OperandType::VM:
+      case OperandType::MM:
+        inst.src[0] = LookUpV(slot, inst.src[0]);
+        inst.src[1] = LookUpV(slot, inst.src[1]);
+        if (CheckExistVreg(slot, inst.src[2]))
+          inst.src[2] = LookUpV(slot, inst.src[2]);
+        inst.dest = DestRenameV(slot, inst, arch_src0);
+        break;
+      case OperandType::VI:
+      case OperandType::V_V:
+      case OperandType::XU_F_V:
+      case OperandType::X_F_V:
+      case OperandType::F_XU_V:
+      case OperandType::F_X_V:
+      case OperandType::F_F_V:
+      case OperandType::F_F_W:
+        inst.src[0] = LookUpV(slot, inst.src[0]);
+        inst.dest = DestRenameV(slot, inst, inst.src[0]);
+        break;
+      case OperandType::V_I:
+        if (inst.src[1] != -1) inst.src[1] = LookUpV(slot, inst.src[1]);
+        inst.dest = DestRenameV(slot, inst, inst.src[0]);
+        break;
+      case OperandType::V_X:
+      case OperandType::S_X:
+        inst.src[0] = LookUpX(slot, inst.src[0]);
+        if (inst.src[1] != -1) inst.src[1] = LookUpV(slot, inst.src[1]);
+        inst.dest = DestRenameV(slot, inst, inst.src[0]);
+        break;
+      case OperandType::VX:
+      case OperandType::WX:
+        inst.src[0] = LookUpV(slot, inst.src[0]);
+        inst.src[1] = LookUpX(slot, inst.src[1]);
+        inst.dest = DestRenameV(slot, inst, inst.src[0]);
+        break;
+    case OperandType::VF:
+      if (inst.opcode == VFMSUB) {
+      inst.src[0] = LookUpF(slot, inst.src[0]);
+      inst.src[1] = LookUpV(slot, inst.src[1]);
+      } else {
+        inst.src[0] = LookUpV(slot, inst.src[0]);
+        inst.src[1] = LookUpF(slot, inst.src[1]);
+      }
+      inst.dest = DestRenameV(slot, inst, inst.src[0]);
+      break;
+      case OperandType::S_F:
+      case OperandType::V_F:
+        inst.src[0] = LookUpF(slot, inst.src[0]);
+        inst.dest = DestRenameV(slot, inst, inst.src[0]);
+        break;
+      case OperandType::F_S:
+        inst.src[0] = LookUpV(slot, inst.src[0]);
+        inst.dest = DestRenameF(slot, inst);
+        break;
+      default:
+        // vsetvli ..
+        break;
+    }
+  } else if (inst.CheckScalarOp()) {
+    /*Register Renaming for Scalar Opcodes*/
+    switch (inst.opcode) {
+      case Opcode::ADD:
+      case Opcode::SUB:
+      case Opcode::MUL:
+      case Opcode::DIV:
+      case Opcode::REM:
+      case Opcode::AND:
+      case Opcode::SLL:
+      case Opcode::SRL:
+      case Opcode::OR:
+        inst.src[0] = LookUpX(slot, inst.src[0]);
+        inst.src[1] = LookUpX(slot, inst.src[1]);
+        inst.dest = DestRenameX(slot, inst);
+        break;
+      case Opcode::ADDI:
+      case Opcode::MULI:
+      case Opcode::ANDI:
+      case Opcode::SLLI:
+      case Opcode::SRLI:
+      case Opcode::ORI:
+        inst.src[0] = LookUpX(slot, inst.src[0]);
+        inst.dest = DestRenameX(slot, inst);
+        break;
+      case Opcode::LI:
+        inst.dest = DestRenameX(slot, inst);
+        break;
+      case Opcode::LBU:
+      case Opcode::LB:
+      case Opcode::LW:
+      case Opcode::LD:
+        inst.src[0] = LookUpX(slot, inst.src[0]);
+        inst.dest = DestRenameX(slot, inst);
+        break;
+      case Opcode::SB:
+      case Opcode::SW:
+      case Opcode::SD:
+        inst.src[0] = LookUpX(slot, inst.src[0]);
+        inst.dest = LookUpX(slot, inst.dest);
+        break;
+      case Opcode::AMOADD:
+      case Opcode::AMOMAX:
+        // An x0 destination discards the old value, as for the vector AMOs
+        inst.dest = inst.dest == REG_X0 ? -1 : DestRenameX(slot, inst);
+        inst.src[1] = LookUpX(slot, inst.src[1]);
+        inst.src[2] = LookUpX(slot, inst.src[2]);
+        break;
+      case Opcode::FAMOADD:
+      case Opcode::FAMOADDH:
+      case Opcode::FAMOMAX:
+        inst.dest = inst.dest == REG_X0 ? -1 : DestRenameF(slot, inst);
+        inst.src[1] = LookUpF(slot, inst.src[1]);
+        inst.src[2] = LookUpX(slot, inst.src[2]);
+        break;
+      case Opcode::CSRW:
+        inst.src[0] = LookUpX(slot, inst.src[0]);
+        break;
+      case Opcode::FADD:
+      case Opcode::FSUB:
+      case Opcode::FDIV:
+      case Opcode::FMUL:
+        inst.src[0] = LookUpF(slot, inst.src[0]);
+        inst.src[1] = LookUpF(slot, inst.src[1]);
+        inst.dest = DestRenameF(slot, inst);
+        break;
+      case Opcode::FLW:
+        inst.src[0] = LookUpX(slot, inst.src[0]);
+        inst.dest = DestRenameF(slot, inst);
+        break;
+      case Opcode::FSW:
+        inst.src[0] = LookUpX(slot, inst.src[0]);
+        inst.dest = LookUpF(slot, inst.dest);
+        break;
+      case Opcode::FMV:
+        if (inst.operand_type == X_W) {
+          inst.src[0] = LookUpF(slot, inst.src[0]);
+          inst.dest = DestRenameX(slot, inst);
+        } else if (inst.operand_type == W_X) {
+          inst.src[0] = LookUpX(slot, inst.src[0]);
+          inst.dest = DestRenameF(slot, inst);
+        }
+        break;
+      case Opcode::FEXP:
+        inst.src[0] = LookUpF(slot, inst.src[0]);
+        inst.dest = DestRenameF(slot, inst);
+        break;
+      case Opcode::EXIT:
+        break;
+      default:
+        // No register operands (nop, csrwi)
+        break;
+    }
   }
-  m_freg_mapping.erase(key);
-  mapping_to_free = m_vreg_mapping[key];
-  for (auto it : mapping_to_free) {
-    int reg = it.second;
+}
+
+void RegisterUnit::FreeRegs(int packet_id) {
+  auto it = m_packet_slot.find(packet_id);
+  if (it == m_packet_slot.end()) return;
+  RenameSlot& slot = m_rename_slots[it->second];
+  for (int i = 0; i < NUM_ARCH_REGS; i++) {
+    if (slot.xreg[i] != -1) m_free_xregs.push_back(slot.xreg[i]);
+    if (slot.freg[i] != -1) m_free_fregs.push_back(slot.freg[i]);
+    int reg = slot.vreg[i];
+    if (reg == -1) continue;
     m_free_vregs.push_back(reg);
+    m_vreg_allocated[reg - REG_PV_BASE] = false;
     if (CheckDoubleReg(reg)) {
-      m_free_vregs.push_back(m_double_vreg[reg]);
-      m_double_vreg.erase(reg);
+      int pair = m_double_vreg[reg - REG_PV_BASE];
+      m_free_vregs.push_back(pair);
+      m_vreg_allocated[pair - REG_PV_BASE] = false;
+      m_double_vreg[reg - REG_PV_BASE] = -1;
     }
   }
-  m_vreg_mapping.erase(key);
+  slot.clear();
+  m_free_slots.push_back(it->second);
+  m_packet_slot.erase(it);
 }
 
 bool RegisterUnit::CheckDoubleReg(int reg) {
-  if (reg < REG_PV_BASE) return false;
-  return m_double_vreg.find(reg) != m_double_vreg.end();
+  if (reg < REG_PV_BASE || reg >= REG_PV_BASE + m_num_vregs) return false;
+  return m_double_vreg[reg - REG_PV_BASE] != -1;
 }
 
 bool RegisterUnit::CheckSpecialReg(int reg) { return reg > SPCIAL_REG_START; }
 
-int RegisterUnit::LookUpX(RegisterMapKey key, int reg) {
-  if (m_xreg_mapping.find(key) != m_xreg_mapping.end() &&
-      m_xreg_mapping[key].find(reg) != m_xreg_mapping[key].end())  // 1, 0
-    return m_xreg_mapping[key][reg];
+int RegisterUnit::LookUpX(RenameSlot& slot, int reg) {
+  int index = ArchIndex(reg, REG_X_BASE);
+  if (index >= 0 && slot.xreg[index] != -1)  // 1, 0
+    return slot.xreg[index];
   else if (CheckSpecialReg(reg))
     return reg;
   throw std::runtime_error("RegisterUnit::LookUpX: Register not found");
 }
 
-int RegisterUnit::LookUpF(RegisterMapKey key, int reg) {
-  if (m_freg_mapping.find(key) != m_freg_mapping.end() &&
-      m_freg_mapping[key].find(reg) != m_freg_mapping[key].end())
-    return m_freg_mapping[key][reg];
+int RegisterUnit::LookUpF(RenameSlot& slot, int reg) {
+  int index = ArchIndex(reg, REG_F_BASE);
+  if (index >= 0 && slot.freg[index] != -1)
+    return slot.freg[index];
   else if (CheckSpecialReg(reg))
     return reg;
   throw std::runtime_error("RegisterUnit::LookUpF: Register not found");
 }
 
-int RegisterUnit::LookUpV(RegisterMapKey key, int reg) {
-  if (m_vreg_mapping.find(key) != m_vreg_mapping.end() &&
-      m_vreg_mapping[key].find(reg) != m_vreg_mapping[key].end())
-    return m_vreg_mapping[key][reg];
+int RegisterUnit::LookUpV(RenameSlot& slot, int reg) {
+  int index = ArchIndex(reg, REG_V_BASE);
+  if (index >= 0 && slot.vreg[index] != -1)
+    return slot.vreg[index];
   else if (CheckSpecialReg(reg))
     return reg;
   throw std::runtime_error("RegisterUnit::LookUpV: Register not found");
 }
 
-int RegisterUnit::DestRenameX(RegisterMapKey key, NdpInstruction inst) {
-  if (m_xreg_mapping.find(key) != m_xreg_mapping.end() &&
-      m_xreg_mapping[key].find(inst.dest) != m_xreg_mapping[key].end()) {
-    return m_xreg_mapping[key][inst.dest];
-  }
+int RegisterUnit::DestRenameX(RenameSlot& slot, NdpInstruction& inst) {
+  int index = ArchIndex(inst.dest, REG_X_BASE);
+  if (index < 0)
+    throw std::runtime_error("RegisterUnit::DestRenameX: Invalid register");
+  if (slot.xreg[index] != -1) return slot.xreg[index];
   int result = m_free_xregs.front();
   m_free_xregs.pop_front();
-  m_xreg_mapping[key][inst.dest] = result;
+  slot.xreg[index] = result;
   return result;
 }
 
-int RegisterUnit::DestRenameF(RegisterMapKey key, NdpInstruction inst) {
-  if (m_freg_mapping.find(key) != m_freg_mapping.end() &&
-      m_freg_mapping[key].find(inst.dest) != m_freg_mapping[key].end()) {
-    return m_freg_mapping[key][inst.dest];
-  }
+int RegisterUnit::DestRenameF(RenameSlot& slot, NdpInstruction& inst) {
+  int index = ArchIndex(inst.dest, REG_F_BASE);
+  if (index < 0)
+    throw std::runtime_error("RegisterUnit::DestRenameF: Invalid register");
+  if (slot.freg[index] != -1) return slot.freg[index];
   int result = m_free_fregs.front();
   m_free_fregs.pop_front();
-  m_freg_mapping[key][inst.dest] = result;
+  slot.freg[index] = result;
   return result;
 }
 
-int RegisterUnit::DestRenameV(RegisterMapKey key, NdpInstruction inst) {
-  if (m_vreg_mapping.find(key) != m_vreg_mapping.end() &&
-      m_vreg_mapping[key].find(inst.dest) != m_vreg_mapping[key].end()) {
-    return m_vreg_mapping[key][inst.dest];
-  }
-  int result = m_free_vregs.front();
-  m_free_vregs.pop_front();
-  m_vreg_mapping[key][inst.dest] = result;
-  if (!inst.CheckNarrowingOp() && CheckDoubleReg(inst.src[0]) ||
-      inst.CheckWideningOp() && !CheckDoubleReg(inst.src[0]) ||
+int RegisterUnit::DestRenameV(RenameSlot& slot, NdpInstruction& inst,
+                              int src0) {
+  int index = ArchIndex(inst.dest, REG_V_BASE);
+  if (index < 0)
+    throw std::runtime_error("RegisterUnit::DestRenameV: Invalid register");
+  if (slot.vreg[index] != -1) return slot.vreg[index];
+  int result = PopFreeVreg();
+  slot.vreg[index] = result;
+  if (!inst.CheckNarrowingOp() && CheckDoubleReg(src0) ||
+      inst.CheckWideningOp() && !CheckDoubleReg(src0) ||
       cvt_vlmul_status == IMM_M2) {
     // If not narrow operation and src is double reg, dest is double reg
-    m_double_vreg[result] = m_free_vregs.front();
-    m_free_vregs.pop_front();
+    m_double_vreg[result - REG_PV_BASE] = PopFreeVreg();
   }
   return result;
 }
 
-int RegisterUnit::DestRenameSegV(RegisterMapKey key, NdpInstruction inst,
+int RegisterUnit::DestRenameSegV(RenameSlot& slot, NdpInstruction& inst,
                                  int index) {
-  if (m_vreg_mapping.find(key) != m_vreg_mapping.end() &&
-      m_vreg_mapping[key].find(inst.segDest[index]) !=
-          m_vreg_mapping[key].end()) {
-    return m_vreg_mapping[key][inst.segDest[index]];
-  }
-  int result = m_free_vregs.front();
-  m_free_vregs.pop_front();
-  m_vreg_mapping[key][inst.segDest[index]] = result;
+  int arch_index = ArchIndex(inst.segDest[index], REG_V_BASE);
+  if (arch_index < 0)
+    throw std::runtime_error("RegisterUnit::DestRenameSegV: Invalid register");
+  if (slot.vreg[arch_index] != -1) return slot.vreg[arch_index];
+  int result = PopFreeVreg();
+  slot.vreg[arch_index] = result;
   if (!inst.CheckNarrowingOp() && CheckDoubleReg(inst.src[0]) ||
       inst.CheckWideningOp() && !CheckDoubleReg(inst.src[0])) {
     // If not narrow operation and src is double reg, dest is double reg
-    m_double_vreg[result] = m_free_vregs.front();
-    m_free_vregs.pop_front();
+    m_double_vreg[result - REG_PV_BASE] = PopFreeVreg();
   }
   return result;
 }
@@ -454,24 +541,19 @@ int RegisterUnit::DestRenameSegV(RegisterMapKey key, NdpInstruction inst,
 int RegisterUnit::GetAnother(int reg) {
   assert(CheckDoubleReg(reg));
   assert(reg >= REG_PV_BASE && reg < REG_PV_BASE + m_num_vregs);
-  return m_double_vreg[reg];
+  return m_double_vreg[reg - REG_PV_BASE];
 }
 
-bool RegisterUnit::CheckExistVreg(RegisterMapKey key, int reg) {
+bool RegisterUnit::CheckExistVreg(RenameSlot& slot, int reg) {
   // Todo : Special register implement
-  if (m_vreg_mapping.find(key) != m_vreg_mapping.end() &&
-      m_vreg_mapping[key].find(reg) != m_vreg_mapping[key].end())
-    return true;
-  else
-    return false;
+  int index = ArchIndex(reg, REG_V_BASE);
+  return index >= 0 && slot.vreg[index] != -1;
 }
 
 bool RegisterUnit::CheckExistRenameVreg(int reg) { // TODO: check the if condition, it is not correct(issue)
-  if (std::find(m_free_vregs.begin(), m_free_vregs.end(), reg) !=
-      m_free_vregs.end())
-    return false;
-  else
-    return true;
+  if (reg >= REG_PV_BASE && reg < REG_PV_BASE + m_num_vregs)
+    return m_vreg_allocated[reg - REG_PV_BASE];
+  return true;
 }
 
 int64_t RegisterUnit::ReadXreg(int reg, Context& context) {
@@ -508,7 +590,7 @@ VectorData RegisterUnit::ReadVreg(int reg, Context& context) {
     if (CheckDoubleReg(reg) && result.GetVlen() != (PACKET_SIZE * BYTE_BIT *
                                                     (context.csr->vtype_vlmul) /
                                                     context.csr->vtype_vsew)) {
-      result.Append(m_vreg_table[m_double_vreg[reg] - REG_PV_BASE]);
+      result.Append(m_vreg_table[m_double_vreg[reg - REG_PV_BASE] - REG_PV_BASE]);
       m_register_stats.register_stats[RegisterStats::V_READ]++;
     }
   } else
@@ -555,9 +637,10 @@ void RegisterUnit::WriteVreg(int reg, VectorData value, Context& context) {
     if (context.csr->vtype_vlmul == 2 || value.GetDoubleReg()) {
       std::array<VectorData, 2> values = value.Split();
       m_vreg_table[reg - REG_PV_BASE] = values[0];
-      if (m_double_vreg[reg] < REG_PV_BASE)
+      int pair = m_double_vreg[reg - REG_PV_BASE];
+      if (pair < REG_PV_BASE)
         throw std::runtime_error("RegisterUnit::Double register not allocated");
-      m_vreg_table[m_double_vreg[reg] - REG_PV_BASE] = values[1];
+      m_vreg_table[pair - REG_PV_BASE] = values[1];
       m_register_stats.register_stats[RegisterStats::V_WRITE]++;
     } else {
       m_vreg_table[reg - REG_PV_BASE] = value;
@@ -590,55 +673,65 @@ bool RegisterUnit::IsFreg(int reg_id) {
 
 RegisterStats RegisterUnit::get_register_stats() { return m_register_stats; }
 
+#ifdef TIMING_SIMULATION
+void RegisterUnit::register_stats(const std::string &prefix) {
+  StatsRegistry *registry = StatsRegistry::get();
+  for (int i = 0; i < RegisterStats::REG_STAT_NUM; i++) {
+    const uint32_t *counter = &m_register_stats.register_stats[i];
+    registry->add(prefix + "." + RegStatusString[i],
+                  [counter]() { return (uint64_t)*counter; });
+  }
+}
+#endif
+
 void RegisterUnit::dump_current_state() {
   spdlog::error("RegisterUnit::dump_current_state");
-  for (auto not_ready_reg : m_not_ready) {
+  for (int reg = REG_PX_BASE; reg < REG_PX_BASE + m_num_xregs; reg++)
+    if (!CheckReady(reg))
+      spdlog::error("RegisterUnit::dump_current_state: not_ready_reg: {}", reg);
+  for (int reg = REG_PF_BASE; reg < REG_PF_BASE + m_num_fregs; reg++)
+    if (!CheckReady(reg))
+      spdlog::error("RegisterUnit::dump_current_state: not_ready_reg: {}", reg);
+  for (int reg = REG_PV_BASE; reg < REG_PV_BASE + m_num_vregs; reg++)
+    if (!CheckReady(reg))
+      spdlog::error("RegisterUnit::dump_current_state: not_ready_reg: {}", reg);
+  for (auto not_ready_reg : m_not_ready_other) {
     spdlog::error("RegisterUnit::dump_current_state: not_ready_reg: {}",
                   not_ready_reg);
   }
 }
 
 void RegisterUnit::DumpRegisterFile(int packet_id) {
-  std::map<RegisterMapKey, std::map<int, int>> ordered_reg;
-  /* Dump integer Register file */
-  for (auto& [key, val] : m_xreg_mapping)
+  std::map<int, RenameSlot*> ordered_slots;
+  for (auto& [key, slot] : m_packet_slot)
     if (packet_id == -1 || key == packet_id)
-      for (auto& [reg, renamed_reg] : val)
-        ordered_reg[key][reg] = renamed_reg;
+      ordered_slots[key] = &m_rename_slots[slot];
 
+  /* Dump integer Register file */
   spdlog::error("==========================Interger Register File==========================");
-  for (auto& [key, val] : ordered_reg) {
-    for (auto& [reg, renamed_reg] : val) {
-      spdlog::debug("x{}: {}", reg - REG_X_BASE, m_xreg_table[renamed_reg - REG_PX_BASE]);
+  for (auto& [key, slot] : ordered_slots) {
+    for (int i = 0; i < NUM_ARCH_REGS; i++) {
+      if (slot->xreg[i] == -1) continue;
+      spdlog::debug("x{}: {}", i, m_xreg_table[slot->xreg[i] - REG_PX_BASE]);
     }
   }
 
-  ordered_reg.clear();
   /* Dump floating point Register file */
-  for (auto& [key, val] : m_freg_mapping)
-    if (packet_id == -1 || key == packet_id)
-      for (auto& [reg, renamed_reg] : val)
-        ordered_reg[key][reg] = renamed_reg;
-
   spdlog::error("=======================Floating point Register File=======================");
-  for (auto& [key, val] : ordered_reg) {
-    for (auto& [reg, renamed_reg] : val) {
-      spdlog::debug("f{}: {}", reg - REG_F_BASE, m_freg_table[renamed_reg - REG_PF_BASE]);
+  for (auto& [key, slot] : ordered_slots) {
+    for (int i = 0; i < NUM_ARCH_REGS; i++) {
+      if (slot->freg[i] == -1) continue;
+      spdlog::debug("f{}: {}", i, m_freg_table[slot->freg[i] - REG_PF_BASE]);
     }
   }
 
-  ordered_reg.clear();
   /* Dump Vector Register file */
-  for (auto& [key, val] : m_vreg_mapping)
-    if (packet_id == -1 || key == packet_id)
-      for (auto& [reg, renamed_reg] : val)
-        ordered_reg[key][reg] = renamed_reg;
-
   spdlog::error("===========================Vector Register File===========================");
-  for (auto& [key, val] : ordered_reg) {
-    for (auto& [reg, renamed_reg] : val) {
-      std::cout << "v" << reg - REG_V_BASE << ": ";
-      spdlog::debug("v{}: {}", reg - REG_V_BASE, m_vreg_table[renamed_reg - REG_PV_BASE].toString());
+  for (auto& [key, slot] : ordered_slots) {
+    for (int i = 0; i < NUM_ARCH_REGS; i++) {
+      if (slot->vreg[i] == -1) continue;
+      std::cout << "v" << i << ": ";
+      spdlog::debug("v{}: {}", i, m_vreg_table[slot->vreg[i] - REG_PV_BASE].toString());
     }
   }
   std::cout << std::endl;
@@ -8,9 +8,18 @@
 #include "ndp_instruction.h"
 namespace NDPSim {
 
-typedef int RegisterMapKey;
-typedef robin_hood::unordered_map<int, int> RegisterBinding;
-typedef robin_hood::unordered_map<RegisterMapKey, RegisterBinding> RegisterMap;
+// Number of architectural registers of each class (x, f and v)
+static const int NUM_ARCH_REGS = 32;
+
+// Rename table of one uthread: architectural register index -> physical
+// register, -1 when unmapped
+struct RenameSlot {
+  int packet_id;
+  int xreg[NUM_ARCH_REGS];
+  int freg[NUM_ARCH_REGS];
+  int vreg[NUM_ARCH_REGS];
+  void clear();
+};
 
 struct RegisterStats {
   enum RegStatEnum {
@@ -54,17 +63,17 @@ class RegisterUnit {
   void SetNotReady(int reg);
   void SetReady(int reg);
 
-  /*Renaming*/
-  std::deque<NdpInstruction> Convert(std::deque<NdpInstruction> input,
-                                     int packet_id,
-                                     RequestInfo* req);
+  /*Renaming (in place)*/
+  void Convert(std::deque<NdpInstruction> &insts, int packet_id,
+               RequestInfo *req);
+  // Rename one instruction of a column bound by RenamePush
+  void RenameFetched(InstColumn *inst_column, NdpInstruction &inst);
 
   void FreeRegs(int packet_id);
   bool CheckDoubleReg(int reg);
   int GetAnother(int reg);
 
   /*Read-Write access*/
-  bool CheckExistVreg(RegisterMapKey key, int reg);
   bool CheckExistRenameVreg(int vreg_id);
   int64_t ReadXreg(int xreg_id, Context& context);
   char ReadXreg(int xreg_id, int idx, Context& context);
@@ -77,6 +86,10 @@ class RegisterUnit {
 
   /*Register Status*/
   RegisterStats get_register_stats();
+  void set_register_stats(RegisterStats stats) { m_register_stats = stats; }
+#ifdef TIMING_SIMULATION
+  void register_stats(const std::string &prefix);
+#endif
   void dump_current_state();
 
   /*Check rf type*/
@@ -95,10 +108,13 @@ class RegisterUnit {
   int cvt_vlmul_status;
 
   std::vector<VectorData> m_reg_table;
-  RegisterMap m_xreg_mapping;
-  RegisterMap m_freg_mapping;
-  RegisterMap m_vreg_mapping;
-  RegisterBinding m_double_vreg;
+  // Rename tables are indexed by slot; a uthread holds one slot between
+  // Convert() and FreeRegs()
+  std::vector<RenameSlot> m_rename_slots;
+  std::vector<int> m_free_slots;
+  robin_hood::unordered_map<int, int> m_packet_slot;  // packet_id -> slot
+  std::vector<int> m_double_vreg;  // [pv - REG_PV_BASE] = pair reg or -1
+  std::vector<bool> m_vreg_allocated;  // [pv - REG_PV_BASE]
   std::deque<int> m_free_xregs;
   std::deque<int> m_free_fregs;
   std::deque<int> m_free_vregs;
@@ -108,19 +124,27 @@ class RegisterUnit {
   std::vector<VectorData> m_vreg_table;
 
   std::deque<InstColumn*> m_after_rename;
-  robin_hood::unordered_set<int> m_not_ready;
+  // Scoreboard over physical registers [px | pf | pv]; other register ids
+  // (never expected in practice) fall back to m_not_ready_other
+  std::vector<bool> m_not_ready;
+  robin_hood::unordered_set<int> m_not_ready_other;
 
   bool CheckSpecialReg(int reg);
-  // int GetVregIndex(int reg);
-  int LookUp(RegisterMapKey key, int reg);
-  int LookUpX(RegisterMapKey key, int reg);
-  int LookUpF(RegisterMapKey key, int reg);
-  int LookUpV(RegisterMapKey key, int reg);
-  int DestRename(RegisterMapKey key, NdpInstruction inst);
-  int DestRenameX(RegisterMapKey key, NdpInstruction inst);
-  int DestRenameF(RegisterMapKey key, NdpInstruction inst);
-  int DestRenameV(RegisterMapKey key, NdpInstruction inst);
-  int DestRenameSegV(RegisterMapKey key, NdpInstruction inst, int index);
+  int ScoreboardIndex(int reg);
+  RenameSlot &AcquireSlot(int packet_id);
+  int BindSlot(int packet_id, RequestInfo *req);
+  void RenameStream(RenameSlot &slot, const std::deque<NdpInstruction> &insts,
+                    std::deque<NdpInstruction> *renamed_insts);
+  void RenameInst(RenameSlot &slot, NdpInstruction &inst);
+  int PopFreeVreg();
+  int LookUpX(RenameSlot &slot, int reg);
+  int LookUpF(RenameSlot &slot, int reg);
+  int LookUpV(RenameSlot &slot, int reg);
+  bool CheckExistVreg(RenameSlot &slot, int reg);
+  int DestRenameX(RenameSlot &slot, NdpInstruction &inst);
+  int DestRenameF(RenameSlot &slot, NdpInstruction &inst);
+  int DestRenameV(RenameSlot &slot, NdpInstruction &inst, int src0);
+  int DestRenameSegV(RenameSlot &slot, NdpInstruction &inst, int index);
 };
 }
 #endif  // FUNCSIM_REGISTER_RENAMING_H_
\ No newline at end of file
@@ -0,0 +1,137 @@
+#ifdef TIMING_SIMULATION
+#include "stats_registry.h"
+
+#include <spdlog/spdlog.h>
+
+#include <cinttypes>
+#include <map>
+namespace NDPSim {
+
+StatsRegistry* StatsRegistry::get() {
+  static StatsRegistry registry;
+  return &registry;
+}
+
+void StatsRegistry::add(const std::string& name, const uint64_t* counter) {
+  add(name, [counter]() { return *counter; });
+}
+
+void StatsRegistry::add(const std::string& name, Counter counter) {
+  // A later owner of the name, e.g. a unit rebuilt with the same id, takes
+  // the slot over
+  auto it = m_index.find(name);
+  if (it != m_index.end()) {
+    m_counters[it->second] = counter;
+    return;
+  }
+  // The stream header lists the names once, so the set is fixed after it
+  if (m_header_written) {
+    spdlog::error("Stats counter {} registered after the first snapshot",
+                  name);
+    exit(1);
+  }
+  m_index.emplace(name, m_names.size());
+  m_names.push_back(name);
+  m_counters.push_back(counter);
+}
+
+void StatsRegistry::remove(const std::string& prefix) {
+  std::vector<std::string> names;
+  std::vector<Counter> counters;
+  for (size_t i = 0; i < m_names.size(); i++) {
+    const std::string& name = m_names[i];
+    bool match = name.compare(0, prefix.size(), prefix) == 0 &&
+                 (name.size() == prefix.size() || name[prefix.size()] == '.');
+    if (match && m_header_written) {
+      uint64_t value = m_counters[i]();
+      m_counters[i] = [value]() { return value; };
+    } else if (!match) {
+      names.push_back(name);
+      counters.push_back(m_counters[i]);
+    }
+  }
+  if (m_header_written) return;
+  m_names.swap(names);
+  m_counters.swap(counters);
+  m_index.clear();
+  for (size_t i = 0; i < m_names.size(); i++) m_index.emplace(m_names[i], i);
+}
+
+void StatsRegistry::open(const std::string& path, int interval) {
+  m_file = fopen(path.c_str(), "w");
+  if (m_file == NULL) {
+    spdlog::error("Cannot open stats file {}", path);
+    exit(1);
+  }
+  m_interval = interval;
+}
+
+void StatsRegistry::cycle(uint64_t ndp_cycle) {
+  if (m_file == NULL || ndp_cycle % m_interval != 0) return;
+  snapshot(ndp_cycle);
+}
+
+uint64_t StatsRegistry::next_snapshot(uint64_t ndp_cycle) const {
+  if (m_file == NULL) return UINT64_MAX;
+  return (ndp_cycle / m_interval + 1) * m_interval;
+}
+
+void StatsRegistry::snapshot(uint64_t ndp_cycle) {
+  // The runner loop visits an NDP cycle once per faster clock domain tick
+  if (m_file == NULL || ndp_cycle == m_last_snapshot) return;
+  m_last_snapshot = ndp_cycle;
+  if (!m_header_written) {
+    fprintf(m_file, "{\"names\":[");
+    for (size_t i = 0; i < m_names.size(); i++)
+      fprintf(m_file, "%s\"%s\"", i ? "," : "", m_names[i].c_str());
+    fprintf(m_file, "]}\n");
+    m_header_written = true;
+  }
+  fprintf(m_file, "{\"cycle\":%" PRIu64 ",\"values\":[", ndp_cycle);
+  for (size_t i = 0; i < m_counters.size(); i++)
+    fprintf(m_file, "%s%" PRIu64, i ? "," : "", m_counters[i]());
+  fprintf(m_file, "]}\n");
+}
+
+void StatsRegistry::close(uint64_t ndp_cycle) {
+  if (m_file == NULL) return;
+  snapshot(ndp_cycle);
+  fclose(m_file);
+  m_file = NULL;
+}
+
+uint64_t StatsRegistry::sum(const std::string& suffix,
+                            const std::string& prefix) const {
+  std::string key = "." + suffix;
+  uint64_t total = 0;
+  for (size_t i = 0; i < m_names.size(); i++) {
+    const std::string& name = m_names[i];
+    if (name.size() >= prefix.size() + key.size() &&
+        name.compare(0, prefix.size(), prefix) == 0 &&
+        name.compare(name.size() - key.size(), key.size(), key) == 0)
+      total += m_counters[i]();
+  }
+  return total;
+}
+
+std::vector<std::pair<std::string, uint64_t>> StatsRegistry::totals(
+    const std::string& prefix) const {
+  std::vector<std::pair<std::string, uint64_t>> totals;
+  std::map<std::string, size_t> index;
+  for (size_t i = 0; i < m_names.size(); i++) {
+    const std::string& name = m_names[i];
+    if (name.compare(0, prefix.size(), prefix) != 0) continue;
+    size_t dot = name.find('.', prefix.size());
+    if (dot == std::string::npos) continue;
+    std::string counter = name.substr(dot + 1);
+    auto it = index.find(counter);
+    if (it == index.end()) {
+      it = index.emplace(counter, totals.size()).first;
+      totals.push_back({counter, 0});
+    }
+    totals[it->second].second += m_counters[i]();
+  }
+  return totals;
+}
+}  // namespace NDPSim
+#endif
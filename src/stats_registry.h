@@ -0,0 +1,59 @@
+#ifdef TIMING_SIMULATION
+#ifndef STATS_REGISTRY_H
+#define STATS_REGISTRY_H
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+namespace NDPSim {
+
+// Counters registered once by dotted name, e.g. "ndp3.l1d.hit". Components
+// keep incrementing their own fields; the registry only reads them when a
+// snapshot is taken. Every snapshot appends one JSON line with the cycle and
+// the raw values in registration order, after a first line listing the
+// names. Deltas and sums across units are left to the consumer or to sum().
+class StatsRegistry {
+ public:
+  typedef std::function<uint64_t()> Counter;
+
+  static StatsRegistry* get();
+  void add(const std::string& name, const uint64_t* counter);
+  void add(const std::string& name, Counter counter);
+  // Drops <prefix> and every counter below it. Counters already listed in
+  // the stream header keep their column with their last value.
+  void remove(const std::string& prefix);
+  void open(const std::string& path, int interval);
+  bool is_open() const { return m_file != NULL; }
+  // Takes a snapshot once per interval; cheap to call every cycle
+  void cycle(uint64_t ndp_cycle);
+  // First NDP cycle after ndp_cycle on which cycle() takes a snapshot
+  uint64_t next_snapshot(uint64_t ndp_cycle) const;
+  void snapshot(uint64_t ndp_cycle);
+  void close(uint64_t ndp_cycle);
+  // Sum over every counter whose name starts with prefix and ends with
+  // "." + suffix
+  uint64_t sum(const std::string& suffix, const std::string& prefix = "") const;
+  // Counters named <prefix><unit>.<counter> summed over every unit, keyed by
+  // <counter> in registration order; e.g. prefix "m2ndp0.ndp" totals the
+  // NDP units of buffer 0
+  std::vector<std::pair<std::string, uint64_t>> totals(
+      const std::string& prefix) const;
+  size_t size() const { return m_names.size(); }
+
+ private:
+  StatsRegistry() {}
+
+  std::vector<std::string> m_names;
+  std::unordered_map<std::string, size_t> m_index;
+  std::vector<Counter> m_counters;
+  FILE* m_file = NULL;
+  int m_interval = 0;
+  bool m_header_written = false;
+  uint64_t m_last_snapshot = UINT64_MAX;
+};
+}  // namespace NDPSim
+#endif
+#endif
@@ -6,6 +6,7 @@
 #include <sstream>
 
 #include "ndp_instruction.h"
+#include "checkpoint.h"
 #include "m2ndp_parser.h"
 namespace NDPSim {
 
@@ -35,7 +36,8 @@ SubCore::SubCore(M2NDPConfig* config, MemoryMap* memory_map, NdpStats* stats, in
 
   m_icache_config.init(m_config->get_l0icache_config(), m_config);
   m_l0_icache = new ReadOnlyCache("l0_icache", m_icache_config, m_id, 0, m_to_icache); //TODO: l0 icache config
-  m_instruction_queue = new InstructionQueue(m_config, m_id, m_sub_core_id, m_l0_icache);
+  m_instruction_queue = new InstructionQueue(m_config, m_id, m_sub_core_id, m_l0_icache,
+                                             m_register_unit);
   m_execution_unit = new ExecutionUnit(m_config, m_id, m_sub_core_id, m_register_unit,
                                         m_finished_contexts,
                                         m_to_ldst_unit,
@@ -53,23 +55,24 @@ SubCore::SubCore(M2NDPConfig* config, MemoryMap* memory_map, NdpStats* stats, in
 #endif
 
 void SubCore::ExecuteInitializer(MemoryMap* spad_map, RequestInfo* info) {
-  std::deque<NdpInstruction> renamed = m_register_unit->Convert(
-      m_ndp_kernel->initializer_insts, info->id, info);
+  std::deque<NdpInstruction> renamed = m_ndp_kernel->initializer_insts;
+  m_register_unit->Convert(renamed, info->id, info);
   ExecuteInsts_Array(spad_map, renamed, info, m_ndp_kernel->loop_map);
   m_register_unit->FreeRegs(info->id);
 }
 
 void SubCore::ExecuteKernelBody(MemoryMap* spad_map, RequestInfo* info,
                                 int kernel_body_id) {
-  std::deque<NdpInstruction> renamed = m_register_unit->Convert(
-      m_ndp_kernel->kernel_body_insts[kernel_body_id], info->id, info);
+  std::deque<NdpInstruction> renamed =
+      m_ndp_kernel->kernel_body_insts[kernel_body_id];
+  m_register_unit->Convert(renamed, info->id, info);
   ExecuteInsts_Array(spad_map, renamed, info, m_ndp_kernel->loop_map);
   m_register_unit->FreeRegs(info->id);
 }
 
 void SubCore::ExecuteFinalizer(MemoryMap* spad_map, RequestInfo* info) {
-  std::deque<NdpInstruction> finalizer_renamed =
-      m_register_unit->Convert(m_ndp_kernel->finalizer_insts, info->id, info);
+  std::deque<NdpInstruction> finalizer_renamed = m_ndp_kernel->finalizer_insts;
+  m_register_unit->Convert(finalizer_renamed, info->id, info);
   ExecuteInsts_Array(spad_map, finalizer_renamed, info, m_ndp_kernel->loop_map);
   m_register_unit->FreeRegs(info->id);
 }
@@ -85,6 +88,7 @@ void SubCore::ExecuteInsts(MemoryMap* spad_map,
   context.scratchpad_map = spad_map;
   context.register_map = m_register_unit;
   context.request_info = info;
+  context.write_log = m_write_log;
   for (NdpInstruction inst : insts) {
     inst.Execute(context);
   }
@@ -102,9 +106,16 @@ void SubCore::ExecuteInsts_Array(MemoryMap* spad_map,
   context.scratchpad_map = spad_map;
   context.register_map = m_register_unit;
   context.request_info = info;
+  context.write_log = m_write_log;
   for (int i = 0; i < insts.size(); i++) {
     try {
-      insts.at(i).Execute(context);
+      if (insts.at(i).GetAluOpType() == ADDRESS_OP) {
+        // Keep read-modify-write accesses atomic when NDP units run in parallel
+        std::lock_guard<MemoryMap> lock(*context.memory_map);
+        insts.at(i).Execute(context);
+      } else {
+        insts.at(i).Execute(context);
+      }
       int key = insts.at(i).IsBranch();
       if (key >= 0) {
         i = loop_map.find(key)->second - 1;
@@ -130,6 +141,13 @@ void SubCore::cycle() {
   m_execution_unit->cycle();
 }
 
+// Tick of an idle sub-core: only the per-cycle stats execute_instruction()
+// records for an empty instruction queue
+void SubCore::idle_cycle() {
+  m_stats->inc_ndp_inst_queue_size(0);
+  m_stats->add_status(EMPTY_QUEUE);
+}
+
 void SubCore::execute_instruction() {
   std::deque<Status> issue_fail_reasons;
   bool issued = false;
@@ -147,6 +165,7 @@ void SubCore::execute_instruction() {
       context.memory_map = m_memory_map;
       context.scratchpad_map = context.request_info->scratchpad_map;
       context.register_map = m_register_unit;
+      context.write_log = m_write_log;
       // try {
         Status status = m_execution_unit->issue(inst, context);
         if (status == ISSUE_SUCCESS) {
@@ -222,7 +241,7 @@ void SubCore::instruction_queue_allocate() {
     return;
   }
   m_register_unit->RenamePop();
-  if (inst->insts.empty()) {
+  if (inst->insts->empty()) {
     //have to push to finished_contexts
     //Make temp context
     Context temp_context;
@@ -256,6 +275,13 @@ bool SubCore::is_active() {
          !m_from_icache->empty();
 }
 
+// Woken again by a new InstColumn on m_inst_column_q
+bool SubCore::is_idle() {
+  return !is_active() && m_register_unit->RenameEmpty() &&
+         m_instruction_queue->is_idle() && m_execution_unit->is_idle() &&
+         m_l0_icache->is_idle();
+}
+
 RegisterStats SubCore::get_register_stats() {
   return m_register_unit->get_register_stats();
 }
@@ -264,6 +290,18 @@ CacheStats SubCore::get_l0_icache_stats() {
   return m_l0_icache->get_stats();
 }
 
+void SubCore::save_state(std::ostream& os) {
+  m_l0_icache->save_state(os);
+  checkpoint_write(os, m_register_unit->get_register_stats());
+}
+
+void SubCore::load_state(std::istream& is) {
+  m_l0_icache->load_state(is);
+  RegisterStats register_stats;
+  checkpoint_read(is, register_stats);
+  m_register_unit->set_register_stats(register_stats);
+}
+
 void SubCore::print_sub_core_stats() {
   float avg_active_queue =
       ((float)m_active_queque_count) / m_config->get_log_interval();
@@ -279,5 +317,10 @@ void SubCore::print_sub_core_stats() {
   m_active_queque_count = 0;
 }
 
+void SubCore::register_stats(const std::string& prefix) {
+  m_l0_icache->register_stats(prefix + ".l0i");
+  m_register_unit->register_stats(prefix + ".reg");
+}
+
 #endif
 }  // namespace NDPSim
\ No newline at end of file
@@ -21,11 +21,14 @@ class SubCore {
  public:
   SubCore() {}
   SubCore(M2NDPConfig* config, MemoryMap* memory_map, int id, int sub_core_id);
+  ~SubCore() { delete m_register_unit; }
   void ExecuteInitializer(MemoryMap* spad_map, RequestInfo* info);
   void ExecuteKernelBody(MemoryMap* spad_map, RequestInfo* info,
                          int kenrel_body_id);
   void ExecuteFinalizer(MemoryMap* spad_map, RequestInfo* info);
-  void set_ndp_kernel(NdpKernel* ndp_kernel) {m_ndp_kernel = ndp_kernel;}
+  void set_ndp_kernel(const NdpKernel* ndp_kernel) {m_ndp_kernel = ndp_kernel;}
+  // Global stores and AMOs go to write_log while it is set
+  void set_write_log(WriteLog* write_log) { m_write_log = write_log; }
 
 #ifdef TIMING_SIMULATION
   SubCore(M2NDPConfig* config, MemoryMap* memory_map, NdpStats* stats, int id, int sub_core_id,
@@ -37,6 +40,7 @@ class SubCore {
           std::queue<Context> *finished_contexts);
                 
   void cycle();
+  void idle_cycle();
   void execute_instruction();
   void l0_inst_cache_cycle();
   void instruction_queue_allocate();
@@ -51,8 +55,12 @@ class SubCore {
   bool is_inst_queue_empty() { return m_instruction_queue->all_empty(); }
 
   bool is_active();
+  bool is_idle();
   RegisterStats get_register_stats();
   CacheStats get_l0_icache_stats();
+  void register_stats(const std::string& prefix);
+  void save_state(std::ostream& os);
+  void load_state(std::istream& is);
   void print_sub_core_stats();
 #endif
 
@@ -64,9 +72,10 @@ class SubCore {
   int m_num_xreg;
   int m_num_freg;
   int m_num_vreg;
-  NdpKernel* m_ndp_kernel;
+  const NdpKernel* m_ndp_kernel;
   MemoryMap* m_memory_map;
-  RegisterUnit* m_register_unit;
+  RegisterUnit* m_register_unit = NULL;
+  WriteLog* m_write_log = NULL;
 #ifdef TIMING_SIMULATION
   InstructionQueue* m_instruction_queue;
   ExecutionUnit* m_execution_unit;
@@ -36,7 +36,7 @@ bool Tlb::full(uint64_t mf_size) {
 }
 
 void Tlb::fill(mem_fetch* mf) {
-  mf->current_state = "TLB Fill";
+  mf->current_state = MF_TLB_FILL;
   if (!m_config->is_dram_tlb_miss_handling_enabled()) {
     assert(mf->get_addr() >= DRAM_TLB_BASE);
     m_tlb->fill(mf, m_config->get_ndp_cycle());
@@ -78,8 +78,13 @@ void Tlb::pop_data() { m_finished_mf.pop(); }
 void Tlb::cycle() {
   // Tlb cache cycle & decrease latency cycle
   m_tlb->cycle();
-  m_tlb_request_queue.cycle();
-  m_dram_tlb_latency_queue.cycle();
+  if (!m_tlb_request_queue.idle()) m_tlb_request_queue.cycle();
+  if (!m_dram_tlb_latency_queue.idle()) m_dram_tlb_latency_queue.cycle();
+}
+
+bool Tlb::is_idle() {
+  return m_tlb->is_idle() && m_tlb_request_queue.idle() &&
+         m_dram_tlb_latency_queue.idle() && m_finished_mf.empty();
 }
 
 void Tlb::bank_access_cycle() {
@@ -128,6 +133,11 @@ void Tlb::bank_access_cycle() {
 
 CacheStats Tlb::get_stats() { return m_tlb->get_stats(); }
 
+void Tlb::warm(uint64_t addr) {
+  if (!m_ideal_tlb)
+    m_tlb->warm(get_tlb_addr(addr), false, m_config->get_ndp_cycle());
+}
+
 uint64_t Tlb::get_tlb_addr(uint64_t addr) {
   return addr / m_page_size * m_tlb_entry_size + DRAM_TLB_BASE;
 }
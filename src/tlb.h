@@ -23,7 +23,15 @@ class Tlb {
   void pop_data();
   void cycle();
   void bank_access_cycle();
+  bool is_idle();
   CacheStats get_stats();
+  // Installs the translation of addr without a walk (functional warming)
+  void warm(uint64_t addr);
+  void register_stats(const std::string &prefix) {
+    m_tlb->register_stats(prefix);
+  }
+  void save_state(std::ostream &os) { m_tlb->save_state(os); }
+  void load_state(std::istream &is) { m_tlb->load_state(is); }
  private:
   uint64_t get_tlb_addr(uint64_t addr);
  private:
@@ -1,10 +1,14 @@
 #ifdef TIMING_SIMULATION
 #include "uthread_generator.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
 #include "memory_map.h"
 namespace NDPSim {
 
-static unsigned long long global_req_id = 0;
+static std::atomic<unsigned long long> global_req_id(0);
 
 UThreadGenerator::UThreadGenerator(M2NDPConfig* config, int ndp_id,
                                    fifo_pipeline<RequestInfo>* request_queue)
@@ -13,7 +17,7 @@ UThreadGenerator::UThreadGenerator(M2NDPConfig* config, int ndp_id,
   m_config = config;
 }
 
-void UThreadGenerator::register_kernel(NdpKernel* kernel) {
+void UThreadGenerator::register_kernel(const NdpKernel* kernel) {
   m_registered_functions.insert(kernel->kernel_id);
   m_num_kernel_bodies[kernel->kernel_id] = kernel->num_kernel_bodies;
   spdlog::info("NDP {} : Register kernel {}", m_ndp_id, kernel->kernel_id);
@@ -53,10 +57,8 @@ void UThreadGenerator::launch(KernelLaunchInfo kinfo) {
   int launch_id = kinfo.launch_id;
   m_launch_infos[kinfo.launch_id] = kinfo;
   assert(kinfo.smem_size <= m_config->get_spad_size()); // SMEM size should be less than SPAD size
-  m_launch_infos[kinfo.launch_id].scratchpad_map = new HashMemoryMap(SCRATCHPAD_BASE, kinfo.smem_size);
+  m_launch_infos[kinfo.launch_id].scratchpad_map = new PagedMemoryMap(SCRATCHPAD_BASE, kinfo.smem_size);
   assert(size % PACKET_SIZE == 0);
-  bool initializer = true;
-  std::deque<RequestInfo*> requests;
   if (m_registered_functions.find(kernel_id) == m_registered_functions.end()) {
     spdlog::warn("NDP {} : Function {} is not registered", m_ndp_id, kernel_id);
     return;
@@ -95,74 +97,36 @@ void UThreadGenerator::launch(KernelLaunchInfo kinfo) {
         spad_addr + outter * PACKET_SIZE, data);
   }
   
-  for (uint64_t addr = base; addr < base + size; addr += PACKET_SIZE) {
-    if (!check_addr_match(addr)) continue;
-    if (initializer) {
-      RequestInfo* info = new RequestInfo();
-      info->kernel_id = kernel_id;
-      info->launch_id = launch_id;
-      info->id = global_req_id++;
-      info->addr = base;
-      info->offset = m_ndp_id;
-      info->type = INITIALIZER;
-      info->scratchpad_map = m_launch_infos[kinfo.launch_id].scratchpad_map;
-      requests.push_back(info);
-      initializer = false;
-    }
-    RequestInfo* info = new RequestInfo();
-    info->kernel_id = kernel_id;
-    info->id = global_req_id++;
-    info->launch_id = launch_id;
-    info->addr = addr;
-    info->offset = addr - base;
-    info->type = KERNEL_BODY;
-    info->kernel_body_id = 0;
-    info->scratchpad_map = m_launch_infos[kinfo.launch_id].scratchpad_map;
-    requests.push_back(info);
-  }
-  for(int kid = 1; kid < m_num_kernel_bodies[kernel_id]; kid++) {
-    for (uint64_t addr = base; addr < base + size; addr += PACKET_SIZE) {
-      if (!check_addr_match(addr)) continue;
-      RequestInfo* info = new RequestInfo();
-      info->kernel_id = kernel_id;
-      info->id = global_req_id++;
-      info->launch_id = launch_id;
-      info->addr = addr;
-      info->offset = addr - base;
-      info->type = KERNEL_BODY;
-      info->kernel_body_id = kid;
-      info->scratchpad_map = m_launch_infos[kinfo.launch_id].scratchpad_map;
-      requests.push_back(info);
-    }
-  }
-  if (requests.size() > 0) {
-    RequestInfo* info = new RequestInfo();
-    info->kernel_id = kernel_id;
-    info->id = global_req_id++;
-    info->launch_id = launch_id;
-    info->addr = base;
-    info->offset = m_ndp_id;
-    info->type = FINALIZER;
-    info->scratchpad_map = m_launch_infos[kinfo.launch_id].scratchpad_map;
-    requests.push_back(info);
-  }
-  m_total_requests[launch_id] = requests.size();
-  m_count_requests[launch_id] = 0;
-  if (!requests.empty()) {
+  // uthreads are materialized from the cursor as the sub-cores take them
+  uint64_t matched = count_matched_packets(base, size);
+  if (matched > 0) {
+    int num_bodies = std::max(1, m_num_kernel_bodies[kernel_id]);
+    m_total_requests[launch_id] = matched * num_bodies + 2;
+    m_count_requests[launch_id] = 0;
     m_launch_queue.push_back(launch_id);
-    m_generated_requests[launch_id] = requests;
-  } 
-  else {
+    m_uthread_cursors[launch_id] = UThreadCursor();
+    if (m_config->is_sampling_enabled()) {
+      m_uthread_cursors[launch_id].phase_left =
+          m_config->get_sampling_detailed_uthreads();
+      m_launch_samples[launch_id].kernel_name = kinfo.kernel_name;
+      m_launch_samples[launch_id].start_cycle = m_config->get_ndp_cycle();
+    }
+  } else {
     finish_launch(launch_id);
-  } 
+  }
   check_kernel_launch();
 }
 
 void UThreadGenerator::increase_count(int launch_id) {
   m_count_requests[launch_id] += 1;
+  m_uthread_count++;
 }
 
 void UThreadGenerator::finish_launch(int launch_id) {
+  if (m_launch_samples.find(launch_id) != m_launch_samples.end()) {
+    m_launch_samples[launch_id].end_cycle = m_config->get_ndp_cycle();
+    m_launch_samples[launch_id].finished = true;
+  }
   m_active_launch_ids.erase(launch_id);
   m_total_requests.erase(launch_id);
   m_count_requests.erase(launch_id);
@@ -176,25 +140,21 @@ void UThreadGenerator::cycle() {
   if(!m_config->is_coarse_grained() && !m_config->is_sc_work()) {
     generate_uthreads(1);
   }
-  if (!m_active_launch_ids.empty() && !m_generated_requests.empty()) {
+  if (!m_active_launch_ids.empty() && !m_uthread_cursors.empty()) {
       int launch_id = get_next_launch_id();
       if(launch_id == -1) return; // no available launch id
-      if (m_generated_requests[launch_id].empty()) {
-        m_generated_requests.erase(launch_id);
-        return;
-      }
-      RequestInfo* info = m_generated_requests[launch_id].front();
+      RequestInfo* info = peek_request(launch_id);
       if (info->type == FINALIZER) {
         //have to check KERNEL_BODY requests are done at all sub-core
         if (m_count_requests[launch_id] == (m_total_requests[launch_id] - 1)) {
           spdlog::debug("NDP {}: Push to uthread_requests_queue as all KERNEL_BODY is done", m_ndp_id);
           m_uthread_request_queue->push(info);
-          m_generated_requests[launch_id].pop_front();
+          pop_request(launch_id);
         }
       } else if (info->type == INITIALIZER){
         //INITIALIZER
         m_uthread_request_queue->push(info);
-        m_generated_requests[launch_id].pop_front();
+        pop_request(launch_id);
       }
     }
   m_launched = false;
@@ -203,19 +163,16 @@ void UThreadGenerator::cycle() {
 bool UThreadGenerator::generate_uthreads(int threads) {
   bool can_issue = false;
   for (int i = 0; i < threads; i++) {
-    if (!m_active_launch_ids.empty() && !m_generated_requests.empty()) {
+    if (!m_active_launch_ids.empty() && !m_uthread_cursors.empty()) {
       int launch_id = get_next_launch_id();
       if(launch_id == -1) { return false;} // no available launch id
-      if (m_generated_requests[launch_id].empty()) {
-        m_generated_requests.erase(launch_id);
-        return false;
-      }
-      RequestInfo* info = m_generated_requests[launch_id].front();
+      RequestInfo* info = peek_request(launch_id);
       if (info->type == KERNEL_BODY) {
         //have to check INITIALIZER request is done at sub-core
-        if (m_count_requests[launch_id] >= 1) {
+        if (m_count_requests[launch_id] >= 1 && sample_can_issue(launch_id)) {
           m_uthread_request_queue->push(info);
-          m_generated_requests[launch_id].pop_front();
+          sample_issued(launch_id);
+          pop_request(launch_id);
           can_issue = true;
         }
       }
@@ -224,6 +181,56 @@ bool UThreadGenerator::generate_uthreads(int threads) {
   return can_issue;
 }
 
+// Next kernel-body uthread of a fast-forward span. The NdpUnit executes it
+// functionally and reports it finished before asking for the next one.
+RequestInfo* UThreadGenerator::pop_fast_forward() {
+  if (!m_config->is_sampling_enabled()) return NULL;
+  for (auto launch_id : m_active_launch_ids) {
+    auto it = m_uthread_cursors.find(launch_id);
+    if (it == m_uthread_cursors.end()) continue;
+    UThreadCursor& cursor = it->second;
+    if (cursor.phase != SAMPLE_FAST_FORWARD) continue;
+    RequestInfo* info = peek_request(launch_id);
+    if (info->type != KERNEL_BODY || !check_can_issue(info)) continue;
+    pop_request(launch_id);
+    m_launch_samples[launch_id].skipped_uthreads++;
+    if (--cursor.phase_left == 0) {
+      cursor.phase = SAMPLE_DETAILED;
+      cursor.phase_left = m_config->get_sampling_detailed_uthreads();
+    }
+    return info;
+  }
+  return NULL;
+}
+
+bool UThreadGenerator::sample_can_issue(int launch_id) {
+  if (!m_config->is_sampling_enabled()) return true;
+  return m_uthread_cursors[launch_id].phase == SAMPLE_DETAILED;
+}
+
+// The first issue of a window closes the previous one. The first window of a
+// launch fills an empty pipeline and is not timed.
+void UThreadGenerator::sample_issued(int launch_id) {
+  if (!m_config->is_sampling_enabled()) return;
+  UThreadCursor& cursor = m_uthread_cursors[launch_id];
+  int window = m_config->get_sampling_detailed_uthreads();
+  if (cursor.phase_left == window) {
+    uint64_t cycle = m_config->get_ndp_cycle();
+    if (cursor.windows >= 2) {
+      double cycles = cycle - cursor.window_start;
+      m_launch_samples[launch_id].window_cycles_per_uthread.push_back(
+          cycles / window);
+    }
+    cursor.windows++;
+    cursor.window_start = cycle;
+  }
+  m_launch_samples[launch_id].detailed_uthreads++;
+  if (--cursor.phase_left == 0) {
+    cursor.phase = SAMPLE_FAST_FORWARD;
+    cursor.phase_left = m_config->get_sampling_skip_uthreads();
+  }
+}
+
 void UThreadGenerator::check_kernel_launch() {
   if (!m_launch_queue.empty() && !m_launched) {
     int launch_id = m_launch_queue.front();
@@ -243,6 +250,100 @@ bool UThreadGenerator::check_addr_match(uint64_t addr) {
   return m_config->get_matched_unit_id(addr) == (m_ndp_id % m_config->get_num_ndp_units()); // 256B aligned
 }
 
+// First packet at or after addr, on the launch's packet grid from base, that
+// belongs to this unit; end if there is none before end
+uint64_t UThreadGenerator::next_matched_addr(uint64_t base, uint64_t addr,
+                                             uint64_t end) {
+  uint64_t stride = m_config->get_stride_size();
+  uint64_t num_units = m_config->get_num_ndp_units();
+  uint64_t unit_id = m_ndp_id % num_units;
+  addr = base + (addr - base + PACKET_SIZE - 1) / PACKET_SIZE * PACKET_SIZE;
+  while (addr < end) {
+    uint64_t window = addr / stride;
+    if (window % num_units == unit_id) return addr;
+    uint64_t owned = window + (unit_id + num_units - window % num_units) % num_units;
+    addr = base + (owned * stride - base + PACKET_SIZE - 1) / PACKET_SIZE *
+                      PACKET_SIZE;
+  }
+  return end;
+}
+
+// Matched packets in [addr, end), walking one owned stride window at a time
+uint64_t UThreadGenerator::count_matched_packets(uint64_t base, uint64_t addr,
+                                                 uint64_t end) {
+  uint64_t stride = m_config->get_stride_size();
+  uint64_t count = 0;
+  for (addr = next_matched_addr(base, addr, end); addr < end;) {
+    uint64_t window_end = std::min((addr / stride + 1) * stride, end);
+    uint64_t packets = (window_end - addr + PACKET_SIZE - 1) / PACKET_SIZE;
+    count += packets;
+    addr = next_matched_addr(base, addr + packets * PACKET_SIZE, end);
+  }
+  return count;
+}
+
+// Matched packets of a whole launch. The ownership pattern repeats every
+// stride * num_units bytes, so only one period and the tail are walked.
+uint64_t UThreadGenerator::count_matched_packets(uint64_t base, uint64_t size) {
+  uint64_t period =
+      (uint64_t)m_config->get_stride_size() * m_config->get_num_ndp_units();
+  uint64_t end = base + size;
+  if (period % PACKET_SIZE != 0 || size < period)
+    return count_matched_packets(base, base, end);
+  uint64_t periods = size / period;
+  uint64_t tail = base + periods * period;
+  return periods * count_matched_packets(base, base, base + period) +
+         count_matched_packets(base, tail, end);
+}
+
+// Head request of a launch, created on first use. The caller hands it to the
+// uthread request queue and then calls pop_request.
+RequestInfo* UThreadGenerator::peek_request(int launch_id) {
+  UThreadCursor& cursor = m_uthread_cursors[launch_id];
+  if (cursor.head != NULL) return cursor.head;
+  KernelLaunchInfo& kinfo = m_launch_infos[launch_id];
+  RequestInfo* info = new RequestInfo();
+  info->kernel_id = kinfo.kernel_id;
+  info->id = global_req_id++;
+  info->launch_id = launch_id;
+  info->type = cursor.type;
+  info->scratchpad_map = kinfo.scratchpad_map;
+  if (cursor.type == KERNEL_BODY) {
+    info->addr = cursor.addr;
+    info->offset = cursor.addr - kinfo.base_addr;
+    info->kernel_body_id = cursor.kernel_body_id;
+  } else {
+    info->addr = kinfo.base_addr;
+    info->offset = m_ndp_id;
+  }
+  cursor.head = info;
+  return info;
+}
+
+void UThreadGenerator::pop_request(int launch_id) {
+  UThreadCursor& cursor = m_uthread_cursors[launch_id];
+  KernelLaunchInfo& kinfo = m_launch_infos[launch_id];
+  uint64_t base = kinfo.base_addr;
+  uint64_t end = kinfo.base_addr + kinfo.size;
+  assert(cursor.head != NULL);
+  cursor.head = NULL;
+  if (cursor.type == INITIALIZER) {
+    cursor.type = KERNEL_BODY;
+    cursor.addr = next_matched_addr(base, base, end);
+  } else if (cursor.type == KERNEL_BODY) {
+    cursor.addr = next_matched_addr(base, cursor.addr + PACKET_SIZE, end);
+    if (cursor.addr >= end) {
+      cursor.kernel_body_id++;
+      cursor.addr = next_matched_addr(base, base, end);
+      if (cursor.kernel_body_id >=
+          std::max(1, m_num_kernel_bodies[kinfo.kernel_id]))
+        cursor.type = FINALIZER;
+    }
+  } else {
+    m_uthread_cursors.erase(launch_id);
+  }
+}
+
 uint32_t UThreadGenerator::get_allocated_spad_size() {
   uint32_t size = 0;
   for (auto id : m_active_launch_ids) {
@@ -253,9 +354,8 @@ uint32_t UThreadGenerator::get_allocated_spad_size() {
 }
 int UThreadGenerator::get_next_launch_id() {
   for(auto active_launch_id : m_active_launch_ids) {
-    if (m_generated_requests.find(active_launch_id) != m_generated_requests.end()) {
-      if(m_generated_requests[active_launch_id].empty()) continue;
-      RequestInfo *info = m_generated_requests[active_launch_id].front();
+    if (m_uthread_cursors.find(active_launch_id) != m_uthread_cursors.end()) {
+      RequestInfo *info = peek_request(active_launch_id);
       if(check_can_issue(info)) return active_launch_id;
     }
   }
@@ -281,6 +381,34 @@ bool UThreadGenerator::check_can_issue(RequestInfo* info) {
   }
   else return false;
 }
+
+double LaunchSample::mean_cycles_per_uthread() const {
+  if (window_cycles_per_uthread.empty()) return 0;
+  double sum = 0;
+  for (double cycles : window_cycles_per_uthread) sum += cycles;
+  return sum / window_cycles_per_uthread.size();
+}
+
+// Simulated cycles plus the skipped uthreads at the mean detailed rate; 0
+// while the launch is still running
+double LaunchSample::estimated_cycles() const {
+  if (!finished) return 0;
+  return (end_cycle - start_cycle) +
+         skipped_uthreads * mean_cycles_per_uthread();
+}
+
+// Normal approximation over the per-window rates, scaled to the skipped
+// uthreads
+double LaunchSample::confidence_interval() const {
+  int num_windows = window_cycles_per_uthread.size();
+  if (num_windows < 2) return 0;
+  double mean = mean_cycles_per_uthread();
+  double var = 0;
+  for (double cycles : window_cycles_per_uthread)
+    var += (cycles - mean) * (cycles - mean);
+  var /= num_windows - 1;
+  return 1.96 * std::sqrt(var / num_windows) * skipped_uthreads;
+}
 }  // namespace NDPSim
 
 #endif
\ No newline at end of file
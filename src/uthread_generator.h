@@ -3,6 +3,7 @@
 #define PACKET_FILTER_H
 
 #include <queue>
+#include <string>
 #include <vector>
 
 #include "delayqueue.h"
@@ -11,13 +12,48 @@
 #include "common_defs.h"
 
 namespace NDPSim {
+// Sampled simulation: kernel-body uthreads alternate between detailed windows
+// and fast-forward spans executed functionally by the NdpUnit. The pipeline
+// is not drained between them, so a window is timed from its first issue to
+// the next window's, at the rate the still-busy pipeline accepts uthreads.
+enum SamplingPhase { SAMPLE_DETAILED, SAMPLE_FAST_FORWARD };
+
+// Sampling record of one launch on one NDP unit
+struct LaunchSample {
+  std::string kernel_name;
+  uint64_t start_cycle = 0;
+  uint64_t end_cycle = 0;  // valid once finished
+  bool finished = false;
+  uint64_t detailed_uthreads = 0;
+  uint64_t skipped_uthreads = 0;
+  std::vector<double> window_cycles_per_uthread;
+  double mean_cycles_per_uthread() const;
+  double estimated_cycles() const;
+  double confidence_interval() const;  // 95% half-width, 0 with < 2 windows
+};
+
+// Position of a launch in its uthread stream: the INITIALIZER, then every
+// matched packet for each kernel body in turn, then the FINALIZER. Only the
+// head request is materialized.
+struct UThreadCursor {
+  RequestType type = INITIALIZER;
+  int kernel_body_id = 0;
+  uint64_t addr = 0;
+  RequestInfo* head = NULL;
+  // Sampling state
+  SamplingPhase phase = SAMPLE_DETAILED;
+  int phase_left = 0;
+  uint64_t windows = 0;
+  uint64_t window_start = 0;
+};
+
 class UThreadGenerator {
  public:
   UThreadGenerator(M2NDPConfig* config, int ndp_id,
                    fifo_pipeline<RequestInfo>* matched_requests);
   void launch(KernelLaunchInfo info);
 
-  void register_kernel(NdpKernel* kernel);
+  void register_kernel(const NdpKernel* kernel);
   void unregister_kernel(int kernel_id);
 
   void finish_launch(int launch_id);
@@ -30,6 +66,18 @@ class UThreadGenerator {
   void increase_count(int launch_id);
   uint32_t get_allocated_spad_size();
   bool generate_uthreads(int threads);
+  RequestInfo* pop_fast_forward();
+  const std::map<int, LaunchSample>& get_launch_samples() {
+    return m_launch_samples;
+  }
+  // Requests counted over every launch, for the stats registry
+  uint64_t get_uthread_count() { return m_uthread_count; }
+  void set_uthread_count(uint64_t count) { m_uthread_count = count; }
+  // Packets of a launch from base that belong to this unit
+  bool check_addr_match(uint64_t addr);
+  uint64_t next_matched_addr(uint64_t base, uint64_t addr, uint64_t end);
+  uint64_t count_matched_packets(uint64_t base, uint64_t addr, uint64_t end);
+  uint64_t count_matched_packets(uint64_t base, uint64_t size);
  private:
   M2NDPConfig* m_config;
   int m_ndp_id;
@@ -43,11 +91,16 @@ class UThreadGenerator {
   std::map<int,KernelLaunchInfo> m_launch_infos;
   fifo_pipeline<RequestInfo>* m_uthread_request_queue;
   std::deque<int> m_launch_queue;
-  std::map<int, std::deque<RequestInfo*>> m_generated_requests;
+  std::map<int, UThreadCursor> m_uthread_cursors;
   std::map<int, int> m_total_requests;
   std::map<int, int> m_count_requests;
+  uint64_t m_uthread_count = 0;
+  std::map<int, LaunchSample> m_launch_samples;
 
-  bool check_addr_match(uint64_t addr);
+  RequestInfo* peek_request(int launch_id);
+  void pop_request(int launch_id);
+  bool sample_can_issue(int launch_id);
+  void sample_issued(int launch_id);
   int get_next_launch_id();
   bool check_can_issue(RequestInfo* info);
   void check_kernel_launch();
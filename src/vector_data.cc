@@ -5,20 +5,174 @@
 #include <iostream>
 
 #include "common.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 namespace NDPSim {
 
+namespace {
+enum class LaneOp { ADD, SUB, MUL, MAX, MIN };
+
+// Element-wise kernels for same-type FLOAT32 and INT32 lanes. A zero rhs
+// stride broadcasts rhs[0]. Max/Min pass operands in std::max/std::min order
+// so NaN and signed zero lanes match the scalar loops bit for bit.
+void FloatLanes(LaneOp op, const Data *lhs, const Data *rhs, int rhs_stride,
+                Data *out, uint32_t n) {
+  const float *a = reinterpret_cast<const float *>(lhs);
+  const float *b = reinterpret_cast<const float *>(rhs);
+  float *c = reinterpret_cast<float *>(out);
+  uint32_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 8 <= n; i += 8) {
+    __m256 x = _mm256_loadu_ps(a + i);
+    __m256 y = rhs_stride ? _mm256_loadu_ps(b + i) : _mm256_set1_ps(b[0]);
+    __m256 r;
+    switch (op) {
+      case LaneOp::ADD: r = _mm256_add_ps(x, y); break;
+      case LaneOp::SUB: r = _mm256_sub_ps(x, y); break;
+      case LaneOp::MUL: r = _mm256_mul_ps(x, y); break;
+      case LaneOp::MAX: r = _mm256_max_ps(y, x); break;
+      default: r = _mm256_min_ps(y, x); break;
+    }
+    _mm256_storeu_ps(c + i, r);
+  }
+#endif
+#if defined(__SSE2__)
+  for (; i + 4 <= n; i += 4) {
+    __m128 x = _mm_loadu_ps(a + i);
+    __m128 y = rhs_stride ? _mm_loadu_ps(b + i) : _mm_set1_ps(b[0]);
+    __m128 r;
+    switch (op) {
+      case LaneOp::ADD: r = _mm_add_ps(x, y); break;
+      case LaneOp::SUB: r = _mm_sub_ps(x, y); break;
+      case LaneOp::MUL: r = _mm_mul_ps(x, y); break;
+      case LaneOp::MAX: r = _mm_max_ps(y, x); break;
+      default: r = _mm_min_ps(y, x); break;
+    }
+    _mm_storeu_ps(c + i, r);
+  }
+#endif
+  for (; i < n; i++) {
+    float x = a[i];
+    float y = b[i * rhs_stride];
+    switch (op) {
+      case LaneOp::ADD: c[i] = x + y; break;
+      case LaneOp::SUB: c[i] = x - y; break;
+      case LaneOp::MUL: c[i] = x * y; break;
+      case LaneOp::MAX: c[i] = std::max(x, y); break;
+      default: c[i] = std::min(x, y); break;
+    }
+  }
+}
+
+void IntLanes(LaneOp op, const Data *lhs, const Data *rhs, int rhs_stride,
+              Data *out, uint32_t n) {
+  const int32_t *a = reinterpret_cast<const int32_t *>(lhs);
+  const int32_t *b = reinterpret_cast<const int32_t *>(rhs);
+  int32_t *c = reinterpret_cast<int32_t *>(out);
+  uint32_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 8 <= n; i += 8) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+    __m256i y =
+        rhs_stride
+            ? _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i))
+            : _mm256_set1_epi32(b[0]);
+    __m256i r;
+    switch (op) {
+      case LaneOp::ADD: r = _mm256_add_epi32(x, y); break;
+      case LaneOp::SUB: r = _mm256_sub_epi32(x, y); break;
+      case LaneOp::MUL: r = _mm256_mullo_epi32(x, y); break;
+      case LaneOp::MAX: r = _mm256_max_epi32(x, y); break;
+      default: r = _mm256_min_epi32(x, y); break;
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(c + i), r);
+  }
+#endif
+#if defined(__SSE4_1__)
+  bool sse_op = true;
+#else
+  // SSE2 has no 32-bit multiply or signed min/max
+  bool sse_op = op == LaneOp::ADD || op == LaneOp::SUB;
+#endif
+#if defined(__SSE2__)
+  for (; sse_op && i + 4 <= n; i += 4) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+    __m128i y = rhs_stride
+                    ? _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i))
+                    : _mm_set1_epi32(b[0]);
+    __m128i r;
+    switch (op) {
+      case LaneOp::ADD: r = _mm_add_epi32(x, y); break;
+#if defined(__SSE4_1__)
+      case LaneOp::MUL: r = _mm_mullo_epi32(x, y); break;
+      case LaneOp::MAX: r = _mm_max_epi32(x, y); break;
+      case LaneOp::MIN: r = _mm_min_epi32(x, y); break;
+#endif
+      default: r = _mm_sub_epi32(x, y); break;
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(c + i), r);
+  }
+#else
+  (void)sse_op;
+#endif
+  for (; i < n; i++) {
+    // Wrap on overflow like the vector paths
+    uint32_t x = a[i];
+    uint32_t y = b[i * rhs_stride];
+    switch (op) {
+      case LaneOp::ADD: c[i] = x + y; break;
+      case LaneOp::SUB: c[i] = x - y; break;
+      case LaneOp::MUL: c[i] = x * y; break;
+      case LaneOp::MAX: c[i] = std::max(a[i], b[i * rhs_stride]); break;
+      default: c[i] = std::min(a[i], b[i * rhs_stride]); break;
+    }
+  }
+}
+
+// Runs op over the first n lanes when both operands hold FLOAT32 or INT32
+// lanes. Returns false for the types left to the generic element loops.
+bool LaneKernel(LaneOp op, DataType type, const DataBuffer &lhs,
+                const DataBuffer &rhs, DataBuffer &out, uint32_t n) {
+  if (n > lhs.size() || n > rhs.size() || n > out.size()) return false;
+  if (type == FLOAT32)
+    FloatLanes(op, lhs.data(), rhs.data(), 1, out.data(), n);
+  else if (type == INT32)
+    IntLanes(op, lhs.data(), rhs.data(), 1, out.data(), n);
+  else
+    return false;
+  return true;
+}
+
+bool LaneKernel(LaneOp op, DataType type, const DataBuffer &lhs, Data rhs,
+                DataBuffer &out, uint32_t n) {
+  if (n > lhs.size() || n > out.size()) return false;
+  if (type == FLOAT32)
+    FloatLanes(op, lhs.data(), &rhs, 0, out.data(), n);
+  else if (type == INT32)
+    IntLanes(op, lhs.data(), &rhs, 0, out.data(), n);
+  else
+    return false;
+  return true;
+}
+}  // namespace
+
 VectorData::VectorData() {
-  m_data = std::vector<Data>(PACKET_ENTRIES);
+  m_data = DataBuffer(PACKET_ENTRIES);
   m_vlen = PACKET_ENTRIES;  // 8
   m_double_reg = false;
 }
 
 VectorData::VectorData(bool double_reg) {
   if (double_reg) {
-    m_data = std::vector<Data>(PACKET_ENTRIES * 2);
+    m_data = DataBuffer(PACKET_ENTRIES * 2);
     m_vlen = PACKET_ENTRIES * 2;
   } else {
-    m_data = std::vector<Data>(PACKET_ENTRIES);
+    m_data = DataBuffer(PACKET_ENTRIES);
     m_vlen = PACKET_ENTRIES;
   }
   m_double_reg = double_reg;
@@ -31,7 +185,7 @@ VectorData::VectorData(int sew, float lmul) {
   float div = UNION_DATA_SIZE / (float)sew;
   int vec_len = (int)(vlen / div);
 
-  m_data = std::vector<Data>(int(ROUND_UP(vec_len, PACKET_ENTRIES)));
+  m_data = DataBuffer(int(ROUND_UP(vec_len, PACKET_ENTRIES)));
   m_vlen = (uint32_t)vlen;
   m_double_reg = (lmul == 2.0);
 }
@@ -43,7 +197,7 @@ VectorData::VectorData(Context &context) {
 
   int vec_len = (m_vlen * context.csr->vtype_vsew) / UNION_DATA_SIZE;
   
-  m_data = std::vector<Data>(int(ROUND_UP(vec_len, PACKET_ENTRIES)));
+  m_data = DataBuffer(int(ROUND_UP(vec_len, PACKET_ENTRIES)));
 
   m_double_reg = (context.csr->vtype_vlmul == 2.0);
 }
@@ -54,17 +208,12 @@ void VectorData::SetVectorDoubleReg() {
 }
 
 void VectorData::Widen(Context &context) {
-  std::vector<Data> new_data;
-  int vec_len = (m_vlen * context.csr->vtype_vsew) / UNION_DATA_SIZE;
-
-  for (int i = 0; i < m_vlen; i++) {
-    new_data.push_back(m_data[i]);
-  }
-  for (int i = 0; i < m_vlen; i++) {
-    new_data.push_back(m_data[i]);
+  DataBuffer new_data(m_vlen * 2);
+  for (uint32_t i = 0; i < m_vlen; i++) {
+    new_data[i] = m_data[i];
+    new_data[m_vlen + i] = m_data[i];
   }
-  m_data.resize(vec_len * 2);
-  m_data = new_data;
+  m_data = std::move(new_data);
   // m_vlen *= 2;
 }
 
@@ -73,51 +222,51 @@ void VectorData::SetType(DataType type) { m_type = type; }
 void VectorData::SetVlen(uint32_t vlen) { m_vlen = vlen; }
 
 void VectorData::SetData(float data, int index) {
-  assert(index < m_vlen);
+  assert(index < (int)m_vlen);
   m_type = FLOAT32;
   m_data[index].fp32_data = data;
 }
 
 void VectorData::SetData(int32_t data, int index) {
-  assert(index < m_vlen);
+  assert(index < (int)m_vlen);
   m_type = INT32;
   m_data[index].int32_data = data;
 }
 
 void VectorData::SetData(int16_t data, int index) {
-  assert((index / 2) < m_vlen);
+  assert((index / 2) < (int)m_vlen);
   m_type = INT16;
   m_data[index / 2].int16_data[index % 2] = data;
 }
 
 void VectorData::SetData(uint8_t data, int index) {
-  assert((index / 4) < m_vlen);
+  assert((index / 4) < (int)m_vlen);
   m_type = UINT8;
   m_data[index / 4].char8_data[index % 4] = data;
 }
 
 void VectorData::SetData(int64_t data, int index) {
-  assert(index < m_vlen);
+  assert(index < (int)m_vlen);
   m_type = INT64;
   m_data[2 * index].int32_data = data >> UNION_DATA_SIZE;
   m_data[2 * index + 1].int32_data = data & 0xffffffff;
 }
 
 void VectorData::SetData(half data, int index) {
-  assert((index / 2) < m_vlen);
+  assert((index / 2) < (int)m_vlen);
   m_type = FLOAT16;
   m_data[index / 2].fp16_data[index % 2] =
       fp16_ieee_from_fp32_value((float)data);
 }
 
 void VectorData::SetData(char data, int index) {
-  assert((index / 4) < m_vlen);
+  assert((index / 4) < (int)m_vlen);
   m_type = CHAR8;
   m_data[index / 4].char8_data[index % 4] = data;
 }
 
 void VectorData::SetData(bool data, int index) {
-  assert((index / 4) < m_vlen);
+  assert((index / 4) < (int)m_vlen);
   m_type = BOOL;
   m_data[index / 4].bool_data[index % 4] = data;
 }
@@ -255,48 +404,48 @@ void VectorData::PrintVectorData() const {
   switch (m_type) {
     case INT64:
       printf("INT64 : ");
-      for (int i = 0; i < m_vlen; i++) printf("%e ", this->GetLongData(i));
+      for (uint32_t i = 0; i < m_vlen; i++) printf("%e ", this->GetLongData(i));
       printf("\n");
       break;
     case FLOAT32:
       printf("FLOAT32 : ");
-      for (int i = 0; i < m_vlen; i++) printf("%e ", this->GetFloatData(i));
+      for (uint32_t i = 0; i < m_vlen; i++) printf("%e ", this->GetFloatData(i));
       printf("\n");
       break;
     case INT32:
       printf("INT32 : ");
-      for (int i = 0; i < m_vlen; i++) printf("%d ", this->GetIntData(i));
+      for (uint32_t i = 0; i < m_vlen; i++) printf("%d ", this->GetIntData(i));
       printf("\n");
       break;
     case INT16:
       printf("INT16 : ");
-      for (int i = 0; i < m_vlen; i++) printf("%d ", this->GetShortData(i));
+      for (uint32_t i = 0; i < m_vlen; i++) printf("%d ", this->GetShortData(i));
       printf("\n");
       break;
     case FLOAT16:
       printf("FLOAT16 : ");
-      for (int i = 0; i < m_vlen; i++)
+      for (uint32_t i = 0; i < m_vlen; i++)
         printf("%f ", (float)(this->GetHalfData(i)));
       printf("\n");
       break;
     case VMASK:
       printf("VMASK : ");
-      for (int i = 0; i < m_vlen; i++) printf("%u ", this->GetVmaskData(i));
+      for (uint32_t i = 0; i < m_vlen; i++) printf("%u ", this->GetVmaskData(i));
       printf("\n");
       break;
     case CHAR8:
       printf("CHAR8 : ");
-      for (int i = 0; i < m_vlen; i++) printf("%c ", this->GetCharData(i));
+      for (uint32_t i = 0; i < m_vlen; i++) printf("%c ", this->GetCharData(i));
       printf("\n");
       break;
     case UINT8:
       printf("UINT8 : ");
-      for (int i = 0; i < m_vlen; i++) printf("%u ", this->GetU8Data(i));
+      for (uint32_t i = 0; i < m_vlen; i++) printf("%u ", this->GetU8Data(i));
       printf("\n");
       break;
     case BOOL:
       printf("BOOL : ");
-      for (int i = 0; i < m_vlen; i++) printf("%d ", this->GetBoolData(i));
+      for (uint32_t i = 0; i < m_vlen; i++) printf("%d ", this->GetBoolData(i));
       printf("\n");
       break;
     default:
@@ -310,41 +459,41 @@ std::string VectorData::toString() const {
   {
   case INT64:
     out += "INT64 : ";
-    for (int i = 0; i < m_vlen; i++) out += std::to_string(this->GetLongData(i)) + " ";
+    for (uint32_t i = 0; i < m_vlen; i++) out += std::to_string(this->GetLongData(i)) + " ";
     break;
   case FLOAT32:
     out += "FLOAT32 : ";
-    for (int i = 0; i < m_vlen; i++) out += std::to_string(this->GetFloatData(i)) + " ";
+    for (uint32_t i = 0; i < m_vlen; i++) out += std::to_string(this->GetFloatData(i)) + " ";
     break;
   case INT32:
     out += "INT32 : ";
-    for (int i = 0; i < m_vlen; i++) out += std::to_string(this->GetIntData(i)) + " ";
+    for (uint32_t i = 0; i < m_vlen; i++) out += std::to_string(this->GetIntData(i)) + " ";
     break;
   case FLOAT16:
     out += "FLOAT16 : ";
-    for (int i = 0; i < m_vlen; i++)
+    for (uint32_t i = 0; i < m_vlen; i++)
       out += std::to_string((float)(this->GetHalfData(i))) + " ";
     break;
   case INT16:
     out += "INT16: ";
-    for (int i = 0; i < m_vlen; i++)
+    for (uint32_t i = 0; i < m_vlen; i++)
       out += std::to_string((short)(this->GetShortData(i))) + " ";
     break;
   case VMASK:
     out += "VMASK : ";
-    for (int i = 0; i < m_vlen; i++) out += std::to_string(this->GetVmaskData(i)) + " ";
+    for (uint32_t i = 0; i < m_vlen; i++) out += std::to_string(this->GetVmaskData(i)) + " ";
     break;
   case CHAR8:
     out += "CHAR8 : ";
-    for (int i = 0; i < m_vlen; i++) out += std::to_string(this->GetCharData(i)) + " ";
+    for (uint32_t i = 0; i < m_vlen; i++) out += std::to_string(this->GetCharData(i)) + " ";
     break;
   case UINT8:
     out += "UINT8 : ";
-    for (int i = 0; i < m_vlen; i++) out += std::to_string(this->GetU8Data(i)) + " ";
+    for (uint32_t i = 0; i < m_vlen; i++) out += std::to_string(this->GetU8Data(i)) + " ";
     break;
   case BOOL:
     out += "BOOL : ";
-    for (int i = 0; i < m_vlen; i++) out += std::to_string(this->GetBoolData(i)) + " ";
+    for (uint32_t i = 0; i < m_vlen; i++) out += std::to_string(this->GetBoolData(i)) + " ";
     break;
   default:
     out += std::to_string(this->GetType()) + " : To String Type Unsupported..\n";
@@ -354,7 +503,10 @@ std::string VectorData::toString() const {
 
 VectorData VectorData::Max(VectorData &rhs) {
   VectorData ret = *this;
-  for (int i = 0; i < GetVlen(); i++) {
+  if (LaneKernel(LaneOp::MAX, m_type, m_data, rhs.m_data, ret.m_data,
+                 GetVlen()))
+    return ret;
+  for (uint32_t i = 0; i < GetVlen(); i++) {
     switch (m_type) {
       case FLOAT32:
         ret.SetData(std::max(GetFloatData(i), rhs.GetFloatData(i)), i);
@@ -380,7 +532,10 @@ VectorData VectorData::Max(VectorData &rhs) {
 
 VectorData VectorData::Min(VectorData &rhs) {
   VectorData ret = *this;
-  for (int i = 0; i < GetVlen(); i++) {
+  if (LaneKernel(LaneOp::MIN, m_type, m_data, rhs.m_data, ret.m_data,
+                 GetVlen()))
+    return ret;
+  for (uint32_t i = 0; i < GetVlen(); i++) {
     switch (m_type) {
       case FLOAT32:
         ret.SetData(std::min(GetFloatData(i), rhs.GetFloatData(i)), i);
@@ -406,7 +561,7 @@ VectorData VectorData::Min(VectorData &rhs) {
 
 VectorData VectorData::And(VectorData &rhs) {
   VectorData ret = *this;
-  for (int i = 0; i < GetVlen(); i++) {
+  for (uint32_t i = 0; i < GetVlen(); i++) {
     switch (m_type) {
       case FLOAT32:
         ret.SetData((GetFloatData(i) && rhs.GetFloatData(i)), i);
@@ -432,7 +587,7 @@ VectorData VectorData::And(VectorData &rhs) {
 
 VectorData VectorData::Or(VectorData &rhs) {
   VectorData ret = *this;
-  for (int i = 0; i < GetVlen(); i++) {
+  for (uint32_t i = 0; i < GetVlen(); i++) {
     switch (m_type) {
       case FLOAT32:
         ret.SetData((GetFloatData(i) || rhs.GetFloatData(i)), i);
@@ -459,7 +614,7 @@ VectorData VectorData::Or(VectorData &rhs) {
 VectorData VectorData::Exp(VectorData &rhs) {
   VectorData ret = *this;
   float exp_data;
-  for (int i = 0; i < GetVlen(); i++) {
+  for (uint32_t i = 0; i < GetVlen(); i++) {
     switch (m_type) {
       case FLOAT32:
         exp_data = std::exp(rhs.GetFloatData(i));
@@ -488,8 +643,12 @@ VectorData operator+(const VectorData &lhs, VectorData &rhs) {
   VectorData ret = lhs;
   DataType lhs_type = lhs.GetType();
   DataType rhs_type = rhs.GetType();
+  if (lhs_type == rhs_type &&
+      LaneKernel(LaneOp::ADD, lhs_type, lhs.m_data, rhs.m_data, ret.m_data,
+                 lhs.GetVlen()))
+    return ret;
 
-  for (int i = 0; i < lhs.GetVlen(); i++) {
+  for (uint32_t i = 0; i < lhs.GetVlen(); i++) {
     if (lhs_type == FLOAT32) {
       if (rhs_type == FLOAT32) {
         ret.SetData(float(lhs.GetFloatData(i) + rhs.GetFloatData(i)), i);
@@ -535,7 +694,13 @@ VectorData operator+(const VectorData &lhs, VectorData &rhs) {
 
 VectorData operator+(const VectorData &lhs, float &rhs) {
   VectorData ret = lhs;
-  for (int i = 0; i < lhs.GetVlen(); i++) {
+  Data scalar;
+  scalar.fp32_data = rhs;
+  if (lhs.GetType() == FLOAT32 &&
+      LaneKernel(LaneOp::ADD, FLOAT32, lhs.m_data, scalar, ret.m_data,
+                 lhs.GetVlen()))
+    return ret;
+  for (uint32_t i = 0; i < lhs.GetVlen(); i++) {
     switch (lhs.GetType()) {
       case FLOAT32:
         ret.SetData(lhs.GetFloatData(i) + rhs, i);
@@ -560,7 +725,13 @@ VectorData operator+(const VectorData &lhs, float &rhs) {
 
 VectorData operator+(const VectorData &lhs, int32_t &rhs) {
   VectorData ret = lhs;
-  for (int i = 0; i < lhs.GetVlen(); i++) {
+  Data scalar;
+  scalar.int32_data = rhs;
+  if (lhs.GetType() == INT32 &&
+      LaneKernel(LaneOp::ADD, INT32, lhs.m_data, scalar, ret.m_data,
+                 lhs.GetVlen()))
+    return ret;
+  for (uint32_t i = 0; i < lhs.GetVlen(); i++) {
     switch (lhs.GetType()) {
       case FLOAT32:
         ret.SetData(lhs.GetFloatData(i) + rhs, i);
@@ -591,7 +762,7 @@ VectorData operator+(const VectorData &lhs, int32_t &rhs) {
 
 VectorData operator+(const VectorData &lhs, int64_t &rhs) {
   VectorData ret = lhs;
-  for (int i = 0; i < lhs.GetVlen(); i++) {
+  for (uint32_t i = 0; i < lhs.GetVlen(); i++) {
     switch (lhs.GetType()) {
       case FLOAT32:
         ret.SetData(lhs.GetFloatData(i) + rhs, i);
@@ -626,8 +797,12 @@ VectorData operator-(const VectorData &lhs, VectorData &rhs) {
   VectorData ret = lhs;
   DataType lhs_type = lhs.GetType();
   DataType rhs_type = rhs.GetType();
+  if (lhs_type == rhs_type &&
+      LaneKernel(LaneOp::SUB, lhs_type, lhs.m_data, rhs.m_data, ret.m_data,
+                 lhs.GetVlen()))
+    return ret;
 
-  for (int i = 0; i < lhs.GetVlen(); i++) {
+  for (uint32_t i = 0; i < lhs.GetVlen(); i++) {
     if (lhs_type == FLOAT32) {
       if (rhs_type == FLOAT32) {
         ret.SetData(float(lhs.GetFloatData(i) - rhs.GetFloatData(i)), i);
@@ -683,7 +858,13 @@ VectorData operator-(const VectorData &lhs, VectorData &rhs) {
 
 VectorData operator-(const VectorData &lhs, float &rhs) {
   VectorData ret = lhs;
-  for (int i = 0; i < lhs.GetVlen(); i++) {
+  Data scalar;
+  scalar.fp32_data = rhs;
+  if (lhs.GetType() == FLOAT32 &&
+      LaneKernel(LaneOp::SUB, FLOAT32, lhs.m_data, scalar, ret.m_data,
+                 lhs.GetVlen()))
+    return ret;
+  for (uint32_t i = 0; i < lhs.GetVlen(); i++) {
     switch (lhs.GetType()) {
       case FLOAT32:
         ret.SetData(lhs.GetFloatData(i) - rhs, i);
@@ -706,7 +887,13 @@ VectorData operator-(const VectorData &lhs, float &rhs) {
 
 VectorData operator-(const VectorData &lhs, int32_t &rhs) {
   VectorData ret = lhs;
-  for (int i = 0; i < lhs.GetVlen(); i++) {
+  Data scalar;
+  scalar.int32_data = rhs;
+  if (lhs.GetType() == INT32 &&
+      LaneKernel(LaneOp::SUB, INT32, lhs.m_data, scalar, ret.m_data,
+                 lhs.GetVlen()))
+    return ret;
+  for (uint32_t i = 0; i < lhs.GetVlen(); i++) {
     switch (lhs.GetType()) {
       case FLOAT32:
         ret.SetData(static_cast<float>(lhs.GetFloatData(i) - rhs), i);
@@ -733,7 +920,7 @@ VectorData operator-(const VectorData &lhs, int32_t &rhs) {
 
 VectorData operator-(const float &lhs, VectorData &rhs) {
   VectorData ret = rhs;
-  for (int i = 0; i < rhs.GetVlen(); i++) {
+  for (uint32_t i = 0; i < rhs.GetVlen(); i++) {
     switch (rhs.GetType()) {
       case FLOAT32:
         ret.SetData(lhs - rhs.GetFloatData(i), i);
@@ -758,7 +945,7 @@ VectorData operator-(const float &lhs, VectorData &rhs) {
 
 VectorData operator-(const int32_t &lhs, VectorData &rhs) {
   VectorData ret = rhs;
-  for (int i = 0; i < rhs.GetVlen(); i++) {
+  for (uint32_t i = 0; i < rhs.GetVlen(); i++) {
     switch (rhs.GetType()) {
       case FLOAT32:
         ret.SetData(static_cast<float>(lhs - rhs.GetFloatData(i)), i);
@@ -789,8 +976,12 @@ VectorData operator*(const VectorData &lhs, VectorData &rhs) {
   VectorData ret = lhs;
   DataType lhs_type = lhs.GetType();
   DataType rhs_type = rhs.GetType();
+  if (lhs_type == rhs_type &&
+      LaneKernel(LaneOp::MUL, lhs_type, lhs.m_data, rhs.m_data, ret.m_data,
+                 lhs.GetVlen()))
+    return ret;
 
-  for (int i = 0; i < lhs.GetVlen(); i++) {
+  for (uint32_t i = 0; i < lhs.GetVlen(); i++) {
     if (lhs_type == FLOAT32) {
       if (rhs_type == FLOAT32) {
         ret.SetData(float(lhs.GetFloatData(i) * rhs.GetFloatData(i)), i);
@@ -844,7 +1035,13 @@ VectorData operator*(const VectorData &lhs, VectorData &rhs) {
 
 VectorData operator*(const VectorData &lhs, float &rhs) {
   VectorData ret = lhs;
-  for (int i = 0; i < lhs.GetVlen(); i++) {
+  Data scalar;
+  scalar.fp32_data = rhs;
+  if (lhs.GetType() == FLOAT32 &&
+      LaneKernel(LaneOp::MUL, FLOAT32, lhs.m_data, scalar, ret.m_data,
+                 lhs.GetVlen()))
+    return ret;
+  for (uint32_t i = 0; i < lhs.GetVlen(); i++) {
     switch (lhs.GetType()) {
       case FLOAT32:
         ret.SetData(lhs.GetFloatData(i) * rhs, i);
@@ -867,7 +1064,13 @@ VectorData operator*(const VectorData &lhs, float &rhs) {
 
 VectorData operator*(const VectorData &lhs, int32_t &rhs) {
   VectorData ret = lhs;
-  for (int i = 0; i < lhs.GetVlen(); i++) {
+  Data scalar;
+  scalar.int32_data = rhs;
+  if (lhs.GetType() == INT32 &&
+      LaneKernel(LaneOp::MUL, INT32, lhs.m_data, scalar, ret.m_data,
+                 lhs.GetVlen()))
+    return ret;
+  for (uint32_t i = 0; i < lhs.GetVlen(); i++) {
     switch (lhs.GetType()) {
       case FLOAT32:
         ret.SetData(lhs.GetFloatData(i) * rhs, i);
@@ -903,7 +1106,7 @@ VectorData operator/(const VectorData &lhs, VectorData &rhs) {
   DataType lhs_type = lhs.GetType();
   DataType rhs_type = rhs.GetType();
 
-  for (int i = 0; i < lhs.GetVlen(); i++) {
+  for (uint32_t i = 0; i < lhs.GetVlen(); i++) {
     if (lhs_type == FLOAT32) {
       if (rhs_type == FLOAT32) {
         ret.SetData(float(lhs.GetFloatData(i) / rhs.GetFloatData(i)), i);
@@ -956,7 +1159,7 @@ VectorData operator/(const VectorData &lhs, VectorData &rhs) {
 
 VectorData operator/(const VectorData &lhs, float &rhs) {
   VectorData ret = lhs;
-  for (int i = 0; i < lhs.GetVlen(); i++) {
+  for (uint32_t i = 0; i < lhs.GetVlen(); i++) {
     switch (lhs.GetType()) {
       case FLOAT32:
         ret.SetData(lhs.GetFloatData(i) / rhs, i);
@@ -979,7 +1182,7 @@ VectorData operator/(const VectorData &lhs, float &rhs) {
 
 VectorData operator/(float &lhs, const VectorData &rhs) {
   VectorData ret = rhs;
-  for (int i = 0; i < rhs.GetVlen(); i++) {
+  for (uint32_t i = 0; i < rhs.GetVlen(); i++) {
     switch (rhs.GetType()) {
       case FLOAT32:
         ret.SetData(lhs / rhs.GetFloatData(i), i);
@@ -1002,7 +1205,7 @@ VectorData operator/(float &lhs, const VectorData &rhs) {
 
 VectorData operator/(const VectorData &lhs, int32_t &rhs) {
   VectorData ret = lhs;
-  for (int i = 0; i < lhs.GetVlen(); i++) {
+  for (uint32_t i = 0; i < lhs.GetVlen(); i++) {
     switch (lhs.GetType()) {
       case FLOAT32:
         ret.SetData(lhs.GetFloatData(i) / rhs, i);
@@ -1,6 +1,8 @@
 #ifndef VECTOR_DATA_H
 #define VECTOR_DATA_H
 #include <half.hpp>
+#include <algorithm>
+#include <cstring>
 #include <vector>
 #include <ostream>
 
@@ -73,6 +75,91 @@ bool logical_operate(LogicalOp op, const T& lhs, const T& rhs) {
       return false;
   }
 };
+// Lane storage of VectorData. Registers up to lmul 4 (and widened lmul 2
+// registers) fit in the inline buffer so copying a VectorData does not touch
+// the heap; larger groups spill to a heap array. New entries are zeroed like
+// a value-initialized std::vector<Data>.
+class DataBuffer {
+ public:
+  static const uint32_t INLINE_CAPACITY = PACKET_ENTRIES * 4;
+
+  DataBuffer() {}
+  explicit DataBuffer(size_t size) { resize(size); }
+  DataBuffer(const DataBuffer &other) { assign(other.m_ptr, other.m_size); }
+  DataBuffer(DataBuffer &&other) noexcept { take(other); }
+  ~DataBuffer() { release(); }
+  DataBuffer &operator=(const DataBuffer &other) {
+    if (this != &other) assign(other.m_ptr, other.m_size);
+    return *this;
+  }
+  DataBuffer &operator=(DataBuffer &&other) noexcept {
+    if (this != &other) {
+      release();
+      take(other);
+    }
+    return *this;
+  }
+
+  size_t size() const { return m_size; }
+  Data *data() { return m_ptr; }
+  const Data *data() const { return m_ptr; }
+  Data *begin() { return m_ptr; }
+  const Data *begin() const { return m_ptr; }
+  Data *end() { return m_ptr + m_size; }
+  const Data *end() const { return m_ptr + m_size; }
+  Data &operator[](size_t index) { return m_ptr[index]; }
+  const Data &operator[](size_t index) const { return m_ptr[index]; }
+
+  void resize(size_t size) {
+    reserve(size);
+    if (size > m_size)
+      std::memset(m_ptr + m_size, 0, (size - m_size) * sizeof(Data));
+    m_size = size;
+  }
+  void push_back(const Data &data) {
+    if (m_size == m_capacity) reserve(m_capacity * 2);
+    m_ptr[m_size++] = data;
+  }
+
+ private:
+  void reserve(size_t capacity) {
+    if (capacity <= m_capacity) return;
+    Data *heap = new Data[capacity];
+    std::memcpy(heap, m_ptr, m_size * sizeof(Data));
+    release();
+    m_ptr = heap;
+    m_capacity = capacity;
+  }
+  void assign(const Data *data, size_t size) {
+    m_size = 0;
+    reserve(size);
+    std::memcpy(m_ptr, data, size * sizeof(Data));
+    m_size = size;
+  }
+  void release() {
+    if (m_ptr != m_inline) delete[] m_ptr;
+    m_ptr = m_inline;
+    m_capacity = INLINE_CAPACITY;
+  }
+  void take(DataBuffer &other) {
+    m_size = other.m_size;
+    if (other.m_ptr == other.m_inline) {
+      std::memcpy(m_inline, other.m_inline, m_size * sizeof(Data));
+    } else {
+      m_ptr = other.m_ptr;
+      m_capacity = other.m_capacity;
+      other.m_ptr = other.m_inline;
+      other.m_capacity = INLINE_CAPACITY;
+    }
+    other.m_size = 0;
+  }
+
+  Data m_inline[INLINE_CAPACITY];
+  Data *m_ptr = m_inline;
+  size_t m_size = 0;
+  size_t m_capacity = INLINE_CAPACITY;
+};
+
 class VectorData {
  public:
   VectorData();
@@ -108,6 +195,10 @@ class VectorData {
   uint32_t GetVlen() const;
   uint32_t GetPrecision() const;
   size_t GetVectorSize() { return m_data.size(); }
+  const Data* GetRawData() const { return m_data.data(); }
+  void SetRawData(const Data* data) {
+    std::copy(data, data + m_data.size(), m_data.begin());
+  }
   void Append(VectorData &rhs);
   std::array<VectorData, 2> Split();
   VectorData Max(VectorData &rhs);
@@ -147,7 +238,7 @@ class VectorData {
   DataType m_type = DataType::MAX_DataType;
   uint32_t m_vlen;
   bool m_double_reg = false;
-  std::vector<Data> m_data;
+  DataBuffer m_data;
 };
 }  // namespace NDPSim
 #endif
\ No newline at end of file
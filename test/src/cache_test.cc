@@ -0,0 +1,217 @@
+#ifdef TIMING_SIMULATION
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "cache.h"
+#include "m2ndp_config.h"
+#include "gtest/gtest.h"
+
+namespace NDPSim {
+
+static M2NDPConfig* make_cache_test_config() {
+  std::string path = "cache_test.config";
+  std::ofstream file(path);
+  file << "functional_sim=0\n";
+  file.close();
+  M2NDPConfig* config = new M2NDPConfig(path, 1);
+  std::remove(path.c_str());
+  return config;
+}
+
+// Exposes the replacement state the tests check
+class TestTagArray : public TagArray {
+ public:
+  using TagArray::TagArray;
+  using TagArray::m_line_policy;
+  using TagArray::m_psel;
+  using TagArray::m_rrpv;
+  using TagArray::m_shct;
+  using TagArray::PSEL_MAX;
+  using TagArray::RRPV_MAX;
+  using TagArray::SHCT_MAX;
+  using TagArray::SHCT_SIZE;
+};
+
+// 64 sets of 4 x 128B lines, allocate on fill, linear set index
+static const uint32_t NUM_SETS = 64;
+static const uint32_t NUM_WAYS = 4;
+static std::string cache_string(char evict_policy) {
+  return std::string("N:64:128:4,") + evict_policy + ":B:f:L:L,A:192:4,32:0,32";
+}
+
+static uint64_t line_addr(uint32_t set, uint64_t tag) {
+  return (tag * NUM_SETS + set) * 128;
+}
+
+// One demand read: the lookup, then the fill that a miss brings back
+static CacheRequestStatus read(TagArray& tags, uint32_t set, uint64_t tag,
+                               uint32_t signature = 0) {
+  static uint32_t time = 0;
+  uint64_t addr = line_addr(set, tag);
+  mem_fetch mf(addr, GLOBAL_ACC_R, READ_REQUEST, 32, 8, time);
+  mf.set_signature(signature);
+  uint32_t idx;
+  CacheRequestStatus status = tags.access(addr, time, idx, &mf);
+  if (status == MISS) tags.fill(addr, time, &mf);
+  time++;
+  return status;
+}
+
+static bool resident(TagArray& tags, uint32_t set, uint64_t tag) {
+  uint64_t addr = line_addr(set, tag);
+  mem_fetch mf(addr, GLOBAL_ACC_R, READ_REQUEST, 32, 8, 0);
+  uint32_t idx;
+  return tags.probe(addr, idx, &mf) == HIT;
+}
+
+static uint32_t line_index(TagArray& tags, uint32_t set, uint64_t tag) {
+  uint64_t addr = line_addr(set, tag);
+  mem_fetch mf(addr, GLOBAL_ACC_R, READ_REQUEST, 32, 8, 0);
+  uint32_t idx;
+  EXPECT_EQ(tags.probe(addr, idx, &mf), HIT);
+  return idx;
+}
+
+// SRRIP inserts at RRPV_MAX - 1 and promotes hits to 0; the victim is the
+// first line with the largest RRPV, and the set ages by what it took
+TEST(CacheSrripVictimTest, BasicAssertions) {
+  M2NDPConfig* config = make_cache_test_config();
+  CacheConfig cache_config;
+  cache_config.init(cache_string('S'), config);
+  TestTagArray tags(cache_config, 0, 0);
+  const int rrpv_max = TestTagArray::RRPV_MAX;
+
+  // Invalid ways fill from the top: lines 3, 2 and 1 sit in ways 0, 1, 2
+  for (uint64_t tag = 0; tag < NUM_WAYS; tag++)
+    ASSERT_EQ(read(tags, 0, tag), MISS);
+  EXPECT_EQ(read(tags, 0, 0), HIT);
+  EXPECT_EQ(tags.m_rrpv[line_index(tags, 0, 0)], 0);
+  EXPECT_EQ(tags.m_rrpv[line_index(tags, 0, 1)], rrpv_max - 1);
+
+  // Lines 1-3 tie at RRPV_MAX - 1; the lowest way goes and the rest age
+  ASSERT_EQ(read(tags, 0, 4), MISS);
+  EXPECT_FALSE(resident(tags, 0, 3));
+  EXPECT_TRUE(resident(tags, 0, 0));
+  EXPECT_EQ(tags.m_rrpv[line_index(tags, 0, 0)], 1);
+  EXPECT_EQ(tags.m_rrpv[line_index(tags, 0, 1)], rrpv_max);
+  EXPECT_EQ(tags.m_rrpv[line_index(tags, 0, 2)], rrpv_max);
+  EXPECT_EQ(tags.m_rrpv[line_index(tags, 0, 4)], rrpv_max - 1);
+
+  // Lines 1 and 2 reached RRPV_MAX, so the next miss takes line 2 in the
+  // lower way without aging the set
+  ASSERT_EQ(read(tags, 0, 5), MISS);
+  EXPECT_FALSE(resident(tags, 0, 2));
+  EXPECT_TRUE(resident(tags, 0, 1));
+  EXPECT_EQ(tags.m_rrpv[line_index(tags, 0, 0)], 1);
+  delete config;
+}
+
+// Misses in SRRIP leader sets (set % 32 == 0) move PSEL up and misses in
+// BRRIP leader sets (set % 32 == 1) move it down; follower sets insert with
+// the policy of the leaders that miss less
+TEST(CacheDrripPselTest, BasicAssertions) {
+  M2NDPConfig* config = make_cache_test_config();
+  CacheConfig cache_config;
+  cache_config.init(cache_string('D'), config);
+  TestTagArray tags(cache_config, 0, 0);
+  const uint32_t psel_max = TestTagArray::PSEL_MAX;
+  const uint32_t follower = 2;
+  uint64_t tag = 0;
+
+  uint32_t psel = tags.m_psel;
+  for (int i = 0; i < 10; i++) read(tags, 0, tag++);
+  EXPECT_EQ(tags.m_psel, psel + 10);
+  for (int i = 0; i < 4; i++) read(tags, 33, tag++);
+  EXPECT_EQ(tags.m_psel, psel + 6);
+  // Follower misses leave PSEL alone
+  read(tags, follower, tag);
+  EXPECT_EQ(tags.m_psel, psel + 6);
+  EXPECT_EQ(tags.m_line_policy[line_index(tags, follower, tag++)],
+            INSERT_BRRIP);
+  // Leaders keep their own policy whatever PSEL says
+  EXPECT_EQ(tags.m_line_policy[line_index(tags, 0, 9)], INSERT_SRRIP);
+  EXPECT_EQ(tags.m_line_policy[line_index(tags, 33, 13)], INSERT_BRRIP);
+
+  for (uint32_t i = 0; i < 2 * psel_max; i++) read(tags, 1, tag++);
+  EXPECT_EQ(tags.m_psel, 0);
+  read(tags, follower, tag);
+  EXPECT_EQ(tags.m_line_policy[line_index(tags, follower, tag++)],
+            INSERT_SRRIP);
+
+  for (uint32_t i = 0; i < 2 * psel_max; i++) read(tags, 32, tag++);
+  EXPECT_EQ(tags.m_psel, psel_max);
+  delete config;
+}
+
+// A line evicted without reuse trains its signature towards distant
+// insertion; every hit trains it back up to SHCT_MAX
+TEST(CacheShipShctTest, BasicAssertions) {
+  M2NDPConfig* config = make_cache_test_config();
+  CacheConfig cache_config;
+  cache_config.init(cache_string('H'), config);
+  TestTagArray tags(cache_config, 0, 0);
+  const int rrpv_max = TestTagArray::RRPV_MAX;
+  const int shct_max = TestTagArray::SHCT_MAX;
+  const size_t shct_size = TestTagArray::SHCT_SIZE;
+  const uint32_t streaming = 7, reused = 11, other = 9;
+
+  ASSERT_EQ(tags.m_shct.size(), shct_size);
+  EXPECT_EQ(tags.m_shct[streaming], 1);
+  for (uint64_t tag = 0; tag < NUM_WAYS; tag++)
+    read(tags, 0, tag, streaming);
+  EXPECT_EQ(tags.m_line_policy[line_index(tags, 0, 0)], INSERT_SHIP_NEAR);
+  read(tags, 0, NUM_WAYS, other);
+  EXPECT_EQ(tags.m_shct[streaming], 0);
+  EXPECT_EQ(tags.m_shct[other], 1);
+
+  // The next line of a signature that never hits comes in distant
+  read(tags, 1, 0, streaming);
+  uint32_t idx = line_index(tags, 1, 0);
+  EXPECT_EQ(tags.m_line_policy[idx], INSERT_SHIP_DISTANT);
+  EXPECT_EQ(tags.m_rrpv[idx], rrpv_max);
+
+  read(tags, 2, 0, reused);
+  for (int i = 0; i < 4; i++) EXPECT_EQ(read(tags, 2, 0, reused), HIT);
+  EXPECT_EQ(tags.m_shct[reused], shct_max);
+  // Reused lines do not train their signature down on eviction. Fresh
+  // signatures insert near, so the set ages until line 0 goes.
+  for (uint64_t tag = 1; tag <= 4 * NUM_WAYS; tag++)
+    read(tags, 2, tag, 100 + tag);
+  EXPECT_FALSE(resident(tags, 2, 0));
+  EXPECT_EQ(tags.m_shct[reused], shct_max);
+  EXPECT_EQ(tags.m_shct[101], 0);
+  delete config;
+}
+
+// Hits count toward the policy a line was inserted with, not the one its
+// set would use now
+TEST(CachePolicyStatsTest, BasicAssertions) {
+  M2NDPConfig* config = make_cache_test_config();
+  CacheConfig cache_config;
+  cache_config.init(cache_string('D'), config);
+  TestTagArray tags(cache_config, 0, 0);
+  CacheStats stats;
+  tags.set_policy_stats(&stats);
+  const uint32_t follower = 2;
+
+  // PSEL starts just above the midpoint, so followers insert with BRRIP
+  read(tags, follower, 0);
+  ASSERT_EQ(tags.m_line_policy[line_index(tags, follower, 0)], INSERT_BRRIP);
+  for (uint64_t tag = 100; tag < 110; tag++) read(tags, 1, tag);
+  ASSERT_EQ(read(tags, follower, 0), HIT);
+
+  FILE* out = tmpfile();
+  stats.print_stats(out, "L1D");
+  rewind(out);
+  std::string text;
+  char buf[256];
+  while (fgets(buf, sizeof(buf), out)) text += buf;
+  fclose(out);
+  EXPECT_NE(text.find("L1D[POLICY][BRRIP] hit 1 "), std::string::npos);
+  EXPECT_EQ(text.find("L1D[POLICY][SRRIP] hit 1 "), std::string::npos);
+  delete config;
+}
+
+}  // namespace NDPSim
+#endif
@@ -0,0 +1,155 @@
+#ifdef TIMING_SIMULATION
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "cache.h"
+#include "m2ndp_config.h"
+#include "ndp_stats.h"
+#include "gtest/gtest.h"
+
+namespace NDPSim {
+
+static M2NDPConfig* make_checkpoint_config() {
+  std::string path = "checkpoint_test.config";
+  std::ofstream file(path);
+  // core, dram, ndp, link, cache and buffer DRAM clocks in MHz
+  file << "functional_sim=0\n"
+       << "freq=2000,1600,1000,2000,1500,800\n";
+  file.close();
+  M2NDPConfig* config = new M2NDPConfig(path, 1);
+  std::remove(path.c_str());
+  return config;
+}
+
+// A restored run continues exactly like the run that wrote the checkpoint
+TEST(CheckpointClockTest, BasicAssertions) {
+  M2NDPConfig* continuous = make_checkpoint_config();
+  for (int i = 0; i < 1000; i++) continuous->cycle();
+  std::stringstream checkpoint;
+  continuous->save_clock_state(checkpoint);
+  M2NDPConfig* restored = make_checkpoint_config();
+  restored->load_clock_state(checkpoint);
+  ASSERT_EQ(restored->get_ndp_cycle(), continuous->get_ndp_cycle());
+  for (int i = 0; i < 1000; i++) {
+    continuous->cycle();
+    restored->cycle();
+    ASSERT_EQ(restored->get_ndp_cycle(), continuous->get_ndp_cycle());
+    ASSERT_EQ(restored->is_buffer_ndp_cycle(),
+              continuous->is_buffer_ndp_cycle());
+    ASSERT_EQ(restored->is_buffer_dram_cycle(),
+              continuous->is_buffer_dram_cycle());
+    ASSERT_EQ(restored->is_link_cycle(), continuous->is_link_cycle());
+    ASSERT_EQ(restored->is_cache_cycle(), continuous->is_cache_cycle());
+  }
+  delete continuous;
+  delete restored;
+}
+
+// Clock state without the mask of the current tick
+static std::string clock_state(M2NDPConfig* config) {
+  std::stringstream state;
+  config->save_clock_state(state);
+  return state.str().erase(2 * sizeof(uint64_t), sizeof(unsigned));
+}
+
+// Skipping lands where a run that ticks every cycle is right before the
+// first BUFFER_NDP or BUFFER_DRAM tick past the limits
+TEST(CheckpointClockSkipTest, BasicAssertions) {
+  M2NDPConfig* continuous = make_checkpoint_config();
+  M2NDPConfig* skipped = make_checkpoint_config();
+  std::vector<std::pair<uint64_t, uint64_t>> limits = {
+      {0, 5}, {7, 0}, {100, 3}, {3, 100}, {1000, UINT64_MAX}, {UINT64_MAX, 999}};
+  for (auto limit : limits) {
+    uint64_t ndp_cycles, dram_cycles;
+    skipped->skip_cycles(limit.first, limit.second, &ndp_cycles, &dram_cycles);
+    ASSERT_TRUE(ndp_cycles == limit.first || dram_cycles == limit.second);
+    uint64_t ndp = 0, dram = 0;
+    while (clock_state(continuous) != clock_state(skipped)) {
+      continuous->cycle();
+      ndp += continuous->is_buffer_ndp_cycle();
+      dram += continuous->is_buffer_dram_cycle();
+      ASSERT_LE(ndp, ndp_cycles);
+      ASSERT_LE(dram, dram_cycles);
+    }
+    ASSERT_EQ(ndp, ndp_cycles);
+    ASSERT_EQ(dram, dram_cycles);
+    continuous->cycle();
+    skipped->cycle();
+    ASSERT_TRUE((continuous->is_buffer_ndp_cycle() && ndp == limit.first) ||
+                (continuous->is_buffer_dram_cycle() && dram == limit.second));
+    ASSERT_EQ(clock_state(skipped), clock_state(continuous));
+  }
+  delete continuous;
+  delete skipped;
+}
+
+// Same access stream into a tag array that ran it all, and into one restored
+// from a checkpoint taken halfway: every hit, miss and victim must agree
+static void check_tag_restore(const std::string& cache_config) {
+  M2NDPConfig* config = make_checkpoint_config();
+  CacheConfig continuous_config, restored_config;
+  continuous_config.init(cache_config, config);
+  restored_config.init(cache_config, config);
+  TagArray continuous(continuous_config, 0, 0);
+  TagArray restored(restored_config, 0, 0);
+  uint64_t state = 12345;
+  auto next_addr = [&]() {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    // Around twice the cache capacity, with some reuse
+    return (state >> 33) % (2 * 64 * 16) * 128 + (state >> 20) % 4 * 32;
+  };
+  auto touch = [](TagArray& tags, uint64_t addr, uint32_t time,
+                  uint32_t& idx) {
+    SectorMask mask;
+    mask.set(addr % MAX_MEMORY_ACCESS_SIZE / MEM_ACCESS_SIZE);
+    CacheRequestStatus status = tags.probe(addr, idx, mask);
+    tags.fill(addr, time, mask, addr / 4096);
+    return status;
+  };
+  uint32_t time = 0, idx, restored_idx;
+  for (; time < 5000; time++) touch(continuous, next_addr(), time, idx);
+  std::stringstream checkpoint;
+  continuous.save(checkpoint);
+  restored.load(checkpoint);
+  for (; time < 10000; time++) {
+    uint64_t addr = next_addr();
+    CacheRequestStatus status = touch(continuous, addr, time, idx);
+    ASSERT_EQ(touch(restored, addr, time, restored_idx), status);
+    ASSERT_EQ(restored_idx, idx);
+  }
+  delete config;
+}
+
+TEST(CheckpointTagArrayTest, BasicAssertions) {
+  check_tag_restore("S:64:128:16,L:B:m:L:L,A:192:4,32:0,32");
+  check_tag_restore("N:64:128:16,D:B:m:L:L,A:192:4,32:0,32");
+  check_tag_restore("N:64:128:16,H:B:m:L:L,A:192:4,32:0,32");
+}
+
+// Statistics written to a checkpoint come back unchanged
+TEST(CheckpointStatsTest, BasicAssertions) {
+  CacheStats cache_stats;
+  cache_stats.inc_stats(GLOBAL_ACC_R, HIT);
+  cache_stats.inc_stats(GLOBAL_ACC_R, MISS);
+  cache_stats.inc_stats(GLOBAL_ACC_W, MISS);
+  NdpStats ndp_stats;
+  ndp_stats.inc_i_unit_issue_count();
+  ndp_stats.add_atomic_status(ATOMIC_L2_MISS, 3);
+  std::stringstream checkpoint;
+  cache_stats.save(checkpoint);
+  ndp_stats.save(checkpoint);
+  CacheStats restored_cache_stats;
+  NdpStats restored_ndp_stats;
+  restored_cache_stats.load(checkpoint);
+  restored_ndp_stats.load(checkpoint);
+  EXPECT_EQ(restored_cache_stats.get_hit(), 1);
+  EXPECT_EQ(restored_cache_stats.get_miss(), 2);
+  EXPECT_EQ(restored_ndp_stats.get_i_unit_issue_count(), 1);
+  EXPECT_EQ(restored_ndp_stats.get_atomic_status(ATOMIC_L2_MISS), 3);
+}
+
+}  // namespace NDPSim
+#endif
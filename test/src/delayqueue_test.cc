@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "delayqueue.h"
+#ifdef TIMING_SIMULATION
+#include "delay_queue.h"
+#endif
+#include "gtest/gtest.h"
+
+namespace NDPSim {
+
+TEST(FifoPipelineWrapTest, BasicAssertions) {
+  fifo_pipeline<int> fifo("wrap", 0, 3);
+  int values[8];
+  for (int i = 0; i < 8; i++) values[i] = i;
+  ASSERT_TRUE(fifo.empty());
+  ASSERT_EQ(fifo.pop(), nullptr);
+  // Interleave pushes and pops so the ring wraps several times
+  int next_pop = 0;
+  for (int i = 0; i < 8; i++) {
+    if (fifo.full()) {
+      ASSERT_EQ(*fifo.pop(), next_pop++);
+    }
+    fifo.push(&values[i]);
+  }
+  ASSERT_TRUE(fifo.full());
+  ASSERT_EQ(fifo.get_n_element(), 3);
+  while (!fifo.empty()) {
+    ASSERT_EQ(*fifo.top(), next_pop);
+    ASSERT_EQ(*fifo.pop(), next_pop++);
+  }
+  ASSERT_EQ(next_pop, 8);
+}
+
+TEST(FifoPipelineMinLenTest, BasicAssertions) {
+  fifo_pipeline<int> fifo("delay", 2, 8);
+  int value = 42;
+  ASSERT_EQ(fifo.get_length(), 2);
+  ASSERT_EQ(fifo.top(), nullptr);
+  fifo.push(&value);
+  // The element replaces the tail bubble and leaves after min_len pops
+  ASSERT_EQ(fifo.get_length(), 2);
+  ASSERT_EQ(fifo.pop(), nullptr);
+  ASSERT_EQ(fifo.pop(), &value);
+  ASSERT_EQ(fifo.get_length(), 2);
+  ASSERT_EQ(fifo.top(), nullptr);
+}
+
+TEST(FifoPipelineEmplaceTest, BasicAssertions) {
+  fifo_pipeline<std::pair<std::string, int>> fifo("emplace", 0, 2);
+  std::string name(64, 'a');
+  fifo.emplace({std::move(name), 1});
+  fifo.emplace({std::string(64, 'b'), 2});
+  ASSERT_TRUE(fifo.full());
+  std::pair<std::string, int>* front = fifo.pop();
+  ASSERT_EQ(front->first, std::string(64, 'a'));
+  ASSERT_EQ(front->second, 1);
+  // A copy of the queue owns its own payloads
+  fifo_pipeline<std::pair<std::string, int>> copy = fifo;
+  fifo.emplace({std::string(64, 'c'), 3});
+  ASSERT_EQ(copy.top()->second, 2);
+  ASSERT_EQ(fifo.pop()->second, 2);
+  ASSERT_EQ(fifo.pop()->first, std::string(64, 'c'));
+  ASSERT_TRUE(fifo.empty());
+}
+
+#ifdef TIMING_SIMULATION
+typedef DelayQueue<RequestInfo*> InfoQueue;
+
+// Pushes one entry per delay at cycle now, then ticks until all have left.
+// Returns the finish cycle of each entry in pop order.
+static std::vector<uint64_t> drain(InfoQueue& queue, uint64_t now,
+                                   const std::vector<int>& delays) {
+  std::vector<RequestInfo> infos(delays.size());
+  for (size_t i = 0; i < delays.size(); i++) {
+    infos[i].addr = now + delays[i];
+    queue.push(&infos[i], delays[i]);
+  }
+  std::vector<uint64_t> finishes;
+  while (!queue.queue_empty()) {
+    while (!queue.empty()) {
+      uint64_t finish = queue.top()->addr;
+      EXPECT_LE(finish, now);
+      queue.pop();
+      finishes.push_back(finish);
+    }
+    queue.cycle();
+    now++;
+  }
+  return finishes;
+}
+
+static void tick(InfoQueue& queue, int cycles) {
+  for (int i = 0; i < cycles; i++) queue.cycle();
+}
+
+// The default queue pops in push order; the wheel pops by finish cycle
+TEST(DelayQueueOrderTest, BasicAssertions) {
+  InfoQueue fifo("fifo", true, -1);
+  InfoQueue wheel("wheel", true, -1, true);
+  std::vector<uint64_t> in_order = drain(fifo, 0, {10, 2, 10});
+  ASSERT_EQ(in_order, std::vector<uint64_t>({10, 2, 10}));
+  // The short entry waited behind the long one
+  std::vector<uint64_t> by_finish = drain(wheel, 0, {10, 2, 10});
+  ASSERT_EQ(by_finish, std::vector<uint64_t>({2, 10, 10}));
+}
+
+// Delays within the lower wheel, the upper wheel and the overflow list
+TEST(DelayQueueWheelLongDelayTest, BasicAssertions) {
+  InfoQueue wheel("wheel", true, -1, true);
+  std::vector<int> delays = {70000, 5000, 4096, 4095, 64, 63, 1, 0, 100};
+  std::vector<uint64_t> finishes = drain(wheel, 0, delays);
+  std::vector<uint64_t> expected(delays.begin(), delays.end());
+  std::sort(expected.begin(), expected.end());
+  ASSERT_EQ(finishes, expected);
+}
+
+// Entries pushed just before the lower and upper wheels wrap
+TEST(DelayQueueWheelWraparoundTest, BasicAssertions) {
+  InfoQueue wheel("wheel", true, -1, true);
+  uint64_t now = 0;
+  for (uint64_t start : {60, 2 * 4096 - 6, 4 * 4096 - 1, 64 * 4096 - 3}) {
+    tick(wheel, start - now);
+    now = start;
+    std::vector<uint64_t> finishes = drain(wheel, now, {1, 2, 6, 7, 70, 4100});
+    ASSERT_EQ(finishes, std::vector<uint64_t>({now + 1, now + 2, now + 6,
+                                               now + 7, now + 70, now + 4100}));
+    now += 4100 + 1;  // drain() ticks once past the last pop
+  }
+}
+
+// An idle queue may skip cycle(); latencies count from the push
+TEST(DelayQueueIdleSkipTest, BasicAssertions) {
+  for (bool timing_wheel : {false, true}) {
+    InfoQueue queue("unit", false, -1, timing_wheel);
+    RequestInfo info;
+    ASSERT_TRUE(queue.idle());
+    queue.push(&info, 3, 2);
+    ASSERT_FALSE(queue.idle());
+    ASSERT_TRUE(queue.full());
+    tick(queue, 2);
+    ASSERT_FALSE(queue.full());
+    ASSERT_TRUE(queue.empty());
+    tick(queue, 1);
+    ASSERT_EQ(queue.top(), &info);
+    queue.pop();
+    ASSERT_TRUE(queue.idle());
+    // Skipped ticks: the owner stops calling cycle() while idle
+    queue.push(&info, 5, 1);
+    tick(queue, 4);
+    ASSERT_TRUE(queue.empty());
+    tick(queue, 1);
+    ASSERT_FALSE(queue.empty());
+  }
+}
+#endif
+}  // namespace NDPSim
@@ -0,0 +1,184 @@
+#ifdef TIMING_SIMULATION
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#include "execution_unit.h"
+#include "m2ndp_config.h"
+#include "memory_map.h"
+#include "register_unit.h"
+#include "gtest/gtest.h"
+
+namespace NDPSim {
+
+static M2NDPConfig* make_test_config(const std::string& extra = "") {
+  std::string path = "execution_unit_test.config";
+  std::ofstream file(path);
+  file << extra
+       << "functional_sim=1\n"
+       << "packet_size=32\n"
+       << "ndp_op_latencies=4,4,4,4,21,4,4,4,4,39,21,12,12,1,4\n"
+       << "ndp_op_initialiation_interval=1,1,1,1,1,1,1,1,1,2,8,8,8,1,1\n"
+       << "num_i_units=1\nnum_f_units=1\nnum_sf_units=1\n"
+       << "num_address_units=1\nnum_v_i_units=1\nnum_v_f_units=1\n"
+       << "num_v_sf_units=1\nnum_v_address_units=1\n";
+  file.close();
+  M2NDPConfig* config = new M2NDPConfig(path, 1);
+  std::remove(path.c_str());
+  return config;
+}
+
+// One NDP unit's worth of execution state around an ExecutionUnit
+struct TestExecutionUnit {
+  TestExecutionUnit(M2NDPConfig* config, int id)
+      : register_unit(32, 32, 32),
+        unit(config, id, 0, &register_unit, &finished_contexts, &to_ldst,
+             &to_spad, &to_v_ldst, &to_v_spad, &stats) {}
+  RegisterUnit register_unit;
+  NdpStats stats;
+  std::queue<Context> finished_contexts;
+  fifo_pipeline<std::pair<NdpInstruction, Context>> to_ldst;
+  fifo_pipeline<std::pair<NdpInstruction, Context>> to_spad;
+  fifo_pipeline<std::pair<NdpInstruction, Context>> to_v_ldst;
+  fifo_pipeline<std::pair<NdpInstruction, Context>> to_v_spad;
+  CSR csr;
+  RequestInfo request_info;
+  WriteLog write_log;
+  ExecutionUnit unit;
+};
+
+// famoadd.w of value to addr, issued on unit; returns the issue status.
+// With defer, the AMO goes to the unit's write log.
+static Status issue_famoadd(TestExecutionUnit& test_unit, MemoryMap* map,
+                            uint64_t addr, float value, bool defer) {
+  Context context;
+  context.ndp_id = 0;
+  context.sub_core_id = 0;
+  context.csr = &test_unit.csr;
+  context.memory_map = map;
+  context.scratchpad_map = NULL;
+  context.register_map = &test_unit.register_unit;
+  context.request_info = &test_unit.request_info;
+  context.last_inst = false;
+  context.exit = false;
+  context.write_log = defer ? &test_unit.write_log : NULL;
+  test_unit.register_unit.WriteXreg(REG_PX_BASE, 0, context);
+  test_unit.register_unit.WriteXreg(REG_PX_BASE + 1, addr, context);
+  test_unit.register_unit.WriteFreg(REG_PF_BASE, value, context);
+  NdpInstruction inst;
+  inst.opcode = FAMOADD;
+  inst.operand_type = W;
+  inst.src[0] = REG_PX_BASE;
+  inst.src[1] = REG_PF_BASE;
+  inst.src[2] = REG_PX_BASE + 1;
+  inst.src[3] = -1;
+  inst.dest = REG_PF_BASE + 1;
+  return test_unit.unit.issue(inst, context);
+}
+
+static void store_zero(MemoryMap& map, uint64_t addr) {
+  VectorData zero(32, 1);
+  zero.SetType(FLOAT32);
+  for (uint32_t i = 0; i < PACKET_SIZE / WORD_SIZE; i++) zero.SetData(0.0f, i);
+  map.Store(addr, zero);
+}
+
+// Units ticked serially write global memory at issue, so the next unit
+// ticked in the same cycle sees the update
+TEST(ExecutionUnitSerialWriteTest, BasicAssertions) {
+  M2NDPConfig* config = make_test_config();
+  const uint64_t addr = 0x1000;
+  HashMemoryMap map(0, 0x10000);
+  store_zero(map, addr);
+  TestExecutionUnit first(config, 0), second(config, 1);
+  ASSERT_EQ(issue_famoadd(first, &map, addr, 2.0f, false), ISSUE_SUCCESS);
+  EXPECT_EQ(map.Load(addr).GetFloatData(0), 2.0f);
+  ASSERT_EQ(issue_famoadd(second, &map, addr, 3.0f, false), ISSUE_SUCCESS);
+  EXPECT_EQ(map.Load(addr).GetFloatData(0), 5.0f);
+  EXPECT_TRUE(first.write_log.Empty());
+  delete config;
+}
+
+// Three units add to the same float in one cycle. Float addition does not
+// associate, so the sum depends on the order the AMOs are applied in; it must
+// follow unit id order whatever order the units were ticked in.
+TEST(ExecutionUnitAmoDeterminismTest, BasicAssertions) {
+  M2NDPConfig* config = make_test_config();
+  const uint64_t addr = 0x1000;
+  const float values[3] = {1.0f, 1e8f, -1e8f};
+  std::vector<int> order = {0, 1, 2};
+  std::vector<float> results;
+  do {
+    HashMemoryMap map(0, 0x10000);
+    store_zero(map, addr);
+    std::vector<TestExecutionUnit*> units;
+    for (int id = 0; id < 3; id++)
+      units.push_back(new TestExecutionUnit(config, id));
+    for (int id : order)
+      ASSERT_EQ(issue_famoadd(*units[id], &map, addr, values[id], true),
+                ISSUE_SUCCESS);
+    // Nothing is visible before the commit
+    ASSERT_EQ(map.Load(addr).GetFloatData(0), 0.0f);
+    for (int id = 0; id < 3; id++) units[id]->write_log.Apply();
+    results.push_back(map.Load(addr).GetFloatData(0));
+    for (auto unit : units) delete unit;
+  } while (std::next_permutation(order.begin(), order.end()));
+
+  float serial = 0.0f;
+  for (float value : values) serial += value;
+  for (float result : results) ASSERT_EQ(result, serial);
+  delete config;
+}
+
+// Requests after coalescing the element addresses of one indexed access,
+// and the "before, after" requests per instruction that the stats report
+static std::vector<uint64_t> coalesce(int window, bool reorder,
+                                      const std::vector<uint64_t>& elements,
+                                      std::string& counts) {
+  M2NDPConfig* config = make_test_config(
+      "indexed_coalesce_window=" + std::to_string(window) +
+      "\nindexed_coalesce_reorder=" + std::to_string(reorder) + "\n");
+  TestExecutionUnit test_unit(config, 0);
+  NdpInstruction inst;
+  test_unit.unit.coalesce_indexed(inst, elements);
+
+  FILE* out = tmpfile();
+  test_unit.stats.print_stats(out);
+  rewind(out);
+  char buf[256];
+  counts.clear();
+  while (fgets(buf, sizeof(buf), out)) {
+    std::string line = buf;
+    size_t pos = line.find("requests per inst: ");
+    if (pos != std::string::npos) counts = line.substr(pos + 19);
+  }
+  fclose(out);
+  delete config;
+  return std::vector<uint64_t>(inst.addr_set.begin(), inst.addr_set.end());
+}
+
+// Repeated packets merge anywhere in a window when reordering is allowed
+// and only within runs of consecutive elements otherwise; requests never
+// merge across windows
+TEST(ExecutionUnitCoalesceIndexedTest, BasicAssertions) {
+  const uint64_t a = 0x1000, b = 0x1020, c = 0x2000;
+  const std::vector<uint64_t> elements = {a, b, a, a, c, b, b, a};
+  std::string counts;
+
+  EXPECT_EQ(coalesce(0, true, elements, counts),
+            std::vector<uint64_t>({a, b, c}));
+  EXPECT_EQ(counts, "8.00 before, 3.00 after coalescing\n");
+  EXPECT_EQ(coalesce(0, false, elements, counts),
+            std::vector<uint64_t>({a, a, a, b, b, c}));
+  EXPECT_EQ(counts, "8.00 before, 6.00 after coalescing\n");
+  // Windows {a, b, a} {a, c, b} {b, a}
+  EXPECT_EQ(coalesce(3, true, elements, counts),
+            std::vector<uint64_t>({a, a, a, b, b, b, c}));
+  EXPECT_EQ(counts, "8.00 before, 7.00 after coalescing\n");
+  EXPECT_EQ(coalesce(3, false, elements, counts),
+            std::vector<uint64_t>({a, a, a, a, b, b, b, c}));
+  EXPECT_EQ(counts, "8.00 before, 8.00 after coalescing\n");
+}
+
+}  // namespace NDPSim
+#endif
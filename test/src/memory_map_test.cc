@@ -0,0 +1,113 @@
+#include "common.h"
+#include "memory_map.h"
+#include "gtest/gtest.h"
+
+namespace NDPSim {
+
+TEST(PagedMemoryMapStoreLoadTest, BasicAssertions) {
+  PagedMemoryMap memory_map;
+  VectorData data(32, 1);
+  for (int i = 0; i < PACKET_SIZE / 4; i++) {
+    data.SetData(i * 3, i);
+  }
+  uint64_t addr = 0x800000000000;
+  ASSERT_FALSE(memory_map.CheckAddr(addr));
+  memory_map.Store(addr, data);
+  ASSERT_TRUE(memory_map.CheckAddr(addr));
+  ASSERT_FALSE(memory_map.CheckAddr(addr + PACKET_SIZE));
+
+  VectorData loaded = memory_map.Load(addr);
+  ASSERT_EQ(loaded.GetType(), INT32);
+  ASSERT_EQ(loaded.GetVlen(), data.GetVlen());
+  for (int i = 0; i < PACKET_SIZE / 4; i++) {
+    ASSERT_EQ(loaded.GetIntData(i), i * 3);
+  }
+}
+
+TEST(PagedMemoryMapTypeTest, BasicAssertions) {
+  PagedMemoryMap memory_map;
+  VectorData data(64, 1);
+  data.SetType(INT64);
+  data.SetData((int64_t)-5, 0);
+  data.SetData((int64_t)1 << 40, 1);
+  // Different pages and regions
+  memory_map.Store(0x800000000000, data);
+  memory_map.Store(0x800000000000 + PagedMemoryMap::PAGE_SIZE, data);
+  memory_map.Store(0x900000000000, data);
+
+  VectorData loaded = memory_map.Load(0x800000000000 + PagedMemoryMap::PAGE_SIZE);
+  ASSERT_EQ(loaded.GetType(), INT64);
+  ASSERT_EQ(loaded.GetVlen(), 4);
+  ASSERT_EQ(loaded.GetLongData(0), -5);
+  ASSERT_EQ(loaded.GetLongData(1), (int64_t)1 << 40);
+  ASSERT_THROW(memory_map.Load(0xa00000000000), std::runtime_error);
+}
+
+TEST(PagedMemoryMapMatchTest, BasicAssertions) {
+  PagedMemoryMap memory_map;
+  HashMemoryMap target_map(0, UINT64_MAX);
+  VectorData data(32, 1);
+  for (int i = 0; i < PACKET_SIZE / 4; i++) {
+    data.SetData((float)i, i);
+  }
+  memory_map.Store(0x800000000000, data);
+  target_map.Store(0x800000000000, data);
+  ASSERT_TRUE(target_map.Match(memory_map));
+  ASSERT_TRUE(memory_map.Match(target_map));
+
+  data.SetData(100.0f, 0);
+  memory_map.Store(0x800000000000, data);
+  ASSERT_FALSE(target_map.Match(memory_map));
+}
+
+TEST(PagedMemoryMapImageTest, BasicAssertions) {
+  PagedMemoryMap memory_map;
+  VectorData data(32, 1);
+  for (int i = 0; i < PACKET_SIZE / 4; i++) {
+    data.SetData((float)i / 2, i);
+  }
+  memory_map.Store(0x800000000000, data);
+  memory_map.Store(0x810000000020, data);
+  std::string image_path = testing::TempDir() + "memory_map_test.mimg";
+  ASSERT_TRUE(memory_map.SaveImage(image_path));
+  ASSERT_TRUE(PagedMemoryMap::IsMemoryImage(image_path));
+
+  PagedMemoryMap image(image_path);
+  ASSERT_TRUE(image.CheckAddr(0x810000000020));
+  ASSERT_FALSE(image.CheckAddr(0x810000000000));
+  ASSERT_TRUE(memory_map.Match(image));
+  // Stores to a mapped image stay private to the process
+  data.SetData(7.0f, 0);
+  image.Store(0x800000000000, data);
+  ASSERT_FALSE(memory_map.Match(image));
+  PagedMemoryMap reloaded(image_path);
+  ASSERT_TRUE(memory_map.Match(reloaded));
+
+  // An image has no slot for a double-width packet
+  PagedMemoryMap oversized;
+  oversized.Store(0x800000000000, VectorData(32, 2));
+  ASSERT_FALSE(oversized.SaveImage(image_path + ".oversized"));
+}
+TEST(TracingMemoryMapTest, BasicAssertions) {
+  PagedMemoryMap memory_map;
+  TracingMemoryMap tracing(&memory_map);
+  VectorData data(32, 1);
+  for (int i = 0; i < PACKET_SIZE / 4; i++) data.SetData(i, i);
+  uint64_t addr = 0x800000000000;
+  tracing.Store(addr + 4, data);
+  ASSERT_TRUE(tracing.CheckAddr(addr));
+  ASSERT_EQ(tracing.Load(addr + PACKET_SIZE - 4).GetIntData(1), 1);
+  // Forwarded to the wrapped map; CheckAddr is not an access
+  ASSERT_TRUE(memory_map.CheckAddr(addr));
+  const std::vector<TracingMemoryMap::Access>& accesses =
+      tracing.GetAccesses();
+  ASSERT_EQ(accesses.size(), 2u);
+  EXPECT_EQ(accesses[0].addr, addr);
+  EXPECT_TRUE(accesses[0].write);
+  EXPECT_EQ(accesses[1].addr, addr);
+  EXPECT_FALSE(accesses[1].write);
+  tracing.ClearAccesses();
+  EXPECT_TRUE(tracing.GetAccesses().empty());
+}
+
+}  // namespace NDPSim
@@ -1,4 +1,5 @@
 #include "common.h"
+#include "memory_map.h"
 #include "ndp_instruction.h"
 #include "register_unit.h"
 #include "gtest/gtest.h"
@@ -104,4 +105,111 @@ TEST(NdpInstructionVectorExponentTest, BasicAssertions) {
     ASSERT_EQ(v3.GetIntData(i), std::exp(i));
   }
 }
+
+// famoadd.w of value to addr with the result in REG_PF_BASE + 1
+static void famoadd(Context& context, uint64_t addr, float value) {
+  context.register_map->WriteXreg(REG_PX_BASE, 0, context);
+  context.register_map->WriteXreg(REG_PX_BASE + 1, addr, context);
+  context.register_map->WriteFreg(REG_PF_BASE, value, context);
+  NdpInstruction inst;
+  inst.opcode = FAMOADD;
+  inst.operand_type = W;
+  inst.src[0] = REG_PX_BASE;
+  inst.src[1] = REG_PF_BASE;
+  inst.src[2] = REG_PX_BASE + 1;
+  inst.dest = REG_PF_BASE + 1;
+  inst.Execute(context);
+}
+
+static void store_zero(MemoryMap& map, uint64_t addr) {
+  VectorData zero(32, 1);
+  zero.SetType(FLOAT32);
+  for (uint32_t i = 0; i < PACKET_SIZE / WORD_SIZE; i++) zero.SetData(0.0f, i);
+  map.Store(addr, zero);
+}
+
+// Units running in parallel record their global writes; applying the logs in
+// unit id order gives the serial result whatever order the units ran in.
+TEST(NdpInstructionWriteLogTest, BasicAssertions) {
+  const uint64_t addr = 0x1000;
+  const float values[3] = {1.0f, 1e8f, -1e8f};
+  HashMemoryMap map(0, 0x10000);
+  store_zero(map, addr);
+  WriteLog logs[3];
+  for (int id = 2; id >= 0; id--) {
+    Context context = make_basic_context();
+    context.memory_map = &map;
+    context.write_log = &logs[id];
+    famoadd(context, addr, values[id]);
+    // The destination gets this unit's view of memory
+    ASSERT_EQ(context.register_map->ReadFreg(REG_PF_BASE + 1, context),
+              values[id]);
+  }
+  ASSERT_EQ(map.Load(addr).GetFloatData(0), 0.0f);
+  for (int id = 0; id < 3; id++) logs[id].Apply();
+  float serial = 0.0f;
+  for (float value : values) serial += value;
+  ASSERT_EQ(map.Load(addr).GetFloatData(0), serial);
+}
+
+// A unit reads its own pending writes back: AMO results and later loads see
+// them in execution order, as they would without the log
+TEST(NdpInstructionWriteLogOwnWritesTest, BasicAssertions) {
+  const uint64_t addr = 0x1000, fresh = 0x2000;
+  HashMemoryMap map(0, 0x10000);
+  store_zero(map, addr);
+  WriteLog log;
+  Context context = make_basic_context();
+  context.memory_map = &map;
+  context.write_log = &log;
+  famoadd(context, addr, 2.0f);
+  famoadd(context, addr, 3.0f);
+  EXPECT_EQ(context.register_map->ReadFreg(REG_PF_BASE + 1, context), 5.0f);
+  famoadd(context, fresh, 4.0f);
+  ASSERT_TRUE(log.Pending(fresh));
+  EXPECT_EQ(log.Load(&map, fresh).GetFloatData(0), 4.0f);
+
+  // A store replaces the pending sum and a later AMO adds to the store
+  VectorData packet = log.Load(&map, addr);
+  packet.SetData(10.0f, 0);
+  log.RecordStore(&map, addr, packet);
+  famoadd(context, addr, 1.0f);
+  EXPECT_EQ(context.register_map->ReadFreg(REG_PF_BASE + 1, context), 11.0f);
+  EXPECT_FALSE(map.CheckAddr(fresh));
+  EXPECT_EQ(map.Load(addr).GetFloatData(0), 0.0f);
+
+  log.Apply();
+  EXPECT_FALSE(log.Pending(addr));
+  EXPECT_EQ(map.Load(addr).GetFloatData(0), 11.0f);
+  EXPECT_EQ(map.Load(fresh).GetFloatData(0), 4.0f);
+}
+
+// insert drops repeated addresses and append keeps them; both keep the set
+// sorted, also once it outgrows the inline buffer and is copied or moved
+TEST(NdpInstructionAddrSetTest, BasicAssertions) {
+  AddrSet set;
+  set.insert(0x40);
+  set.insert(0x20);
+  set.insert(0x40);
+  EXPECT_EQ(std::vector<uint64_t>(set.begin(), set.end()),
+            std::vector<uint64_t>({0x20, 0x40}));
+  set.append(0x40);
+  set.append(0x00);
+  EXPECT_EQ(std::vector<uint64_t>(set.begin(), set.end()),
+            std::vector<uint64_t>({0x00, 0x20, 0x40, 0x40}));
+
+  std::vector<uint64_t> expected(set.begin(), set.end());
+  for (uint64_t i = 0; i < AddrSet::INLINE_CAPACITY; i++) {
+    uint64_t addr = (i % 3) * 0x20;
+    set.append(addr);
+    expected.insert(std::upper_bound(expected.begin(), expected.end(), addr),
+                    addr);
+  }
+  EXPECT_EQ(std::vector<uint64_t>(set.begin(), set.end()), expected);
+  AddrSet copy(set);
+  AddrSet moved(std::move(set));
+  EXPECT_TRUE(set.empty());
+  EXPECT_EQ(std::vector<uint64_t>(copy.begin(), copy.end()), expected);
+  EXPECT_EQ(std::vector<uint64_t>(moved.begin(), moved.end()), expected);
+}
 }
\ No newline at end of file
@@ -0,0 +1,77 @@
+#ifdef TIMING_SIMULATION
+#include "prefetcher.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace NDPSim {
+
+static M2NDPConfig* make_prefetcher_test_config() {
+  std::string path = "prefetcher_test.config";
+  std::ofstream file(path);
+  file << "functional_sim=0\n";
+  file.close();
+  M2NDPConfig* config = new M2NDPConfig(path, 1);
+  std::remove(path.c_str());
+  return config;
+}
+
+static const uint64_t LINE_SIZE = 128;
+
+// The lines behind every queued candidate, in order and without repeats
+static std::vector<uint64_t> drain_lines(Prefetcher& prefetcher) {
+  std::vector<uint64_t> lines;
+  while (prefetcher.has_candidate()) {
+    uint64_t line = prefetcher.top_candidate() / LINE_SIZE;
+    if (lines.empty() || lines.back() != line) lines.push_back(line);
+    prefetcher.pop_candidate();
+  }
+  return lines;
+}
+
+// A stream skips the lines the cache already holds
+TEST(PrefetcherResidentTest, BasicAssertions) {
+  M2NDPConfig* config = make_prefetcher_test_config();
+  CacheConfig cache_config;
+  cache_config.init("N:64:128:4,L:B:f:L:L,A:192:4,32:0,32", config);
+  fifo_pipeline<mem_fetch> to_mem("to_mem", 0, 8);
+  DataCache cache("l1d_cache", cache_config, 0, 0, &to_mem);
+  NdpStats stats;
+  Prefetcher prefetcher(STREAM_PREFETCH, 2, 4, 4, &cache, &cache_config,
+                        &stats);
+
+  cache.warm(12 * LINE_SIZE, false, 0);
+  prefetcher.demand_access(10 * LINE_SIZE, MISS);
+  prefetcher.demand_access(11 * LINE_SIZE, MISS);
+  EXPECT_EQ(drain_lines(prefetcher), std::vector<uint64_t>({13}));
+  delete config;
+}
+
+// Two loads with the same stride propose the same line only once, even
+// after the first proposal has left the candidate queue
+TEST(PrefetcherRecentTest, BasicAssertions) {
+  M2NDPConfig* config = make_prefetcher_test_config();
+  CacheConfig cache_config;
+  cache_config.init("N:64:128:4,L:B:f:L:L,A:192:4,32:0,32", config);
+  fifo_pipeline<mem_fetch> to_mem("to_mem", 0, 8);
+  DataCache cache("l1d_cache", cache_config, 0, 0, &to_mem);
+  NdpStats stats;
+  Prefetcher prefetcher(STRIDE_PREFETCH, 1, 2, 4, &cache, &cache_config,
+                        &stats);
+
+  for (uint64_t line = 0; line < 3; line++)
+    prefetcher.train_load(1, line * LINE_SIZE);
+  EXPECT_EQ(drain_lines(prefetcher), std::vector<uint64_t>({4}));
+  for (uint64_t line = 0; line < 3; line++)
+    prefetcher.train_load(2, line * LINE_SIZE);
+  EXPECT_FALSE(prefetcher.has_candidate());
+  prefetcher.train_load(2, 3 * LINE_SIZE);
+  EXPECT_EQ(drain_lines(prefetcher), std::vector<uint64_t>({5}));
+  delete config;
+}
+
+}  // namespace NDPSim
+#endif
@@ -0,0 +1,140 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "common.h"
+#include "kernel_cache.h"
+#include "m2ndp_parser.h"
+#include "register_unit.h"
+#include "gtest/gtest.h"
+
+namespace NDPSim {
+
+static NdpKernel parse_kernel(const std::string& body) {
+  std::string path = "register_unit_test.ndp";
+  std::ofstream file(path);
+  file << "-kernel name = rename\n"
+       << "-kernel id = 0\n"
+       << "\n"
+       << "KERNELBODY:\n"
+       << body;
+  file.close();
+  NdpKernel kernel;
+  M2NDPParser::parse_ndp_kernel(1, path, &kernel, NULL);
+  std::remove(path.c_str());
+  return kernel;
+}
+
+// One kernel body touching every operand class the renamer handles
+static NdpKernel make_rename_kernel() {
+  std::ostringstream file;
+  file << "vsetvli 0, 0, e32, m1, 0\n"
+       << "li x3, 64\n"
+       << "li x5, 128\n"
+       << "li x6, 0\n"
+       << "fmv.w.x f0, x3\n"
+       << "fmv.w.x f1, x5\n"
+       << "vmset.m v0\n"
+       << "vle32.v v1, (ADDR)\n"
+       << "vmv.v.i v2, 1\n"
+       << "vmv.v.x v3, x3\n"
+       << "vadd.vv v4, v1, v2\n"
+       << "vadd.vx v5, v4, x5\n"
+       << "vfadd.vf v6, v4, f0\n"
+       << "vmv.x.s x7, v6\n"
+       << "vfmv.f.s f2, v6\n"
+       << "vfirst.m x8, v0, v0\n"
+       << "vluxei32.v v7, (x3), v2, v0\n"
+       << "vsuxei32.v v7, (x5), v2, v0\n"
+       << "vamoaddei32.v x0, (x6), v2, v1\n"
+       << "vse32.v v7, (ADDR)\n"
+       << "add x9, x3, x5\n"
+       << "ld x10, 8(x6)\n"
+       << "sw x9, (x6)\n"
+       << "famoadd.w x0, f1, (x6)\n"
+       << "fdiv f3, f1, f0\n"
+       << "bge x3, x5, .SKIP0\n"
+       << ".SKIP0\n";
+  return parse_kernel(file.str());
+}
+
+static const NdpInstruction& find_inst(const std::deque<NdpInstruction>& insts,
+                                       Opcode opcode) {
+  for (const NdpInstruction& inst : insts)
+    if (inst.opcode == opcode) return inst;
+  throw std::runtime_error("opcode not in kernel");
+}
+
+// Every operand of a renamed stream names a physical register, and the
+// x register base of indexed stores and vector AMOs is renamed exactly once
+static void check_renamed(const std::deque<NdpInstruction>& insts) {
+  // li x3, li x5, li x6
+  const int x3 = insts[1].dest;
+  const int x5 = insts[2].dest;
+  const int x6 = insts[3].dest;
+  ASSERT_GE(x3, REG_PX_BASE);
+  const NdpInstruction& store = find_inst(insts, VSUXEI32);
+  EXPECT_EQ(store.src[0], x5);
+  EXPECT_GE(store.dest, REG_PV_BASE);
+  EXPECT_GE(store.src[2], REG_PV_BASE);
+  EXPECT_GE(store.src[3], REG_PV_BASE);
+  const NdpInstruction& amo = find_inst(insts, VAMOADDEI32);
+  EXPECT_EQ(amo.src[0], x6);
+  EXPECT_EQ(amo.dest, -1);
+  EXPECT_GE(amo.src[1], REG_PV_BASE);
+  EXPECT_GE(amo.src[2], REG_PV_BASE);
+  const NdpInstruction& load = find_inst(insts, VLUXEI32);
+  EXPECT_EQ(load.src[0], x3);
+  EXPECT_GE(load.dest, REG_PV_BASE);
+  const NdpInstruction& famo = find_inst(insts, FAMOADD);
+  EXPECT_EQ(famo.dest, -1);
+  EXPECT_EQ(famo.src[2], x6);
+}
+
+TEST(RegisterUnitConvertTest, BasicAssertions) {
+  NdpKernel kernel = make_rename_kernel();
+  RegisterUnit register_unit(32, 32, 32);
+  RequestInfo info;
+  info.addr = 0x1000;
+  info.offset = 0;
+  std::deque<NdpInstruction> insts = kernel.kernel_body_insts[0];
+  ASSERT_NO_THROW(register_unit.Convert(insts, 0, &info));
+  check_renamed(insts);
+  register_unit.FreeRegs(0);
+}
+
+// Timing path: registers are bound at RenamePush and each shared instruction
+// is renamed as it is fetched
+TEST(RegisterUnitRenameFetchedTest, BasicAssertions) {
+  NdpKernel kernel = make_rename_kernel();
+  RegisterUnit register_unit(32, 32, 32);
+  RequestInfo info;
+  info.addr = 0x1000;
+  info.offset = 0;
+  InstColumn col;
+  col.insts = &kernel.kernel_body_insts[0];
+  col.req = &info;
+  KernelCache::count_required_regs(*col.insts, col.xregs, col.fregs,
+                                   col.vregs);
+  ASSERT_FALSE(register_unit.RenameFull(&col));
+  ASSERT_NO_THROW(register_unit.RenamePush(&col, 0));
+  ASSERT_EQ(register_unit.RenameTop(), &col);
+  std::deque<NdpInstruction> insts;
+  for (const NdpInstruction& arch_inst : *col.insts) {
+    insts.push_back(arch_inst);
+    ASSERT_NO_THROW(register_unit.RenameFetched(&col, insts.back()));
+  }
+  check_renamed(insts);
+  register_unit.RenamePop();
+  register_unit.FreeRegs(0);
+}
+
+// Only scalar AMOs with a destination other than x0 return a result
+TEST(KernelCacheAmoResultTest, BasicAssertions) {
+  NdpKernel kernel = make_rename_kernel();
+  EXPECT_FALSE(KernelCache::amo_result_used(kernel.kernel_body_insts[0]));
+  kernel = parse_kernel("li x6, 0\nfamoadd.w f4, f1, (x6)\n");
+  EXPECT_TRUE(KernelCache::amo_result_used(kernel.kernel_body_insts[0]));
+}
+
+}  // namespace NDPSim
@@ -0,0 +1,128 @@
+#ifdef TIMING_SIMULATION
+#include "stats_registry.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "ndp_stats.h"
+
+namespace NDPSim {
+
+// The registry is a process-wide singleton, so every test registers its own
+// top-level prefix
+TEST(StatsRegistryTotalsTest, BasicAssertions) {
+  StatsRegistry* registry = StatsRegistry::get();
+  uint64_t hits[3] = {1, 2, 4};
+  uint64_t misses[3] = {8, 16, 32};
+  for (int i = 0; i < 3; i++) {
+    std::string unit = "totals0.ndp" + std::to_string(i);
+    registry->add(unit + ".l1d.hit", &hits[i]);
+    registry->add(unit + ".l1d.miss", &misses[i]);
+  }
+  uint64_t other_hit = 64;
+  registry->add("totals1.ndp3.l1d.hit", &other_hit);
+
+  EXPECT_EQ(registry->sum("l1d.hit", "totals0.ndp"), 7);
+  EXPECT_EQ(registry->sum("l1d.miss", "totals0.ndp"), 56);
+  EXPECT_EQ(registry->sum("l1d.hit", "totals"), 71);
+  EXPECT_EQ(registry->sum("hit", "totals0.ndp1"), 2);
+
+  auto totals = registry->totals("totals0.ndp");
+  ASSERT_EQ(totals.size(), 2);
+  EXPECT_EQ(totals[0].first, "l1d.hit");
+  EXPECT_EQ(totals[0].second, 7);
+  EXPECT_EQ(totals[1].first, "l1d.miss");
+  EXPECT_EQ(totals[1].second, 56);
+
+  // Counters are read when summed, not when registered
+  hits[0] = 11;
+  EXPECT_EQ(registry->totals("totals0.ndp")[0].second, 17);
+}
+
+// A second registration of a name rebinds it to the new counter
+TEST(StatsRegistryDuplicateTest, BasicAssertions) {
+  static uint64_t first = 1, second = 2;
+  StatsRegistry* registry = StatsRegistry::get();
+  size_t size = registry->size();
+  registry->add("duplicate0.ndp0.cycle", &first);
+  registry->add("duplicate0.ndp0.cycle", &second);
+  EXPECT_EQ(registry->size(), size + 1);
+  EXPECT_EQ(registry->sum("cycle", "duplicate0"), 2);
+}
+
+TEST(StatsRegistryRemoveTest, BasicAssertions) {
+  static uint64_t counters[3] = {1, 2, 4};
+  StatsRegistry* registry = StatsRegistry::get();
+  size_t size = registry->size();
+  registry->add("remove0.ndp1.cycle", &counters[0]);
+  registry->add("remove0.ndp1.l1d.hit", &counters[1]);
+  registry->add("remove0.ndp10.cycle", &counters[2]);
+  registry->remove("remove0.ndp1");
+  EXPECT_EQ(registry->size(), size + 1);
+  EXPECT_EQ(registry->sum("cycle", "remove0"), 4);
+  EXPECT_EQ(registry->sum("hit", "remove0"), 0);
+  registry->remove("remove0");
+  EXPECT_EQ(registry->size(), size);
+}
+
+// The Total NDP report sums the units' registered counters
+TEST(StatsRegistryNdpTotalsTest, BasicAssertions) {
+  NdpStats units[2];
+  for (int i = 0; i < 2; i++) {
+    units[i].register_stats("ndp_totals0.ndp" + std::to_string(i));
+    units[i].inc_cycle(10);
+    for (int j = 0; j <= i; j++) units[i].inc_i_unit_issue_count();
+    units[i].add_status(EMPTY_QUEUE);
+  }
+  NdpStats total;
+  total.load_totals("ndp_totals0.ndp");
+  EXPECT_EQ(total.get_i_unit_issue_count(), 3);
+  EXPECT_EQ(StatsRegistry::get()->sum("status.EMPTY_QUEUE", "ndp_totals0"), 2);
+  StatsRegistry::get()->remove("ndp_totals0");
+}
+
+// Runs last in this file: after the first snapshot the name set is frozen
+TEST(StatsRegistrySnapshotTest, BasicAssertions) {
+  static uint64_t counter = 5;
+  StatsRegistry* registry = StatsRegistry::get();
+  registry->add("snapshot0.ndp0.cycle", &counter);
+  std::string path = "stats_registry_test.jsonl";
+  registry->open(path, 10);
+  EXPECT_EQ(registry->next_snapshot(3), 10);
+  EXPECT_EQ(registry->next_snapshot(10), 20);
+  registry->cycle(3);
+  registry->cycle(10);
+  counter = 6;
+  registry->close(12);
+
+  std::ifstream file(path);
+  std::string header, first, last;
+  std::getline(file, header);
+  std::getline(file, first);
+  std::getline(file, last);
+  file.close();
+  std::remove(path.c_str());
+  EXPECT_NE(header.find("\"snapshot0.ndp0.cycle\""), std::string::npos);
+  EXPECT_EQ(first.find("{\"cycle\":10,"), 0);
+  EXPECT_NE(first.find(",5]}"), std::string::npos);
+  EXPECT_EQ(last.find("{\"cycle\":12,"), 0);
+  EXPECT_NE(last.find(",6]}"), std::string::npos);
+
+  // A removed counter keeps its column at its last value until the name is
+  // registered again
+  size_t size = registry->size();
+  registry->remove("snapshot0.ndp0");
+  counter = 7;
+  EXPECT_EQ(registry->size(), size);
+  EXPECT_EQ(registry->sum("cycle", "snapshot0"), 6);
+  registry->add("snapshot0.ndp0.cycle", &counter);
+  EXPECT_EQ(registry->sum("cycle", "snapshot0"), 7);
+
+  EXPECT_EXIT(registry->add("snapshot0.ndp1.cycle", &counter),
+              ::testing::ExitedWithCode(1), "");
+}
+
+}  // namespace NDPSim
+#endif
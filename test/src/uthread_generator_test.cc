@@ -0,0 +1,112 @@
+#ifdef TIMING_SIMULATION
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "uthread_generator.h"
+#include "gtest/gtest.h"
+
+namespace NDPSim {
+
+static LaunchSample make_sample(std::vector<double> windows,
+                                uint64_t skipped) {
+  LaunchSample sample;
+  sample.start_cycle = 100;
+  sample.end_cycle = 1100;
+  sample.finished = true;
+  sample.skipped_uthreads = skipped;
+  sample.window_cycles_per_uthread = windows;
+  return sample;
+}
+
+TEST(LaunchSampleEstimateTest, BasicAssertions) {
+  // No timed window: nothing to extrapolate with
+  LaunchSample none = make_sample({}, 50);
+  EXPECT_EQ(none.mean_cycles_per_uthread(), 0);
+  EXPECT_EQ(none.estimated_cycles(), 1000);
+  EXPECT_EQ(none.confidence_interval(), 0);
+
+  // One window: an estimate but no interval
+  LaunchSample one = make_sample({4.0}, 50);
+  EXPECT_DOUBLE_EQ(one.mean_cycles_per_uthread(), 4.0);
+  EXPECT_DOUBLE_EQ(one.estimated_cycles(), 1000 + 50 * 4.0);
+  EXPECT_EQ(one.confidence_interval(), 0);
+
+  // Equal windows: no spread
+  LaunchSample flat = make_sample({3.0, 3.0, 3.0}, 10);
+  EXPECT_DOUBLE_EQ(flat.estimated_cycles(), 1030);
+  EXPECT_DOUBLE_EQ(flat.confidence_interval(), 0);
+
+  // Still running: no end cycle to count from
+  LaunchSample running = make_sample({3.0}, 10);
+  running.end_cycle = 0;
+  running.finished = false;
+  EXPECT_EQ(running.estimated_cycles(), 0);
+}
+
+TEST(LaunchSampleConfidenceTest, BasicAssertions) {
+  // Rates 2, 4, 6, 8: mean 5, sample variance 20/3
+  LaunchSample sample = make_sample({2.0, 4.0, 6.0, 8.0}, 100);
+  EXPECT_DOUBLE_EQ(sample.mean_cycles_per_uthread(), 5.0);
+  EXPECT_DOUBLE_EQ(sample.estimated_cycles(), 1000 + 100 * 5.0);
+  double half_width = 1.96 * std::sqrt(20.0 / 3 / 4) * 100;
+  EXPECT_DOUBLE_EQ(sample.confidence_interval(), half_width);
+
+  // Scales with the skipped uthreads, none skipped means an exact run
+  EXPECT_DOUBLE_EQ(make_sample({2.0, 4.0, 6.0, 8.0}, 200).confidence_interval(),
+                   2 * half_width);
+  EXPECT_EQ(make_sample({2.0, 4.0, 6.0, 8.0}, 0).confidence_interval(), 0);
+
+  // Shrinks as 1/sqrt(n) for the same spread
+  LaunchSample twice = make_sample({2.0, 4.0, 6.0, 8.0, 2.0, 4.0, 6.0, 8.0},
+                                   100);
+  double var = 20.0 * 2 / 7;
+  EXPECT_DOUBLE_EQ(twice.confidence_interval(),
+                   1.96 * std::sqrt(var / 8) * 100);
+}
+
+static M2NDPConfig* make_matching_config(int num_ndp_units) {
+  std::string path = "uthread_generator_test.config";
+  std::ofstream file(path);
+  file << "functional_sim=0\n"
+       << "num_ndp_units=" << num_ndp_units << "\n";
+  file.close();
+  M2NDPConfig* config = new M2NDPConfig(path, 1);
+  std::remove(path.c_str());
+  return config;
+}
+
+// The stride-window walks agree with testing every packet of the launch grid
+// with check_addr_match, for unaligned bases and range ends
+TEST(UThreadGeneratorMatchTest, BasicAssertions) {
+  for (int num_units : {1, 3, 4}) {
+    M2NDPConfig* config = make_matching_config(num_units);
+    for (int ndp_id : {0, 1, 2, 5}) {
+      UThreadGenerator generator(config, ndp_id, NULL);
+      for (uint64_t base : {0, 32, 224, 1000, 4096 + 8}) {
+        for (uint64_t offset : {0, 1, 31, 32, 255, 256, 777}) {
+          uint64_t addr = base + offset;
+          for (uint64_t size : {0, 32, 100, 256, 1024, 3000, 9000}) {
+            uint64_t end = addr + size;
+            uint64_t first = end, count = 0;
+            for (uint64_t packet = base; packet < end; packet += PACKET_SIZE) {
+              if (packet < addr || !generator.check_addr_match(packet))
+                continue;
+              if (first == end) first = packet;
+              count++;
+            }
+            ASSERT_EQ(generator.next_matched_addr(base, addr, end), first);
+            ASSERT_EQ(generator.count_matched_packets(base, addr, end), count);
+            if (offset == 0)
+              ASSERT_EQ(generator.count_matched_packets(base, size), count);
+          }
+        }
+      }
+    }
+    delete config;
+  }
+}
+
+}  // namespace NDPSim
+#endif
@@ -0,0 +1,69 @@
+#include <cmath>
+#include <limits>
+
+#include "common.h"
+#include "vector_data.h"
+#include "gtest/gtest.h"
+
+namespace NDPSim {
+
+TEST(VectorDataFloatLanesTest, BasicAssertions) {
+  // lmul 8 spills past the inline buffer and leaves a scalar tail
+  VectorData lhs(32, 8);
+  VectorData rhs(32, 8);
+  lhs.SetVlen(61);
+  rhs.SetVlen(61);
+  for (int i = 0; i < 61; i++) {
+    lhs.SetData(i * 0.5f, i);
+    rhs.SetData(3.0f - i, i);
+  }
+  VectorData sum = lhs + rhs;
+  VectorData product = lhs * rhs;
+  VectorData max = lhs.Max(rhs);
+  float scalar = 2.0f;
+  VectorData shifted = lhs - scalar;
+  for (int i = 0; i < 61; i++) {
+    ASSERT_EQ(sum.GetFloatData(i), i * 0.5f + (3.0f - i));
+    ASSERT_EQ(product.GetFloatData(i), i * 0.5f * (3.0f - i));
+    ASSERT_EQ(max.GetFloatData(i), std::max(i * 0.5f, 3.0f - i));
+    ASSERT_EQ(shifted.GetFloatData(i), i * 0.5f - 2.0f);
+  }
+  ASSERT_EQ(sum.GetType(), FLOAT32);
+}
+
+TEST(VectorDataMaxOrderTest, BasicAssertions) {
+  VectorData lhs(32, 1);
+  VectorData rhs(32, 1);
+  for (uint32_t i = 0; i < PACKET_ENTRIES; i++) {
+    lhs.SetData(std::numeric_limits<float>::quiet_NaN(), i);
+    rhs.SetData(-0.0f, i);
+  }
+  lhs.SetData(0.0f, 0);
+  // std::max keeps lhs when the lanes do not compare
+  VectorData max = lhs.Max(rhs);
+  VectorData min = lhs.Min(rhs);
+  ASSERT_FALSE(std::signbit(max.GetFloatData(0)));
+  ASSERT_FALSE(std::signbit(min.GetFloatData(0)));
+  ASSERT_TRUE(std::isnan(max.GetFloatData(1)));
+  ASSERT_TRUE(std::isnan(min.GetFloatData(1)));
+}
+
+TEST(VectorDataIntLanesTest, BasicAssertions) {
+  VectorData lhs(32, 2);
+  VectorData rhs(32, 2);
+  for (int i = 0; i < 16; i++) {
+    lhs.SetData(i * 1000003, i);
+    rhs.SetData(7 - i, i);
+  }
+  int32_t scalar = -3;
+  VectorData product = lhs * rhs;
+  VectorData min = lhs.Min(rhs);
+  VectorData added = lhs + scalar;
+  for (int i = 0; i < 16; i++) {
+    ASSERT_EQ(product.GetIntData(i), i * 1000003 * (7 - i));
+    ASSERT_EQ(min.GetIntData(i), std::min(i * 1000003, 7 - i));
+    ASSERT_EQ(added.GetIntData(i), i * 1000003 - 3);
+  }
+  ASSERT_EQ(product.GetType(), INT32);
+}
+}  // namespace NDPSim